@@ -324,7 +324,7 @@ u8 util_freelist_free(freelist* list, alloc_data* data, u64* currently_allocated
     return true;
 }
 
-u8 freelist_multiple_alloc_and_free_random(void) {
+static u8 freelist_alloc_and_free_random(freelist_mode mode) {
     freelist list;
 
     // Pick random sizes.
@@ -344,11 +344,11 @@ u8 freelist_multiple_alloc_and_free_random(void) {
 
     // Get the memory requirement
     u64 memory_requirement = 0;
-    freelist_create(total_size, &memory_requirement, 0, 0);
+    freelist_create_with_mode(total_size, mode, &memory_requirement, 0, 0);
 
     // Allocate and create the freelist.
     void* block = kallocate(memory_requirement, MEMORY_TAG_ENGINE);
-    freelist_create(total_size, &memory_requirement, block, &list);
+    freelist_create_with_mode(total_size, mode, &memory_requirement, block, &list);
 
     // Verify free space.
     u64 free_space = freelist_free_space(&list);
@@ -409,6 +409,189 @@ u8 freelist_multiple_alloc_and_free_random(void) {
     return true;
 }
 
+u8 freelist_multiple_alloc_and_free_random(void) {
+    return freelist_alloc_and_free_random(FREELIST_MODE_LINEAR);
+}
+
+u8 freelist_tlsf_multiple_alloc_and_free_random(void) {
+    return freelist_alloc_and_free_random(FREELIST_MODE_TLSF);
+}
+
+u8 freelist_tlsf_should_coalesce_freed_blocks(void) {
+    freelist list;
+    u64 memory_requirement = 0;
+    u64 total_size = 512;
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, 0, 0);
+    void* block = kallocate(memory_requirement, MEMORY_TAG_ENGINE);
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, block, &list);
+
+    // Fill the list with 8 blocks.
+    u64 offsets[8];
+    for (u32 i = 0; i < 8; ++i) {
+        expect_to_be_true(freelist_allocate_block(&list, 64, &offsets[i]));
+    }
+    expect_should_be(0, freelist_free_space(&list));
+    u64 extra = 0;
+    expect_to_be_false(freelist_allocate_block(&list, 1, &extra));
+
+    // Free in an order which requires merging with left, right and both neighbours.
+    u32 order[8] = {1, 3, 2, 6, 4, 5, 0, 7};
+    for (u32 i = 0; i < 8; ++i) {
+        expect_to_be_true(freelist_free_block(&list, 64, offsets[order[i]]));
+    }
+    expect_should_be(total_size, freelist_free_space(&list));
+
+    // Everything should have merged back into one range.
+    u64 offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block(&list, total_size, &offset));
+    expect_should_be(0, offset);
+
+    freelist_destroy(&list);
+    expect_should_be(0, list.memory);
+    kfree(block, memory_requirement, MEMORY_TAG_ENGINE);
+    return true;
+}
+
+// Resizes the list to its current size when it runs low on room to track free ranges, as owners do.
+static void util_freelist_grow_if_needed(freelist* list, u64 total_size, void** block, u64* memory_requirement) {
+    if (freelist_should_grow(list)) {
+        u64 new_requirement = 0;
+        freelist_resize(list, &new_requirement, 0, total_size, 0);
+        void* new_block = kallocate(new_requirement, MEMORY_TAG_ENGINE);
+        void* old_block = 0;
+        freelist_resize(list, &new_requirement, new_block, total_size, &old_block);
+        kfree(old_block, *memory_requirement, MEMORY_TAG_ENGINE);
+        *block = new_block;
+        *memory_requirement = new_requirement;
+    }
+}
+
+u8 freelist_tlsf_allocations_should_not_overlap(void) {
+    freelist list;
+    u64 memory_requirement = 0;
+    const u64 total_size = KIBIBYTES(64);
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, 0, 0);
+    void* block = kallocate(memory_requirement, MEMORY_TAG_ENGINE);
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, block, &list);
+
+    // Track which bytes are in use to catch any range being handed out twice.
+    u8* used = kallocate(total_size, MEMORY_TAG_ENGINE);
+    const u32 slot_count = 256;
+    alloc_data datas[256];
+    for (u32 i = 0; i < slot_count; ++i) {
+        datas[i].size = 0;
+        datas[i].offset = INVALID_ID;
+    }
+
+    for (u32 op = 0; op < 20000; ++op) {
+        alloc_data* d = &datas[krandom_in_range(0, slot_count - 1)];
+        if (d->offset == INVALID_ID) {
+            d->size = (u64)krandom_in_range(1, 512);
+            if (freelist_allocate_block(&list, d->size, &d->offset)) {
+                b8 in_range = d->offset + d->size <= total_size;
+                expect_to_be_true(in_range);
+                for (u64 b = d->offset; b < d->offset + d->size; ++b) {
+                    expect_should_be(0, used[b]);
+                    used[b] = 1;
+                }
+            } else {
+                d->offset = INVALID_ID;
+            }
+        } else {
+            util_freelist_grow_if_needed(&list, total_size, &block, &memory_requirement);
+            expect_to_be_true(freelist_free_block(&list, d->size, d->offset));
+            kzero_memory(used + d->offset, d->size);
+            d->offset = INVALID_ID;
+        }
+    }
+
+    for (u32 i = 0; i < slot_count; ++i) {
+        if (datas[i].offset != INVALID_ID) {
+            util_freelist_grow_if_needed(&list, total_size, &block, &memory_requirement);
+            expect_to_be_true(freelist_free_block(&list, datas[i].size, datas[i].offset));
+        }
+    }
+    expect_should_be(total_size, freelist_free_space(&list));
+
+    kfree(used, total_size, MEMORY_TAG_ENGINE);
+    freelist_destroy(&list);
+    kfree(block, memory_requirement, MEMORY_TAG_ENGINE);
+    return true;
+}
+
+u8 freelist_tlsf_should_resize(void) {
+    freelist list;
+    u64 memory_requirement = 0;
+    u64 total_size = 512;
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, 0, 0);
+    void* block = kallocate(memory_requirement, MEMORY_TAG_ENGINE);
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, block, &list);
+
+    // Leave a free range at the end, which should merge with the new space.
+    u64 offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block(&list, 448, &offset));
+
+    u64 new_size = 1024;
+    u64 new_requirement = 0;
+    expect_to_be_true(freelist_resize(&list, &new_requirement, 0, new_size, 0));
+    void* new_block = kallocate(new_requirement, MEMORY_TAG_ENGINE);
+    void* old_block = 0;
+    expect_to_be_true(freelist_resize(&list, &new_requirement, new_block, new_size, &old_block));
+    expect_should_be(block, old_block);
+    kfree(old_block, memory_requirement, MEMORY_TAG_ENGINE);
+
+    expect_should_be(new_size - 448, freelist_free_space(&list));
+    u64 big_offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block(&list, new_size - 448, &big_offset));
+    expect_should_be(448, big_offset);
+
+    freelist_destroy(&list);
+    kfree(new_block, new_requirement, MEMORY_TAG_ENGINE);
+    return true;
+}
+
+u8 freelist_tlsf_should_grow_to_track_fragments(void) {
+    freelist list;
+    u64 memory_requirement = 0;
+    const u64 total_size = KIBIBYTES(64);
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, 0, 0);
+    void* block = kallocate(memory_requirement, MEMORY_TAG_ENGINE);
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &memory_requirement, block, &list);
+    u64 initial_requirement = memory_requirement;
+
+    // Fill the list with small blocks, then free every other one so no frees can merge.
+    const u64 block_size = 64;
+    const u64 block_count = total_size / block_size;
+    for (u64 i = 0; i < block_count; ++i) {
+        u64 offset = INVALID_ID;
+        expect_to_be_true(freelist_allocate_block(&list, block_size, &offset));
+        expect_should_be(i * block_size, offset);
+    }
+    expect_to_be_false(freelist_should_grow(&list));
+    for (u64 i = 0; i < block_count; i += 2) {
+        util_freelist_grow_if_needed(&list, total_size, &block, &memory_requirement);
+        expect_to_be_true(freelist_free_block(&list, block_size, i * block_size));
+    }
+    expect_should_be(total_size / 2, freelist_free_space(&list));
+    // Growing is only done when the fragments call for it.
+    b8 grew = memory_requirement > initial_requirement;
+    expect_to_be_true(grew);
+
+    // Free the rest, which merges everything back into a single range.
+    for (u64 i = 1; i < block_count; i += 2) {
+        util_freelist_grow_if_needed(&list, total_size, &block, &memory_requirement);
+        expect_to_be_true(freelist_free_block(&list, block_size, i * block_size));
+    }
+    expect_should_be(total_size, freelist_free_space(&list));
+    u64 offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block(&list, total_size, &offset));
+    expect_should_be(0, offset);
+
+    freelist_destroy(&list);
+    kfree(block, memory_requirement, MEMORY_TAG_ENGINE);
+    return true;
+}
+
 void freelist_register_tests(void) {
     test_manager_register_test(freelist_should_create_and_destroy, "Freelist should create and destroy");
     test_manager_register_test(freelist_should_allocate_one_and_free_one, "Freelist allocate and free one entry.");
@@ -416,4 +599,9 @@ void freelist_register_tests(void) {
     test_manager_register_test(freelist_should_allocate_one_and_free_multi_varying_sizes, "Freelist allocate and free multiple entries of varying sizes.");
     test_manager_register_test(freelist_should_allocate_to_full_and_fail_to_allocate_more, "Freelist allocate to full and fail when trying to allocate more.");
     test_manager_register_test(freelist_multiple_alloc_and_free_random, "Freelist should randomly allocate and free.");
+    test_manager_register_test(freelist_tlsf_multiple_alloc_and_free_random, "Freelist (TLSF) should randomly allocate and free.");
+    test_manager_register_test(freelist_tlsf_should_coalesce_freed_blocks, "Freelist (TLSF) should coalesce freed blocks.");
+    test_manager_register_test(freelist_tlsf_allocations_should_not_overlap, "Freelist (TLSF) allocations should never overlap.");
+    test_manager_register_test(freelist_tlsf_should_resize, "Freelist (TLSF) should resize.");
+    test_manager_register_test(freelist_tlsf_should_grow_to_track_fragments, "Freelist (TLSF) should grow to track fragments.");
 }
@@ -0,0 +1,164 @@
+#include "hashmap_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <containers/hashmap.h>
+#include <defines.h>
+
+u8 hashmap_should_create_and_destroy(void) {
+    hashmap map;
+    expect_to_be_true(hashmap_create(sizeof(u64), 3, &map));
+
+    expect_should_not_be(0, map.keys);
+    expect_should_be(sizeof(u64), map.element_size);
+    expect_should_be(0, map.count);
+    // Capacity is always a power of 2.
+    expect_should_be(0, (map.capacity & (map.capacity - 1)));
+
+    hashmap_destroy(&map);
+
+    expect_should_be(0, map.keys);
+    expect_should_be(0, map.element_size);
+    expect_should_be(0, map.capacity);
+
+    return true;
+}
+
+u8 hashmap_should_set_get_and_update(void) {
+    hashmap map;
+    hashmap_create(sizeof(u64), 3, &map);
+
+    u64 key = hashmap_key_from_string("test1");
+    u64 testval1 = 23;
+    expect_to_be_true(hashmap_set(&map, key, &testval1));
+    u64 get_testval_1 = 0;
+    expect_to_be_true(hashmap_get(&map, key, &get_testval_1));
+    expect_should_be(testval1, get_testval_1);
+
+    // Updating an existing key should not add an entry.
+    u64 testval2 = 99;
+    expect_to_be_true(hashmap_set(&map, key, &testval2));
+    expect_should_be(1, map.count);
+    u64* ref = hashmap_get_ref(&map, key);
+    expect_should_not_be(0, ref);
+    expect_should_be(testval2, *ref);
+
+    // Non-existent entries should not be found.
+    u64 other = hashmap_key_from_string("test2");
+    expect_to_be_false(hashmap_get(&map, other, &get_testval_1));
+    expect_to_be_false(hashmap_contains(&map, other));
+    expect_should_be(0, hashmap_get_ref(&map, other));
+
+    hashmap_destroy(&map);
+    return true;
+}
+
+u8 hashmap_should_keep_colliding_keys(void) {
+    hashmap map;
+    hashmap_create(sizeof(u32), 4, &map);
+
+    // Keys which differ only in bits above the slot mask would collide without mixing, and
+    // some will collide regardless. Every one of them must survive.
+    const u32 count = 64;
+    for (u32 i = 0; i < count; ++i) {
+        u64 key = (u64)i << 40;
+        expect_to_be_true(hashmap_set(&map, key, &i));
+    }
+    expect_should_be(count, map.count);
+
+    for (u32 i = 0; i < count; ++i) {
+        u32 value = INVALID_ID;
+        expect_to_be_true(hashmap_get(&map, (u64)i << 40, &value));
+        expect_should_be(i, value);
+    }
+
+    hashmap_destroy(&map);
+    return true;
+}
+
+u8 hashmap_should_grow_and_remove(void) {
+    hashmap map;
+    hashmap_create(sizeof(u64), 0, &map);
+    u32 initial_capacity = map.capacity;
+
+    const u64 count = 10000;
+    for (u64 i = 0; i < count; ++i) {
+        u64 value = i * 3;
+        hashmap_set(&map, i, &value);
+    }
+    expect_should_be(count, map.count);
+    b8 grew = map.capacity > initial_capacity;
+    expect_to_be_true(grew);
+    // Load factor must stay at or below 7/8.
+    b8 within_load_factor = ((u64)map.count * 8) <= ((u64)map.capacity * 7);
+    expect_to_be_true(within_load_factor);
+
+    // Remove every even key.
+    for (u64 i = 0; i < count; i += 2) {
+        u64 removed = 0;
+        expect_to_be_true(hashmap_remove(&map, i, &removed));
+        expect_should_be(i * 3, removed);
+    }
+    expect_should_be(count / 2, map.count);
+    expect_to_be_false(hashmap_remove(&map, 0, 0));
+
+    // Odd keys should all remain, even keys should all be gone.
+    for (u64 i = 0; i < count; ++i) {
+        u64 value = 0;
+        b8 found = hashmap_get(&map, i, &value);
+        if (i % 2) {
+            expect_to_be_true(found);
+            expect_should_be(i * 3, value);
+        } else {
+            expect_to_be_false(found);
+        }
+    }
+
+    // Re-adding removed keys should work as normal.
+    for (u64 i = 0; i < count; i += 2) {
+        hashmap_set(&map, i, &i);
+    }
+    expect_should_be(count, map.count);
+
+    hashmap_clear(&map);
+    expect_should_be(0, map.count);
+    expect_to_be_false(hashmap_contains(&map, 1));
+
+    hashmap_destroy(&map);
+    return true;
+}
+
+u8 hashmap_should_iterate_all_entries(void) {
+    hashmap map;
+    hashmap_create(sizeof(u32), 16, &map);
+
+    const u32 count = 100;
+    for (u32 i = 0; i < count; ++i) {
+        u32 value = i + 1;
+        hashmap_set(&map, i, &value);
+    }
+
+    u32 iterator = 0;
+    u64 key = 0;
+    void* value = 0;
+    u32 visited = 0;
+    u64 key_sum = 0;
+    while (hashmap_next(&map, &iterator, &key, &value)) {
+        expect_should_be(key + 1, *(u32*)value);
+        key_sum += key;
+        visited++;
+    }
+    expect_should_be(count, visited);
+    expect_should_be((count * (count - 1)) / 2, key_sum);
+
+    hashmap_destroy(&map);
+    return true;
+}
+
+void hashmap_register_tests(void) {
+    test_manager_register_test(hashmap_should_create_and_destroy, "Hashmap should create and destroy");
+    test_manager_register_test(hashmap_should_set_get_and_update, "Hashmap should set, get and update");
+    test_manager_register_test(hashmap_should_keep_colliding_keys, "Hashmap should keep all colliding keys");
+    test_manager_register_test(hashmap_should_grow_and_remove, "Hashmap should grow and remove entries");
+    test_manager_register_test(hashmap_should_iterate_all_entries, "Hashmap should iterate all entries");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void hashmap_register_tests(void);
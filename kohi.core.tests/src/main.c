@@ -1,17 +1,25 @@
 #include <logger.h>
+#include <strings/kstring.h>
 
 #include "containers/array_tests.h"
 #include "containers/darray_tests.h"
 #include "containers/freelist_tests.h"
+#include "containers/hashmap_tests.h"
 #include "containers/hashtable_tests.h"
 #include "containers/stackarray_tests.h"
+#include "math/bvh_tests.h"
+#include "math/kmath_tests.h"
 #include "memory/dynamic_allocator_tests.h"
+#include "memory/frame_arena_tests.h"
+#include "memory/kmemory_tests.h"
 #include "memory/linear_allocator_tests.h"
+#include "memory/pool_allocator_tests.h"
 #include "parsers/kson_parser_tests.h"
 #include "strings/string_tests.h"
 #include "test_manager.h"
+#include "utils/ksort_tests.h"
 
-int main(void) {
+int main(int argc, char** argv) {
     // Always initalize the test manager first.
     test_manager_init();
 
@@ -23,14 +31,34 @@ int main(void) {
     kson_parser_register_tests();
     linear_allocator_register_tests();
     hashtable_register_tests();
+    hashmap_register_tests();
     freelist_register_tests();
     dynamic_allocator_register_tests();
+    kmemory_register_tests();
+    pool_allocator_register_tests();
+    frame_arena_register_tests();
+    bvh_register_tests();
+    kmath_register_tests();
+    ksort_register_tests();
     string_register_tests();
 
-    KDEBUG("Starting tests...");
+    // Benchmarks are only run when asked for, in place of the tests.
+    b8 run_benchmarks = false;
+    for (i32 i = 1; i < argc; ++i) {
+        if (strings_equal(argv[i], "--bench")) {
+            run_benchmarks = true;
+        }
+    }
 
-    // Execute tests
-    test_manager_run_tests();
+    if (run_benchmarks) {
+        KDEBUG("Starting benchmarks...");
+        test_manager_run_benchmarks();
+    } else {
+        KDEBUG("Starting tests...");
+
+        // Execute tests
+        test_manager_run_tests();
+    }
 
     return 0;
 }
@@ -0,0 +1,282 @@
+#include "bvh_tests.h"
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <containers/darray.h>
+#include <defines.h>
+#include <math/bvh.h>
+#include <math/geometry_3d.h>
+#include <math/kmath.h>
+#include <memory/kmemory.h>
+#include <platform/platform.h>
+
+#define BVH_TEST_COUNT 2000
+#define BVH_BENCH_COUNT 20000
+
+static extents_3d random_box(f32 world_size) {
+    vec3 center = {kfrandom_in_range(-world_size, world_size), kfrandom_in_range(-world_size, world_size), kfrandom_in_range(-world_size, world_size)};
+    vec3 half = {kfrandom_in_range(0.1f, 2.0f), kfrandom_in_range(0.1f, 2.0f), kfrandom_in_range(0.1f, 2.0f)};
+    return (extents_3d){vec3_sub(center, half), vec3_add(center, half)};
+}
+
+// Walks the tree, checking links, heights and bounds. Returns the number of leaves found.
+static u32 validate_node(const bvh* t, u32 index, u32 parent, b8* valid) {
+    const bvh_node* node = &t->nodes[index];
+    if (node->parent != parent) {
+        KERROR("Node %u has parent %u, expected %u.", index, node->parent, parent);
+        *valid = false;
+    }
+    if (node->left == INVALID_ID) {
+        if (node->height != 0) {
+            *valid = false;
+        }
+        return 1;
+    }
+
+    const bvh_node* left = &t->nodes[node->left];
+    const bvh_node* right = &t->nodes[node->right];
+    if (node->height != 1 + KMAX(left->height, right->height)) {
+        KERROR("Node %u has the wrong height.", index);
+        *valid = false;
+    }
+    for (u32 i = 0; i < 3; ++i) {
+        f32 min = KMIN(left->aabb.min.elements[i], right->aabb.min.elements[i]);
+        f32 max = KMAX(left->aabb.max.elements[i], right->aabb.max.elements[i]);
+        if (node->aabb.min.elements[i] != min || node->aabb.max.elements[i] != max) {
+            KERROR("Node %u does not exactly bound its children.", index);
+            *valid = false;
+        }
+    }
+    return validate_node(t, node->left, index, valid) + validate_node(t, node->right, index, valid);
+}
+
+static b8 validate(const bvh* t) {
+    if (t->root == INVALID_ID) {
+        return t->leaf_count == 0;
+    }
+    b8 valid = true;
+    u32 leaf_count = validate_node(t, t->root, INVALID_ID, &valid);
+    if (leaf_count != t->leaf_count) {
+        KERROR("Found %u leaves, expected %u.", leaf_count, t->leaf_count);
+        valid = false;
+    }
+    // Rotations keep the tree close to balanced, so it should never be much deeper than a perfectly balanced one.
+    f32 balanced_height = klog2((f32)leaf_count);
+    if (t->nodes[t->root].height > (i32)(balanced_height * 2.0f) + 1) {
+        KERROR("Tree height %i is too large for %u leaves.", t->nodes[t->root].height, leaf_count);
+        valid = false;
+    }
+    return valid;
+}
+
+// Checks that a query returned exactly the expected set, once each.
+static b8 results_match(u64* results, const b8* expected, u32 count) {
+    b8* seen = kallocate(sizeof(b8) * count, MEMORY_TAG_ARRAY);
+    b8 match = true;
+    u32 result_count = darray_length(results);
+    u32 expected_count = 0;
+    for (u32 i = 0; i < result_count; ++i) {
+        u64 index = results[i];
+        if (index >= count || seen[index] || !expected[index]) {
+            match = false;
+        } else {
+            seen[index] = true;
+        }
+    }
+    for (u32 i = 0; i < count; ++i) {
+        expected_count += expected[i] ? 1 : 0;
+    }
+    if (result_count != expected_count) {
+        KERROR("Query returned %u results, expected %u.", result_count, expected_count);
+        match = false;
+    }
+    kfree(seen, sizeof(b8) * count, MEMORY_TAG_ARRAY);
+    return match;
+}
+
+u8 bvh_should_stay_valid_through_inserts_updates_and_removes(void) {
+    bvh t;
+    expect_to_be_true(bvh_create(0, 0.5f, &t));
+
+    bvh_id* ids = kallocate(sizeof(bvh_id) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+        ids[i] = bvh_insert(&t, random_box(100.0f), i);
+    }
+    expect_should_be(BVH_TEST_COUNT, t.leaf_count);
+    expect_to_be_true(validate(&t));
+
+    // Small moves stay inside the enlarged boxes, large ones force a reinsert.
+    u32 reinsert_count = 0;
+    for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+        extents_3d box = t.nodes[ids[i]].aabb;
+        vec3 shrink = vec3_mul_scalar(vec3_one(), 0.25f);
+        box = (extents_3d){vec3_add(box.min, shrink), vec3_sub(box.max, shrink)};
+        expect_to_be_false(bvh_update(&t, ids[i], box));
+        if (bvh_update(&t, ids[i], random_box(100.0f))) {
+            reinsert_count++;
+        }
+    }
+    expect_should_be(BVH_TEST_COUNT, reinsert_count);
+    expect_to_be_true(validate(&t));
+
+    // Remove every other leaf.
+    for (u32 i = 0; i < BVH_TEST_COUNT; i += 2) {
+        expect_should_be(i, bvh_user_data_get(&t, ids[i]));
+        bvh_remove(&t, ids[i]);
+    }
+    expect_should_be(BVH_TEST_COUNT / 2, t.leaf_count);
+    expect_to_be_true(validate(&t));
+
+    // Freed nodes should be reused rather than growing the pool.
+    u32 capacity = t.capacity;
+    for (u32 i = 0; i < BVH_TEST_COUNT; i += 2) {
+        ids[i] = bvh_insert(&t, random_box(100.0f), i);
+    }
+    expect_should_be(capacity, t.capacity);
+    expect_to_be_true(validate(&t));
+
+    for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+        bvh_remove(&t, ids[i]);
+    }
+    expect_should_be(INVALID_ID, t.root);
+    expect_should_be(0, t.leaf_count);
+
+    kfree(ids, sizeof(bvh_id) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+    bvh_destroy(&t);
+    return true;
+}
+
+u8 bvh_queries_should_match_brute_force(void) {
+    // With no margin, the tree's boxes are the exact boxes, so results should match exactly.
+    bvh t;
+    expect_to_be_true(bvh_create(BVH_TEST_COUNT * 2, 0.0f, &t));
+
+    extents_3d* boxes = kallocate(sizeof(extents_3d) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+    b8* expected = kallocate(sizeof(b8) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+        boxes[i] = random_box(100.0f);
+        bvh_insert(&t, boxes[i], i);
+    }
+
+    for (u32 q = 0; q < 20; ++q) {
+        // Box query.
+        extents_3d query_box = random_box(100.0f);
+        query_box.max = vec3_add(query_box.max, (vec3){20.0f, 20.0f, 20.0f});
+        for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+            expected[i] = boxes[i].min.x <= query_box.max.x && boxes[i].max.x >= query_box.min.x &&
+                          boxes[i].min.y <= query_box.max.y && boxes[i].max.y >= query_box.min.y &&
+                          boxes[i].min.z <= query_box.max.z && boxes[i].max.z >= query_box.min.z;
+        }
+        u64* results = darray_create(u64);
+        bvh_query_aabb(&t, query_box, &results);
+        expect_to_be_true(results_match(results, expected, BVH_TEST_COUNT));
+        darray_clear(results);
+
+        // Ray query, from outside the world towards a random point in it.
+        vec3 origin = {kfrandom_in_range(-150.0f, 150.0f), 150.0f, kfrandom_in_range(-150.0f, 150.0f)};
+        vec3 target = {kfrandom_in_range(-50.0f, 50.0f), 0.0f, kfrandom_in_range(-50.0f, 50.0f)};
+        ray r = ray_create(origin, vec3_normalized(vec3_sub(target, origin)));
+        for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+            vec3 point;
+            expected[i] = raycast_aabb(boxes[i], &r, &point);
+        }
+        bvh_query_ray(&t, &r, K_FLOAT_MAX, &results);
+        expect_to_be_true(results_match(results, expected, BVH_TEST_COUNT));
+        darray_clear(results);
+
+        // Frustum query.
+        vec3 position = {kfrandom_in_range(-50.0f, 50.0f), kfrandom_in_range(-50.0f, 50.0f), kfrandom_in_range(-50.0f, 50.0f)};
+        vec3 forward = vec3_normalized((vec3){kfrandom_in_range(-1.0f, 1.0f), kfrandom_in_range(-1.0f, 1.0f), -1.0f});
+        vec3 right = vec3_normalized(vec3_cross(forward, vec3_up()));
+        vec3 up = vec3_cross(right, forward);
+        frustum f = frustum_create(&position, &forward, &right, &up, 1.6f, deg_to_rad(60.0f), 0.1f, 80.0f);
+        for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+            vec3 center = extents_3d_half(boxes[i]);
+            vec3 half_extents = vec3_mul_scalar(vec3_sub(boxes[i].max, boxes[i].min), 0.5f);
+            expected[i] = frustum_intersects_aabb(&f, &center, &half_extents);
+        }
+        bvh_query_frustum(&t, &f, &results);
+        expect_to_be_true(results_match(results, expected, BVH_TEST_COUNT));
+        darray_clear(results);
+
+        // Line query. Results are conservative, so only check that nothing is missed.
+        f32 radius = 10.0f;
+        bvh_query_line(&t, position, forward, radius, &results);
+        b8* found = kallocate(sizeof(b8) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+        u32 result_count = darray_length(results);
+        for (u32 i = 0; i < result_count; ++i) {
+            found[results[i]] = true;
+        }
+        for (u32 i = 0; i < BVH_TEST_COUNT; ++i) {
+            // Any box with its center within range is certainly within range.
+            vec3 center = extents_3d_half(boxes[i]);
+            if (vec3_distance_to_line(center, position, forward) <= radius) {
+                expect_to_be_true(found[i]);
+            }
+        }
+        kfree(found, sizeof(b8) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+        darray_destroy(results);
+    }
+
+    kfree(boxes, sizeof(extents_3d) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+    kfree(expected, sizeof(b8) * BVH_TEST_COUNT, MEMORY_TAG_ARRAY);
+    bvh_destroy(&t);
+    return true;
+}
+
+u8 bvh_raycast_benchmark(void) {
+    bvh t;
+    expect_to_be_true(bvh_create(BVH_BENCH_COUNT * 2, 0.1f, &t));
+    extents_3d* boxes = kallocate(sizeof(extents_3d) * BVH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < BVH_BENCH_COUNT; ++i) {
+        boxes[i] = random_box(500.0f);
+        bvh_insert(&t, boxes[i], i);
+    }
+
+    const u32 ray_count = 1000;
+    ray* rays = kallocate(sizeof(ray) * ray_count, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < ray_count; ++i) {
+        vec3 origin = {kfrandom_in_range(-600.0f, 600.0f), 600.0f, kfrandom_in_range(-600.0f, 600.0f)};
+        vec3 target = {kfrandom_in_range(-500.0f, 500.0f), 0.0f, kfrandom_in_range(-500.0f, 500.0f)};
+        rays[i] = ray_create(origin, vec3_normalized(vec3_sub(target, origin)));
+    }
+
+    u32 brute_hits = 0;
+    f64 start = platform_get_absolute_time();
+    for (u32 r = 0; r < ray_count; ++r) {
+        for (u32 i = 0; i < BVH_BENCH_COUNT; ++i) {
+            vec3 point;
+            if (raycast_aabb(boxes[i], &rays[r], &point)) {
+                brute_hits++;
+            }
+        }
+    }
+    f64 brute_time = platform_get_absolute_time() - start;
+
+    u64* results = darray_reserve(u64, 256);
+    u32 bvh_candidates = 0;
+    start = platform_get_absolute_time();
+    for (u32 r = 0; r < ray_count; ++r) {
+        darray_clear(results);
+        bvh_query_ray(&t, &rays[r], K_FLOAT_MAX, &results);
+        bvh_candidates += darray_length(results);
+    }
+    f64 bvh_time = platform_get_absolute_time() - start;
+
+    // The enlarged boxes can only add candidates, never lose hits.
+    b8 no_hits_lost = bvh_candidates >= brute_hits;
+    expect_to_be_true(no_hits_lost);
+    KINFO("BENCH raycast against %u boxes: linear scan %.3f ms/ray, bvh %.4f ms/ray (%u hits, %u candidates)", BVH_BENCH_COUNT, (brute_time * 1000.0) / ray_count, (bvh_time * 1000.0) / ray_count, brute_hits, bvh_candidates);
+
+    darray_destroy(results);
+    kfree(rays, sizeof(ray) * ray_count, MEMORY_TAG_ARRAY);
+    kfree(boxes, sizeof(extents_3d) * BVH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    bvh_destroy(&t);
+    return true;
+}
+
+void bvh_register_tests(void) {
+    test_manager_register_test(bvh_should_stay_valid_through_inserts_updates_and_removes, "BVH should stay valid through inserts, updates and removes");
+    test_manager_register_test(bvh_queries_should_match_brute_force, "BVH queries should match brute force");
+    test_manager_register_benchmark(bvh_raycast_benchmark, "BVH raycast benchmark");
+}
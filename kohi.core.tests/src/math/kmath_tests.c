@@ -0,0 +1,299 @@
+#include "kmath_tests.h"
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <defines.h>
+#include <math/kmath.h>
+#include <memory/kmemory.h>
+#include <platform/platform.h>
+
+#define KMATH_BENCH_COUNT 100000
+
+// The local matrix as the xform system used to build it, one multiply at a time.
+static mat4 reference_trs(vec3 t, quat r, vec3 s) {
+    mat4 m = mat4_mul(quat_to_mat4(r), mat4_translation(t));
+    return mat4_mul(mat4_scale(s), m);
+}
+
+static void random_trs(vec3* t, quat* r, vec3* s) {
+    *t = (vec3){kfrandom_in_range(-100.0f, 100.0f), kfrandom_in_range(-100.0f, 100.0f), kfrandom_in_range(-100.0f, 100.0f)};
+    vec3 axis = vec3_normalized((vec3){kfrandom_in_range(-1.0f, 1.0f), kfrandom_in_range(-1.0f, 1.0f), 1.0f});
+    *r = quat_from_axis_angle(axis, kfrandom_in_range(-K_PI, K_PI), false);
+    *s = (vec3){kfrandom_in_range(0.1f, 4.0f), kfrandom_in_range(0.1f, 4.0f), kfrandom_in_range(0.1f, 4.0f)};
+}
+
+static b8 matrices_match(const mat4* expected, const mat4* actual) {
+    for (u32 i = 0; i < 16; ++i) {
+        // Relative tolerance, since translations can be large.
+        f32 tolerance = 0.0001f * KMAX(1.0f, kabs(expected->data[i]));
+        if (kabs(expected->data[i] - actual->data[i]) > tolerance) {
+            KERROR("--> Element %u: expected %f, got %f.", i, expected->data[i], actual->data[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+u8 mat4_compose_trs_batch_should_match_scalar(void) {
+    vec3 positions[11];
+    quat rotations[11];
+    vec3 scales[11];
+    mat4 out[11];
+    for (u32 i = 0; i < 11; ++i) {
+        random_trs(&positions[i], &rotations[i], &scales[i]);
+    }
+    // An unnormalized rotation should be normalized the same way.
+    rotations[3] = (quat){0.5f, 1.0f, 2.0f, 3.0f};
+
+    // Every count from 1 to 11 covers full groups of 4 as well as partial ones.
+    for (u32 count = 1; count <= 11; ++count) {
+        kzero_memory(out, sizeof(out));
+        mat4_compose_trs_batch(count, 0, positions, rotations, scales, out);
+        for (u32 i = 0; i < 11; ++i) {
+            if (i < count) {
+                mat4 expected = reference_trs(positions[i], rotations[i], scales[i]);
+                expect_to_be_true(matrices_match(&expected, &out[i]));
+            } else {
+                // Nothing past the end should be written.
+                expect_float_to_be(0.0f, out[i].data[15]);
+            }
+        }
+    }
+
+    // Only the indexed entries should be written.
+    u32 indices[3] = {9, 2, 5};
+    kzero_memory(out, sizeof(out));
+    mat4_compose_trs_batch(3, indices, positions, rotations, scales, out);
+    for (u32 i = 0; i < 11; ++i) {
+        if (i == 9 || i == 2 || i == 5) {
+            mat4 expected = reference_trs(positions[i], rotations[i], scales[i]);
+            expect_to_be_true(matrices_match(&expected, &out[i]));
+        } else {
+            expect_float_to_be(0.0f, out[i].data[15]);
+        }
+    }
+    return true;
+}
+
+u8 mat4_mul_batch_should_match_scalar(void) {
+    mat4 locals[8];
+    mat4 worlds[8];
+    for (u32 i = 0; i < 8; ++i) {
+        vec3 t, s;
+        quat r;
+        random_trs(&t, &r, &s);
+        locals[i] = reference_trs(t, r, s);
+    }
+
+    // A small hierarchy, processed one level at a time, writing into the same array it reads parents from.
+    // 0 is the root; 1 and 2 are its children; 3-7 are children of 1 and 2.
+    u32 parents[8] = {INVALID_ID, 0, 0, 1, 1, 2, 2, 2};
+    worlds[0] = locals[0];
+    u32 level1[2] = {1, 2};
+    u32 level1_parents[2] = {0, 0};
+    mat4_mul_batch(2, level1, locals, level1_parents, worlds, worlds);
+    u32 level2[5] = {3, 4, 5, 6, 7};
+    u32 level2_parents[5] = {1, 1, 2, 2, 2};
+    mat4_mul_batch(5, level2, locals, level2_parents, worlds, worlds);
+
+    mat4 expected[8];
+    expected[0] = locals[0];
+    for (u32 i = 1; i < 8; ++i) {
+        expected[i] = mat4_mul(locals[i], expected[parents[i]]);
+    }
+    for (u32 i = 0; i < 8; ++i) {
+        expect_to_be_true(matrices_match(&expected[i], &worlds[i]));
+    }
+    return true;
+}
+
+typedef struct soa_boxes {
+    f32* cx;
+    f32* cy;
+    f32* cz;
+    f32* ex;
+    f32* ey;
+    f32* ez;
+} soa_boxes;
+
+static soa_boxes soa_boxes_create(u32 count) {
+    soa_boxes b;
+    f32** arrays[6] = {&b.cx, &b.cy, &b.cz, &b.ex, &b.ey, &b.ez};
+    for (u32 a = 0; a < 6; ++a) {
+        *arrays[a] = kallocate(sizeof(f32) * count, MEMORY_TAG_ARRAY);
+    }
+    for (u32 i = 0; i < count; ++i) {
+        b.cx[i] = kfrandom_in_range(-200.0f, 200.0f);
+        b.cy[i] = kfrandom_in_range(-200.0f, 200.0f);
+        b.cz[i] = kfrandom_in_range(-200.0f, 200.0f);
+        b.ex[i] = kfrandom_in_range(0.1f, 5.0f);
+        b.ey[i] = kfrandom_in_range(0.1f, 5.0f);
+        b.ez[i] = kfrandom_in_range(0.1f, 5.0f);
+    }
+    return b;
+}
+
+static void soa_boxes_destroy(soa_boxes* b, u32 count) {
+    f32* arrays[6] = {b->cx, b->cy, b->cz, b->ex, b->ey, b->ez};
+    for (u32 a = 0; a < 6; ++a) {
+        kfree(arrays[a], sizeof(f32) * count, MEMORY_TAG_ARRAY);
+    }
+}
+
+static frustum random_frustum(void) {
+    vec3 position = {kfrandom_in_range(-50.0f, 50.0f), kfrandom_in_range(-50.0f, 50.0f), kfrandom_in_range(-50.0f, 50.0f)};
+    vec3 forward = vec3_normalized((vec3){kfrandom_in_range(-1.0f, 1.0f), kfrandom_in_range(-1.0f, 1.0f), -1.0f});
+    vec3 right = vec3_normalized(vec3_cross(forward, vec3_up()));
+    vec3 up = vec3_cross(right, forward);
+    return frustum_create(&position, &forward, &right, &up, 1.6f, deg_to_rad(60.0f), 0.1f, 150.0f);
+}
+
+// The batch and scalar tests add up terms in a different order, so allow them to disagree for boxes just touching a plane.
+static b8 box_touches_plane(const frustum* f, vec3 center, vec3 extents) {
+    for (u32 p = 0; p < FRUSTUM_SIDE_COUNT; ++p) {
+        const plane_3d* plane = &f->sides[p];
+        f32 r = extents.x * kabs(plane->normal.x) + extents.y * kabs(plane->normal.y) + extents.z * kabs(plane->normal.z);
+        if (kabs(plane_signed_distance(plane, &center) + r) < 0.001f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u8 frustum_intersects_aabb_batch_should_match_scalar(void) {
+    const u32 count = 1003;
+    soa_boxes boxes = soa_boxes_create(count);
+    b8* results = kallocate(sizeof(b8) * count, MEMORY_TAG_ARRAY);
+    u32* indices = kallocate(sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < count; ++i) {
+        indices[i] = count - 1 - i;
+    }
+
+    for (u32 q = 0; q < 10; ++q) {
+        frustum f = random_frustum();
+        u32 visible_count = 0;
+
+        // In order, then in reverse through the indices. Odd counts cover partial groups of 4.
+        for (u32 pass = 0; pass < 2; ++pass) {
+            const u32* pass_indices = pass ? indices : 0;
+            frustum_intersects_aabb_batch(&f, count, pass_indices, boxes.cx, boxes.cy, boxes.cz, boxes.ex, boxes.ey, boxes.ez, results);
+            for (u32 i = 0; i < count; ++i) {
+                u32 b = pass_indices ? pass_indices[i] : i;
+                vec3 center = {boxes.cx[b], boxes.cy[b], boxes.cz[b]};
+                vec3 extents = {boxes.ex[b], boxes.ey[b], boxes.ez[b]};
+                b8 expected = frustum_intersects_aabb(&f, &center, &extents);
+                if (results[i] != expected) {
+                    expect_to_be_true(box_touches_plane(&f, center, extents));
+                }
+                visible_count += results[i] ? 1 : 0;
+            }
+        }
+        // Make sure the test isn't trivially passing.
+        b8 not_all_visible = visible_count < count * 2;
+        expect_to_be_true(not_all_visible);
+    }
+
+    kfree(indices, sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    kfree(results, sizeof(b8) * count, MEMORY_TAG_ARRAY);
+    soa_boxes_destroy(&boxes, count);
+    return true;
+}
+
+u8 kmath_transform_batch_benchmark(void) {
+    vec3* positions = kallocate(sizeof(vec3) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    quat* rotations = kallocate(sizeof(quat) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    vec3* scales = kallocate(sizeof(vec3) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    mat4* locals = kallocate(sizeof(mat4) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    mat4* worlds = kallocate(sizeof(mat4) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    u32* parents = kallocate(sizeof(u32) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < KMATH_BENCH_COUNT; ++i) {
+        random_trs(&positions[i], &rotations[i], &scales[i]);
+        worlds[i] = mat4_identity();
+        parents[i] = (u32)krandom_in_range(0, KMATH_BENCH_COUNT - 1);
+    }
+
+    const u32 runs = 10;
+    f64 start = platform_get_absolute_time();
+    for (u32 r = 0; r < runs; ++r) {
+        for (u32 i = 0; i < KMATH_BENCH_COUNT; ++i) {
+            locals[i] = reference_trs(positions[i], rotations[i], scales[i]);
+        }
+    }
+    f64 scalar_compose = platform_get_absolute_time() - start;
+
+    start = platform_get_absolute_time();
+    for (u32 r = 0; r < runs; ++r) {
+        mat4_compose_trs_batch(KMATH_BENCH_COUNT, 0, positions, rotations, scales, locals);
+    }
+    f64 batch_compose = platform_get_absolute_time() - start;
+
+    start = platform_get_absolute_time();
+    for (u32 r = 0; r < runs; ++r) {
+        for (u32 i = 0; i < KMATH_BENCH_COUNT; ++i) {
+            worlds[i] = mat4_mul(locals[i], locals[parents[i]]);
+        }
+    }
+    f64 scalar_mul = platform_get_absolute_time() - start;
+
+    start = platform_get_absolute_time();
+    for (u32 r = 0; r < runs; ++r) {
+        mat4_mul_batch(KMATH_BENCH_COUNT, 0, locals, parents, locals, worlds);
+    }
+    f64 batch_mul = platform_get_absolute_time() - start;
+
+    f64 count = (f64)KMATH_BENCH_COUNT * runs;
+    KINFO("BENCH TRS compose, %u transforms: scalar %.2f M matrices/sec, batched %.2f M matrices/sec", KMATH_BENCH_COUNT, (count / scalar_compose) / 1000000.0, (count / batch_compose) / 1000000.0);
+    KINFO("BENCH mat4 multiply, %u transforms: scalar %.2f M matrices/sec, batched %.2f M matrices/sec", KMATH_BENCH_COUNT, (count / scalar_mul) / 1000000.0, (count / batch_mul) / 1000000.0);
+
+    kfree(positions, sizeof(vec3) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    kfree(rotations, sizeof(quat) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    kfree(scales, sizeof(vec3) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    kfree(locals, sizeof(mat4) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    kfree(worlds, sizeof(mat4) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    kfree(parents, sizeof(u32) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 frustum_cull_batch_benchmark(void) {
+    soa_boxes boxes = soa_boxes_create(KMATH_BENCH_COUNT);
+    b8* results = kallocate(sizeof(b8) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    frustum f = random_frustum();
+
+    const u32 runs = 10;
+    u32 scalar_visible = 0;
+    f64 start = platform_get_absolute_time();
+    for (u32 r = 0; r < runs; ++r) {
+        for (u32 i = 0; i < KMATH_BENCH_COUNT; ++i) {
+            vec3 center = {boxes.cx[i], boxes.cy[i], boxes.cz[i]};
+            vec3 extents = {boxes.ex[i], boxes.ey[i], boxes.ez[i]};
+            results[i] = frustum_intersects_aabb(&f, &center, &extents);
+            scalar_visible += results[i];
+        }
+    }
+    f64 scalar_time = platform_get_absolute_time() - start;
+
+    u32 batch_visible = 0;
+    start = platform_get_absolute_time();
+    for (u32 r = 0; r < runs; ++r) {
+        frustum_intersects_aabb_batch(&f, KMATH_BENCH_COUNT, 0, boxes.cx, boxes.cy, boxes.cz, boxes.ex, boxes.ey, boxes.ez, results);
+        for (u32 i = 0; i < KMATH_BENCH_COUNT; ++i) {
+            batch_visible += results[i];
+        }
+    }
+    f64 batch_time = platform_get_absolute_time() - start;
+
+    f64 count = (f64)KMATH_BENCH_COUNT * runs;
+    KINFO("BENCH frustum cull, %u boxes: scalar %.2f M boxes/sec, batched %.2f M boxes/sec (%u/%u visible)", KMATH_BENCH_COUNT, (count / scalar_time) / 1000000.0, (count / batch_time) / 1000000.0, scalar_visible / runs, batch_visible / runs);
+
+    kfree(results, sizeof(b8) * KMATH_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    soa_boxes_destroy(&boxes, KMATH_BENCH_COUNT);
+    return true;
+}
+
+void kmath_register_tests(void) {
+    test_manager_register_test(mat4_compose_trs_batch_should_match_scalar, "Batched TRS composition should match scalar matrix multiplication");
+    test_manager_register_test(mat4_mul_batch_should_match_scalar, "Batched matrix multiply should match mat4_mul, level by level");
+    test_manager_register_test(frustum_intersects_aabb_batch_should_match_scalar, "Batched frustum/AABB tests should match frustum_intersects_aabb");
+    test_manager_register_benchmark(kmath_transform_batch_benchmark, "Batched transform math benchmark");
+    test_manager_register_benchmark(frustum_cull_batch_benchmark, "Batched frustum culling benchmark");
+}
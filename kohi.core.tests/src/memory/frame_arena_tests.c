@@ -0,0 +1,131 @@
+#include "frame_arena_tests.h"
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <defines.h>
+#include <memory/allocators/frame_arena.h>
+#include <threads/kthread.h>
+
+u8 frame_arena_should_create_and_destroy(void) {
+    frame_arena arena;
+    expect_to_be_true(frame_arena_create(1024, 256, 3, 4, &arena));
+    expect_should_be(3, arena.frame_count);
+    expect_should_be(0, arena.frame_index);
+    // The creating thread has a slot right away.
+    expect_should_be(1, arena.claimed_count);
+    expect_should_be(0, frame_arena_allocated(&arena));
+
+    frame_arena_destroy(&arena);
+    expect_should_be(0, arena.allocators);
+    expect_should_be(0, arena.slot_thread_ids);
+    return true;
+}
+
+u8 frame_arena_should_align_allocations(void) {
+    frame_arena arena;
+    frame_arena_create(1024, 256, 2, 4, &arena);
+
+    u8* a = frame_arena_allocate(&arena, 3);
+    u8* b = frame_arena_allocate(&arena, 17);
+    u8* c = frame_arena_allocate(&arena, 1);
+    expect_should_not_be(0, a);
+    expect_should_be(0, (u64)a % 16);
+    expect_should_be(0, (u64)b % 16);
+    expect_should_be(0, (u64)c % 16);
+    expect_should_be(16 + 32 + 16, frame_arena_allocated(&arena));
+
+    frame_arena_destroy(&arena);
+    return true;
+}
+
+u8 frame_arena_should_keep_frames_alive_until_ring_wraps(void) {
+    frame_arena arena;
+    frame_arena_create(64, 64, 3, 1, &arena);
+
+    // Fill the first frame.
+    u64* first = frame_arena_allocate(&arena, 64);
+    expect_should_not_be(0, first);
+    *first = 42;
+    expect_should_be(0, frame_arena_allocate(&arena, 16));
+
+    // The next two frames use different memory, so the first allocation is untouched.
+    for (u32 i = 0; i < 2; ++i) {
+        frame_arena_begin_frame(&arena);
+        expect_should_be(0, frame_arena_allocated(&arena));
+        u64* other = frame_arena_allocate(&arena, 64);
+        expect_should_not_be(0, other);
+        expect_should_not_be(first, other);
+        *other = 7;
+    }
+    expect_should_be(42, *first);
+
+    // Wrapping back around resets the first frame's memory for reuse.
+    frame_arena_begin_frame(&arena);
+    expect_should_be(0, arena.frame_index);
+    u64* reused = frame_arena_allocate(&arena, 64);
+    expect_should_be(first, reused);
+
+    frame_arena_destroy(&arena);
+    return true;
+}
+
+typedef struct frame_arena_thread_data {
+    kthread thread;
+    frame_arena* arena;
+    u64* blocks[64];
+    b8 failed;
+} frame_arena_thread_data;
+
+static u32 frame_arena_thread_run(void* params) {
+    frame_arena_thread_data* data = params;
+    for (u32 i = 0; i < 64; ++i) {
+        data->blocks[i] = frame_arena_allocate(data->arena, sizeof(u64));
+        if (!data->blocks[i]) {
+            data->failed = true;
+            return 0;
+        }
+        *data->blocks[i] = (u64)data;
+    }
+    return 0;
+}
+
+u8 frame_arena_should_give_each_thread_its_own_arena(void) {
+    frame_arena arena;
+    frame_arena_create(1024, 1024, 2, 5, &arena);
+
+    frame_arena_thread_data threads[4];
+    for (u32 i = 0; i < 4; ++i) {
+        threads[i].arena = &arena;
+        threads[i].failed = false;
+        expect_to_be_true(kthread_create(frame_arena_thread_run, &threads[i], false, &threads[i].thread));
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        kthread_wait(&threads[i].thread);
+        kthread_destroy(&threads[i].thread);
+    }
+
+    expect_should_be(5, arena.claimed_count);
+    for (u32 i = 0; i < 4; ++i) {
+        expect_to_be_false(threads[i].failed);
+        // No other thread wrote over these blocks.
+        for (u32 j = 0; j < 64; ++j) {
+            expect_should_be((u64)&threads[i], *threads[i].blocks[j]);
+        }
+    }
+    expect_should_be(4 * 64 * 16, frame_arena_allocated(&arena));
+
+    // All threads are reset together.
+    frame_arena_begin_frame(&arena);
+    frame_arena_begin_frame(&arena);
+    expect_should_be(0, frame_arena_allocated(&arena));
+
+    frame_arena_destroy(&arena);
+    return true;
+}
+
+void frame_arena_register_tests(void) {
+    test_manager_register_test(frame_arena_should_create_and_destroy, "Frame arena should create and destroy");
+    test_manager_register_test(frame_arena_should_align_allocations, "Frame arena should align allocations");
+    test_manager_register_test(frame_arena_should_keep_frames_alive_until_ring_wraps, "Frame arena should keep frames alive until the ring wraps");
+    test_manager_register_test(frame_arena_should_give_each_thread_its_own_arena, "Frame arena should give each thread its own arena");
+}
@@ -0,0 +1,169 @@
+#include "kmemory_tests.h"
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <defines.h>
+
+#include <memory/kmemory.h>
+#include <platform/platform.h>
+#include <threads/kthread.h>
+
+#define KMEMORY_TEST_POOL_SIZE MEBIBYTES(64)
+
+static b8 kmemory_test_startup(void) {
+    memory_system_configuration config = {0};
+    config.total_alloc_size = KMEMORY_TEST_POOL_SIZE;
+    return memory_system_initialize(config);
+}
+
+u8 kmemory_small_allocations_should_be_aligned_and_tracked(void) {
+    expect_to_be_true(kmemory_test_startup());
+    u64 base_count = get_memory_alloc_count();
+
+    void* blocks[256];
+    for (u32 i = 0; i < 256; ++i) {
+        u64 size = i + 1;
+        blocks[i] = kallocate(size, MEMORY_TAG_ENGINE);
+        expect_should_not_be(0, blocks[i]);
+        expect_should_be(0, ((u64)blocks[i] % 16));
+
+        // Should be zeroed and fully writable.
+        u8* bytes = blocks[i];
+        for (u64 j = 0; j < size; ++j) {
+            expect_should_be(0, bytes[j]);
+        }
+        kset_memory(bytes, 0xFF, size);
+
+        u64 block_size = 0;
+        u16 block_alignment = 0;
+        expect_to_be_true(kmemory_get_size_alignment(blocks[i], &block_size, &block_alignment));
+        b8 size_covers_request = block_size >= size;
+        expect_to_be_true(size_covers_request);
+    }
+    u64 expected_count = base_count + 256;
+    expect_should_be(expected_count, get_memory_alloc_count());
+
+    // Freed blocks should be reused, and come back zeroed.
+    kfree(blocks[31], 32, MEMORY_TAG_ENGINE);
+    void* reused = kallocate(32, MEMORY_TAG_ENGINE);
+    expect_should_be(blocks[31], reused);
+    expect_should_be(0, ((u8*)reused)[0]);
+    blocks[31] = reused;
+
+    for (u32 i = 0; i < 256; ++i) {
+        kfree(blocks[i], i + 1, MEMORY_TAG_ENGINE);
+    }
+    expect_should_be(base_count, get_memory_alloc_count());
+
+    memory_system_shutdown();
+    return true;
+}
+
+typedef struct kmemory_test_thread {
+    kthread thread;
+    u64 size;
+    u32 iterations;
+    b8 failed;
+} kmemory_test_thread;
+
+#define KMEMORY_TEST_WINDOW 64
+
+static u32 kmemory_test_thread_run(void* params) {
+    kmemory_test_thread* t = params;
+    void* live[KMEMORY_TEST_WINDOW] = {0};
+    // Keep a window of live allocations, replacing the oldest each iteration.
+    for (u32 i = 0; i < t->iterations; ++i) {
+        u32 slot = i % KMEMORY_TEST_WINDOW;
+        if (live[slot]) {
+            // A block handed to another thread as well would have been overwritten.
+            if (*(u32*)live[slot] != i - KMEMORY_TEST_WINDOW) {
+                t->failed = true;
+            }
+            kfree(live[slot], t->size, MEMORY_TAG_ENGINE);
+        }
+        live[slot] = kallocate(t->size, MEMORY_TAG_ENGINE);
+        if (!live[slot]) {
+            t->failed = true;
+            break;
+        }
+        *(u32*)live[slot] = i;
+    }
+    for (u32 i = 0; i < KMEMORY_TEST_WINDOW; ++i) {
+        if (live[i]) {
+            kfree(live[i], t->size, MEMORY_TAG_ENGINE);
+        }
+    }
+    kmemory_thread_cache_release();
+    return 0;
+}
+
+// Runs the given number of threads, each allocating and freeing blocks of the given size.
+static b8 kmemory_threads_run(u64 size, u32 thread_count, u32 iterations) {
+    kmemory_test_thread threads[8] = {0};
+    for (u32 i = 0; i < thread_count; ++i) {
+        threads[i].size = size;
+        threads[i].iterations = iterations;
+        if (!kthread_create(kmemory_test_thread_run, &threads[i], false, &threads[i].thread)) {
+            return false;
+        }
+    }
+    b8 failed = false;
+    for (u32 i = 0; i < thread_count; ++i) {
+        kthread_wait(&threads[i].thread);
+        kthread_destroy(&threads[i].thread);
+        failed |= threads[i].failed;
+    }
+    return !failed;
+}
+
+static b8 kmemory_bench_run(u64 size, u32 thread_count, u32 iterations) {
+    f64 start = platform_get_absolute_time();
+    b8 result = kmemory_threads_run(size, thread_count, iterations);
+    f64 elapsed = platform_get_absolute_time() - start;
+    u64 ops = (u64)thread_count * iterations * 2;
+    KINFO("BENCH kallocate/kfree %4llu bytes, %u thread(s): %.2f ms, %.2f M ops/sec", size, thread_count, elapsed * 1000.0, (ops / elapsed) / 1000000.0);
+    return result;
+}
+
+u8 kmemory_allocations_should_be_thread_safe(void) {
+    expect_to_be_true(kmemory_test_startup());
+    u64 base_count = get_memory_alloc_count();
+
+    // Both the per-thread caches and the shared allocator.
+    u64 sizes[2] = {64, 1024};
+    for (u32 s = 0; s < 2; ++s) {
+        expect_to_be_true(kmemory_threads_run(sizes[s], 4, 10000));
+    }
+
+    // Everything should have been returned.
+    expect_should_be(base_count, get_memory_alloc_count());
+
+    memory_system_shutdown();
+    return true;
+}
+
+u8 kmemory_contention_benchmark(void) {
+    expect_to_be_true(kmemory_test_startup());
+    u64 base_count = get_memory_alloc_count();
+
+    const u32 iterations = 100000;
+    // Small allocations use per-thread caches; large ones go through the locked dynamic allocator for comparison.
+    u64 sizes[2] = {64, 1024};
+    for (u32 s = 0; s < 2; ++s) {
+        for (u32 thread_count = 1; thread_count <= 8; thread_count *= 2) {
+            expect_to_be_true(kmemory_bench_run(sizes[s], thread_count, iterations));
+        }
+    }
+
+    // Everything should have been returned.
+    expect_should_be(base_count, get_memory_alloc_count());
+
+    memory_system_shutdown();
+    return true;
+}
+
+void kmemory_register_tests(void) {
+    test_manager_register_test(kmemory_small_allocations_should_be_aligned_and_tracked, "kmemory small allocations should be aligned, zeroed, reused and tracked");
+    test_manager_register_test(kmemory_allocations_should_be_thread_safe, "kmemory allocations should be safe from multiple threads");
+    test_manager_register_benchmark(kmemory_contention_benchmark, "kmemory multithreaded allocation contention benchmark");
+}
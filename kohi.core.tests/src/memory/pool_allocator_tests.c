@@ -0,0 +1,146 @@
+#include "pool_allocator_tests.h"
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <containers/u64_bst.h>
+#include <defines.h>
+#include <memory/allocators/pool_allocator.h>
+#include <threads/kthread.h>
+
+typedef struct pool_test_struct {
+    u64 a;
+    u32 b;
+    u8 c;
+} pool_test_struct;
+
+u8 pool_allocator_should_create_and_destroy(void) {
+    pool_allocator pool;
+    expect_to_be_true(pool_allocator_create(sizeof(pool_test_struct), 8, false, MEMORY_TAG_ENGINE, &pool));
+    // Block size is padded to a multiple of 8.
+    expect_should_be(16, pool.block_size);
+    // Nothing is allocated until needed.
+    expect_should_be(0, pool.page_count);
+    expect_should_be(0, pool.pages);
+
+    pool_allocator_destroy(&pool);
+    expect_should_be(0, pool.block_size);
+    expect_should_be(0, pool.pages);
+    return true;
+}
+
+u8 pool_allocator_should_grow_and_reuse_blocks(void) {
+    pool_allocator pool;
+    pool_allocator_create(sizeof(pool_test_struct), 8, false, MEMORY_TAG_ENGINE, &pool);
+
+    // Allocate enough to need several pages.
+    pool_test_struct* blocks[20];
+    for (u32 i = 0; i < 20; ++i) {
+        blocks[i] = pool_allocator_allocate(&pool);
+        expect_should_not_be(0, blocks[i]);
+        // Blocks come back zeroed.
+        expect_should_be(0, blocks[i]->a);
+        blocks[i]->a = i;
+    }
+    expect_should_be(3, pool.page_count);
+    expect_should_be(20, pool.allocated_count);
+
+    // Every block should be distinct and intact.
+    for (u32 i = 0; i < 20; ++i) {
+        expect_should_be(i, blocks[i]->a);
+        for (u32 j = i + 1; j < 20; ++j) {
+            expect_should_not_be(blocks[i], blocks[j]);
+        }
+    }
+
+    // Freed blocks are reused before growing again.
+    pool_allocator_free(&pool, blocks[5]);
+    expect_should_be(19, pool.allocated_count);
+    pool_test_struct* reused = pool_allocator_allocate(&pool);
+    expect_should_be(blocks[5], reused);
+    expect_should_be(0, reused->a);
+    expect_should_be(3, pool.page_count);
+
+    pool_allocator_destroy(&pool);
+    return true;
+}
+
+typedef struct pool_thread_data {
+    kthread thread;
+    pool_allocator* pool;
+    b8 failed;
+} pool_thread_data;
+
+static u32 pool_thread_run(void* params) {
+    pool_thread_data* data = params;
+    u64* live[32];
+    for (u32 round = 0; round < 2000; ++round) {
+        for (u32 i = 0; i < 32; ++i) {
+            live[i] = pool_allocator_allocate(data->pool);
+            *live[i] = ((u64)round << 32) | i;
+        }
+        for (u32 i = 0; i < 32; ++i) {
+            // Catch any block handed out to two threads at once.
+            if (*live[i] != (((u64)round << 32) | i)) {
+                data->failed = true;
+            }
+            pool_allocator_free(data->pool, live[i]);
+        }
+    }
+    return 0;
+}
+
+u8 pool_allocator_should_be_thread_safe(void) {
+    pool_allocator pool;
+    pool_allocator_create(sizeof(u64), 64, true, MEMORY_TAG_ENGINE, &pool);
+
+    pool_thread_data threads[4];
+    for (u32 i = 0; i < 4; ++i) {
+        threads[i].pool = &pool;
+        threads[i].failed = false;
+        expect_to_be_true(kthread_create(pool_thread_run, &threads[i], false, &threads[i].thread));
+    }
+    for (u32 i = 0; i < 4; ++i) {
+        kthread_wait(&threads[i].thread);
+        kthread_destroy(&threads[i].thread);
+        expect_to_be_false(threads[i].failed);
+    }
+    expect_should_be(0, pool.allocated_count);
+
+    pool_allocator_destroy(&pool);
+    return true;
+}
+
+u8 pool_allocator_should_back_bst_nodes(void) {
+    bt_node* root = 0;
+    for (u64 i = 0; i < 1000; ++i) {
+        bt_node_value value;
+        value.u64 = i * 2;
+        // Insert in a scattered order.
+        u64 key = (i * 7919) % 1000;
+        if (!root) {
+            root = u64_bst_insert(0, key, value);
+        } else {
+            u64_bst_insert(root, key, value);
+        }
+    }
+    for (u64 i = 0; i < 1000; i += 3) {
+        root = u64_bst_delete(root, i);
+    }
+    for (u64 i = 0; i < 1000; ++i) {
+        const bt_node* node = u64_bst_find(root, i);
+        if (i % 3 == 0) {
+            expect_should_be(0, node);
+        } else {
+            expect_should_not_be(0, node);
+        }
+    }
+    u64_bst_cleanup(root);
+    return true;
+}
+
+void pool_allocator_register_tests(void) {
+    test_manager_register_test(pool_allocator_should_create_and_destroy, "Pool allocator should create and destroy");
+    test_manager_register_test(pool_allocator_should_grow_and_reuse_blocks, "Pool allocator should grow by pages and reuse freed blocks");
+    test_manager_register_test(pool_allocator_should_be_thread_safe, "Pool allocator should be safe to use from multiple threads");
+    test_manager_register_test(pool_allocator_should_back_bst_nodes, "Pool allocator should back u64_bst nodes");
+}
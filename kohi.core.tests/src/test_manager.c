@@ -11,9 +11,12 @@ typedef struct test_entry {
 } test_entry;
 
 static test_entry* tests;
+// Only run on request, as they take a while and mostly report timings.
+static test_entry* benchmarks;
 
 void test_manager_init(void) {
     tests = darray_create(test_entry);
+    benchmarks = darray_create(test_entry);
 }
 
 void test_manager_register_test(u8 (*PFN_test)(void), char* desc) {
@@ -23,12 +26,19 @@ void test_manager_register_test(u8 (*PFN_test)(void), char* desc) {
     darray_push(tests, e);
 }
 
-void test_manager_run_tests(void) {
+void test_manager_register_benchmark(u8 (*PFN_test)(void), char* desc) {
+    test_entry e;
+    e.func = PFN_test;
+    e.desc = desc;
+    darray_push(benchmarks, e);
+}
+
+static void run_entries(test_entry* entries) {
     u32 passed = 0;
     u32 failed = 0;
     u32 skipped = 0;
 
-    u32 count = darray_length(tests);
+    u32 count = darray_length(entries);
 
     kclock total_time;
     kclock_start(&total_time);
@@ -36,16 +46,16 @@ void test_manager_run_tests(void) {
     for (u32 i = 0; i < count; ++i) {
         kclock test_time;
         kclock_start(&test_time);
-        u8 result = tests[i].func();
+        u8 result = entries[i].func();
         kclock_update(&test_time);
 
         if (result == true) {
             ++passed;
         } else if (result == BYPASS) {
-            KWARN("[SKIPPED]: %s", tests[i].desc);
+            KWARN("[SKIPPED]: %s", entries[i].desc);
             ++skipped;
         } else {
-            KERROR("[FAILED]: %s", tests[i].desc);
+            KERROR("[FAILED]: %s", entries[i].desc);
             ++failed;
         }
         char status[20];
@@ -58,3 +68,11 @@ void test_manager_run_tests(void) {
 
     KINFO("Results: %d passed, %d failed, %d skipped.", passed, failed, skipped);
 }
+
+void test_manager_run_tests(void) {
+    run_entries(tests);
+}
+
+void test_manager_run_benchmarks(void) {
+    run_entries(benchmarks);
+}
@@ -10,4 +10,8 @@ void test_manager_init(void);
 
 void test_manager_register_test(PFN_test, char* desc);
 
-void test_manager_run_tests(void);
\ No newline at end of file
+void test_manager_run_tests(void);
+
+void test_manager_register_benchmark(PFN_test, char* desc);
+
+void test_manager_run_benchmarks(void);
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "ksort_tests.h"
+#include "../expect.h"
+#include "../test_manager.h"
+
+#include <defines.h>
+#include <math/kmath.h>
+#include <memory/kmemory.h>
+#include <platform/platform.h>
+#include <utils/ksort.h>
+
+#define KSORT_TEST_COUNT 10000
+#define KSORT_BENCH_COUNT 65536
+
+// Roughly the size of a draw, to show the cost of moving whole items around while sorting.
+typedef struct sort_test_item {
+    mat4 model;
+    u64 key;
+    u32 data[8];
+} sort_test_item;
+
+static i32 sort_test_item_compare(void* a, void* b) {
+    sort_test_item* a_typed = a;
+    sort_test_item* b_typed = b;
+    // NOTE: kquick_sort moves items for which this is positive to the front.
+    if (a_typed->key < b_typed->key) {
+        return 1;
+    } else if (a_typed->key > b_typed->key) {
+        return -1;
+    }
+    return 0;
+}
+
+u8 radix_sort_should_sort_keys_and_values(void) {
+    u64* keys = kallocate(sizeof(u64) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+    u64* original_keys = kallocate(sizeof(u64) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+    u32* values = kallocate(sizeof(u32) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+
+    // Use only a few distinct keys, spread across all digits, so stability can be checked.
+    for (u32 i = 0; i < KSORT_TEST_COUNT; ++i) {
+        u64 r = krandom_u64();
+        keys[i] = ((r & 0x3) << 56) | (((r >> 8) & 0x3) << 24) | ((r >> 16) & 0x3);
+        original_keys[i] = keys[i];
+        values[i] = i;
+    }
+
+    kradix_sort_u64(KSORT_TEST_COUNT, keys, values, 0, 0);
+
+    for (u32 i = 0; i < KSORT_TEST_COUNT; ++i) {
+        // Each value should still be paired with its key.
+        expect_should_be(original_keys[values[i]], keys[i]);
+        if (i > 0) {
+            b8 ordered = keys[i - 1] <= keys[i];
+            expect_to_be_true(ordered);
+            // Equal keys should keep their original order.
+            if (keys[i - 1] == keys[i]) {
+                b8 stable = values[i - 1] < values[i];
+                expect_to_be_true(stable);
+            }
+        }
+    }
+
+    // Keys only, with scratch space provided.
+    u64* scratch = kallocate(sizeof(u64) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < KSORT_TEST_COUNT; ++i) {
+        keys[i] = krandom_u64();
+    }
+    kradix_sort_u64(KSORT_TEST_COUNT, keys, 0, scratch, 0);
+    for (u32 i = 1; i < KSORT_TEST_COUNT; ++i) {
+        b8 ordered = keys[i - 1] <= keys[i];
+        expect_to_be_true(ordered);
+    }
+
+    kfree(scratch, sizeof(u64) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+    kfree(keys, sizeof(u64) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+    kfree(original_keys, sizeof(u64) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+    kfree(values, sizeof(u32) * KSORT_TEST_COUNT, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 sort_key_from_f32_should_keep_order(void) {
+    f32 values[] = {-K_FLOAT_MAX, -1000.0f, -1.5f, -1.0f, -K_FLOAT_EPSILON, 0.0f, K_FLOAT_EPSILON, 0.5f, 1.0f, 1000.0f, K_FLOAT_MAX};
+    u32 count = sizeof(values) / sizeof(f32);
+    for (u32 i = 1; i < count; ++i) {
+        b8 ordered = ksort_key_from_f32(values[i - 1]) < ksort_key_from_f32(values[i]);
+        expect_to_be_true(ordered);
+    }
+    return true;
+}
+
+u8 radix_sort_benchmark(void) {
+    sort_test_item* items = kallocate(sizeof(sort_test_item) * KSORT_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    u64* keys = kallocate(sizeof(u64) * KSORT_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    u32* indices = kallocate(sizeof(u32) * KSORT_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    for (u32 i = 0; i < KSORT_BENCH_COUNT; ++i) {
+        // A pass bit, a few hundred materials and a depth, much like a draw key.
+        u64 material = (u64)krandom_in_range(0, 300);
+        items[i].key = (material << 32) | ksort_key_from_f32(kfrandom_in_range(0.0f, 1000.0f));
+    }
+
+    f64 start = platform_get_absolute_time();
+    for (u32 i = 0; i < KSORT_BENCH_COUNT; ++i) {
+        keys[i] = items[i].key;
+        indices[i] = i;
+    }
+    kradix_sort_u64(KSORT_BENCH_COUNT, keys, indices, 0, 0);
+    f64 radix_time = platform_get_absolute_time() - start;
+
+    start = platform_get_absolute_time();
+    kquick_sort(sizeof(sort_test_item), items, 0, KSORT_BENCH_COUNT - 1, sort_test_item_compare);
+    f64 quick_time = platform_get_absolute_time() - start;
+
+    // Both should agree on the order of keys.
+    for (u32 i = 0; i < KSORT_BENCH_COUNT; ++i) {
+        expect_should_be(items[i].key, keys[i]);
+    }
+    KINFO("BENCH sorting %u draws: kquick_sort over items %.3f ms, kradix_sort_u64 over keys %.3f ms", KSORT_BENCH_COUNT, quick_time * 1000.0, radix_time * 1000.0);
+
+    kfree(items, sizeof(sort_test_item) * KSORT_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    kfree(keys, sizeof(u64) * KSORT_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    kfree(indices, sizeof(u32) * KSORT_BENCH_COUNT, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+void ksort_register_tests(void) {
+    test_manager_register_test(radix_sort_should_sort_keys_and_values, "Radix sort should sort keys and values");
+    test_manager_register_test(sort_key_from_f32_should_keep_order, "Sort keys from floats should keep their order");
+    test_manager_register_benchmark(radix_sort_benchmark, "Radix sort benchmark");
+}
@@ -193,6 +193,10 @@ typedef struct kasset_heightmap_terrain {
     vec3 tile_scale;
     u8 material_count;
     kname* material_names;
+    // Indicates if the terrain should be streamed as a quadtree instead of being loaded whole.
+    b8 use_quadtree;
+    // The most GPU memory a quadtree terrain's geometry may use, in MiB. 0 uses the default.
+    u32 memory_budget_mb;
 } kasset_heightmap_terrain;
 
 typedef enum kasset_image_format {
@@ -353,6 +357,8 @@ typedef struct kasset_shader_stage {
 typedef struct kasset_shader_attribute {
     const char* name;
     shader_attribute_type type;
+    /** @brief Indicates the attribute is sourced from per-instance data instead of per-vertex data. */
+    b8 per_instance;
 } kasset_shader_attribute;
 
 /**
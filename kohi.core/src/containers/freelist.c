@@ -9,17 +9,98 @@ typedef struct freelist_node {
     struct freelist_node* next;
 } freelist_node;
 
+// Number of bits used for the second-level index, giving 16 size classes between each power of 2.
+#define TLSF_SL_LOG2 4
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG2)
+// First-level index covers every power of 2 up to 2^63. Index 0 holds everything below TLSF_SL_COUNT.
+#define TLSF_FL_COUNT (64 - TLSF_SL_LOG2 + 1)
+#define TLSF_NULL INVALID_ID
+// The node pool starts out sized for one free range per this many bytes, and grows on resize
+// when it runs low. Heavily fragmented ranges are the exception rather than the rule.
+#define TLSF_BYTES_PER_NODE KIBIBYTES(64)
+#define TLSF_MIN_NODES 64
+#define TLSF_MAX_INITIAL_NODES 65536
+// A free needs at most one new node, so a handful spare is enough warning to grow.
+#define TLSF_GROW_THRESHOLD 4
+
+// A free range tracked by a TLSF freelist. Linked by index rather than pointer so that
+// the whole state can be copied on resize.
+typedef struct tlsf_node {
+    u64 offset;
+    u64 size;
+    // Links within the list of free ranges of the same size class.
+    u32 prev_in_class;
+    u32 next_in_class;
+    // Link within the lookup bucket by offset. Also links the pool of unused nodes.
+    u32 next_by_start;
+    // Link within the lookup bucket by end (offset + size).
+    u32 next_by_end;
+} tlsf_node;
+
+typedef struct tlsf_state {
+    // Bit per first-level index, set if any of its second-level lists are non-empty.
+    u64 fl_bitmap;
+    // Bit per second-level list, set if the list is non-empty.
+    u32 sl_bitmaps[TLSF_FL_COUNT];
+    // Heads of the free lists for each size class.
+    u32 heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    // Lookups of free ranges by start and end offset, used to find neighbours to merge with when freeing.
+    u32 bucket_mask;
+    u32* start_buckets;
+    u32* end_buckets;
+    tlsf_node* nodes;
+    // Head of the pool of released nodes.
+    u32 unused_head;
+    // Nodes at or past this index have never been used, so the pool doesn't need linking up front.
+    u32 next_untouched;
+    u32 used_count;
+    u64 free_space;
+} tlsf_state;
+
 typedef struct internal_state {
+    freelist_mode mode;
     u64 total_size;
     u64 max_entries;
     freelist_node* head;
     freelist_node* nodes;
+    // Only used in FREELIST_MODE_TLSF.
+    tlsf_state* tlsf;
 } internal_state;
 
 static freelist_node* get_node(freelist* list);
 static void return_node(freelist_node* node);
 
+static u64 tlsf_max_entries(u64 total_size, u64 used_count);
+static u32 tlsf_bucket_count(u64 max_entries);
+static u64 tlsf_memory_requirement(u64 max_entries);
+static void tlsf_setup(internal_state* state, u64 max_entries);
+static b8 tlsf_allocate_block(internal_state* state, u64 size, u64* out_offset);
+static b8 tlsf_free_block(internal_state* state, u64 size, u64 offset);
+static b8 tlsf_resize(freelist* list, u64* memory_requirement, void* new_memory, u64 new_size, void** out_old_memory);
+
 void freelist_create(u64 total_size, u64* memory_requirement, void* memory, freelist* out_list) {
+    freelist_create_with_mode(total_size, FREELIST_MODE_LINEAR, memory_requirement, memory, out_list);
+}
+
+void freelist_create_with_mode(u64 total_size, freelist_mode mode, u64* memory_requirement, void* memory, freelist* out_list) {
+    if (mode == FREELIST_MODE_TLSF) {
+        u64 max_entries = tlsf_max_entries(total_size, 0);
+        *memory_requirement = tlsf_memory_requirement(max_entries);
+        if (!memory) {
+            return;
+        }
+        out_list->memory = memory;
+        // Nodes are initialized as they are first used.
+        kzero_memory(out_list->memory, sizeof(internal_state) + sizeof(tlsf_state));
+        internal_state* state = out_list->memory;
+        state->mode = FREELIST_MODE_TLSF;
+        state->total_size = total_size;
+        tlsf_setup(state, max_entries);
+        // The entire range starts out free.
+        tlsf_free_block(state, total_size, 0);
+        return;
+    }
+
     // Enough space to hold state, plus array for all nodes.
     u64 max_entries = (total_size / (sizeof(void*) * sizeof(freelist_node))); // NOTE: This might have a remainder, but that's ok.
 
@@ -48,6 +129,7 @@ void freelist_create(u64 total_size, u64* memory_requirement, void* memory, free
     // The block's layout is head* first, then array of available nodes.
     kzero_memory(out_list->memory, *memory_requirement);
     internal_state* state = out_list->memory;
+    state->mode = FREELIST_MODE_LINEAR;
     state->nodes = (void*)(out_list->memory + sizeof(internal_state));
     state->max_entries = max_entries;
     state->total_size = total_size;
@@ -64,7 +146,11 @@ void freelist_destroy(freelist* list) {
     if (list && list->memory) {
         // Just zero out the memory before giving it back.
         internal_state* state = list->memory;
-        kzero_memory(list->memory, sizeof(internal_state) + sizeof(freelist_node) * state->max_entries);
+        if (state->mode == FREELIST_MODE_TLSF) {
+            kzero_memory(list->memory, tlsf_memory_requirement(state->max_entries));
+        } else {
+            kzero_memory(list->memory, sizeof(internal_state) + sizeof(freelist_node) * state->max_entries);
+        }
         list->memory = 0;
     }
 }
@@ -74,6 +160,9 @@ b8 freelist_allocate_block(freelist* list, u64 size, u64* out_offset) {
         return false;
     }
     internal_state* state = list->memory;
+    if (state->mode == FREELIST_MODE_TLSF) {
+        return tlsf_allocate_block(state, size, out_offset);
+    }
     freelist_node* node = state->head;
     freelist_node* previous = 0;
     while (node) {
@@ -115,6 +204,9 @@ b8 freelist_free_block(freelist* list, u64 size, u64 offset) {
         return false;
     }
     internal_state* state = list->memory;
+    if (state->mode == FREELIST_MODE_TLSF) {
+        return tlsf_free_block(state, size, offset);
+    }
     freelist_node* node = state->head;
     freelist_node* previous = 0;
     if (!node) {
@@ -207,6 +299,10 @@ b8 freelist_resize(freelist* list, u64* memory_requirement, void* new_memory, u6
         return false;
     }
 
+    if (((internal_state*)list->memory)->mode == FREELIST_MODE_TLSF) {
+        return tlsf_resize(list, memory_requirement, new_memory, new_size, out_old_memory);
+    }
+
     // Enough space to hold state, plus array for all nodes.
     u64 max_entries = (new_size / sizeof(void*)); // NOTE: This might have a remainder, but that's ok.
 
@@ -236,6 +332,7 @@ b8 freelist_resize(freelist* list, u64* memory_requirement, void* new_memory, u6
 
     // Setup the new state.
     internal_state* state = (internal_state*)list->memory;
+    state->mode = FREELIST_MODE_LINEAR;
     state->nodes = (void*)(list->memory + sizeof(internal_state));
     state->max_entries = max_entries;
     state->total_size = new_size;
@@ -299,6 +396,12 @@ void freelist_clear(freelist* list) {
     }
 
     internal_state* state = list->memory;
+    if (state->mode == FREELIST_MODE_TLSF) {
+        tlsf_setup(state, state->max_entries);
+        tlsf_free_block(state, state->total_size, 0);
+        return;
+    }
+
     // Invalidate the offset for all but the first node. The invalid
     // value will be checked for when seeking a new node from the list.
     kzero_memory(state->nodes, sizeof(freelist_node) * state->max_entries);
@@ -314,8 +417,12 @@ u64 freelist_free_space(freelist* list) {
         return 0;
     }
 
-    u64 running_total = 0;
     internal_state* state = list->memory;
+    if (state->mode == FREELIST_MODE_TLSF) {
+        return state->tlsf->free_space;
+    }
+
+    u64 running_total = 0;
     freelist_node* node = state->head;
     while (node) {
         running_total += node->size;
@@ -325,6 +432,18 @@ u64 freelist_free_space(freelist* list) {
     return running_total;
 }
 
+b8 freelist_should_grow(freelist* list) {
+    if (!list || !list->memory) {
+        return false;
+    }
+
+    internal_state* state = list->memory;
+    if (state->mode != FREELIST_MODE_TLSF) {
+        return false;
+    }
+    return state->max_entries - state->tlsf->used_count < TLSF_GROW_THRESHOLD;
+}
+
 static freelist_node* get_node(freelist* list) {
     internal_state* state = list->memory;
     for (u64 i = 1; i < state->max_entries; ++i) {
@@ -344,3 +463,316 @@ static void return_node(freelist_node* node) {
     node->size = 0;
     node->next = 0;
 }
+
+// TLSF implementation
+
+static u64 tlsf_max_entries(u64 total_size, u64 used_count) {
+    u64 max_entries = total_size / TLSF_BYTES_PER_NODE;
+    if (max_entries < TLSF_MIN_NODES) {
+        max_entries = TLSF_MIN_NODES;
+    } else if (max_entries > TLSF_MAX_INITIAL_NODES) {
+        max_entries = TLSF_MAX_INITIAL_NODES;
+    }
+    // Always leave room to double the ranges already being tracked.
+    if (max_entries < used_count * 2) {
+        max_entries = used_count * 2;
+    }
+    // Nodes are linked by u32 index.
+    if (max_entries >= TLSF_NULL) {
+        max_entries = TLSF_NULL - 1;
+    }
+    return max_entries;
+}
+
+static u32 tlsf_bucket_count(u64 max_entries) {
+    // Roughly one bucket per two entries, keeping chains short without doubling the memory used.
+    u32 count = 16;
+    while (count < max_entries / 2 && count < 0x80000000U) {
+        count <<= 1;
+    }
+    return count;
+}
+
+static u64 tlsf_memory_requirement(u64 max_entries) {
+    // Layout: internal_state, tlsf_state, nodes, start buckets, end buckets.
+    return sizeof(internal_state) + sizeof(tlsf_state) + (sizeof(tlsf_node) * max_entries) + (sizeof(u32) * tlsf_bucket_count(max_entries) * 2);
+}
+
+// Resets the state to hold no free ranges. Memory is assumed to already be laid out.
+static void tlsf_setup(internal_state* state, u64 max_entries) {
+    state->max_entries = max_entries;
+    state->tlsf = (tlsf_state*)((u8*)state + sizeof(internal_state));
+    tlsf_state* tlsf = state->tlsf;
+
+    u32 bucket_count = tlsf_bucket_count(max_entries);
+    tlsf->nodes = (tlsf_node*)((u8*)tlsf + sizeof(tlsf_state));
+    tlsf->start_buckets = (u32*)((u8*)tlsf->nodes + (sizeof(tlsf_node) * max_entries));
+    tlsf->end_buckets = tlsf->start_buckets + bucket_count;
+    tlsf->bucket_mask = bucket_count - 1;
+
+    tlsf->fl_bitmap = 0;
+    tlsf->free_space = 0;
+    kzero_memory(tlsf->sl_bitmaps, sizeof(tlsf->sl_bitmaps));
+    kset_memory(tlsf->heads, 0xFF, sizeof(tlsf->heads));
+    kset_memory(tlsf->start_buckets, 0xFF, sizeof(u32) * bucket_count * 2);
+
+    tlsf->unused_head = TLSF_NULL;
+    tlsf->next_untouched = 0;
+    tlsf->used_count = 0;
+}
+
+static u32 tlsf_hash(const tlsf_state* tlsf, u64 key) {
+    return (u32)((key * 0x9E3779B97F4A7C15ULL) >> 32) & tlsf->bucket_mask;
+}
+
+// Gets the first and second-level indices of the size class containing size.
+static void tlsf_mapping(u64 size, u32* fl, u32* sl) {
+    if (size < TLSF_SL_COUNT) {
+        *fl = 0;
+        *sl = (u32)size;
+    } else {
+        u32 msb = 63 - (u32)__builtin_clzll(size);
+        *fl = msb - TLSF_SL_LOG2 + 1;
+        *sl = (u32)(size >> (msb - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+    }
+}
+
+static u32 tlsf_node_acquire(internal_state* state) {
+    tlsf_state* tlsf = state->tlsf;
+    u32 index = tlsf->unused_head;
+    if (index != TLSF_NULL) {
+        tlsf->unused_head = tlsf->nodes[index].next_by_start;
+    } else if (tlsf->next_untouched < state->max_entries) {
+        index = tlsf->next_untouched++;
+    } else {
+        return TLSF_NULL;
+    }
+    tlsf->used_count++;
+    return index;
+}
+
+static void tlsf_node_release(tlsf_state* tlsf, u32 index) {
+    tlsf->used_count--;
+    tlsf->nodes[index].offset = 0;
+    tlsf->nodes[index].size = 0;
+    tlsf->nodes[index].next_by_start = tlsf->unused_head;
+    tlsf->unused_head = index;
+}
+
+static u32 tlsf_find_by_start(const tlsf_state* tlsf, u64 offset) {
+    u32 index = tlsf->start_buckets[tlsf_hash(tlsf, offset)];
+    while (index != TLSF_NULL && tlsf->nodes[index].offset != offset) {
+        index = tlsf->nodes[index].next_by_start;
+    }
+    return index;
+}
+
+static u32 tlsf_find_by_end(const tlsf_state* tlsf, u64 end) {
+    u32 index = tlsf->end_buckets[tlsf_hash(tlsf, end)];
+    while (index != TLSF_NULL && tlsf->nodes[index].offset + tlsf->nodes[index].size != end) {
+        index = tlsf->nodes[index].next_by_end;
+    }
+    return index;
+}
+
+// Removes index from the bucket chain starting at head, following either the start or end links.
+static void tlsf_bucket_remove(tlsf_state* tlsf, u32* head, u32 index, b8 by_start) {
+    u32* link = head;
+    while (*link != TLSF_NULL) {
+        if (*link == index) {
+            *link = by_start ? tlsf->nodes[index].next_by_start : tlsf->nodes[index].next_by_end;
+            return;
+        }
+        link = by_start ? &tlsf->nodes[*link].next_by_start : &tlsf->nodes[*link].next_by_end;
+    }
+}
+
+static void tlsf_insert(tlsf_state* tlsf, u32 index) {
+    tlsf_node* node = &tlsf->nodes[index];
+    u32 fl, sl;
+    tlsf_mapping(node->size, &fl, &sl);
+
+    // Push onto the size class list.
+    node->prev_in_class = TLSF_NULL;
+    node->next_in_class = tlsf->heads[fl][sl];
+    if (node->next_in_class != TLSF_NULL) {
+        tlsf->nodes[node->next_in_class].prev_in_class = index;
+    }
+    tlsf->heads[fl][sl] = index;
+    tlsf->fl_bitmap |= (1ULL << fl);
+    tlsf->sl_bitmaps[fl] |= (1U << sl);
+
+    // Add to the lookups.
+    u32* start_bucket = &tlsf->start_buckets[tlsf_hash(tlsf, node->offset)];
+    node->next_by_start = *start_bucket;
+    *start_bucket = index;
+    u32* end_bucket = &tlsf->end_buckets[tlsf_hash(tlsf, node->offset + node->size)];
+    node->next_by_end = *end_bucket;
+    *end_bucket = index;
+
+    tlsf->free_space += node->size;
+}
+
+static void tlsf_remove(tlsf_state* tlsf, u32 index) {
+    tlsf_node* node = &tlsf->nodes[index];
+    u32 fl, sl;
+    tlsf_mapping(node->size, &fl, &sl);
+
+    // Unlink from the size class list, clearing bitmaps if it is now empty.
+    if (node->prev_in_class != TLSF_NULL) {
+        tlsf->nodes[node->prev_in_class].next_in_class = node->next_in_class;
+    } else {
+        tlsf->heads[fl][sl] = node->next_in_class;
+        if (node->next_in_class == TLSF_NULL) {
+            tlsf->sl_bitmaps[fl] &= ~(1U << sl);
+            if (!tlsf->sl_bitmaps[fl]) {
+                tlsf->fl_bitmap &= ~(1ULL << fl);
+            }
+        }
+    }
+    if (node->next_in_class != TLSF_NULL) {
+        tlsf->nodes[node->next_in_class].prev_in_class = node->prev_in_class;
+    }
+
+    // Remove from the lookups.
+    tlsf_bucket_remove(tlsf, &tlsf->start_buckets[tlsf_hash(tlsf, node->offset)], index, true);
+    tlsf_bucket_remove(tlsf, &tlsf->end_buckets[tlsf_hash(tlsf, node->offset + node->size)], index, false);
+
+    tlsf->free_space -= node->size;
+}
+
+// Finds a free range of at least size bytes, or TLSF_NULL if there is none.
+static u32 tlsf_find_suitable(const tlsf_state* tlsf, u64 size) {
+    u32 fl, sl;
+    // Round up to the next size class so that any range in the class found is large enough.
+    u64 search_size = size;
+    if (size >= TLSF_SL_COUNT) {
+        u32 msb = 63 - (u32)__builtin_clzll(size);
+        u64 round = (1ULL << (msb - TLSF_SL_LOG2)) - 1;
+        if (size <= U64_MAX - round) {
+            search_size += round;
+        }
+    }
+    tlsf_mapping(search_size, &fl, &sl);
+
+    if (fl < TLSF_FL_COUNT) {
+        u32 sl_map = tlsf->sl_bitmaps[fl] & (~0U << sl);
+        if (!sl_map) {
+            u64 fl_map = tlsf->fl_bitmap & (~0ULL << (fl + 1));
+            if (fl_map) {
+                fl = (u32)__builtin_ctzll(fl_map);
+                sl_map = tlsf->sl_bitmaps[fl];
+            }
+        }
+        if (sl_map) {
+            return tlsf->heads[fl][__builtin_ctz(sl_map)];
+        }
+    }
+
+    // Nothing in a larger class. The class containing size may still hold a range which fits.
+    tlsf_mapping(size, &fl, &sl);
+    u32 index = tlsf->heads[fl][sl];
+    while (index != TLSF_NULL) {
+        if (tlsf->nodes[index].size >= size) {
+            return index;
+        }
+        index = tlsf->nodes[index].next_in_class;
+    }
+    return TLSF_NULL;
+}
+
+static b8 tlsf_allocate_block(internal_state* state, u64 size, u64* out_offset) {
+    tlsf_state* tlsf = state->tlsf;
+    u32 index = tlsf_find_suitable(tlsf, size);
+    if (index == TLSF_NULL) {
+        KWARN("freelist_find_block, no block with enough free space found (requested: %lluB, available: %lluB).", size, tlsf->free_space);
+        return false;
+    }
+
+    tlsf_remove(tlsf, index);
+    tlsf_node* node = &tlsf->nodes[index];
+    *out_offset = node->offset;
+    if (node->size > size) {
+        // Return the remainder to the list.
+        node->offset += size;
+        node->size -= size;
+        tlsf_insert(tlsf, index);
+    } else {
+        tlsf_node_release(tlsf, index);
+    }
+    return true;
+}
+
+static b8 tlsf_free_block(internal_state* state, u64 size, u64 offset) {
+    tlsf_state* tlsf = state->tlsf;
+    if (tlsf_find_by_start(tlsf, offset) != TLSF_NULL) {
+        KFATAL("Attempting to free already-freed block of memory at offset %llu", offset);
+        return false;
+    }
+
+    // Merge with free neighbours on either side.
+    u32 left = tlsf_find_by_end(tlsf, offset);
+    u32 right = tlsf_find_by_start(tlsf, offset + size);
+    u32 index = TLSF_NULL;
+    if (left != TLSF_NULL) {
+        tlsf_remove(tlsf, left);
+        tlsf->nodes[left].size += size;
+        index = left;
+    }
+    if (right != TLSF_NULL) {
+        tlsf_remove(tlsf, right);
+        if (index != TLSF_NULL) {
+            tlsf->nodes[index].size += tlsf->nodes[right].size;
+            tlsf_node_release(tlsf, right);
+        } else {
+            tlsf->nodes[right].offset = offset;
+            tlsf->nodes[right].size += size;
+            index = right;
+        }
+    }
+    if (index == TLSF_NULL) {
+        index = tlsf_node_acquire(state);
+        if (index == TLSF_NULL) {
+            KERROR("freelist_free_block ran out of nodes to track free ranges. Memory will be leaked. Check freelist_should_grow before freeing.");
+            return false;
+        }
+        tlsf->nodes[index].offset = offset;
+        tlsf->nodes[index].size = size;
+    }
+
+    tlsf_insert(tlsf, index);
+    return true;
+}
+
+static b8 tlsf_resize(freelist* list, u64* memory_requirement, void* new_memory, u64 new_size, void** out_old_memory) {
+    internal_state* old_state = list->memory;
+    u64 max_entries = tlsf_max_entries(new_size, old_state->tlsf->used_count);
+    *memory_requirement = tlsf_memory_requirement(max_entries);
+    if (!new_memory) {
+        return true;
+    }
+
+    *out_old_memory = list->memory;
+
+    list->memory = new_memory;
+    kzero_memory(list->memory, sizeof(internal_state) + sizeof(tlsf_state));
+    internal_state* state = list->memory;
+    state->mode = FREELIST_MODE_TLSF;
+    state->total_size = new_size;
+    tlsf_setup(state, max_entries);
+
+    // Carry over the free ranges. Unused nodes have a size of 0.
+    tlsf_state* old_tlsf = old_state->tlsf;
+    for (u32 i = 0; i < old_tlsf->next_untouched; ++i) {
+        tlsf_node* old_node = &old_tlsf->nodes[i];
+        if (old_node->size) {
+            tlsf_free_block(state, old_node->size, old_node->offset);
+        }
+    }
+
+    // The new space at the end is free, and merges with any free range at the old end.
+    if (new_size > old_state->total_size) {
+        tlsf_free_block(state, new_size - old_state->total_size, old_state->total_size);
+    }
+    return true;
+}
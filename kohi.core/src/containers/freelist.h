@@ -13,6 +13,24 @@
 
 #include "defines.h"
 
+/**
+ * @brief The strategy used by a freelist to track free ranges.
+ */
+typedef enum freelist_mode {
+    /**
+     * @brief Free ranges are kept in a single list sorted by offset and searched first-fit.
+     * Allocation and free are O(n) in the number of free ranges, but allocations are always
+     * taken from the lowest offset possible.
+     */
+    FREELIST_MODE_LINEAR,
+    /**
+     * @brief Two-level segregated fit. Free ranges are binned by size class and found through
+     * bitmaps, and neighbouring ranges are found through lookup tables, so allocation and free
+     * are O(1) regardless of fragmentation. Uses somewhat more memory for bookkeeping.
+     */
+    FREELIST_MODE_TLSF
+} freelist_mode;
+
 /**
  * @brief A data structure to be used alongside an allocator for dynamic memory
  * allocation. Tracks free ranges of memory.
@@ -34,6 +52,19 @@ typedef struct freelist {
  */
 KAPI void freelist_create(u64 total_size, u64* memory_requirement, void* memory, freelist* out_list);
 
+/**
+ * @brief Creates a new freelist using the given mode, or obtains the memory requirement for one.
+ * Call twice; once passing 0 to memory to obtain memory requirement, and a second
+ * time passing an allocated block to memory. freelist_create uses FREELIST_MODE_LINEAR.
+ *
+ * @param total_size The total size in bytes that the free list should track.
+ * @param mode The strategy used to track free ranges.
+ * @param memory_requirement A pointer to hold memory requirement for the free list itself.
+ * @param memory 0, or a pre-allocated block of memory for the free list to use.
+ * @param out_list A pointer to hold the created free list.
+ */
+KAPI void freelist_create_with_mode(u64 total_size, freelist_mode mode, u64* memory_requirement, void* memory, freelist* out_list);
+
 /**
  * @brief Destroys the provided list.
  * 
@@ -65,7 +96,8 @@ KAPI b8 freelist_free_block(freelist* list, u64 size, u64 offset);
 /**
  * @brief Attempts to resize the provided freelist to the given size. Internal data is copied to the new
  * block of memory. The old block must be freed after this call.
- * NOTE: New size must be _greater_ than the existing size of the given list.
+ * NOTE: New size must be _greater_ than the existing size of the given list. TLSF lists may also be
+ * resized to their current size, which only makes room to track more free ranges (see freelist_should_grow).
  * NOTE: Should be called twice; once to query the memory requirement (passing new_memory=0),
  * and a second time to actually resize the list.
  * 
@@ -86,11 +118,22 @@ KAPI b8 freelist_resize(freelist* list, u64* memory_requirement, void* new_memor
 KAPI void freelist_clear(freelist* list);
 
 /**
- * @brief Returns the amount of free space in this list. NOTE: Since this has
- * to iterate the entire internal list, this can be an expensive operation.
+ * @brief Returns the amount of free space in this list. NOTE: For linear lists this
+ * has to iterate the entire internal list, and can be an expensive operation.
  * Use sparingly.
  * 
  * @param list A pointer to the list to obtain from.
  * @return The amount of free space in bytes.
  */
 KAPI u64 freelist_free_space(freelist* list);
+
+/**
+ * @brief Indicates if the list is about to run out of room to track free ranges. TLSF lists size
+ * this for typical fragmentation rather than the worst case, so owners should check this before
+ * freeing and resize the list (to its current size, if need be) when it returns true.
+ * Always false for linear lists.
+ *
+ * @param list A pointer to the list to check.
+ * @return True if the list should be resized before more blocks are freed; otherwise false.
+ */
+KAPI b8 freelist_should_grow(freelist* list);
@@ -0,0 +1,276 @@
+#include "hashmap.h"
+
+#include "logger.h"
+#include "memory/kmemory.h"
+#include "strings/kstring.h"
+#include "utils/crc64.h"
+
+// The smallest number of slots a map will have.
+#define HASHMAP_MIN_CAPACITY 8
+// Distances are stored in a u8, offset by one so that 0 can mean empty.
+#define HASHMAP_MAX_DISTANCE 255
+
+// Mixes the bits of the key so that sequential keys (i.e. indices) spread evenly across slots.
+static u64 hash_key(u64 key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return key;
+}
+
+static u64 hashmap_memory_requirement(u32 element_size, u32 capacity) {
+    // Keys first to keep them aligned, then values, then distances.
+    return (sizeof(u64) * capacity) + ((u64)element_size * capacity) + (sizeof(u8) * capacity);
+}
+
+static void* value_at(const hashmap* map, u32 index) {
+    return (u8*)map->values + ((u64)map->element_size * index);
+}
+
+static void hashmap_assign_memory(hashmap* map, u32 capacity) {
+    void* block = kallocate(hashmap_memory_requirement(map->element_size, capacity), MEMORY_TAG_HASHTABLE);
+    map->capacity = capacity;
+    map->keys = block;
+    map->values = (u8*)block + (sizeof(u64) * capacity);
+    map->distances = (u8*)map->values + ((u64)map->element_size * capacity);
+}
+
+static void hashmap_free_memory(hashmap* map) {
+    if (map->keys) {
+        kfree(map->keys, hashmap_memory_requirement(map->element_size, map->capacity), MEMORY_TAG_HASHTABLE);
+    }
+    map->keys = 0;
+    map->values = 0;
+    map->distances = 0;
+}
+
+// Returns the slot index of the key, or INVALID_ID if not found.
+static u32 find_index(const hashmap* map, u64 key) {
+    if (!map->count) {
+        return INVALID_ID;
+    }
+    u32 mask = map->capacity - 1;
+    u32 index = (u32)(hash_key(key) & mask);
+    u32 distance = 1;
+    while (true) {
+        u32 slot_distance = map->distances[index];
+        // Once an entry closer to its ideal slot is hit (or an empty slot), the key cannot be further along.
+        if (slot_distance < distance) {
+            return INVALID_ID;
+        }
+        if (map->keys[index] == key) {
+            return index;
+        }
+        index = (index + 1) & mask;
+        distance++;
+    }
+}
+
+static b8 hashmap_grow(hashmap* map);
+
+// Inserts a key which is known not to exist in the map.
+static b8 insert_new(hashmap* map, u64 key, const void* value) {
+    u32 mask = map->capacity - 1;
+    u32 index = (u32)(hash_key(key) & mask);
+    u32 distance = 1;
+
+    // Find the first slot that is either empty or whose entry is closer to its ideal slot than this one would be.
+    while (map->distances[index] && map->distances[index] >= distance) {
+        index = (index + 1) & mask;
+        distance++;
+    }
+
+    // Find the end of the run starting at the insertion point, making sure nothing would be pushed too far.
+    u32 end = index;
+    while (map->distances[end]) {
+        if (map->distances[end] >= HASHMAP_MAX_DISTANCE) {
+            return hashmap_grow(map) && insert_new(map, key, value);
+        }
+        end = (end + 1) & mask;
+    }
+    if (distance >= HASHMAP_MAX_DISTANCE) {
+        return hashmap_grow(map) && insert_new(map, key, value);
+    }
+
+    // Shift the run back by one slot to make room, moving each entry one further from its ideal slot.
+    while (end != index) {
+        u32 prev = (end - 1) & mask;
+        map->keys[end] = map->keys[prev];
+        map->distances[end] = map->distances[prev] + 1;
+        kcopy_memory(value_at(map, end), value_at(map, prev), map->element_size);
+        end = prev;
+    }
+
+    map->keys[index] = key;
+    map->distances[index] = (u8)distance;
+    kcopy_memory(value_at(map, index), value, map->element_size);
+    map->count++;
+    return true;
+}
+
+static b8 hashmap_grow(hashmap* map) {
+    hashmap old = *map;
+
+    hashmap_assign_memory(map, old.capacity * 2);
+    kzero_memory(map->distances, sizeof(u8) * map->capacity);
+    map->count = 0;
+
+    // Reinsert everything.
+    for (u32 i = 0; i < old.capacity; ++i) {
+        if (old.distances[i]) {
+            if (!insert_new(map, old.keys[i], value_at(&old, i))) {
+                KERROR("hashmap_grow failed to reinsert an entry. The map is likely corrupted.");
+                hashmap_free_memory(&old);
+                return false;
+            }
+        }
+    }
+
+    hashmap_free_memory(&old);
+    return true;
+}
+
+b8 hashmap_create(u32 element_size, u32 initial_capacity, hashmap* out_map) {
+    if (!out_map) {
+        KERROR("hashmap_create requires a valid pointer to hold the map.");
+        return false;
+    }
+    if (!element_size) {
+        KERROR("hashmap_create - element_size must be a positive non-zero value.");
+        return false;
+    }
+
+    kzero_memory(out_map, sizeof(hashmap));
+    out_map->element_size = element_size;
+
+    // Make enough room to hold the initial capacity without growing, rounded up to a power of 2.
+    u64 required = ((u64)initial_capacity * 8) / 7 + 1;
+    u32 capacity = HASHMAP_MIN_CAPACITY;
+    while (capacity < required) {
+        capacity <<= 1;
+    }
+
+    hashmap_assign_memory(out_map, capacity);
+    kzero_memory(out_map->distances, sizeof(u8) * capacity);
+    return true;
+}
+
+void hashmap_destroy(hashmap* map) {
+    if (map) {
+        hashmap_free_memory(map);
+        kzero_memory(map, sizeof(hashmap));
+    }
+}
+
+b8 hashmap_set(hashmap* map, u64 key, const void* value) {
+    if (!map || !value || !map->keys) {
+        KERROR("hashmap_set requires a valid map and value.");
+        return false;
+    }
+
+    u32 index = find_index(map, key);
+    if (index != INVALID_ID) {
+        kcopy_memory(value_at(map, index), value, map->element_size);
+        return true;
+    }
+
+    // Keep the load factor at or below 7/8.
+    if (((u64)map->count + 1) * 8 > (u64)map->capacity * 7) {
+        if (!hashmap_grow(map)) {
+            return false;
+        }
+    }
+
+    return insert_new(map, key, value);
+}
+
+b8 hashmap_get(const hashmap* map, u64 key, void* out_value) {
+    if (!map || !out_value) {
+        KERROR("hashmap_get requires a valid map and out_value.");
+        return false;
+    }
+
+    u32 index = find_index(map, key);
+    if (index == INVALID_ID) {
+        return false;
+    }
+    kcopy_memory(out_value, value_at(map, index), map->element_size);
+    return true;
+}
+
+void* hashmap_get_ref(const hashmap* map, u64 key) {
+    if (!map) {
+        return 0;
+    }
+    u32 index = find_index(map, key);
+    return index == INVALID_ID ? 0 : value_at(map, index);
+}
+
+b8 hashmap_contains(const hashmap* map, u64 key) {
+    return map && find_index(map, key) != INVALID_ID;
+}
+
+b8 hashmap_remove(hashmap* map, u64 key, void* out_value) {
+    if (!map) {
+        return false;
+    }
+
+    u32 index = find_index(map, key);
+    if (index == INVALID_ID) {
+        return false;
+    }
+
+    if (out_value) {
+        kcopy_memory(out_value, value_at(map, index), map->element_size);
+    }
+
+    // Shift following entries back until one is found that is already in its ideal slot (or is empty).
+    u32 mask = map->capacity - 1;
+    u32 next = (index + 1) & mask;
+    while (map->distances[next] > 1) {
+        map->keys[index] = map->keys[next];
+        map->distances[index] = map->distances[next] - 1;
+        kcopy_memory(value_at(map, index), value_at(map, next), map->element_size);
+        index = next;
+        next = (next + 1) & mask;
+    }
+    map->distances[index] = 0;
+    map->count--;
+    return true;
+}
+
+void hashmap_clear(hashmap* map) {
+    if (map && map->distances) {
+        kzero_memory(map->distances, sizeof(u8) * map->capacity);
+        map->count = 0;
+    }
+}
+
+b8 hashmap_next(const hashmap* map, u32* iterator, u64* out_key, void** out_value) {
+    if (!map || !iterator) {
+        return false;
+    }
+
+    while (*iterator < map->capacity) {
+        u32 index = (*iterator)++;
+        if (map->distances[index]) {
+            if (out_key) {
+                *out_key = map->keys[index];
+            }
+            if (out_value) {
+                *out_value = value_at(map, index);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+u64 hashmap_key_from_string(const char* str) {
+    if (!str) {
+        return 0;
+    }
+    return crc64(0, (const u8*)str, string_length(str));
+}
@@ -0,0 +1,152 @@
+/**
+ * @file hashmap.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief A growable hash map keyed by 64-bit values, such as knames, handles
+ * or pre-hashed strings.
+ *
+ * @details
+ * Uses open addressing with Robin Hood probing. Entries which are further from
+ * their ideal slot take the place of those which are closer, which keeps probe
+ * sequences short even at high load. Removals shift the following entries back
+ * instead of leaving tombstones behind, so lookups never slow down over time.
+ * The map grows (doubling its capacity) as required. Unlike hashtable, colliding
+ * keys never overwrite each other.
+ *
+ * Values are copied into the map. To store pointers, use an element size of
+ * sizeof(void*) and pass the address of the pointer.
+ *
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "defines.h"
+#include "identifiers/khandle.h"
+#include "strings/kname.h"
+
+/**
+ * @brief Represents a hash map. Members of this structure should not be
+ * modified outside the functions associated with it.
+ */
+typedef struct hashmap {
+    /** @brief The size of each value in bytes. */
+    u32 element_size;
+    /** @brief The number of slots. Always a power of 2. */
+    u32 capacity;
+    /** @brief The number of entries currently stored. */
+    u32 count;
+    /** @brief The distance of each slot's entry from its ideal slot, plus one. 0 means the slot is empty. */
+    u8* distances;
+    /** @brief The key of each slot. */
+    u64* keys;
+    /** @brief The value of each slot. */
+    void* values;
+} hashmap;
+
+/**
+ * @brief Creates a new hash map.
+ *
+ * @param element_size The size of each value in bytes.
+ * @param initial_capacity The number of entries to make room for up front. The map grows as needed beyond this.
+ * @param out_map A pointer to hold the created map.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 hashmap_create(u32 element_size, u32 initial_capacity, hashmap* out_map);
+
+/**
+ * @brief Destroys the given map, releasing its memory. Does not release memory for pointer values.
+ *
+ * @param map A pointer to the map to be destroyed.
+ */
+KAPI void hashmap_destroy(hashmap* map);
+
+/**
+ * @brief Stores a copy of value under the given key, replacing any existing value.
+ *
+ * @param map A pointer to the map. Required.
+ * @param key The key to store the value under.
+ * @param value A pointer to the value to be copied in. Required.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 hashmap_set(hashmap* map, u64 key, const void* value);
+
+/**
+ * @brief Obtains a copy of the value stored under the given key.
+ *
+ * @param map A pointer to the map. Required.
+ * @param key The key to look up.
+ * @param out_value A pointer to hold a copy of the value. Required.
+ * @returns True if found; otherwise false.
+ */
+KAPI b8 hashmap_get(const hashmap* map, u64 key, void* out_value);
+
+/**
+ * @brief Obtains a pointer to the value stored under the given key.
+ * @note The pointer is only valid until the map is next modified.
+ *
+ * @param map A pointer to the map. Required.
+ * @param key The key to look up.
+ * @returns A pointer to the value if found; otherwise 0.
+ */
+KAPI void* hashmap_get_ref(const hashmap* map, u64 key);
+
+/**
+ * @brief Indicates if an entry exists for the given key.
+ *
+ * @param map A pointer to the map. Required.
+ * @param key The key to look up.
+ * @returns True if found; otherwise false.
+ */
+KAPI b8 hashmap_contains(const hashmap* map, u64 key);
+
+/**
+ * @brief Removes the entry with the given key, if it exists.
+ *
+ * @param map A pointer to the map. Required.
+ * @param key The key of the entry to remove.
+ * @param out_value A pointer to hold a copy of the removed value. Optional.
+ * @returns True if an entry was removed; otherwise false.
+ */
+KAPI b8 hashmap_remove(hashmap* map, u64 key, void* out_value);
+
+/**
+ * @brief Removes all entries from the map. Does not release any memory.
+ *
+ * @param map A pointer to the map. Required.
+ */
+KAPI void hashmap_clear(hashmap* map);
+
+/**
+ * @brief Iterates the entries of the map in no particular order. Start with an iterator
+ * of 0 and call until false is returned. The map must not be modified while iterating.
+ *
+ * @param map A pointer to the map. Required.
+ * @param iterator A pointer to the iteration state. Required.
+ * @param out_key A pointer to hold the key of the entry. Optional.
+ * @param out_value A pointer to hold a pointer to the value of the entry. Optional.
+ * @returns True if an entry was found; false once iteration is complete.
+ */
+KAPI b8 hashmap_next(const hashmap* map, u32* iterator, u64* out_key, void** out_value);
+
+/**
+ * @brief Creates a key from the given string. The string is hashed once here, so the key
+ * should be kept and reused rather than recreated for every lookup. Case-sensitive.
+ *
+ * @param str The string to create a key for.
+ * @returns The key.
+ */
+KAPI u64 hashmap_key_from_string(const char* str);
+
+/** @brief Creates a key from the given kname. */
+KINLINE u64 hashmap_key_from_kname(kname name) {
+    return name;
+}
+
+/** @brief Creates a key from the given handle. Handles with the same index but different unique ids are different keys. */
+KINLINE u64 hashmap_key_from_khandle(khandle handle) {
+    return handle.unique_id.uniqueid ^ ((u64)handle.handle_index * 0x9E3779B97F4A7C15ULL);
+}
@@ -21,6 +21,9 @@
  * pointer types, make sure to use the _ptr setter and getter. Table
  * does not take ownership of pointers or associated memory allocations,
  * and should be managed externally.
+ *
+ * @note Colliding keys overwrite each other, and the table cannot grow.
+ * Prefer hashmap (containers/hashmap.h) for new code.
  */
 typedef struct hashtable {
     u64 element_size;
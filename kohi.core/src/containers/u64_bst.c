@@ -1,9 +1,34 @@
 #include "u64_bst.h"
 #include "defines.h"
+#include "memory/allocators/pool_allocator.h"
 #include "memory/kmemory.h"
+#include "threads/katomic.h"
+
+// The number of nodes allocated at once when the node pool runs out.
+#define BST_NODES_PER_PAGE 256
+
+// All nodes of all trees come from one pool, since trees are only represented by their root node.
+static pool_allocator node_pool;
+// 0 = not created, 1 = being created, 2 = ready.
+static volatile u32 node_pool_state = 0;
+
+static pool_allocator* get_node_pool(void) {
+    if (katomic_load_u32(&node_pool_state) != 2) {
+        if (katomic_compare_exchange_u32(&node_pool_state, 0, 1)) {
+            pool_allocator_create(sizeof(bt_node), BST_NODES_PER_PAGE, true, MEMORY_TAG_BST, &node_pool);
+            katomic_store_u32(&node_pool_state, 2);
+        } else {
+            // Another thread is creating it.
+            while (katomic_load_u32(&node_pool_state) != 2) {
+                katomic_pause();
+            }
+        }
+    }
+    return &node_pool;
+}
 
 static bt_node* node_create(u64 key, bt_node_value value) {
-    bt_node* node = kallocate(sizeof(bt_node), MEMORY_TAG_BST);
+    bt_node* node = pool_allocator_allocate(get_node_pool());
     node->key = key;
     node->value = value;
     node->left = node->right = 0;
@@ -41,7 +66,7 @@ KAPI bt_node* u64_bst_delete(bt_node* root, u64 key) {
         root->left = u64_bst_delete(root->left, key);
     } else {
         if (!root->left && !root->right) {
-            kfree(root, sizeof(bt_node), MEMORY_TAG_BST);
+            pool_allocator_free(get_node_pool(), root);
             return 0;
         } else if (!root->left || !root->right) {
             bt_node* temp;
@@ -50,7 +75,7 @@ KAPI bt_node* u64_bst_delete(bt_node* root, u64 key) {
             } else {
                 temp = root->left;
             }
-            kfree(root, sizeof(bt_node), MEMORY_TAG_BST);
+            pool_allocator_free(get_node_pool(), root);
             return temp;
         } else {
             bt_node* temp = find_min(root->right);
@@ -81,6 +106,13 @@ void u64_bst_cleanup(bt_node* node) {
             u64_bst_cleanup(node->right);
             node->right = 0;
         }
-        kfree(node, sizeof(bt_node), MEMORY_TAG_BST);
+        pool_allocator_free(get_node_pool(), node);
+    }
+}
+
+void u64_bst_shutdown(void) {
+    if (katomic_compare_exchange_u32(&node_pool_state, 2, 1)) {
+        pool_allocator_destroy(&node_pool);
+        katomic_store_u32(&node_pool_state, 0);
     }
 }
@@ -64,3 +64,11 @@ KAPI const bt_node* u64_bst_find(const bt_node* root, u64 key);
  * @param node A pointer to the node to cleanup.
  */
 KAPI void u64_bst_cleanup(bt_node* node);
+
+/**
+ * Releases the node pool shared by all trees. Any nodes still in use by any
+ * tree are freed along with it, so this should only be called once no trees
+ * are in use (i.e. during memory system shutdown). The pool is created again
+ * if a tree is used afterward.
+ */
+KAPI void u64_bst_shutdown(void);
@@ -191,6 +191,8 @@ typedef struct shader_attribute {
     shader_attribute_type type;
     /** @brief The attribute size in bytes. */
     u32 size;
+    /** @brief Indicates the attribute advances once per instance instead of once per vertex. */
+    b8 per_instance;
 } shader_attribute;
 
 /**
@@ -274,6 +276,8 @@ typedef struct shader_attribute_config {
     u8 size;
     /** @brief The type of the attribute. */
     shader_attribute_type type;
+    /** @brief Indicates the attribute advances once per instance instead of once per vertex. */
+    b8 per_instance;
 } shader_attribute_config;
 
 /** @brief Configuration for a uniform. */
@@ -247,6 +247,15 @@ STATIC_ASSERT(sizeof(f64) == 8, "Expected f64 to be 8 bytes.");
 #    define KNOINLINE
 #endif
 
+// Thread-local storage
+#if defined(_MSC_VER) && !defined(__clang__)
+/** @brief Thread-local storage qualifier. Each thread gets its own copy of the variable. */
+#    define KTHREAD_LOCAL __declspec(thread)
+#else
+/** @brief Thread-local storage qualifier. Each thread gets its own copy of the variable. */
+#    define KTHREAD_LOCAL _Thread_local
+#endif
+
 // Deprecation
 #if defined(__clang__) || defined(__gcc__)
 /** @brief Mark something (i.e. a function) as deprecated. */
@@ -0,0 +1,481 @@
+#include "bvh.h"
+
+#include "containers/darray.h"
+#include "debug/kassert.h"
+#include "logger.h"
+#include "math/geometry_3d.h"
+#include "math/kmath.h"
+#include "memory/kmemory.h"
+
+// A balanced tree is never deeper than ~1.44 * log2(leaf count), so this covers far more leaves than could ever fit in memory.
+#define BVH_STACK_SIZE 128
+
+// Leaves whose enlarged box grows this many margins past their actual bounds are refit, so boxes don't stay large after an object shrinks.
+#define BVH_SHRINK_MARGIN_MULTIPLIER 4.0f
+
+static b8 is_leaf(const bvh_node* node) {
+    return node->left == INVALID_ID;
+}
+
+static extents_3d aabb_union(extents_3d a, extents_3d b) {
+    return (extents_3d){vec3_min(a.min, b.min), vec3_max(a.max, b.max)};
+}
+
+static extents_3d aabb_expand(extents_3d a, f32 amount) {
+    vec3 v = vec3_create(amount, amount, amount);
+    return (extents_3d){vec3_sub(a.min, v), vec3_add(a.max, v)};
+}
+
+static b8 aabb_contains(extents_3d outer, extents_3d inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static b8 aabb_overlaps(extents_3d a, extents_3d b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// Half the surface area, which is all that is needed to compare costs.
+static f32 aabb_cost(extents_3d a) {
+    vec3 d = vec3_sub(a.max, a.min);
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static u32 node_allocate(bvh* t) {
+    if (t->free_list == INVALID_ID) {
+        // Grow the pool, then chain the new nodes into the free list.
+        u32 old_capacity = t->capacity;
+        u32 new_capacity = old_capacity ? old_capacity * 2 : 16;
+        bvh_node* new_nodes = kallocate(sizeof(bvh_node) * new_capacity, MEMORY_TAG_ARRAY);
+        if (t->nodes) {
+            kcopy_memory(new_nodes, t->nodes, sizeof(bvh_node) * old_capacity);
+            kfree(t->nodes, sizeof(bvh_node) * old_capacity, MEMORY_TAG_ARRAY);
+        }
+        for (u32 i = old_capacity; i < new_capacity; ++i) {
+            new_nodes[i].parent = (i + 1 < new_capacity) ? i + 1 : INVALID_ID;
+            new_nodes[i].height = -1;
+        }
+        t->nodes = new_nodes;
+        t->capacity = new_capacity;
+        t->free_list = old_capacity;
+    }
+
+    u32 index = t->free_list;
+    bvh_node* node = &t->nodes[index];
+    t->free_list = node->parent;
+    node->parent = INVALID_ID;
+    node->left = INVALID_ID;
+    node->right = INVALID_ID;
+    node->height = 0;
+    node->user_data = 0;
+    return index;
+}
+
+static void node_free(bvh* t, u32 index) {
+    t->nodes[index].parent = t->free_list;
+    t->nodes[index].height = -1;
+    t->free_list = index;
+}
+
+static void child_replace(bvh* t, u32 parent, u32 old_child, u32 new_child) {
+    if (parent == INVALID_ID) {
+        t->root = new_child;
+    } else if (t->nodes[parent].left == old_child) {
+        t->nodes[parent].left = new_child;
+    } else {
+        t->nodes[parent].right = new_child;
+    }
+}
+
+// Performs a rotation at the given node if its children's heights differ by more than 1. Returns the index of the node now in its place.
+static u32 balance(bvh* t, u32 a_index) {
+    bvh_node* a = &t->nodes[a_index];
+    if (is_leaf(a) || a->height < 2) {
+        return a_index;
+    }
+
+    u32 b_index = a->left;
+    u32 c_index = a->right;
+    bvh_node* b = &t->nodes[b_index];
+    bvh_node* c = &t->nodes[c_index];
+    i32 difference = c->height - b->height;
+
+    if (difference > 1) {
+        // Rotate c up, and move the taller of its children up with it.
+        u32 f_index = c->left;
+        u32 g_index = c->right;
+        bvh_node* f = &t->nodes[f_index];
+        bvh_node* g = &t->nodes[g_index];
+
+        c->left = a_index;
+        c->parent = a->parent;
+        a->parent = c_index;
+        child_replace(t, c->parent, a_index, c_index);
+
+        if (f->height > g->height) {
+            c->right = f_index;
+            a->right = g_index;
+            g->parent = a_index;
+            a->aabb = aabb_union(b->aabb, g->aabb);
+            c->aabb = aabb_union(a->aabb, f->aabb);
+            a->height = 1 + KMAX(b->height, g->height);
+            c->height = 1 + KMAX(a->height, f->height);
+        } else {
+            c->right = g_index;
+            a->right = f_index;
+            f->parent = a_index;
+            a->aabb = aabb_union(b->aabb, f->aabb);
+            c->aabb = aabb_union(a->aabb, g->aabb);
+            a->height = 1 + KMAX(b->height, f->height);
+            c->height = 1 + KMAX(a->height, g->height);
+        }
+        return c_index;
+    }
+
+    if (difference < -1) {
+        // Rotate b up, and move the taller of its children up with it.
+        u32 d_index = b->left;
+        u32 e_index = b->right;
+        bvh_node* d = &t->nodes[d_index];
+        bvh_node* e = &t->nodes[e_index];
+
+        b->left = a_index;
+        b->parent = a->parent;
+        a->parent = b_index;
+        child_replace(t, b->parent, a_index, b_index);
+
+        if (d->height > e->height) {
+            b->right = d_index;
+            a->left = e_index;
+            e->parent = a_index;
+            a->aabb = aabb_union(c->aabb, e->aabb);
+            b->aabb = aabb_union(a->aabb, d->aabb);
+            a->height = 1 + KMAX(c->height, e->height);
+            b->height = 1 + KMAX(a->height, d->height);
+        } else {
+            b->right = e_index;
+            a->left = d_index;
+            d->parent = a_index;
+            a->aabb = aabb_union(c->aabb, d->aabb);
+            b->aabb = aabb_union(a->aabb, e->aabb);
+            a->height = 1 + KMAX(c->height, d->height);
+            b->height = 1 + KMAX(a->height, e->height);
+        }
+        return b_index;
+    }
+
+    return a_index;
+}
+
+// Rebalances and refits every node from the given one up to the root.
+static void refit_upward(bvh* t, u32 index) {
+    while (index != INVALID_ID) {
+        index = balance(t, index);
+
+        bvh_node* node = &t->nodes[index];
+        bvh_node* left = &t->nodes[node->left];
+        bvh_node* right = &t->nodes[node->right];
+        node->height = 1 + KMAX(left->height, right->height);
+        node->aabb = aabb_union(left->aabb, right->aabb);
+
+        index = node->parent;
+    }
+}
+
+static void leaf_insert(bvh* t, u32 leaf) {
+    if (t->root == INVALID_ID) {
+        t->root = leaf;
+        t->nodes[leaf].parent = INVALID_ID;
+        return;
+    }
+
+    // Walk down the tree to find the sibling which adds the least surface area.
+    extents_3d leaf_aabb = t->nodes[leaf].aabb;
+    u32 index = t->root;
+    while (!is_leaf(&t->nodes[index])) {
+        const bvh_node* node = &t->nodes[index];
+        f32 area = aabb_cost(node->aabb);
+        f32 combined_area = aabb_cost(aabb_union(node->aabb, leaf_aabb));
+
+        // The cost of making a new parent for this node and the leaf.
+        f32 cost = 2.0f * combined_area;
+        // The minimum cost of pushing the leaf further down, which grows every ancestor.
+        f32 inheritance_cost = 2.0f * (combined_area - area);
+
+        f32 child_costs[2];
+        u32 children[2] = {node->left, node->right};
+        for (u32 i = 0; i < 2; ++i) {
+            const bvh_node* child = &t->nodes[children[i]];
+            f32 union_area = aabb_cost(aabb_union(child->aabb, leaf_aabb));
+            child_costs[i] = (is_leaf(child) ? union_area : union_area - aabb_cost(child->aabb)) + inheritance_cost;
+        }
+
+        if (cost < child_costs[0] && cost < child_costs[1]) {
+            break;
+        }
+        index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+    }
+
+    // Create a new parent for the sibling and the leaf. NOTE: may grow the pool, so no node pointers are held across this.
+    u32 sibling = index;
+    u32 old_parent = t->nodes[sibling].parent;
+    u32 new_parent = node_allocate(t);
+    t->nodes[new_parent].parent = old_parent;
+    t->nodes[new_parent].aabb = aabb_union(leaf_aabb, t->nodes[sibling].aabb);
+    t->nodes[new_parent].height = t->nodes[sibling].height + 1;
+    t->nodes[new_parent].left = sibling;
+    t->nodes[new_parent].right = leaf;
+    child_replace(t, old_parent, sibling, new_parent);
+    t->nodes[sibling].parent = new_parent;
+    t->nodes[leaf].parent = new_parent;
+
+    refit_upward(t, old_parent);
+}
+
+static void leaf_remove(bvh* t, u32 leaf) {
+    if (leaf == t->root) {
+        t->root = INVALID_ID;
+        return;
+    }
+
+    // The leaf's parent is removed along with it, and the sibling takes its place.
+    u32 parent = t->nodes[leaf].parent;
+    u32 grandparent = t->nodes[parent].parent;
+    u32 sibling = t->nodes[parent].left == leaf ? t->nodes[parent].right : t->nodes[parent].left;
+
+    child_replace(t, grandparent, parent, sibling);
+    t->nodes[sibling].parent = grandparent;
+    node_free(t, parent);
+
+    refit_upward(t, grandparent);
+}
+
+b8 bvh_create(u32 initial_capacity, f32 margin, bvh* out_bvh) {
+    if (!out_bvh) {
+        KERROR("bvh_create requires a valid pointer to out_bvh.");
+        return false;
+    }
+
+    kzero_memory(out_bvh, sizeof(bvh));
+    out_bvh->root = INVALID_ID;
+    out_bvh->free_list = INVALID_ID;
+    out_bvh->margin = margin;
+
+    if (initial_capacity) {
+        out_bvh->nodes = kallocate(sizeof(bvh_node) * initial_capacity, MEMORY_TAG_ARRAY);
+        for (u32 i = 0; i < initial_capacity; ++i) {
+            out_bvh->nodes[i].parent = (i + 1 < initial_capacity) ? i + 1 : INVALID_ID;
+            out_bvh->nodes[i].height = -1;
+        }
+        out_bvh->capacity = initial_capacity;
+        out_bvh->free_list = 0;
+    }
+    return true;
+}
+
+void bvh_destroy(bvh* t) {
+    if (t) {
+        if (t->nodes) {
+            kfree(t->nodes, sizeof(bvh_node) * t->capacity, MEMORY_TAG_ARRAY);
+        }
+        kzero_memory(t, sizeof(bvh));
+        t->root = INVALID_ID;
+        t->free_list = INVALID_ID;
+    }
+}
+
+bvh_id bvh_insert(bvh* t, extents_3d aabb, u64 user_data) {
+    u32 leaf = node_allocate(t);
+    t->nodes[leaf].aabb = aabb_expand(aabb, t->margin);
+    t->nodes[leaf].user_data = user_data;
+    leaf_insert(t, leaf);
+    t->leaf_count++;
+    return leaf;
+}
+
+void bvh_remove(bvh* t, bvh_id id) {
+    KASSERT_DEBUG(id < t->capacity && is_leaf(&t->nodes[id]) && t->nodes[id].height == 0);
+    leaf_remove(t, id);
+    node_free(t, id);
+    t->leaf_count--;
+}
+
+b8 bvh_update(bvh* t, bvh_id id, extents_3d aabb) {
+    KASSERT_DEBUG(id < t->capacity && is_leaf(&t->nodes[id]) && t->nodes[id].height == 0);
+
+    extents_3d fat = t->nodes[id].aabb;
+    if (aabb_contains(fat, aabb)) {
+        // Still fits. Only refit if the object has shrunk well inside its box.
+        extents_3d loose = aabb_expand(aabb, t->margin * BVH_SHRINK_MARGIN_MULTIPLIER);
+        if (aabb_contains(loose, fat)) {
+            return false;
+        }
+    }
+
+    leaf_remove(t, id);
+    t->nodes[id].aabb = aabb_expand(aabb, t->margin);
+    leaf_insert(t, id);
+    return true;
+}
+
+u64 bvh_user_data_get(const bvh* t, bvh_id id) {
+    KASSERT_DEBUG(id < t->capacity && t->nodes[id].height == 0);
+    return t->nodes[id].user_data;
+}
+
+void bvh_query_aabb(const bvh* t, extents_3d aabb, u64** out_user_data) {
+    if (!t || t->root == INVALID_ID) {
+        return;
+    }
+
+    u32 stack[BVH_STACK_SIZE];
+    u32 stack_count = 0;
+    stack[stack_count++] = t->root;
+    while (stack_count) {
+        const bvh_node* node = &t->nodes[stack[--stack_count]];
+        if (!aabb_overlaps(node->aabb, aabb)) {
+            continue;
+        }
+        if (is_leaf(node)) {
+            darray_push(*out_user_data, node->user_data);
+        } else {
+            stack[stack_count++] = node->left;
+            stack[stack_count++] = node->right;
+        }
+    }
+}
+
+// Pushes the user data of every leaf under the given node, without testing any of them.
+static void subtree_gather(const bvh* t, u32 index, u64** out_user_data) {
+    u32 stack[BVH_STACK_SIZE];
+    u32 stack_count = 0;
+    stack[stack_count++] = index;
+    while (stack_count) {
+        const bvh_node* node = &t->nodes[stack[--stack_count]];
+        if (is_leaf(node)) {
+            darray_push(*out_user_data, node->user_data);
+        } else {
+            stack[stack_count++] = node->left;
+            stack[stack_count++] = node->right;
+        }
+    }
+}
+
+void bvh_query_frustum(const bvh* t, const frustum* f, u64** out_user_data) {
+    if (!t || !f || t->root == INVALID_ID) {
+        return;
+    }
+
+    u32 stack[BVH_STACK_SIZE];
+    u32 stack_count = 0;
+    stack[stack_count++] = t->root;
+    while (stack_count) {
+        u32 index = stack[--stack_count];
+        const bvh_node* node = &t->nodes[index];
+
+        vec3 center = extents_3d_half(node->aabb);
+        vec3 half_extents = vec3_mul_scalar(vec3_sub(node->aabb.max, node->aabb.min), 0.5f);
+
+        b8 outside = false;
+        b8 inside = true;
+        for (u32 i = 0; i < FRUSTUM_SIDE_COUNT; ++i) {
+            const plane_3d* p = &f->sides[i];
+            f32 r = half_extents.x * kabs(p->normal.x) + half_extents.y * kabs(p->normal.y) + half_extents.z * kabs(p->normal.z);
+            f32 d = plane_signed_distance(p, &center);
+            if (d < -r) {
+                outside = true;
+                break;
+            }
+            if (d < r) {
+                inside = false;
+            }
+        }
+
+        if (outside) {
+            continue;
+        }
+        if (inside || is_leaf(node)) {
+            subtree_gather(t, index, out_user_data);
+        } else {
+            stack[stack_count++] = node->left;
+            stack[stack_count++] = node->right;
+        }
+    }
+}
+
+// Slab test. Returns true if the ray enters the box before max_distance.
+static b8 ray_hits_aabb(extents_3d aabb, vec3 origin, vec3 inv_direction, f32 max_distance) {
+    f32 t_min = 0.0f;
+    f32 t_max = max_distance;
+    for (u32 i = 0; i < 3; ++i) {
+        f32 t0 = (aabb.min.elements[i] - origin.elements[i]) * inv_direction.elements[i];
+        f32 t1 = (aabb.max.elements[i] - origin.elements[i]) * inv_direction.elements[i];
+        if (t0 > t1) {
+            KSWAP(f32, t0, t1);
+        }
+        t_min = KMAX(t_min, t0);
+        t_max = KMIN(t_max, t1);
+        if (t_min > t_max) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void bvh_query_ray(const bvh* t, const ray* r, f32 max_distance, u64** out_user_data) {
+    if (!t || !r || t->root == INVALID_ID) {
+        return;
+    }
+
+    // Avoid dividing by zero for axis-aligned rays. A huge value behaves the same in the slab test.
+    vec3 inv_direction;
+    for (u32 i = 0; i < 3; ++i) {
+        f32 d = r->direction.elements[i];
+        if (kabs(d) < K_FLOAT_EPSILON) {
+            d = d < 0.0f ? -K_FLOAT_EPSILON : K_FLOAT_EPSILON;
+        }
+        inv_direction.elements[i] = 1.0f / d;
+    }
+
+    u32 stack[BVH_STACK_SIZE];
+    u32 stack_count = 0;
+    stack[stack_count++] = t->root;
+    while (stack_count) {
+        const bvh_node* node = &t->nodes[stack[--stack_count]];
+        if (!ray_hits_aabb(node->aabb, r->origin, inv_direction, max_distance)) {
+            continue;
+        }
+        if (is_leaf(node)) {
+            darray_push(*out_user_data, node->user_data);
+        } else {
+            stack[stack_count++] = node->left;
+            stack[stack_count++] = node->right;
+        }
+    }
+}
+
+void bvh_query_line(const bvh* t, vec3 point, vec3 direction, f32 radius, u64** out_user_data) {
+    if (!t || t->root == INVALID_ID) {
+        return;
+    }
+
+    u32 stack[BVH_STACK_SIZE];
+    u32 stack_count = 0;
+    stack[stack_count++] = t->root;
+    while (stack_count) {
+        const bvh_node* node = &t->nodes[stack[--stack_count]];
+        vec3 center = extents_3d_half(node->aabb);
+        f32 node_radius = vec3_distance(node->aabb.max, center);
+        if (vec3_distance_to_line(center, point, direction) - node_radius > radius) {
+            continue;
+        }
+        if (is_leaf(node)) {
+            darray_push(*out_user_data, node->user_data);
+        } else {
+            stack[stack_count++] = node->left;
+            stack[stack_count++] = node->right;
+        }
+    }
+}
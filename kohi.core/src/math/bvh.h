@@ -0,0 +1,159 @@
+/**
+ * @file bvh.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief A dynamic bounding volume hierarchy of axis-aligned boxes, used to
+ * accelerate spatial queries such as raycasts and frustum culling.
+ * @details Each leaf holds a box enlarged by a margin, along with user data
+ * (i.e. an index or handle to whatever the box bounds). As long as an object
+ * stays inside its enlarged box, moving it costs nothing. Otherwise, its leaf is
+ * removed and reinserted. Inserting picks the sibling which adds the least surface
+ * area to the tree, and the tree is kept balanced with rotations, so queries stay
+ * O(log n) for well-distributed objects.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "defines.h"
+#include "math/math_types.h"
+
+struct ray;
+
+/** @brief The identifier of a leaf in a bvh. */
+typedef u32 bvh_id;
+
+/** @brief A single node of a bvh. */
+typedef struct bvh_node {
+    /** @brief The bounds of this node. For leaves, this is enlarged by the tree's margin. */
+    extents_3d aabb;
+    /** @brief The data provided when the leaf was inserted. Unused by branches. */
+    u64 user_data;
+    /** @brief The index of the parent node. When the node is free, this is the index of the next free node instead. */
+    u32 parent;
+    /** @brief The index of the left child node. INVALID_ID for leaves. */
+    u32 left;
+    /** @brief The index of the right child node. INVALID_ID for leaves. */
+    u32 right;
+    /** @brief The height of the node in the tree. 0 for leaves, -1 for free nodes. */
+    i32 height;
+} bvh_node;
+
+/**
+ * @brief A dynamic bounding volume hierarchy. Members should not be modified
+ * outside the functions associated with it.
+ */
+typedef struct bvh {
+    /** @brief The node pool. Leaves and branches are both stored here. */
+    bvh_node* nodes;
+    /** @brief The number of nodes allocated in the pool. */
+    u32 capacity;
+    /** @brief The index of the root node, or INVALID_ID if the tree is empty. */
+    u32 root;
+    /** @brief The index of the first free node, or INVALID_ID if there is none. */
+    u32 free_list;
+    /** @brief The number of leaves in the tree. */
+    u32 leaf_count;
+    /** @brief The amount each leaf's box is enlarged by on each side. */
+    f32 margin;
+} bvh;
+
+/**
+ * @brief Creates a new, empty bvh.
+ *
+ * @param initial_capacity The number of nodes to allocate up front. A tree of n leaves uses 2n - 1 nodes. Grows as needed.
+ * @param margin The amount leaf boxes are enlarged by on each side. Larger values mean fewer reinserts for moving objects, but looser queries.
+ * @param out_bvh A pointer to hold the created tree.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 bvh_create(u32 initial_capacity, f32 margin, bvh* out_bvh);
+
+/**
+ * @brief Destroys the given bvh, releasing its memory.
+ *
+ * @param t A pointer to the tree to be destroyed.
+ */
+KAPI void bvh_destroy(bvh* t);
+
+/**
+ * @brief Inserts a new leaf into the tree.
+ *
+ * @param t A pointer to the tree.
+ * @param aabb The bounds of the object.
+ * @param user_data Data to be handed back by queries for this leaf.
+ * @returns The id of the new leaf.
+ */
+KAPI bvh_id bvh_insert(bvh* t, extents_3d aabb, u64 user_data);
+
+/**
+ * @brief Removes the given leaf from the tree. The id should not be used afterward.
+ *
+ * @param t A pointer to the tree.
+ * @param id The id of the leaf to be removed.
+ */
+KAPI void bvh_remove(bvh* t, bvh_id id);
+
+/**
+ * @brief Updates the bounds of the given leaf. Only changes the tree if the new bounds
+ * no longer fit within the leaf's enlarged box, or if they are much smaller than it.
+ *
+ * @param t A pointer to the tree.
+ * @param id The id of the leaf to be updated.
+ * @param aabb The new bounds of the object.
+ * @returns True if the leaf was reinserted; otherwise false.
+ */
+KAPI b8 bvh_update(bvh* t, bvh_id id, extents_3d aabb);
+
+/**
+ * @brief Obtains the user data of the given leaf.
+ *
+ * @param t A constant pointer to the tree.
+ * @param id The id of the leaf.
+ * @returns The user data provided when the leaf was inserted.
+ */
+KAPI u64 bvh_user_data_get(const bvh* t, bvh_id id);
+
+/**
+ * @brief Finds all leaves whose enlarged box overlaps the given box.
+ *
+ * @param t A constant pointer to the tree.
+ * @param aabb The box to test against.
+ * @param out_user_data A pointer to a darray, which the user data of each leaf found is pushed to.
+ */
+KAPI void bvh_query_aabb(const bvh* t, extents_3d aabb, u64** out_user_data);
+
+/**
+ * @brief Finds all leaves whose enlarged box is at least partially inside the given frustum.
+ * Entire subtrees found to be inside the frustum are gathered without further testing.
+ *
+ * @param t A constant pointer to the tree.
+ * @param f A constant pointer to the frustum to test against.
+ * @param out_user_data A pointer to a darray, which the user data of each leaf found is pushed to.
+ */
+KAPI void bvh_query_frustum(const bvh* t, const frustum* f, u64** out_user_data);
+
+/**
+ * @brief Finds all leaves whose enlarged box is hit by the given ray. Leaves are
+ * not given in any particular order, and should be tested more precisely by the caller.
+ *
+ * @param t A constant pointer to the tree.
+ * @param r A constant pointer to the ray. The direction does not need to be normalized.
+ * @param max_distance Boxes further than this along the ray (in units of the ray's direction) are ignored.
+ * @param out_user_data A pointer to a darray, which the user data of each leaf found is pushed to.
+ */
+KAPI void bvh_query_ray(const bvh* t, const struct ray* r, f32 max_distance, u64** out_user_data);
+
+/**
+ * @brief Finds all leaves whose enlarged box may come within the given distance of an infinite
+ * line. Boxes are treated as their bounding spheres, so results are conservative.
+ *
+ * @param t A constant pointer to the tree.
+ * @param point A point on the line.
+ * @param direction The direction of the line.
+ * @param radius The distance from the line within which leaves are included.
+ * @param out_user_data A pointer to a darray, which the user data of each leaf found is pushed to.
+ */
+KAPI void bvh_query_line(const bvh* t, vec3 point, vec3 direction, f32 radius, u64** out_user_data);
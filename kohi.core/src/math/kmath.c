@@ -3,6 +3,7 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include "math/ksimd.h"
 #include "math/math_types.h"
 #include "math/mtwister.h" // for 64-bit RNG
 #include "platform/platform.h"
@@ -174,6 +175,77 @@ b8 frustum_intersects_aabb(const frustum* f, const vec3* center, const vec3* ext
     return true;
 }
 
+// Loads up to 4 elements of the given array, repeating the last one to fill any remaining lanes.
+static ksimd_f32x4 load_lanes(const f32* values, const u32* indices, u32 start, u32 lane_count) {
+    f32 lanes[4];
+    for (u32 i = 0; i < 4; ++i) {
+        u32 n = start + KMIN(i, lane_count - 1);
+        lanes[i] = values[indices ? indices[n] : n];
+    }
+    return ksimd_f32x4_load(lanes);
+}
+
+void frustum_intersects_aabb_batch(const frustum* f, u32 count, const u32* indices, const f32* centers_x, const f32* centers_y, const f32* centers_z, const f32* extents_x, const f32* extents_y, const f32* extents_z, b8* out_results) {
+    // Broadcast each plane once up front.
+    ksimd_f32x4 normal_x[FRUSTUM_SIDE_COUNT];
+    ksimd_f32x4 normal_y[FRUSTUM_SIDE_COUNT];
+    ksimd_f32x4 normal_z[FRUSTUM_SIDE_COUNT];
+    ksimd_f32x4 abs_normal_x[FRUSTUM_SIDE_COUNT];
+    ksimd_f32x4 abs_normal_y[FRUSTUM_SIDE_COUNT];
+    ksimd_f32x4 abs_normal_z[FRUSTUM_SIDE_COUNT];
+    ksimd_f32x4 distance[FRUSTUM_SIDE_COUNT];
+    for (u32 p = 0; p < FRUSTUM_SIDE_COUNT; ++p) {
+        const plane_3d* plane = &f->sides[p];
+        normal_x[p] = ksimd_f32x4_set1(plane->normal.x);
+        normal_y[p] = ksimd_f32x4_set1(plane->normal.y);
+        normal_z[p] = ksimd_f32x4_set1(plane->normal.z);
+        abs_normal_x[p] = ksimd_f32x4_set1(kabs(plane->normal.x));
+        abs_normal_y[p] = ksimd_f32x4_set1(kabs(plane->normal.y));
+        abs_normal_z[p] = ksimd_f32x4_set1(kabs(plane->normal.z));
+        distance[p] = ksimd_f32x4_set1(plane->distance);
+    }
+
+    for (u32 i = 0; i < count; i += 4) {
+        u32 lane_count = KMIN(4, count - i);
+        ksimd_f32x4 cx, cy, cz, ex, ey, ez;
+        if (!indices && lane_count == 4) {
+            cx = ksimd_f32x4_load(centers_x + i);
+            cy = ksimd_f32x4_load(centers_y + i);
+            cz = ksimd_f32x4_load(centers_z + i);
+            ex = ksimd_f32x4_load(extents_x + i);
+            ey = ksimd_f32x4_load(extents_y + i);
+            ez = ksimd_f32x4_load(extents_z + i);
+        } else {
+            cx = load_lanes(centers_x, indices, i, lane_count);
+            cy = load_lanes(centers_y, indices, i, lane_count);
+            cz = load_lanes(centers_z, indices, i, lane_count);
+            ex = load_lanes(extents_x, indices, i, lane_count);
+            ey = load_lanes(extents_y, indices, i, lane_count);
+            ez = load_lanes(extents_z, indices, i, lane_count);
+        }
+
+        // A box is outside if it is entirely behind any plane, so keep the worst
+        // (signed distance + projected radius) across all planes.
+        ksimd_f32x4 worst = ksimd_f32x4_set1(K_FLOAT_MAX);
+        for (u32 p = 0; p < FRUSTUM_SIDE_COUNT; ++p) {
+            ksimd_f32x4 d = ksimd_f32x4_mul(normal_x[p], cx);
+            d = ksimd_f32x4_mul_add(normal_y[p], cy, d);
+            d = ksimd_f32x4_mul_add(normal_z[p], cz, d);
+            d = ksimd_f32x4_sub(d, distance[p]);
+            ksimd_f32x4 r = ksimd_f32x4_mul(abs_normal_x[p], ex);
+            r = ksimd_f32x4_mul_add(abs_normal_y[p], ey, r);
+            r = ksimd_f32x4_mul_add(abs_normal_z[p], ez, r);
+            worst = ksimd_f32x4_min(worst, ksimd_f32x4_add(d, r));
+        }
+
+        f32 results[4];
+        ksimd_f32x4_store(results, worst);
+        for (u32 l = 0; l < lane_count; ++l) {
+            out_results[i + l] = results[l] >= 0.0f;
+        }
+    }
+}
+
 void frustum_corner_points_world_space(mat4 projection_view, vec4* corners) {
     mat4 inverse_view_proj = mat4_inverse(projection_view);
 
@@ -198,6 +270,123 @@ f32 vec3_distance_to_line(vec3 point, vec3 line_start, vec3 line_direction) {
     return magnitude / vec3_length(line_direction);
 }
 
+void mat4_mul_batch(u32 count, const u32* indices, const mat4* a, const u32* b_indices, const mat4* b, mat4* out_matrices) {
+    for (u32 i = 0; i < count; ++i) {
+        u32 index = indices ? indices[i] : i;
+        const f32* a_ptr = a[index].data;
+        const f32* b_ptr = b[b_indices ? b_indices[i] : i].data;
+
+        ksimd_f32x4 b0 = ksimd_f32x4_load(b_ptr);
+        ksimd_f32x4 b1 = ksimd_f32x4_load(b_ptr + 4);
+        ksimd_f32x4 b2 = ksimd_f32x4_load(b_ptr + 8);
+        ksimd_f32x4 b3 = ksimd_f32x4_load(b_ptr + 12);
+
+        // Each row of the result is the rows of b, weighted by the same row of a.
+        ksimd_f32x4 rows[4];
+        for (u32 r = 0; r < 4; ++r) {
+            const f32* a_row = a_ptr + (r * 4);
+            ksimd_f32x4 row = ksimd_f32x4_mul(ksimd_f32x4_set1(a_row[0]), b0);
+            row = ksimd_f32x4_mul_add(ksimd_f32x4_set1(a_row[1]), b1, row);
+            row = ksimd_f32x4_mul_add(ksimd_f32x4_set1(a_row[2]), b2, row);
+            rows[r] = ksimd_f32x4_mul_add(ksimd_f32x4_set1(a_row[3]), b3, row);
+        }
+
+        // Only write once everything is read, in case out_matrices is a or b.
+        f32* out_ptr = out_matrices[index].data;
+        ksimd_f32x4_store(out_ptr, rows[0]);
+        ksimd_f32x4_store(out_ptr + 4, rows[1]);
+        ksimd_f32x4_store(out_ptr + 8, rows[2]);
+        ksimd_f32x4_store(out_ptr + 12, rows[3]);
+    }
+}
+
+void mat4_compose_trs_batch(u32 count, const u32* indices, const vec3* positions, const quat* rotations, const vec3* scales, mat4* out_matrices) {
+    const ksimd_f32x4 one = ksimd_f32x4_set1(1.0f);
+    const ksimd_f32x4 two = ksimd_f32x4_set1(2.0f);
+    const ksimd_f32x4 zero = ksimd_f32x4_set1(0.0f);
+
+    // Work on 4 at a time, with each lane of a vector holding a different transform.
+    // The final group is padded by repeating the last transform.
+    for (u32 i = 0; i < count; i += 4) {
+        u32 idx[4];
+        for (u32 l = 0; l < 4; ++l) {
+            u32 n = KMIN(i + l, count - 1);
+            idx[l] = indices ? indices[n] : n;
+        }
+
+        // Load the rotations, then transpose so each vector holds one component of all 4.
+        ksimd_f32x4 x = ksimd_f32x4_load(rotations[idx[0]].elements);
+        ksimd_f32x4 y = ksimd_f32x4_load(rotations[idx[1]].elements);
+        ksimd_f32x4 z = ksimd_f32x4_load(rotations[idx[2]].elements);
+        ksimd_f32x4 w = ksimd_f32x4_load(rotations[idx[3]].elements);
+        ksimd_f32x4_transpose(&x, &y, &z, &w);
+
+        // Normalize.
+        ksimd_f32x4 length = ksimd_f32x4_mul(x, x);
+        length = ksimd_f32x4_mul_add(y, y, length);
+        length = ksimd_f32x4_mul_add(z, z, length);
+        length = ksimd_f32x4_mul_add(w, w, length);
+        length = ksimd_f32x4_sqrt(length);
+        x = ksimd_f32x4_div(x, length);
+        y = ksimd_f32x4_div(y, length);
+        z = ksimd_f32x4_div(z, length);
+        w = ksimd_f32x4_div(w, length);
+
+        ksimd_f32x4 xx = ksimd_f32x4_mul(x, x);
+        ksimd_f32x4 yy = ksimd_f32x4_mul(y, y);
+        ksimd_f32x4 zz = ksimd_f32x4_mul(z, z);
+        ksimd_f32x4 xy = ksimd_f32x4_mul(x, y);
+        ksimd_f32x4 xz = ksimd_f32x4_mul(x, z);
+        ksimd_f32x4 yz = ksimd_f32x4_mul(y, z);
+        ksimd_f32x4 xw = ksimd_f32x4_mul(x, w);
+        ksimd_f32x4 yw = ksimd_f32x4_mul(y, w);
+        ksimd_f32x4 zw = ksimd_f32x4_mul(z, w);
+
+        ksimd_f32x4 sx = ksimd_f32x4_set(scales[idx[0]].x, scales[idx[1]].x, scales[idx[2]].x, scales[idx[3]].x);
+        ksimd_f32x4 sy = ksimd_f32x4_set(scales[idx[0]].y, scales[idx[1]].y, scales[idx[2]].y, scales[idx[3]].y);
+        ksimd_f32x4 sz = ksimd_f32x4_set(scales[idx[0]].z, scales[idx[1]].z, scales[idx[2]].z, scales[idx[3]].z);
+
+        // The rotation matrix, laid out the same as quat_to_mat4, with each row multiplied by the scale.
+        ksimd_f32x4 m00 = ksimd_f32x4_mul(ksimd_f32x4_sub(one, ksimd_f32x4_mul(two, ksimd_f32x4_add(yy, zz))), sx);
+        ksimd_f32x4 m01 = ksimd_f32x4_mul(ksimd_f32x4_mul(two, ksimd_f32x4_sub(xy, zw)), sx);
+        ksimd_f32x4 m02 = ksimd_f32x4_mul(ksimd_f32x4_mul(two, ksimd_f32x4_add(xz, yw)), sx);
+
+        ksimd_f32x4 m10 = ksimd_f32x4_mul(ksimd_f32x4_mul(two, ksimd_f32x4_add(xy, zw)), sy);
+        ksimd_f32x4 m11 = ksimd_f32x4_mul(ksimd_f32x4_sub(one, ksimd_f32x4_mul(two, ksimd_f32x4_add(xx, zz))), sy);
+        ksimd_f32x4 m12 = ksimd_f32x4_mul(ksimd_f32x4_mul(two, ksimd_f32x4_sub(yz, xw)), sy);
+
+        ksimd_f32x4 m20 = ksimd_f32x4_mul(ksimd_f32x4_mul(two, ksimd_f32x4_sub(xz, yw)), sz);
+        ksimd_f32x4 m21 = ksimd_f32x4_mul(ksimd_f32x4_mul(two, ksimd_f32x4_add(yz, xw)), sz);
+        ksimd_f32x4 m22 = ksimd_f32x4_mul(ksimd_f32x4_sub(one, ksimd_f32x4_mul(two, ksimd_f32x4_add(xx, yy))), sz);
+
+        // The translation ends up in the last row untouched.
+        ksimd_f32x4 tx = ksimd_f32x4_set(positions[idx[0]].x, positions[idx[1]].x, positions[idx[2]].x, positions[idx[3]].x);
+        ksimd_f32x4 ty = ksimd_f32x4_set(positions[idx[0]].y, positions[idx[1]].y, positions[idx[2]].y, positions[idx[3]].y);
+        ksimd_f32x4 tz = ksimd_f32x4_set(positions[idx[0]].z, positions[idx[1]].z, positions[idx[2]].z, positions[idx[3]].z);
+        ksimd_f32x4 tw = one;
+
+        // Transpose back so that each vector holds one row of a single matrix.
+        ksimd_f32x4 row0_pad = zero, row1_pad = zero, row2_pad = zero;
+        ksimd_f32x4_transpose(&m00, &m01, &m02, &row0_pad);
+        ksimd_f32x4_transpose(&m10, &m11, &m12, &row1_pad);
+        ksimd_f32x4_transpose(&m20, &m21, &m22, &row2_pad);
+        ksimd_f32x4_transpose(&tx, &ty, &tz, &tw);
+
+        ksimd_f32x4 row0[4] = {m00, m01, m02, row0_pad};
+        ksimd_f32x4 row1[4] = {m10, m11, m12, row1_pad};
+        ksimd_f32x4 row2[4] = {m20, m21, m22, row2_pad};
+        ksimd_f32x4 row3[4] = {tx, ty, tz, tw};
+        u32 lane_count = KMIN(4, count - i);
+        for (u32 l = 0; l < lane_count; ++l) {
+            f32* out_ptr = out_matrices[idx[l]].data;
+            ksimd_f32x4_store(out_ptr, row0[l]);
+            ksimd_f32x4_store(out_ptr + 4, row1[l]);
+            ksimd_f32x4_store(out_ptr + 8, row2[l]);
+            ksimd_f32x4_store(out_ptr + 12, row3[l]);
+        }
+    }
+}
+
 static void seed_randoms(void) {
     u32 ptime_u32;
     u32 ptime_u64;
@@ -1136,6 +1136,37 @@ KINLINE mat4 mat4_mul(mat4 matrix_0, mat4 matrix_1) {
     return out_matrix;
 }
 
+/**
+ * @brief Multiplies matrices in a batch, using SIMD where available. For each entry i,
+ * out_matrices[indices[i]] = mat4_mul(a[indices[i]], b[b_indices[i]]).
+ * @note out_matrices may be the same array as b, as long as no entry of the batch
+ * reads an element of b that another entry of the same batch writes to (i.e. one
+ * level of a hierarchy at a time).
+ *
+ * @param count The number of matrices to multiply.
+ * @param indices Indices into a and out_matrices. Pass 0 to use the first count elements in order.
+ * @param a The first matrices to be multiplied.
+ * @param b_indices Indices into b. Pass 0 to use the first count elements in order.
+ * @param b The second matrices to be multiplied.
+ * @param out_matrices An array to hold the results.
+ */
+KAPI void mat4_mul_batch(u32 count, const u32* indices, const mat4* a, const u32* b_indices, const mat4* b, mat4* out_matrices);
+
+/**
+ * @brief Builds matrices from the provided translations, rotations and scales in a batch,
+ * using SIMD where available. The result of each is the same as
+ * mat4_mul(mat4_scale(s), mat4_mul(quat_to_mat4(r), mat4_translation(t))), but is composed
+ * directly rather than by multiplying matrices together.
+ *
+ * @param count The number of matrices to build.
+ * @param indices Indices into all of the arrays. Pass 0 to use the first count elements in order.
+ * @param positions The translations.
+ * @param rotations The rotations. Need not be normalized.
+ * @param scales The scales.
+ * @param out_matrices An array to hold the results.
+ */
+KAPI void mat4_compose_trs_batch(u32 count, const u32* indices, const vec3* positions, const quat* rotations, const vec3* scales, mat4* out_matrices);
+
 /**
  * @brief Creates and returns an orthographic projection matrix. Typically used
  * to render flat or 2D scenes.
@@ -1777,14 +1808,14 @@ KINLINE f32 quat_dot(quat q_0, quat q_1) {
 
 KINLINE vec3 vec3_min(vec3 vector_0, vec3 vector_1) {
     return vec3_create(
-        KMIN(vector_0.x, vector_1.y),
+        KMIN(vector_0.x, vector_1.x),
         KMIN(vector_0.y, vector_1.y),
         KMIN(vector_0.z, vector_1.z));
 }
 
 KINLINE vec3 vec3_max(vec3 vector_0, vec3 vector_1) {
     return vec3_create(
-        KMAX(vector_0.x, vector_1.y),
+        KMAX(vector_0.x, vector_1.x),
         KMAX(vector_0.y, vector_1.y),
         KMAX(vector_0.z, vector_1.z));
 }
@@ -2131,6 +2162,23 @@ KAPI b8 plane_intersects_aabb(const plane_3d* p, const vec3* center,
 KAPI b8 frustum_intersects_aabb(const frustum* f, const vec3* center,
                                 const vec3* extents);
 
+/**
+ * @brief Performs the same test as frustum_intersects_aabb for many boxes at once, using
+ * SIMD where available. Boxes are provided as separate arrays of each component (SoA).
+ *
+ * @param f A constant pointer to the frustum.
+ * @param count The number of boxes to test.
+ * @param indices Indices into the component arrays of the boxes to test. Pass 0 to test the first count boxes in order.
+ * @param centers_x The x component of each box's center.
+ * @param centers_y The y component of each box's center.
+ * @param centers_z The z component of each box's center.
+ * @param extents_x The x component of each box's half-extents.
+ * @param extents_y The y component of each box's half-extents.
+ * @param extents_z The z component of each box's half-extents.
+ * @param out_results An array of count results, in the same order as tested. True if the box is intersected by or contained within the frustum.
+ */
+KAPI void frustum_intersects_aabb_batch(const frustum* f, u32 count, const u32* indices, const f32* centers_x, const f32* centers_y, const f32* centers_z, const f32* extents_x, const f32* extents_y, const f32* extents_z, b8* out_results);
+
 KINLINE b8 rect_2d_contains_point(rect_2d rect, vec2 point) {
     return (point.x >= rect.x && point.x <= rect.x + rect.width) && (point.y >= rect.y && point.y <= rect.y + rect.height);
 }
@@ -0,0 +1,184 @@
+/**
+ * @file ksimd.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief Contains a small set of 4-wide float vector operations used by the batched
+ * math routines. Uses SSE on x86-64, NEON on ARM64, and falls back to plain scalar
+ * code elsewhere, so callers never need to check for support themselves.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "defines.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#    define KSIMD_SSE 1
+#    include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    define KSIMD_NEON 1
+#    include <arm_neon.h>
+#endif
+
+#if KSIMD_SSE
+/** @brief Four 32-bit floats, operated on together. */
+typedef __m128 ksimd_f32x4;
+#elif KSIMD_NEON
+/** @brief Four 32-bit floats, operated on together. */
+typedef float32x4_t ksimd_f32x4;
+#else
+/** @brief Four 32-bit floats, operated on together. */
+typedef struct ksimd_f32x4 {
+    f32 v[4];
+} ksimd_f32x4;
+#endif
+
+/** @brief Loads four floats from the given address, which does not need to be aligned. */
+KINLINE ksimd_f32x4 ksimd_f32x4_load(const f32* ptr) {
+#if KSIMD_SSE
+    return _mm_loadu_ps(ptr);
+#elif KSIMD_NEON
+    return vld1q_f32(ptr);
+#else
+    return (ksimd_f32x4){{ptr[0], ptr[1], ptr[2], ptr[3]}};
+#endif
+}
+
+/** @brief Stores four floats to the given address, which does not need to be aligned. */
+KINLINE void ksimd_f32x4_store(f32* ptr, ksimd_f32x4 a) {
+#if KSIMD_SSE
+    _mm_storeu_ps(ptr, a);
+#elif KSIMD_NEON
+    vst1q_f32(ptr, a);
+#else
+    ptr[0] = a.v[0];
+    ptr[1] = a.v[1];
+    ptr[2] = a.v[2];
+    ptr[3] = a.v[3];
+#endif
+}
+
+/** @brief Returns a vector with all four elements set to the given value. */
+KINLINE ksimd_f32x4 ksimd_f32x4_set1(f32 value) {
+#if KSIMD_SSE
+    return _mm_set1_ps(value);
+#elif KSIMD_NEON
+    return vdupq_n_f32(value);
+#else
+    return (ksimd_f32x4){{value, value, value, value}};
+#endif
+}
+
+/** @brief Returns a vector made of the given values, in order. */
+KINLINE ksimd_f32x4 ksimd_f32x4_set(f32 x, f32 y, f32 z, f32 w) {
+#if KSIMD_SSE
+    return _mm_setr_ps(x, y, z, w);
+#elif KSIMD_NEON
+    f32 values[4] = {x, y, z, w};
+    return vld1q_f32(values);
+#else
+    return (ksimd_f32x4){{x, y, z, w}};
+#endif
+}
+
+/** @brief Returns a + b, per element. */
+KINLINE ksimd_f32x4 ksimd_f32x4_add(ksimd_f32x4 a, ksimd_f32x4 b) {
+#if KSIMD_SSE
+    return _mm_add_ps(a, b);
+#elif KSIMD_NEON
+    return vaddq_f32(a, b);
+#else
+    return (ksimd_f32x4){{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+#endif
+}
+
+/** @brief Returns a - b, per element. */
+KINLINE ksimd_f32x4 ksimd_f32x4_sub(ksimd_f32x4 a, ksimd_f32x4 b) {
+#if KSIMD_SSE
+    return _mm_sub_ps(a, b);
+#elif KSIMD_NEON
+    return vsubq_f32(a, b);
+#else
+    return (ksimd_f32x4){{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}};
+#endif
+}
+
+/** @brief Returns a * b, per element. */
+KINLINE ksimd_f32x4 ksimd_f32x4_mul(ksimd_f32x4 a, ksimd_f32x4 b) {
+#if KSIMD_SSE
+    return _mm_mul_ps(a, b);
+#elif KSIMD_NEON
+    return vmulq_f32(a, b);
+#else
+    return (ksimd_f32x4){{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+#endif
+}
+
+/** @brief Returns a / b, per element. */
+KINLINE ksimd_f32x4 ksimd_f32x4_div(ksimd_f32x4 a, ksimd_f32x4 b) {
+#if KSIMD_SSE
+    return _mm_div_ps(a, b);
+#elif KSIMD_NEON
+    return vdivq_f32(a, b);
+#else
+    return (ksimd_f32x4){{a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]}};
+#endif
+}
+
+/** @brief Returns a * b + c, per element. */
+KINLINE ksimd_f32x4 ksimd_f32x4_mul_add(ksimd_f32x4 a, ksimd_f32x4 b, ksimd_f32x4 c) {
+#if KSIMD_NEON
+    return vfmaq_f32(c, a, b);
+#else
+    // NOTE: Not fused on SSE, since FMA isn't part of the baseline instruction set.
+    return ksimd_f32x4_add(ksimd_f32x4_mul(a, b), c);
+#endif
+}
+
+/** @brief Returns the smaller of a and b, per element. */
+KINLINE ksimd_f32x4 ksimd_f32x4_min(ksimd_f32x4 a, ksimd_f32x4 b) {
+#if KSIMD_SSE
+    return _mm_min_ps(a, b);
+#elif KSIMD_NEON
+    return vminq_f32(a, b);
+#else
+    return (ksimd_f32x4){{KMIN(a.v[0], b.v[0]), KMIN(a.v[1], b.v[1]), KMIN(a.v[2], b.v[2]), KMIN(a.v[3], b.v[3])}};
+#endif
+}
+
+/** @brief Returns the square root of each element. */
+KINLINE ksimd_f32x4 ksimd_f32x4_sqrt(ksimd_f32x4 a) {
+#if KSIMD_SSE
+    return _mm_sqrt_ps(a);
+#elif KSIMD_NEON
+    return vsqrtq_f32(a);
+#else
+    return (ksimd_f32x4){{__builtin_sqrtf(a.v[0]), __builtin_sqrtf(a.v[1]), __builtin_sqrtf(a.v[2]), __builtin_sqrtf(a.v[3])}};
+#endif
+}
+
+/**
+ * @brief Transposes the 4x4 matrix formed by the given rows in place, so that
+ * each vector then holds what was a column.
+ */
+KINLINE void ksimd_f32x4_transpose(ksimd_f32x4* r0, ksimd_f32x4* r1, ksimd_f32x4* r2, ksimd_f32x4* r3) {
+#if KSIMD_SSE
+    _MM_TRANSPOSE4_PS(*r0, *r1, *r2, *r3);
+#elif KSIMD_NEON
+    float32x4x2_t t01 = vtrnq_f32(*r0, *r1);
+    float32x4x2_t t23 = vtrnq_f32(*r2, *r3);
+    *r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    *r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    *r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    *r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+#else
+    ksimd_f32x4 a = *r0, b = *r1, c = *r2, d = *r3;
+    *r0 = (ksimd_f32x4){{a.v[0], b.v[0], c.v[0], d.v[0]}};
+    *r1 = (ksimd_f32x4){{a.v[1], b.v[1], c.v[1], d.v[1]}};
+    *r2 = (ksimd_f32x4){{a.v[2], b.v[2], c.v[2], d.v[2]}};
+    *r3 = (ksimd_f32x4){{a.v[3], b.v[3], c.v[3], d.v[3]}};
+#endif
+}
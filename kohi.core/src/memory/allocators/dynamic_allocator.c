@@ -10,6 +10,9 @@ typedef struct dynamic_allocator_state {
     freelist list;
     void* freelist_block;
     void* memory_block;
+    // The range of the memory block holding the free list once it has outgrown its original block.
+    u64 grown_freelist_offset;
+    u64 grown_freelist_size;
 } dynamic_allocator_state;
 
 typedef struct alloc_header {
@@ -20,6 +23,8 @@ typedef struct alloc_header {
 // The storage size in bytes of a node's user memory block size
 #define KSIZE_STORAGE sizeof(u32)
 
+static b8 dynamic_allocator_grow_freelist(dynamic_allocator_state* state);
+
 b8 dynamic_allocator_create(u64 total_size, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator) {
     if (total_size < 1) {
         KERROR("dynamic_allocator_create cannot have a total_size of 0. Create failed.");
@@ -30,8 +35,8 @@ b8 dynamic_allocator_create(u64 total_size, u64* memory_requirement, void* memor
         return false;
     }
     u64 freelist_requirement = 0;
-    // Grab the memory requirement for the free list first.
-    freelist_create(total_size, &freelist_requirement, 0, 0);
+    // Grab the memory requirement for the free list first. TLSF keeps allocations O(1) as the heap fragments.
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &freelist_requirement, 0, 0);
 
     *memory_requirement = freelist_requirement + sizeof(dynamic_allocator_state) + total_size;
 
@@ -51,7 +56,7 @@ b8 dynamic_allocator_create(u64 total_size, u64* memory_requirement, void* memor
     state->memory_block = (void*)(state->freelist_block + freelist_requirement);
 
     // Actually create the freelist
-    freelist_create(total_size, &freelist_requirement, state->freelist_block, &state->list);
+    freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &freelist_requirement, state->freelist_block, &state->list);
 
     kzero_memory(state->memory_block, total_size);
     return true;
@@ -148,6 +153,9 @@ b8 dynamic_allocator_free_aligned(dynamic_allocator* allocator, void* block) {
     alloc_header* header = (alloc_header*)((u64)block + *block_size);
     u64 required_size = header->alignment + sizeof(alloc_header) + KSIZE_STORAGE + *block_size;
     u64 offset = (u64)header->start - (u64)state->memory_block;
+    if (freelist_should_grow(&state->list) && !dynamic_allocator_grow_freelist(state)) {
+        KWARN("dynamic_allocator_free_aligned could not grow the free list. The free may fail.");
+    }
     if (!freelist_free_block(&state->list, required_size, offset)) {
         KERROR("dynamic_allocator_free_aligned failed.");
         return false;
@@ -187,3 +195,35 @@ u64 dynamic_allocator_header_size(void) {
     // Enough space for a header and size storage.
     return sizeof(alloc_header) + KSIZE_STORAGE;
 }
+
+static b8 dynamic_allocator_grow_freelist(dynamic_allocator_state* state) {
+    // Resizing to the same size only makes room for more free ranges.
+    u64 requirement = 0;
+    freelist_resize(&state->list, &requirement, 0, state->total_size, 0);
+
+    // The larger free list is carved out of the memory block itself. Allocating never needs more
+    // room in the free list, so this works right up until the block is full. Extra space is kept
+    // so the free list can be aligned.
+    u64 size = requirement + sizeof(u64);
+    u64 offset = 0;
+    if (!freelist_allocate_block(&state->list, size, &offset)) {
+        KERROR("dynamic_allocator_grow_freelist could not find space for a larger free list.");
+        return false;
+    }
+    void* new_block = (void*)get_aligned((u64)state->memory_block + offset, sizeof(u64));
+    void* old_block = 0;
+    if (!freelist_resize(&state->list, &requirement, new_block, state->total_size, &old_block)) {
+        KERROR("dynamic_allocator_grow_freelist failed to resize the free list.");
+        return false;
+    }
+
+    // The original free list sits ahead of the memory block and can't be reused, but any
+    // previously grown one is handed back.
+    if (state->grown_freelist_size) {
+        freelist_free_block(&state->list, state->grown_freelist_size, state->grown_freelist_offset);
+    }
+    state->grown_freelist_offset = offset;
+    state->grown_freelist_size = size;
+    state->freelist_block = new_block;
+    return true;
+}
@@ -0,0 +1,169 @@
+#include "frame_arena.h"
+
+#include "logger.h"
+#include "memory/kmemory.h"
+#include "threads/katomic.h"
+#include "threads/kthread.h"
+
+#define FRAME_ARENA_ALIGNMENT 16
+
+// Used to hand out unique arena ids, so threads never confuse a new arena with an old one at the same address.
+static volatile u32 next_arena_id = 0;
+
+// The slot the calling thread last used, and the arena it belongs to.
+static KTHREAD_LOCAL u32 cached_arena_id = 0;
+static KTHREAD_LOCAL u32 cached_slot = 0;
+
+static u64 slot_frame_size(const frame_arena* arena, u32 slot) {
+    return slot == 0 ? arena->owner_size : arena->thread_size;
+}
+
+static b8 slot_initialize(frame_arena* arena, u32 slot) {
+    u64 frame_size = slot_frame_size(arena, slot);
+    u8* memory = kallocate_aligned(frame_size * arena->frame_count, FRAME_ARENA_ALIGNMENT, MEMORY_TAG_LINEAR_ALLOCATOR);
+    if (!memory) {
+        return false;
+    }
+    for (u8 i = 0; i < arena->frame_count; ++i) {
+        linear_allocator_create(frame_size, memory + (frame_size * i), &arena->allocators[(slot * arena->frame_count) + i]);
+    }
+
+    // Mark the slot as ready last, so the frame reset never sees a partially set up slot.
+    katomic_store_u64(&arena->slot_thread_ids[slot], platform_current_thread_id());
+    return true;
+}
+
+static u32 claimed_slot_count(frame_arena* arena) {
+    u32 claimed = katomic_load_u32(&arena->claimed_count);
+    return KMIN(claimed, arena->max_threads);
+}
+
+// Returns the slot belonging to the calling thread, claiming one if needed, or INVALID_ID on failure.
+static u32 get_thread_slot(frame_arena* arena) {
+    if (cached_arena_id == arena->id) {
+        return cached_slot;
+    }
+
+    // The thread may have used this arena before, then used another.
+    u64 thread_id = platform_current_thread_id();
+    u32 slot = INVALID_ID;
+    u32 claimed = claimed_slot_count(arena);
+    for (u32 i = 0; i < claimed; ++i) {
+        if (katomic_load_u64(&arena->slot_thread_ids[i]) == thread_id) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot == INVALID_ID) {
+        slot = katomic_fetch_add_u32(&arena->claimed_count, 1);
+        if (slot >= arena->max_threads) {
+            KERROR("frame_arena_allocate - more than %u threads have allocated from this arena. Increase max_threads.", arena->max_threads);
+            return INVALID_ID;
+        }
+        if (!slot_initialize(arena, slot)) {
+            KERROR("frame_arena_allocate - failed to allocate memory for thread arena.");
+            return INVALID_ID;
+        }
+    }
+
+    cached_arena_id = arena->id;
+    cached_slot = slot;
+    return slot;
+}
+
+b8 frame_arena_create(u64 owner_size, u64 thread_size, u8 frame_count, u32 max_threads, frame_arena* out_arena) {
+    if (!out_arena || !owner_size || !max_threads) {
+        KERROR("frame_arena_create requires a valid pointer, owner_size and max_threads.");
+        return false;
+    }
+    if (frame_count < 1 || frame_count > FRAME_ARENA_MAX_FRAME_COUNT) {
+        KERROR("frame_arena_create - frame_count must be in the range [1, %u].", FRAME_ARENA_MAX_FRAME_COUNT);
+        return false;
+    }
+
+    kzero_memory(out_arena, sizeof(frame_arena));
+    out_arena->id = katomic_fetch_add_u32(&next_arena_id, 1) + 1;
+    out_arena->frame_count = frame_count;
+    // Keep each frame's block aligned when they are laid out back to back.
+    out_arena->owner_size = get_aligned(owner_size, FRAME_ARENA_ALIGNMENT);
+    out_arena->thread_size = get_aligned(thread_size, FRAME_ARENA_ALIGNMENT);
+    out_arena->max_threads = max_threads;
+    out_arena->slot_thread_ids = kallocate(sizeof(u64) * max_threads, MEMORY_TAG_LINEAR_ALLOCATOR);
+    out_arena->allocators = kallocate(sizeof(linear_allocator) * max_threads * frame_count, MEMORY_TAG_LINEAR_ALLOCATOR);
+
+    // The creating thread takes the first slot right away.
+    out_arena->claimed_count = 1;
+    if (!slot_initialize(out_arena, 0)) {
+        KERROR("frame_arena_create failed to allocate memory.");
+        frame_arena_destroy(out_arena);
+        return false;
+    }
+    cached_arena_id = out_arena->id;
+    cached_slot = 0;
+    return true;
+}
+
+void frame_arena_destroy(frame_arena* arena) {
+    if (arena && arena->allocators) {
+        u32 claimed = claimed_slot_count(arena);
+        for (u32 i = 0; i < claimed; ++i) {
+            if (arena->slot_thread_ids[i]) {
+                // The first frame's allocator points to the start of the slot's block.
+                void* memory = arena->allocators[i * arena->frame_count].memory;
+                kfree_aligned(memory, slot_frame_size(arena, i) * arena->frame_count, FRAME_ARENA_ALIGNMENT, MEMORY_TAG_LINEAR_ALLOCATOR);
+            }
+        }
+        kfree((void*)arena->slot_thread_ids, sizeof(u64) * arena->max_threads, MEMORY_TAG_LINEAR_ALLOCATOR);
+        kfree(arena->allocators, sizeof(linear_allocator) * arena->max_threads * arena->frame_count, MEMORY_TAG_LINEAR_ALLOCATOR);
+        kzero_memory(arena, sizeof(frame_arena));
+    }
+}
+
+void* frame_arena_allocate(frame_arena* arena, u64 size) {
+    if (!arena || !arena->allocators) {
+        KERROR("frame_arena_allocate - provided arena not initialized.");
+        return 0;
+    }
+
+    u32 slot = get_thread_slot(arena);
+    if (slot == INVALID_ID) {
+        return 0;
+    }
+
+    u32 frame = katomic_load_u32(&arena->frame_index);
+    // Padding the size keeps the next allocation aligned as well.
+    return linear_allocator_allocate(&arena->allocators[(slot * arena->frame_count) + frame], get_aligned(size, FRAME_ARENA_ALIGNMENT));
+}
+
+void frame_arena_begin_frame(frame_arena* arena) {
+    if (!arena || !arena->allocators) {
+        return;
+    }
+
+    u32 frame = (katomic_load_u32(&arena->frame_index) + 1) % arena->frame_count;
+    u32 claimed = claimed_slot_count(arena);
+    for (u32 i = 0; i < claimed; ++i) {
+        if (katomic_load_u64(&arena->slot_thread_ids[i])) {
+            // Don't wipe the memory each time, to save on performance.
+            linear_allocator_free_all(&arena->allocators[(i * arena->frame_count) + frame], false);
+        }
+    }
+    katomic_store_u32(&arena->frame_index, frame);
+}
+
+u64 frame_arena_allocated(frame_arena* arena) {
+    if (!arena || !arena->allocators) {
+        return 0;
+    }
+
+    u64 total = 0;
+    u32 frame = katomic_load_u32(&arena->frame_index);
+    u32 claimed = claimed_slot_count(arena);
+    for (u32 i = 0; i < claimed; ++i) {
+        if (katomic_load_u64(&arena->slot_thread_ids[i])) {
+            total += arena->allocators[(i * arena->frame_count) + frame].allocated;
+        }
+    }
+    return total;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file frame_arena.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief This file contains the frame arena implementation.
+ * @details A frame arena is a set of linear allocators, one per thread that uses it, which
+ * are all reset together at the start of a frame. Each thread allocates only from its own
+ * arena, so allocations are lock-free and may be made from job threads. Each thread's arena
+ * is further split into a ring of frames. Beginning a new frame only resets the oldest one,
+ * so memory allocated during a frame stays valid until frame_count - 1 more frames have
+ * begun. This allows data to be handed off to work which completes later (i.e. the GPU
+ * consuming data for a frame in flight) without copying it elsewhere first.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "defines.h"
+#include "memory/allocators/linear_allocator.h"
+
+/** @brief The largest number of frames a frame arena may keep alive at once. */
+#define FRAME_ARENA_MAX_FRAME_COUNT 4
+
+/**
+ * @brief The data structure for a frame arena. Members should not be modified
+ * outside the functions associated with it.
+ */
+typedef struct frame_arena {
+    /** @brief A unique identifier for this arena, used to match threads to their slots. */
+    u32 id;
+    /** @brief The number of frames in the ring. */
+    u8 frame_count;
+    /** @brief The index of the frame currently being allocated from. */
+    volatile u32 frame_index;
+    /** @brief The size of each frame's arena for the thread which created this arena. */
+    u64 owner_size;
+    /** @brief The size of each frame's arena for all other threads. */
+    u64 thread_size;
+    /** @brief The maximum number of threads which may allocate from this arena. */
+    u32 max_threads;
+    /** @brief The number of slots claimed by threads so far. */
+    volatile u32 claimed_count;
+    /** @brief The thread id of the owner of each slot, or 0 if the slot is not ready. */
+    volatile u64* slot_thread_ids;
+    /** @brief The linear allocators, frame_count per slot. */
+    linear_allocator* allocators;
+} frame_arena;
+
+/**
+ * @brief Creates a frame arena. The calling thread is given the first slot.
+ * Memory for other threads is allocated the first time each of them allocates.
+ *
+ * @param owner_size The size in bytes of each frame's arena for the calling thread.
+ * @param thread_size The size in bytes of each frame's arena for every other thread.
+ * @param frame_count The number of frames an allocation stays alive for. Must be in the range [1, FRAME_ARENA_MAX_FRAME_COUNT].
+ * @param max_threads The maximum number of threads which may allocate from the arena, including the calling thread.
+ * @param out_arena A pointer to hold the created arena.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 frame_arena_create(u64 owner_size, u64 thread_size, u8 frame_count, u32 max_threads, frame_arena* out_arena);
+
+/**
+ * @brief Destroys the given arena, releasing the memory of all threads.
+ * No other thread may be using the arena at this time.
+ *
+ * @param arena A pointer to the arena to be destroyed.
+ */
+KAPI void frame_arena_destroy(frame_arena* arena);
+
+/**
+ * @brief Allocates the given amount from the calling thread's arena for the current frame.
+ * Allocations are aligned to 16 bytes. Safe to call from any thread, but not at the same
+ * time as frame_arena_begin_frame.
+ *
+ * @param arena A pointer to the arena to allocate from.
+ * @param size The size to be allocated.
+ * @returns A pointer to the allocated block. If this fails, 0 is returned.
+ */
+KAPI void* frame_arena_allocate(frame_arena* arena, u64 size);
+
+/**
+ * @brief Moves to the next frame in the ring, resetting the arenas of all threads for it.
+ * Anything allocated frame_count frames ago is no longer valid after this. Should be called
+ * once per frame by a single thread while no other thread is allocating from the arena.
+ *
+ * @param arena A pointer to the arena.
+ */
+KAPI void frame_arena_begin_frame(frame_arena* arena);
+
+/**
+ * @brief Obtains the total amount allocated across all threads for the current frame.
+ *
+ * @param arena A pointer to the arena.
+ * @returns The number of bytes allocated.
+ */
+KAPI u64 frame_arena_allocated(frame_arena* arena);
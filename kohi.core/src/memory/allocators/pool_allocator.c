@@ -0,0 +1,144 @@
+#include "pool_allocator.h"
+
+#include "logger.h"
+#include "threads/katomic.h"
+
+// Pages start with a pointer to the next page, padded to keep blocks aligned.
+#define POOL_PAGE_HEADER_SIZE 16
+#define POOL_PAGE_ALIGNMENT 16
+// User-space pointers fit in 48 bits, leaving the rest of the free head for the change counter.
+#define POOL_POINTER_MASK 0x0000FFFFFFFFFFFFULL
+#define POOL_TAG_SHIFT 48
+
+static u64 page_size(const pool_allocator* allocator) {
+    return POOL_PAGE_HEADER_SIZE + (allocator->block_size * allocator->blocks_per_page);
+}
+
+b8 pool_allocator_create(u64 block_size, u32 blocks_per_page, b8 thread_safe, memory_tag tag, pool_allocator* out_allocator) {
+    if (!out_allocator || !block_size || !blocks_per_page) {
+        KERROR("pool_allocator_create requires a valid pointer, block_size and blocks_per_page.");
+        return false;
+    }
+
+    kzero_memory(out_allocator, sizeof(pool_allocator));
+    // Free blocks hold a pointer to the next, so must be at least that large.
+    out_allocator->block_size = get_aligned(KMAX(block_size, sizeof(void*)), 8);
+    out_allocator->blocks_per_page = blocks_per_page;
+    out_allocator->tag = tag;
+    out_allocator->thread_safe = thread_safe;
+
+    if (thread_safe && !kmutex_create(&out_allocator->mutex)) {
+        KERROR("pool_allocator_create failed to create mutex.");
+        return false;
+    }
+
+    return true;
+}
+
+void pool_allocator_destroy(pool_allocator* allocator) {
+    if (allocator) {
+        u64 size = page_size(allocator);
+        void* page = allocator->pages;
+        while (page) {
+            void* next = *(void**)page;
+            kfree_aligned(page, size, POOL_PAGE_ALIGNMENT, allocator->tag);
+            page = next;
+        }
+        if (allocator->thread_safe) {
+            kmutex_destroy(&allocator->mutex);
+        }
+        kzero_memory(allocator, sizeof(pool_allocator));
+    }
+}
+
+// Pops a block from the free list, or returns 0 if it is empty. Pages are never released while
+// the pool is alive, so reading the next pointer of a block that was just taken by another
+// thread is harmless; the counter in the head makes the exchange fail and the pop is retried.
+static void* pool_pop(pool_allocator* allocator) {
+    while (true) {
+        u64 head = katomic_load_u64(&allocator->free_head);
+        void* block = (void*)(head & POOL_POINTER_MASK);
+        if (!block) {
+            return 0;
+        }
+        u64 next = katomic_load_u64((volatile u64*)block);
+        u64 tag = (head >> POOL_TAG_SHIFT) + 1;
+        if (katomic_compare_exchange_u64(&allocator->free_head, head, (tag << POOL_TAG_SHIFT) | next)) {
+            return block;
+        }
+    }
+}
+
+// Pushes an already linked chain of blocks onto the free list.
+static void pool_push(pool_allocator* allocator, void* first, void* last) {
+    while (true) {
+        u64 head = katomic_load_u64(&allocator->free_head);
+        katomic_store_u64((volatile u64*)last, head & POOL_POINTER_MASK);
+        u64 tag = (head >> POOL_TAG_SHIFT) + 1;
+        if (katomic_compare_exchange_u64(&allocator->free_head, head, (tag << POOL_TAG_SHIFT) | (u64)first)) {
+            return;
+        }
+    }
+}
+
+// Allocates a new page, keeping its first block for the caller and pushing the rest onto the free list.
+static void* pool_grow(pool_allocator* allocator) {
+    u8* page = kallocate_aligned(page_size(allocator), POOL_PAGE_ALIGNMENT, allocator->tag);
+    if (!page) {
+        return 0;
+    }
+    *(void**)page = allocator->pages;
+    allocator->pages = page;
+    allocator->page_count++;
+
+    // Link in address order so blocks are handed out in address order.
+    u8* blocks = page + POOL_PAGE_HEADER_SIZE;
+    u8* last = blocks + ((u64)(allocator->blocks_per_page - 1) * allocator->block_size);
+    for (u8* block = blocks + allocator->block_size; block < last; block += allocator->block_size) {
+        *(u64*)block = (u64)(block + allocator->block_size);
+    }
+    if (allocator->blocks_per_page > 1) {
+        pool_push(allocator, blocks + allocator->block_size, last);
+    }
+    return blocks;
+}
+
+void* pool_allocator_allocate(pool_allocator* allocator) {
+    if (!allocator || !allocator->block_size) {
+        KERROR("pool_allocator_allocate - provided allocator not initialized.");
+        return 0;
+    }
+
+    void* block = pool_pop(allocator);
+    if (!block) {
+        if (allocator->thread_safe) {
+            kmutex_lock(&allocator->mutex);
+        }
+        // Another thread may have added a page while this one waited.
+        block = pool_pop(allocator);
+        if (!block) {
+            block = pool_grow(allocator);
+        }
+        if (allocator->thread_safe) {
+            kmutex_unlock(&allocator->mutex);
+        }
+        if (!block) {
+            KERROR("pool_allocator_allocate failed to allocate a new page.");
+            return 0;
+        }
+    }
+    katomic_fetch_add_u64(&allocator->allocated_count, 1);
+
+    kzero_memory(block, allocator->block_size);
+    return block;
+}
+
+void pool_allocator_free(pool_allocator* allocator, void* block) {
+    if (!allocator || !block) {
+        KERROR("pool_allocator_free requires a valid allocator and block.");
+        return;
+    }
+
+    pool_push(allocator, block, block);
+    katomic_fetch_sub_u64(&allocator->allocated_count, 1);
+}
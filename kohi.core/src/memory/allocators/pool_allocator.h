@@ -0,0 +1,87 @@
+/**
+ * @file pool_allocator.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief This file contains the pool allocator implementation.
+ * @details A pool allocator hands out blocks of a single, fixed size. Blocks are carved
+ * from pages which each hold a fixed number of blocks, and freed blocks are kept in a
+ * list for reuse, so both allocation and free are O(1). Blocks of the same pool are kept
+ * close together in memory, which makes it a good fit for small objects which are created
+ * and destroyed often (i.e. tree nodes). The pool grows by a page at a time as needed, and
+ * pages are only released when the pool is destroyed. Thread-safe pools allocate and free
+ * without locking, and only take a lock to add a page.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "defines.h"
+#include "memory/kmemory.h"
+#include "threads/kmutex.h"
+
+/**
+ * @brief The data structure for a pool allocator.
+ */
+typedef struct pool_allocator {
+    /** @brief The size of each block in bytes, including any padding. */
+    u64 block_size;
+    /** @brief The number of blocks held by each page. */
+    u32 blocks_per_page;
+    /** @brief The number of pages currently allocated. */
+    u32 page_count;
+    /** @brief The number of blocks currently handed out. */
+    volatile u64 allocated_count;
+    /** @brief The tag all pages are allocated with. */
+    memory_tag tag;
+    /** @brief Indicates if allocate/free may be called from multiple threads at once. */
+    b8 thread_safe;
+    /** @brief Guards adding pages when thread_safe is set. */
+    kmutex mutex;
+    /**
+     * @brief The first free block in the low 48 bits, and a counter bumped on every change in
+     * the high 16 bits so that a stale head can't be swapped back in. Each free block holds a
+     * pointer to the next.
+     */
+    volatile u64 free_head;
+    /** @brief The first page. Each page holds a pointer to the next. */
+    void* pages;
+} pool_allocator;
+
+/**
+ * @brief Creates a pool allocator. No memory is allocated until the first allocation.
+ *
+ * @param block_size The size in bytes of each block. Rounded up to a multiple of 8.
+ * @param blocks_per_page The number of blocks to allocate at once when the pool runs out.
+ * @param thread_safe Indicates if allocate/free may be called from multiple threads at once.
+ * @param tag The memory tag that pages are allocated with.
+ * @param out_allocator A pointer to hold the new allocator.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 pool_allocator_create(u64 block_size, u32 blocks_per_page, b8 thread_safe, memory_tag tag, pool_allocator* out_allocator);
+
+/**
+ * @brief Destroys the given allocator, freeing all of its pages. Any blocks still
+ * allocated from it are invalid after this call.
+ *
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+KAPI void pool_allocator_destroy(pool_allocator* allocator);
+
+/**
+ * @brief Allocates a single zeroed block from the pool, growing it by a page if required.
+ *
+ * @param allocator A pointer to the allocator to allocate from.
+ * @return A pointer to the block. If this fails, 0 is returned.
+ */
+KAPI void* pool_allocator_allocate(pool_allocator* allocator);
+
+/**
+ * @brief Returns the given block to the pool. The block must have been allocated from this pool.
+ *
+ * @param allocator A pointer to the allocator to return the block to.
+ * @param block The block to be freed.
+ */
+KAPI void pool_allocator_free(pool_allocator* allocator, void* block);
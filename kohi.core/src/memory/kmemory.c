@@ -1,10 +1,12 @@
 #include "memory/kmemory.h"
 
+#include "containers/u64_bst.h"
 #include "debug/kassert.h"
 #include "logger.h"
 #include "memory/allocators/dynamic_allocator.h"
 #include "platform/platform.h"
 #include "strings/kstring.h"
+#include "threads/katomic.h"
 #include "threads/kmutex.h"
 
 // TODO: Custom string lib
@@ -24,6 +26,7 @@
 #        define kaligned_free free
 #    endif
 #endif
+// NOTE: Stats are only ever modified atomically, and so never need the allocation lock.
 struct memory_stats {
     u64 total_allocated;
     u64 tagged_allocations[MEMORY_TAG_MAX_TAGS];
@@ -31,6 +34,58 @@ struct memory_stats {
     u64 new_tagged_deallocations[MEMORY_TAG_MAX_TAGS];
 };
 
+// Small allocations are rounded up to a multiple of this, which is also their alignment.
+#define SMALL_ALLOC_GRANULARITY 16
+// The number of small size classes (16, 32, 48 ... 256 bytes).
+#define SMALL_ALLOC_CLASS_COUNT 16
+// The largest allocation served by the small allocator.
+#define SMALL_ALLOC_MAX_SIZE (SMALL_ALLOC_GRANULARITY * SMALL_ALLOC_CLASS_COUNT)
+// Size of a page of the small allocation region. Each page holds blocks of a single size class.
+#define SMALL_ALLOC_PAGE_SIZE KIBIBYTES(64)
+// The number of blocks moved between a thread cache and the shared pool at once.
+#define SMALL_ALLOC_BATCH_SIZE 32
+// The number of blocks a thread may cache per size class before returning a batch to the shared pool.
+#define SMALL_ALLOC_THREAD_CACHE_MAX (SMALL_ALLOC_BATCH_SIZE * 2)
+// The default size of the small allocation region, if not configured.
+#define SMALL_ALLOC_DEFAULT_SIZE MEBIBYTES(64)
+
+// A free block of the small allocator. Only exists while the block is free.
+typedef struct small_block {
+    struct small_block* next;
+} small_block;
+
+// The shared free list of a single size class.
+typedef struct small_class_pool {
+    // Spin lock guarding the free list. Only held to move a batch of blocks.
+    volatile u32 lock;
+    u32 free_count;
+    small_block* free_list;
+} small_class_pool;
+
+typedef struct small_allocator {
+    // The start of the region. All small blocks live within this range.
+    u8* base;
+    u64 size;
+    u32 page_count;
+    // The index of the next page to be handed out to a size class.
+    volatile u32 next_page;
+    // The size class of each page.
+    u8* page_classes;
+    small_class_pool classes[SMALL_ALLOC_CLASS_COUNT];
+} small_allocator;
+
+// Per-thread cache of small blocks, which is used without any locking.
+typedef struct small_thread_cache {
+    // Matches small_alloc_generation when the cache holds blocks from the current memory system.
+    u32 generation;
+    u32 counts[SMALL_ALLOC_CLASS_COUNT];
+    small_block* free_lists[SMALL_ALLOC_CLASS_COUNT];
+} small_thread_cache;
+
+static KTHREAD_LOCAL small_thread_cache thread_cache;
+// Incremented each time the memory system is initialized, which invalidates all thread caches.
+static volatile u32 small_alloc_generation = 0;
+
 static const char* memory_tag_strings[MEMORY_TAG_MAX_TAGS] = {
     "UNKNOWN    ",
     "ARRAY      ",
@@ -75,13 +130,160 @@ typedef struct memory_system_state {
     u64 allocator_memory_requirement;
     dynamic_allocator allocator;
     void* allocator_block;
-    // A mutex for allocations/frees
+    // A mutex for allocations/frees made through the dynamic allocator.
     kmutex allocation_mutex;
+    // Serves small allocations without taking the allocation mutex.
+    small_allocator small;
 } memory_system_state;
 
 // Pointer to system state.
 static memory_system_state* state_ptr;
 
+static void stats_record_allocation(u64 size, memory_tag tag) {
+    katomic_fetch_add_u64(&state_ptr->stats.total_allocated, size);
+    katomic_fetch_add_u64(&state_ptr->stats.tagged_allocations[tag], size);
+    katomic_fetch_add_u64(&state_ptr->stats.new_tagged_allocations[tag], size);
+    katomic_fetch_add_u64(&state_ptr->alloc_count, 1);
+}
+
+static void stats_record_free(u64 size, memory_tag tag) {
+    katomic_fetch_sub_u64(&state_ptr->stats.total_allocated, size);
+    katomic_fetch_sub_u64(&state_ptr->stats.tagged_allocations[tag], size);
+    katomic_fetch_add_u64(&state_ptr->stats.new_tagged_deallocations[tag], size);
+    katomic_fetch_sub_u64(&state_ptr->alloc_count, 1);
+}
+
+static void small_pool_lock(small_class_pool* pool) {
+    while (!katomic_compare_exchange_u32(&pool->lock, 0, 1)) {
+        katomic_pause();
+    }
+}
+
+static void small_pool_unlock(small_class_pool* pool) {
+    katomic_store_u32(&pool->lock, 0);
+}
+
+// Returns the size class for the given size and alignment, or INVALID_ID_U8 if the small allocator cannot serve it.
+static u8 small_class_index(u64 size, u16 alignment) {
+    if (size == 0 || size > SMALL_ALLOC_MAX_SIZE || alignment > SMALL_ALLOC_GRANULARITY) {
+        return INVALID_ID_U8;
+    }
+    return (u8)((size - 1) / SMALL_ALLOC_GRANULARITY);
+}
+
+static u64 small_class_size(u8 class_index) {
+    return (u64)(class_index + 1) * SMALL_ALLOC_GRANULARITY;
+}
+
+static b8 small_owns(const small_allocator* small, const void* block) {
+    return small->base && (const u8*)block >= small->base && (const u8*)block < small->base + small->size;
+}
+
+static u8 small_class_of(const small_allocator* small, const void* block) {
+    return small->page_classes[((const u8*)block - small->base) / SMALL_ALLOC_PAGE_SIZE];
+}
+
+// Makes sure the thread cache does not hold blocks from a previous run of the memory system.
+static void thread_cache_validate(void) {
+    u32 generation = katomic_load_u32(&small_alloc_generation);
+    if (thread_cache.generation != generation) {
+        kzero_memory(&thread_cache, sizeof(small_thread_cache));
+        thread_cache.generation = generation;
+    }
+}
+
+// Moves up to a batch of blocks from the shared pool of the class into the thread cache. Carves a new page if the pool is empty.
+static b8 thread_cache_refill(small_allocator* small, u8 class_index) {
+    small_class_pool* pool = &small->classes[class_index];
+    small_pool_lock(pool);
+
+    if (!pool->free_list) {
+        // Carve a fresh page into blocks of this class.
+        u32 page = katomic_fetch_add_u32(&small->next_page, 1);
+        if (page >= small->page_count) {
+            small_pool_unlock(pool);
+            return false;
+        }
+        small->page_classes[page] = class_index;
+        u64 block_size = small_class_size(class_index);
+        u64 block_count = SMALL_ALLOC_PAGE_SIZE / block_size;
+        u8* page_start = small->base + ((u64)page * SMALL_ALLOC_PAGE_SIZE);
+        for (u64 i = 0; i < block_count; ++i) {
+            small_block* b = (small_block*)(page_start + (i * block_size));
+            b->next = pool->free_list;
+            pool->free_list = b;
+        }
+        pool->free_count += block_count;
+    }
+
+    // Detach a batch.
+    small_block* first = pool->free_list;
+    small_block* last = first;
+    u32 taken = 1;
+    while (taken < SMALL_ALLOC_BATCH_SIZE && last->next) {
+        last = last->next;
+        taken++;
+    }
+    pool->free_list = last->next;
+    pool->free_count -= taken;
+    small_pool_unlock(pool);
+
+    last->next = thread_cache.free_lists[class_index];
+    thread_cache.free_lists[class_index] = first;
+    thread_cache.counts[class_index] += taken;
+    return true;
+}
+
+// Moves count blocks of the class from the thread cache back to the shared pool.
+static void thread_cache_flush(small_allocator* small, u8 class_index, u32 count) {
+    small_block* first = thread_cache.free_lists[class_index];
+    if (!first || !count) {
+        return;
+    }
+    small_block* last = first;
+    u32 moved = 1;
+    while (moved < count && last->next) {
+        last = last->next;
+        moved++;
+    }
+    thread_cache.free_lists[class_index] = last->next;
+    thread_cache.counts[class_index] -= moved;
+
+    small_class_pool* pool = &small->classes[class_index];
+    small_pool_lock(pool);
+    last->next = pool->free_list;
+    pool->free_list = first;
+    pool->free_count += moved;
+    small_pool_unlock(pool);
+}
+
+static void* small_allocate(small_allocator* small, u8 class_index) {
+    thread_cache_validate();
+    if (!thread_cache.free_lists[class_index]) {
+        if (!thread_cache_refill(small, class_index)) {
+            return 0;
+        }
+    }
+    small_block* b = thread_cache.free_lists[class_index];
+    thread_cache.free_lists[class_index] = b->next;
+    thread_cache.counts[class_index]--;
+    return b;
+}
+
+static void small_free(small_allocator* small, void* block) {
+    thread_cache_validate();
+    u8 class_index = small_class_of(small, block);
+    small_block* b = block;
+    b->next = thread_cache.free_lists[class_index];
+    thread_cache.free_lists[class_index] = b;
+    thread_cache.counts[class_index]++;
+
+    // Don't let a thread which frees more than it allocates hoard blocks.
+    if (thread_cache.counts[class_index] > SMALL_ALLOC_THREAD_CACHE_MAX) {
+        thread_cache_flush(small, class_index, SMALL_ALLOC_BATCH_SIZE);
+    }
+}
+
 b8 memory_system_initialize(memory_system_configuration config) {
 #if K_USE_CUSTOM_MEMORY_ALLOCATOR
     // The amount needed by the system state.
@@ -116,8 +318,26 @@ b8 memory_system_initialize(memory_system_configuration config) {
         KFATAL("Memory system is unable to setup internal allocator. Application cannot continue.");
         return false;
     }
+
+    // Reserve a region of the allocator for small allocations, along with a table of the size class of each page.
+    platform_zero_memory(&state_ptr->small, sizeof(small_allocator));
+    u64 small_size = config.small_alloc_size ? config.small_alloc_size : KMIN(SMALL_ALLOC_DEFAULT_SIZE, config.total_alloc_size / 16);
+    u32 page_count = (u32)(small_size / SMALL_ALLOC_PAGE_SIZE);
+    if (page_count) {
+        small_allocator* small = &state_ptr->small;
+        small->size = (u64)page_count * SMALL_ALLOC_PAGE_SIZE;
+        small->page_count = page_count;
+        small->base = dynamic_allocator_allocate_aligned(&state_ptr->allocator, small->size, SMALL_ALLOC_GRANULARITY);
+        small->page_classes = dynamic_allocator_allocate(&state_ptr->allocator, page_count);
+        if (!small->base || !small->page_classes) {
+            KFATAL("Memory system is unable to reserve the small allocation region. Application cannot continue.");
+            return false;
+        }
+    }
+    katomic_fetch_add_u32(&small_alloc_generation, 1);
 #else
     state_ptr = kaligned_alloc(sizeof(memory_system_state), 16);
+    platform_zero_memory(state_ptr, sizeof(memory_system_state));
     state_ptr->config = config;
     state_ptr->alloc_count = 0;
     state_ptr->allocator_memory_requirement = 0;
@@ -135,6 +355,9 @@ b8 memory_system_initialize(memory_system_configuration config) {
 
 void memory_system_shutdown(void) {
     if (state_ptr) {
+        // BST nodes come from a pool which lives for the life of the memory system.
+        u64_bst_shutdown();
+
         // Destroy allocation mutex
         kmutex_destroy(&state_ptr->allocation_mutex);
 
@@ -163,24 +386,32 @@ void* kallocate_aligned(u64 size, u16 alignment, memory_tag tag) {
     // really happen.
     void* block = 0;
     if (state_ptr) {
-        // Make sure multithreaded requests don't trample each other.
-        if (!kmutex_lock(&state_ptr->allocation_mutex)) {
-            KFATAL("Error obtaining mutex lock during allocation.");
-            return 0;
+        // Small allocations come from the calling thread's cache, without locking.
+        u8 class_index = small_class_index(size, alignment);
+        if (class_index != INVALID_ID_U8 && state_ptr->small.base) {
+            block = small_allocate(&state_ptr->small, class_index);
         }
 
-        // FIXME: Track aligned alloc offset as part of size.
-        state_ptr->stats.total_allocated += size;
-        state_ptr->stats.tagged_allocations[tag] += size;
-        state_ptr->stats.new_tagged_allocations[tag] += size;
-        state_ptr->alloc_count++;
+        if (block) {
+            // Track the full block so the matching free is tracked the same way.
+            stats_record_allocation(small_class_size(class_index), tag);
+        } else {
+            // Make sure multithreaded requests don't trample each other.
+            if (!kmutex_lock(&state_ptr->allocation_mutex)) {
+                KFATAL("Error obtaining mutex lock during allocation.");
+                return 0;
+            }
 
 #if K_USE_CUSTOM_MEMORY_ALLOCATOR
-        block = dynamic_allocator_allocate_aligned(&state_ptr->allocator, size, alignment);
+            block = dynamic_allocator_allocate_aligned(&state_ptr->allocator, size, alignment);
 #else
-        block = kaligned_alloc(size, alignment);
+            block = kaligned_alloc(size, alignment);
 #endif
-        kmutex_unlock(&state_ptr->allocation_mutex);
+            kmutex_unlock(&state_ptr->allocation_mutex);
+
+            // FIXME: Track aligned alloc offset as part of size.
+            stats_record_allocation(size, tag);
+        }
     } else {
         // If the system is not up yet, warn about it but give memory for now.
         /* KTRACE("Warning: kallocate_aligned called before the memory system is initialized."); */
@@ -198,16 +429,7 @@ void* kallocate_aligned(u64 size, u16 alignment, memory_tag tag) {
 }
 
 void kallocate_report(u64 size, memory_tag tag) {
-    // Make sure multithreaded requests don't trample each other.
-    if (!kmutex_lock(&state_ptr->allocation_mutex)) {
-        KFATAL("Error obtaining mutex lock during allocation reporting.");
-        return;
-    }
-    state_ptr->stats.total_allocated += size;
-    state_ptr->stats.tagged_allocations[tag] += size;
-    state_ptr->stats.new_tagged_allocations[tag] += size;
-    state_ptr->alloc_count++;
-    kmutex_unlock(&state_ptr->allocation_mutex);
+    stats_record_allocation(size, tag);
 }
 
 void* kreallocate(void* block, u64 old_size, u64 new_size, memory_tag tag) {
@@ -237,6 +459,16 @@ void kfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag) {
         KWARN("kfree_aligned called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
     }
     if (state_ptr) {
+        if (small_owns(&state_ptr->small, block)) {
+            u8 class_index = small_class_of(&state_ptr->small, block);
+            if (small_class_index(size, 1) != class_index) {
+                printf("Free size mismatch! (original=%llu, requested=%llu)\n", small_class_size(class_index), size);
+            }
+            stats_record_free(small_class_size(class_index), tag);
+            small_free(&state_ptr->small, block);
+            return;
+        }
+
         // Make sure multithreaded requests don't trample each other.
         if (!kmutex_lock(&state_ptr->allocation_mutex)) {
             KFATAL("Unable to obtain mutex lock for free operation. Heap corruption is likely.");
@@ -255,10 +487,6 @@ void kfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag) {
         }
 #endif
 
-        state_ptr->stats.total_allocated -= size;
-        state_ptr->stats.tagged_allocations[tag] -= size;
-        state_ptr->stats.new_tagged_deallocations[tag] += size;
-        state_ptr->alloc_count--;
 #if K_USE_CUSTOM_MEMORY_ALLOCATOR
         b8 result = dynamic_allocator_free_aligned(&state_ptr->allocator, block);
 #else
@@ -268,6 +496,8 @@ void kfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag) {
 
         kmutex_unlock(&state_ptr->allocation_mutex);
 
+        stats_record_free(size, tag);
+
         // If the free failed, it's possible this is because the allocation was made
         // before this system was started up. Since this absolutely should be an exception
         // to the rule, try freeing it on the platform level. If this fails, some other
@@ -283,19 +513,16 @@ void kfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag) {
 }
 
 void kfree_report(u64 size, memory_tag tag) {
-    // Make sure multithreaded requests don't trample each other.
-    if (!kmutex_lock(&state_ptr->allocation_mutex)) {
-        KFATAL("Error obtaining mutex lock during allocation reporting.");
-        return;
-    }
-    state_ptr->stats.total_allocated -= size;
-    state_ptr->stats.tagged_allocations[tag] -= size;
-    state_ptr->stats.new_tagged_deallocations[tag] += size;
-    state_ptr->alloc_count--;
-    kmutex_unlock(&state_ptr->allocation_mutex);
+    stats_record_free(size, tag);
 }
 
 b8 kmemory_get_size_alignment(void* block, u64* out_size, u16* out_alignment) {
+    if (small_owns(&state_ptr->small, block)) {
+        *out_size = small_class_size(small_class_of(&state_ptr->small, block));
+        *out_alignment = SMALL_ALLOC_GRANULARITY;
+        return true;
+    }
+
     if (!kmutex_lock(&state_ptr->allocation_mutex)) {
         KFATAL("Error obtaining mutex lock during kmemory_get_size_alignment.");
         return false;
@@ -311,6 +538,16 @@ b8 kmemory_get_size_alignment(void* block, u64* out_size, u16* out_alignment) {
     return result;
 }
 
+void kmemory_thread_cache_release(void) {
+    if (!state_ptr || !state_ptr->small.base) {
+        return;
+    }
+    thread_cache_validate();
+    for (u8 i = 0; i < SMALL_ALLOC_CLASS_COUNT; ++i) {
+        thread_cache_flush(&state_ptr->small, i, thread_cache.counts[i]);
+    }
+}
+
 void* kzero_memory(void* block, u64 size) {
     return platform_zero_memory(block, size);
 }
@@ -345,17 +582,15 @@ char* get_memory_usage_str(void) {
     for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
         f32 amounts[3] = {1.0f, 1.0f, 1.0f};
         const char* units[3] = {
-            get_unit_for_size(state_ptr->stats.tagged_allocations[i], &amounts[0]),
-            get_unit_for_size(state_ptr->stats.new_tagged_allocations[i], &amounts[1]),
-            get_unit_for_size(state_ptr->stats.new_tagged_deallocations[i], &amounts[2])};
+            get_unit_for_size(katomic_load_u64(&state_ptr->stats.tagged_allocations[i]), &amounts[0]),
+            get_unit_for_size(katomic_exchange_u64(&state_ptr->stats.new_tagged_allocations[i], 0), &amounts[1]),
+            get_unit_for_size(katomic_exchange_u64(&state_ptr->stats.new_tagged_deallocations[i], 0), &amounts[2])};
 
         i32 length = snprintf(buffer + offset, 8000, "  %s: %-7.2f %-3s [+ %-7.2f %-3s | - %-7.2f%-3s]\n",
                               memory_tag_strings[i],
                               amounts[0], units[0], amounts[1], units[1], amounts[2], units[2]);
         offset += length;
     }
-    kzero_memory(&state_ptr->stats.new_tagged_allocations, sizeof(state_ptr->stats.new_tagged_allocations));
-    kzero_memory(&state_ptr->stats.new_tagged_deallocations, sizeof(state_ptr->stats.new_tagged_deallocations));
     {
 // Compute total usage.
 #if K_USE_CUSTOM_MEMORY_ALLOCATOR
@@ -386,7 +621,7 @@ char* get_memory_usage_str(void) {
 
 u64 get_memory_alloc_count(void) {
     if (state_ptr) {
-        return state_ptr->alloc_count;
+        return katomic_load_u64(&state_ptr->alloc_count);
     }
     return 0;
 }
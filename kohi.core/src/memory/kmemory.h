@@ -72,6 +72,11 @@ typedef enum memory_tag {
 typedef struct memory_system_configuration {
     /** @brief The total memory size in byes used by the internal allocator for this system. */
     u64 total_alloc_size;
+    /**
+     * @brief The portion of total_alloc_size in bytes reserved for small allocations (<= 256 bytes). These
+     * are served from per-thread caches and never take the global allocation lock. If 0, a default is used.
+     */
+    u64 small_alloc_size;
 } memory_system_configuration;
 
 /**
@@ -225,6 +230,13 @@ KAPI void kfree_report(u64 size, memory_tag tag);
  */
 KAPI b8 kmemory_get_size_alignment(void* block, u64* out_size, u16* out_alignment);
 
+/**
+ * @brief Returns any small allocation blocks cached by the calling thread to the shared pool.
+ * Should be called by threads other than the main thread just before they exit, otherwise
+ * blocks cached by that thread are never reused.
+ */
+KAPI void kmemory_thread_cache_release(void);
+
 /**
  * @brief Zeroes out the provided memory block.
  * @param block A pointer to the block of memory to be zeroed out.
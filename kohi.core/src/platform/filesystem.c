@@ -8,6 +8,10 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#ifdef _MSC_VER
+#    include <direct.h>
+#endif
+
 b8 filesystem_exists(const char* path) {
 #ifdef _MSC_VER
     struct _stat buffer;
@@ -18,6 +22,17 @@ b8 filesystem_exists(const char* path) {
 #endif
 }
 
+b8 filesystem_directory_create(const char* path) {
+    if (filesystem_exists(path)) {
+        return true;
+    }
+#ifdef _MSC_VER
+    return _mkdir(path) == 0;
+#else
+    return mkdir(path, 0755) == 0;
+#endif
+}
+
 b8 filesystem_open(const char* path, file_modes mode, b8 binary, file_handle* out_handle) {
     out_handle->is_valid = false;
     out_handle->handle = 0;
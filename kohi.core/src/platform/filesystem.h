@@ -52,6 +52,13 @@ typedef enum file_modes {
  */
 KAPI b8 filesystem_exists(const char* path);
 
+/**
+ * @brief Creates a directory at the given path. The parent directory must already exist.
+ * @param path The path of the directory to be created.
+ * @returns True if the directory was created or already exists; otherwise false.
+ */
+KAPI b8 filesystem_directory_create(const char* path);
+
 /**
  * @brief Attempt to open file located at path.
  * @param path The path of the file to be opened.
@@ -48,6 +48,16 @@ const char* kasset_heightmap_terrain_serialize(const kasset* asset) {
         goto cleanup_kson;
     }
 
+    // use_quadtree - optional
+    if (typed_asset->use_quadtree) {
+        kson_object_value_add_boolean(&tree.root, "use_quadtree", typed_asset->use_quadtree);
+    }
+
+    // memory_budget_mb - optional
+    if (typed_asset->memory_budget_mb) {
+        kson_object_value_add_int(&tree.root, "memory_budget_mb", typed_asset->memory_budget_mb);
+    }
+
     // Material names array.
     kson_array material_names_array = kson_array_create();
     for (u32 i = 0; i < typed_asset->material_count; ++i) {
@@ -109,6 +119,18 @@ b8 kasset_heightmap_terrain_deserialize(const char* file_text, kasset* out_asset
             typed_asset->tile_scale = vec3_one();
         }
 
+        // use_quadtree - optional, defaults to false.
+        typed_asset->use_quadtree = false;
+        kson_object_property_value_get_bool(&tree.root, "use_quadtree", &typed_asset->use_quadtree);
+
+        // memory_budget_mb - optional, 0 uses the default.
+        i64 memory_budget_mb = 0;
+        if (kson_object_property_value_get_int(&tree.root, "memory_budget_mb", &memory_budget_mb) && memory_budget_mb > 0) {
+            typed_asset->memory_budget_mb = (u32)memory_budget_mb;
+        } else {
+            typed_asset->memory_budget_mb = 0;
+        }
+
         // Material names array.
         kson_array material_names_obj_array = {0};
         if (!kson_object_property_value_get_object(&tree.root, "material_names", &material_names_obj_array)) {
@@ -131,6 +131,9 @@ const char* kasset_shader_serialize(const kasset* asset) {
 
             kson_object_value_add_string(&attribute_obj, "type", shader_attribute_type_to_string(attribute->type));
             kson_object_value_add_string(&attribute_obj, "name", attribute->name);
+            if (attribute->per_instance) {
+                kson_object_value_add_boolean(&attribute_obj, "per_instance", attribute->per_instance);
+            }
 
             kson_array_value_add_object(&attributes_array, attribute_obj);
         }
@@ -350,6 +353,11 @@ b8 kasset_shader_deserialize(const char* file_text, kasset* out_asset) {
                 string_free(temp);
 
                 kson_object_property_value_get_string(&attribute_obj, "name", &attribute->name);
+
+                // Optional, defaults to per-vertex.
+                if (!kson_object_property_value_get_bool(&attribute_obj, "per_instance", &attribute->per_instance)) {
+                    attribute->per_instance = false;
+                }
             }
         }
 
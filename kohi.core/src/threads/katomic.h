@@ -0,0 +1,121 @@
+/**
+ * @file katomic.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief Contains a small set of atomic operations used by lock-free code
+ * throughout the engine (i.e. the job system). All operations are sequentially
+ * consistent, which keeps reasoning about them simple at a small cost.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "defines.h"
+
+#if !defined(__clang__) && !defined(__gcc__) && !defined(__GNUC__)
+#    error "Unsupported compiler - don't know how to define atomic operations!"
+#endif
+
+/** @brief Atomically loads and returns the value at the given address. */
+KINLINE u32 katomic_load_u32(volatile u32* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically stores the given value at the given address. */
+KINLINE void katomic_store_u32(volatile u32* ptr, u32 value) {
+    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically adds value to the value at the given address. @returns The previous value. */
+KINLINE u32 katomic_fetch_add_u32(volatile u32* ptr, u32 value) {
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically subtracts value from the value at the given address. @returns The previous value. */
+KINLINE u32 katomic_fetch_sub_u32(volatile u32* ptr, u32 value) {
+    return __atomic_fetch_sub(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically replaces the value at the given address. @returns The previous value. */
+KINLINE u32 katomic_exchange_u32(volatile u32* ptr, u32 value) {
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Atomically replaces the value at the given address with desired, but only
+ * if it currently holds expected.
+ * @returns True if the exchange happened; otherwise false.
+ */
+KINLINE b8 katomic_compare_exchange_u32(volatile u32* ptr, u32 expected, u32 desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically loads and returns the value at the given address. */
+KINLINE u64 katomic_load_u64(volatile u64* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically stores the given value at the given address. */
+KINLINE void katomic_store_u64(volatile u64* ptr, u64 value) {
+    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically adds value to the value at the given address. @returns The previous value. */
+KINLINE u64 katomic_fetch_add_u64(volatile u64* ptr, u64 value) {
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically subtracts value from the value at the given address. @returns The previous value. */
+KINLINE u64 katomic_fetch_sub_u64(volatile u64* ptr, u64 value) {
+    return __atomic_fetch_sub(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically replaces the value at the given address. @returns The previous value. */
+KINLINE u64 katomic_exchange_u64(volatile u64* ptr, u64 value) {
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Atomically replaces the value at the given address with desired, but only
+ * if it currently holds expected.
+ * @returns True if the exchange happened; otherwise false.
+ */
+KINLINE b8 katomic_compare_exchange_u64(volatile u64* ptr, u64 expected, u64 desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically loads and returns the value at the given address. */
+KINLINE i64 katomic_load_i64(volatile i64* ptr) {
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+/** @brief Atomically stores the given value at the given address. */
+KINLINE void katomic_store_i64(volatile i64* ptr, i64 value) {
+    __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Atomically replaces the value at the given address with desired, but only
+ * if it currently holds expected.
+ * @returns True if the exchange happened; otherwise false.
+ */
+KINLINE b8 katomic_compare_exchange_i64(volatile i64* ptr, i64 expected, i64 desired) {
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/** @brief A full memory barrier. */
+KINLINE void katomic_thread_fence(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/** @brief Hints to the processor that the calling thread is spin-waiting. */
+KINLINE void katomic_pause(void) {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
@@ -31,6 +31,7 @@ static u32 worker_thread_loop(void* params) {
     }
 
     KTRACE("Worker thread work complete.");
+    kmemory_thread_cache_release();
 
     return 1;
 }
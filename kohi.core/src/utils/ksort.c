@@ -70,3 +70,82 @@ i32 kquicksort_compare_u32(void* a, void* b) {
     }
     return 0;
 }
+
+void kradix_sort_u64(u32 count, u64* keys, u32* values, u64* scratch_keys, u32* scratch_values) {
+    if (count < 2 || !keys) {
+        return;
+    }
+
+    // Use scratch space from the caller if provided, otherwise allocate it here.
+    b8 owns_scratch_keys = !scratch_keys;
+    b8 owns_scratch_values = values && !scratch_values;
+    if (owns_scratch_keys) {
+        scratch_keys = kallocate(sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    }
+    if (owns_scratch_values) {
+        scratch_values = kallocate(sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    }
+
+    // Build the histograms for all 8 digits in a single pass over the keys.
+    u32 histograms[8][256] = {0};
+    for (u32 i = 0; i < count; ++i) {
+        u64 key = keys[i];
+        for (u32 d = 0; d < 8; ++d) {
+            histograms[d][(key >> (d * 8)) & 0xFF]++;
+        }
+    }
+
+    u64* src_keys = keys;
+    u32* src_values = values;
+    u64* dst_keys = scratch_keys;
+    u32* dst_values = scratch_values;
+    for (u32 d = 0; d < 8; ++d) {
+        u32* histogram = histograms[d];
+
+        // If every key has the same digit here, this pass would not change anything.
+        if (histogram[(src_keys[0] >> (d * 8)) & 0xFF] == count) {
+            continue;
+        }
+
+        // Turn the counts into starting offsets.
+        u32 offset = 0;
+        for (u32 b = 0; b < 256; ++b) {
+            u32 c = histogram[b];
+            histogram[b] = offset;
+            offset += c;
+        }
+
+        u32 shift = d * 8;
+        for (u32 i = 0; i < count; ++i) {
+            u64 key = src_keys[i];
+            u32 dst = histogram[(key >> shift) & 0xFF]++;
+            dst_keys[dst] = key;
+            if (values) {
+                dst_values[dst] = src_values[i];
+            }
+        }
+
+        // Swap source and destination for the next pass.
+        u64* temp_keys = src_keys;
+        src_keys = dst_keys;
+        dst_keys = temp_keys;
+        u32* temp_values = src_values;
+        src_values = dst_values;
+        dst_values = temp_values;
+    }
+
+    // If the sorted result ended up in the scratch space, copy it back.
+    if (src_keys != keys) {
+        kcopy_memory(keys, src_keys, sizeof(u64) * count);
+        if (values) {
+            kcopy_memory(values, src_values, sizeof(u32) * count);
+        }
+    }
+
+    if (owns_scratch_keys) {
+        kfree(scratch_keys, sizeof(u64) * count, MEMORY_TAG_ARRAY);
+    }
+    if (owns_scratch_values) {
+        kfree(scratch_values, sizeof(u32) * count, MEMORY_TAG_ARRAY);
+    }
+}
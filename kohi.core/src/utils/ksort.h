@@ -10,3 +10,37 @@ KAPI void kquick_sort(u64 type_size, void* data, i32 low_index, i32 high_index,
 
 KAPI i32 kquicksort_compare_u32_desc(void* a, void* b);
 KAPI i32 kquicksort_compare_u32(void* a, void* b);
+
+/**
+ * @brief Sorts the given 64-bit keys in ascending order using a least-significant-digit
+ * radix sort, carrying a 32-bit value (typically the index of whatever the key
+ * describes) along with each key. The sort is stable, and runs in linear time.
+ * Sorting small keys alongside indices like this avoids ever moving the (potentially
+ * large) items themselves; they can be visited in key order afterward.
+ *
+ * @param count The number of keys to be sorted.
+ * @param keys The keys to be sorted. Holds the sorted keys afterward.
+ * @param values The values to be reordered along with the keys. Optional.
+ * @param scratch_keys Scratch space for at least count keys. Optional; allocated internally if not provided.
+ * @param scratch_values Scratch space for at least count values. Optional; allocated internally if not provided and values are.
+ */
+KAPI void kradix_sort_u64(u32 count, u64* keys, u32* values, u64* scratch_keys, u32* scratch_values);
+
+/**
+ * @brief Converts the given float to an unsigned integer which sorts in the same
+ * order, for use in radix sort keys. Handles negative values.
+ *
+ * @param value The value to be converted.
+ * @returns The sortable representation of the value.
+ */
+KINLINE u32 ksort_key_from_f32(f32 value) {
+    union {
+        f32 f;
+        u32 u;
+    } bits;
+    bits.f = value;
+    // Negative values have all of their bits flipped so larger magnitudes sort first,
+    // positive values just have the sign bit set so they sort after all negatives.
+    u32 mask = (u32)(-(i32)(bits.u >> 31)) | 0x80000000u;
+    return bits.u ^ mask;
+}
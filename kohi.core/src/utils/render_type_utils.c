@@ -6,6 +6,7 @@
 #include "logger.h"
 #include "memory/kmemory.h"
 #include "strings/kstring.h"
+#include "utils/crc64.h"
 
 b8 uniform_type_is_sampler(shader_uniform_type type) {
     switch (type) {
@@ -530,3 +531,9 @@ kmaterial_model string_to_kmaterial_model(const char* str) {
         return KMATERIAL_MODEL_PBR;
     }
 }
+
+u64 shader_spirv_cache_key(shader_stage stage, const char* options, const char* source, u64 source_length) {
+    u64 key = crc64(0, (const u8*)&stage, sizeof(shader_stage));
+    key = crc64(key, (const u8*)options, string_length(options));
+    return crc64(key, (const u8*)source, source_length);
+}
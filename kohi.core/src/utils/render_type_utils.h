@@ -87,3 +87,23 @@ KAPI const char* kmaterial_model_to_string(kmaterial_model model);
 
 /** @brief Converts the given string into a material model. Case-insensitive. */
 KAPI kmaterial_model string_to_kmaterial_model(const char* str);
+
+/**
+ * @brief The options every shader stage is compiled to SPIR-V with, given as arguments
+ * to glslc. The runtime compiler must be configured to match, since these are part of
+ * the SPIR-V cache key.
+ */
+#define SHADER_SPIRV_COMPILE_OPTIONS "--target-env=vulkan1.2"
+
+/**
+ * @brief Returns the key used to store the SPIR-V compiled from the given shader stage source
+ * in the SPIR-V cache. The key changes with the stage, the compile options and every byte of
+ * the source, so stale entries are never picked up.
+ *
+ * @param stage The shader stage the source is for.
+ * @param options The options the source is compiled with. Normally SHADER_SPIRV_COMPILE_OPTIONS.
+ * @param source The GLSL source text.
+ * @param source_length The length of the source text in bytes.
+ * @returns The cache key.
+ */
+KAPI u64 shader_spirv_cache_key(shader_stage stage, const char* options, const char* source, u64 source_length);
@@ -787,6 +787,7 @@ static u32 source_work_thread(void* params) {
     }
 
     KDEBUG("Audio source thread shutting down.");
+    kmemory_thread_cache_release();
     return 0;
 }
 
@@ -83,6 +83,7 @@ typedef struct krhi_vulkan {
     RHI_VULKAN_DECL(vkCreateFence);
     RHI_VULKAN_DECL(vkDestroyFence);
     RHI_VULKAN_DECL(vkWaitForFences);
+    RHI_VULKAN_DECL(vkGetFenceStatus);
     RHI_VULKAN_DECL(vkAcquireNextImageKHR);
     RHI_VULKAN_DECL(vkResetFences);
     RHI_VULKAN_DECL(vkCreateDescriptorSetLayout);
@@ -104,6 +105,9 @@ typedef struct krhi_vulkan {
     RHI_VULKAN_DECL(vkDestroyPipelineLayout);
     RHI_VULKAN_DECL(vkCreateGraphicsPipelines);
     RHI_VULKAN_DECL(vkDestroyPipeline);
+    RHI_VULKAN_DECL(vkCreatePipelineCache);
+    RHI_VULKAN_DECL(vkDestroyPipelineCache);
+    RHI_VULKAN_DECL(vkGetPipelineCacheData);
     RHI_VULKAN_DECL(vkAllocateDescriptorSets);
     RHI_VULKAN_DECL(vkFreeDescriptorSets);
     RHI_VULKAN_DECL(vkUpdateDescriptorSets);
@@ -114,6 +118,7 @@ typedef struct krhi_vulkan {
     RHI_VULKAN_DECL(vkCmdCopyBuffer);
     RHI_VULKAN_DECL(vkCmdCopyBufferToImage);
     RHI_VULKAN_DECL(vkCmdCopyImageToBuffer);
+    RHI_VULKAN_DECL(vkCmdCopyImage);
     RHI_VULKAN_DECL(vkCmdExecuteCommands);
     RHI_VULKAN_DECL(vkCmdSetViewport);
     RHI_VULKAN_DECL(vkCmdSetScissor);
@@ -136,6 +141,7 @@ typedef struct krhi_vulkan {
     RHI_VULKAN_DECL(vkCmdBindIndexBuffer);
     RHI_VULKAN_DECL(vkCmdDraw);
     RHI_VULKAN_DECL(vkCmdDrawIndexed);
+    RHI_VULKAN_DECL(vkCmdDrawIndexedIndirect);
     RHI_VULKAN_DECL(vkCmdBindDescriptorSets);
 
     RHI_VULKAN_DECL(vkQueueSubmit);
@@ -2,11 +2,16 @@
 
 #include "vulkan_backend.h"
 
-#include <shaderc/env.h>
 #include <vulkan/vulkan_core.h>
+
+#include "vulkan_types.h"
+
+#if KVULKAN_RUNTIME_SHADER_COMPILATION
 // For runtime shader compilation.
-#include <shaderc/shaderc.h>
-#include <shaderc/status.h>
+#    include <shaderc/env.h>
+#    include <shaderc/shaderc.h>
+#    include <shaderc/status.h>
+#endif
 
 #include <containers/darray.h>
 #include <core/engine.h>
@@ -21,6 +26,7 @@
 #include <math/kmath.h>
 #include <math/math_types.h>
 #include <memory/kmemory.h>
+#include <platform/filesystem.h>
 #include <platform/platform.h>
 #include <platform/vulkan_platform.h>
 #include <renderer/renderer_frontend.h>
@@ -32,11 +38,13 @@
 #include <utils/render_type_utils.h>
 
 #include "vulkan_command_buffer.h"
+#include "vulkan_deletion_queue.h"
 #include "vulkan_device.h"
 #include "vulkan_image.h"
 #include "vulkan_loader.h"
+#include "vulkan_pipeline_cache.h"
 #include "vulkan_swapchain.h"
-#include "vulkan_types.h"
+#include "vulkan_upload.h"
 #include "vulkan_utils.h"
 
 // NOTE: If wanting to trace allocations, uncomment this.
@@ -64,6 +72,7 @@ static b8 vulkan_buffer_copy_range_internal(vulkan_context* context,
                                             VkBuffer dest, u64 dest_offset,
                                             u64 size, b8 queue_wait);
 static vulkan_command_buffer* get_current_command_buffer(vulkan_context* context);
+static vulkan_command_buffer* get_node_command_buffer(vulkan_context* context, u32 slot);
 static u32 get_current_image_index(vulkan_context* context);
 static u32 get_current_frame_index(vulkan_context* context);
 
@@ -73,6 +82,7 @@ static u32 get_current_image_count(vulkan_context* context);
 
 static b8 vulkan_graphics_pipeline_create(vulkan_context* context, const vulkan_pipeline_config* config, vulkan_pipeline* out_pipeline);
 static void vulkan_pipeline_destroy(vulkan_context* context, vulkan_pipeline* pipeline);
+static void vulkan_pipeline_destroy_deferred(vulkan_context* context, vulkan_pipeline* pipeline);
 static void vulkan_pipeline_bind(vulkan_context* context, vulkan_command_buffer* command_buffer, VkPipelineBindPoint bind_point, vulkan_pipeline* pipeline);
 static b8 setup_frequency_state(renderer_backend_interface* backend, vulkan_shader* internal_shader, shader_update_frequency frequency, u32* out_frequency_id);
 static b8 release_shader_frequency_state(vulkan_context* context, vulkan_shader* internal_shader, shader_update_frequency frequency, u32 frequency_id);
@@ -81,12 +91,15 @@ static b8 shader_create_modules_and_pipelines(renderer_backend_interface* backen
 static void setup_frequency_descriptors(b8 do_ubo, vulkan_shader_frequency_info* frequency_info, vulkan_descriptor_set_config* set_config, const kresource_shader* config);
 static b8 vulkan_descriptorset_update_and_bind(
     vulkan_context* context,
-    u16 generation,
     vulkan_shader* internal_shader,
     const vulkan_shader_frequency_info* info,
     vulkan_shader_frequency_state* frequency_state,
     u32 descriptor_set_index);
 static b8 frequency_has_uniforms(vulkan_shader_frequency_info* frequency_info);
+static b8 descriptor_state_sync(vulkan_descriptor_state* state, u32 image_index, u64 resource_handle, u64 resource_uniqueid, u16 resource_generation);
+
+// The node command list being recorded on this thread, if any.
+static KTHREAD_LOCAL vulkan_command_buffer* thread_node_command_buffer = 0;
 
 // FIXME: May want to have this as a configurable option instead.
 // Forward declarations of custom vulkan allocator functions.
@@ -280,8 +293,8 @@ b8 vulkan_renderer_backend_initialize(renderer_backend_interface* backend, const
         darray_destroy(required_validation_layer_names);
     }
 
-    // TODO: implement multi-threading.
-    context->multithreading_enabled = false;
+    // Rendergraph nodes may be recorded on job threads, into node command lists.
+    context->multithreading_enabled = true;
 
     // Debugger
     if (context->validation_enabled) {
@@ -334,14 +347,30 @@ b8 vulkan_renderer_backend_initialize(renderer_backend_interface* backend, const
         return false;
     }
 
+    // Pipeline cache. Failing to create one isn't fatal, pipelines are just compiled from scratch.
+    if (!vulkan_pipeline_cache_create(context, VULKAN_PIPELINE_CACHE_PATH)) {
+        KWARN("Failed to create Vulkan pipeline cache. Pipelines will be created without one.");
+    }
+
+    // Upload manager, used to stage texture and buffer data without stalling.
+    if (!vulkan_upload_manager_create(context)) {
+        KERROR("Failed to create Vulkan upload manager!");
+        return false;
+    }
+
+    // Deletion queue, used to destroy objects once frames in flight are done with them.
+    vulkan_deletion_queue_create(context);
+
     // Samplers array.
     context->samplers = darray_create(vulkan_sampler_handle_data);
 
     // Shaders array.
     context->shaders = darray_reserve(vulkan_shader, config->max_shader_count);
 
-    // Create a shader compiler to be used.
+#if KVULKAN_RUNTIME_SHADER_COMPILATION
+    // Create a shader compiler to be used for shader stages not found in the SPIR-V cache.
     context->shader_compiler = shaderc_compiler_initialize();
+#endif
 
     KINFO("Renderer config requests %s-buffering to be used.", config->use_triple_buffering ? "triple" : "double");
     context->triple_buffering_enabled = config->use_triple_buffering;
@@ -356,11 +385,24 @@ void vulkan_renderer_backend_shutdown(renderer_backend_interface* backend) {
     krhi_vulkan* rhi = &context->rhi;
     rhi->kvkDeviceWaitIdle(context->device.logical_device);
 
+#if KVULKAN_RUNTIME_SHADER_COMPILATION
     // Destroy the runtime shader compiler.
     if (context->shader_compiler) {
         shaderc_compiler_release(context->shader_compiler);
         context->shader_compiler = 0;
     }
+#endif
+
+    KDEBUG("Destroying Vulkan upload manager...");
+    vulkan_upload_manager_destroy(context);
+
+    KDEBUG("Destroying objects pending deletion...");
+    vulkan_deletion_queue_destroy(context);
+
+    KINFO("Created %u graphics pipelines in %.2f ms total (pipeline cache %s).",
+          context->pipeline_creation_count, context->pipeline_creation_time * 1000.0, context->pipeline_cache_loaded ? "warm" : "cold");
+    KDEBUG("Saving and destroying Vulkan pipeline cache...");
+    vulkan_pipeline_cache_destroy(context, VULKAN_PIPELINE_CACHE_PATH);
 
     KDEBUG("Destroying Vulkan device...");
     vulkan_device_destroy(context);
@@ -435,13 +477,8 @@ b8 vulkan_renderer_on_window_created(renderer_backend_interface* backend, kwindo
         window_backend->queue_complete_semaphores = KALLOC_TYPE_CARRAY(VkSemaphore, window_backend->max_frames_in_flight);
         window_backend->in_flight_fences = KALLOC_TYPE_CARRAY(VkFence, window_backend->max_frames_in_flight);
 
-        window_backend->frame_texture_updated_list = KALLOC_TYPE_CARRAY(khandle*, window_backend->max_frames_in_flight);
         window_backend->graphics_command_buffers = KALLOC_TYPE_CARRAY(vulkan_command_buffer, window_backend->max_frames_in_flight);
-
-        // The staging buffer also goes here since it is tied to the frame.
-        // TODO: Reduce this to a single buffer split by max_frames_in_flight.
-        const u64 staging_buffer_size = MEBIBYTES(768); // FIXME: This is huge. Need to queue updates per frame in flight to shrink this down.
-        window_backend->staging = kallocate(sizeof(renderbuffer) * window_backend->max_frames_in_flight, MEMORY_TAG_ARRAY);
+        window_backend->submitted_frame_numbers = KALLOC_TYPE_CARRAY(u64, window_backend->max_frames_in_flight);
 
         for (u8 i = 0; i < window_backend->max_frames_in_flight; ++i) {
             VkSemaphoreCreateInfo semaphore_create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
@@ -456,17 +493,6 @@ b8 vulkan_renderer_on_window_created(renderer_backend_interface* backend, kwindo
             fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
             VK_CHECK(rhi->kvkCreateFence(context->device.logical_device, &fence_create_info, context->allocator, &window_backend->in_flight_fences[i]));
 
-            // Staging buffer.
-            // TODO: Reduce this to a single buffer split by max_frames_in_flight.
-            if (!renderer_renderbuffer_create("staging", RENDERBUFFER_TYPE_STAGING, staging_buffer_size, RENDERBUFFER_TRACK_TYPE_LINEAR, &window_backend->staging[i])) {
-                KERROR("Failed to create staging buffer.");
-                return false;
-            }
-            renderer_renderbuffer_bind(&window_backend->staging[i], 0);
-
-            // Create the per-frame list of updated texture handles.
-            window_backend->frame_texture_updated_list[i] = darray_create(khandle);
-
             // Command buffer.
             vulkan_command_buffer* primary_buffer = &window_backend->graphics_command_buffers[i];
             kzero_memory(primary_buffer, sizeof(vulkan_command_buffer));
@@ -483,6 +509,22 @@ b8 vulkan_renderer_on_window_created(renderer_backend_interface* backend, kwindo
 
             KDEBUG("Vulkan command buffers created.")
         }
+
+        // Node command lists. Each slot gets its own pool, so different slots may be recorded on different threads at once.
+        window_backend->node_command_pools = KALLOC_TYPE_CARRAY(VkCommandPool, RENDERER_MAX_NODE_COMMAND_LISTS);
+        window_backend->node_command_buffers = KALLOC_TYPE_CARRAY(vulkan_command_buffer, RENDERER_MAX_NODE_COMMAND_LISTS * window_backend->max_frames_in_flight);
+        for (u32 slot = 0; slot < RENDERER_MAX_NODE_COMMAND_LISTS; ++slot) {
+            VkCommandPoolCreateInfo pool_create_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+            pool_create_info.queueFamilyIndex = context->device.graphics_queue_index;
+            pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            VK_CHECK(rhi->kvkCreateCommandPool(context->device.logical_device, &pool_create_info, context->allocator, &window_backend->node_command_pools[slot]));
+
+            for (u8 i = 0; i < window_backend->max_frames_in_flight; ++i) {
+                char* name = string_format("%s_node_command_buffer_%u_%u", window->name, i, slot);
+                vulkan_command_buffer_allocate(context, window_backend->node_command_pools[slot], false, name, &window_backend->node_command_buffers[(i * RENDERER_MAX_NODE_COMMAND_LISTS) + slot], 0);
+                string_free(name);
+            }
+        }
     }
 
     // If there is not yet a current window, assign it now.
@@ -502,9 +544,6 @@ void vulkan_renderer_on_window_destroyed(renderer_backend_interface* backend, kw
     // Destroy per-frame-in-flight resources.
     {
         for (u32 i = 0; i < window_backend->max_frames_in_flight; ++i) {
-            // Destroy staging buffers
-            renderer_renderbuffer_destroy(&window_backend->staging[i]);
-
             // Sync objects
             if (window_backend->image_available_semaphores[i]) {
                 rhi->kvkDestroySemaphore(context->device.logical_device, window_backend->image_available_semaphores[i], context->allocator);
@@ -532,11 +571,28 @@ void vulkan_renderer_on_window_destroyed(renderer_backend_interface* backend, kw
         KFREE_TYPE_CARRAY(window_backend->in_flight_fences, VkFence, window_backend->max_frames_in_flight);
         window_backend->in_flight_fences = 0;
 
-        KFREE_TYPE_CARRAY(window_backend->staging, renderbuffer, window_backend->max_frames_in_flight);
-        window_backend->staging = 0;
+        KFREE_TYPE_CARRAY(window_backend->submitted_frame_numbers, u64, window_backend->max_frames_in_flight);
+        window_backend->submitted_frame_numbers = 0;
 
         KFREE_TYPE_CARRAY(window_backend->graphics_command_buffers, vulkan_command_buffer, window_backend->max_frames_in_flight);
         window_backend->graphics_command_buffers = 0;
+
+        // Node command lists.
+        if (window_backend->node_command_pools) {
+            for (u32 slot = 0; slot < RENDERER_MAX_NODE_COMMAND_LISTS; ++slot) {
+                for (u8 i = 0; i < window_backend->max_frames_in_flight; ++i) {
+                    vulkan_command_buffer* node_buffer = &window_backend->node_command_buffers[(i * RENDERER_MAX_NODE_COMMAND_LISTS) + slot];
+                    if (node_buffer->handle) {
+                        vulkan_command_buffer_free(context, window_backend->node_command_pools[slot], node_buffer);
+                    }
+                }
+                rhi->kvkDestroyCommandPool(context->device.logical_device, window_backend->node_command_pools[slot], context->allocator);
+            }
+            KFREE_TYPE_CARRAY(window_backend->node_command_pools, VkCommandPool, RENDERER_MAX_NODE_COMMAND_LISTS);
+            window_backend->node_command_pools = 0;
+            KFREE_TYPE_CARRAY(window_backend->node_command_buffers, vulkan_command_buffer, RENDERER_MAX_NODE_COMMAND_LISTS * window_backend->max_frames_in_flight);
+            window_backend->node_command_buffers = 0;
+        }
     }
 
     // Destroy per-swapchain-image resources.
@@ -604,7 +660,18 @@ void vulkan_renderer_end_debug_label(renderer_backend_interface* backend) {
 }
 
 b8 vulkan_renderer_frame_prepare(renderer_backend_interface* backend, struct frame_data* p_frame_data) {
-    // NOTE: this is an intentional no-op in this backend.
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+
+    // Report the time spent creating pipelines during startup once the first frame begins.
+    // Compare a run without a cache file (cold) against a following run (warm) to see its effect.
+    if (!context->pipeline_metrics_reported) {
+        context->pipeline_metrics_reported = true;
+        KINFO("Startup created %u graphics pipelines in %.2f ms (pipeline cache %s).",
+              context->pipeline_creation_count, context->pipeline_creation_time * 1000.0, context->pipeline_cache_loaded ? "warm" : "cold");
+    }
+
+    // Reclaim staging space from (and make callbacks for) any uploads which have completed.
+    vulkan_upload_update(context);
     return true;
 }
 
@@ -672,19 +739,10 @@ b8 vulkan_renderer_frame_prepare_window_surface(renderer_backend_interface* back
         return false;
     }
 
-    // Increment texture generations in list of handles updated within frame workload.
-    khandle* updated_textures = context->current_window->renderer_state->backend_state->frame_texture_updated_list[window_backend->current_frame];
-    u32 updated_texture_count = 0;
-    for (u32 i = 0; i < updated_texture_count; ++i) {
-        vulkan_texture_handle_data* texture = &context->textures[updated_textures[i].handle_index];
-        texture->generation++;
-        // Roll over when at max u16.
-        if (texture->generation == INVALID_ID_U16) {
-            texture->generation = 0;
-        }
-    }
-    // Clear the list.
-    darray_clear(updated_textures);
+    // The frame last submitted with this fence is complete, and so is everything submitted before it.
+    // Destroy anything which was waiting on those frames.
+    context->completed_frame_number = KMAX(context->completed_frame_number, window_backend->submitted_frame_numbers[window_backend->current_frame]);
+    vulkan_deletion_queue_update(context);
 
     // Acquire the next image from the swap chain. Pass along the semaphore that
     // should signaled when this completes. This same semaphore will later be
@@ -711,12 +769,6 @@ b8 vulkan_renderer_frame_prepare_window_surface(renderer_backend_interface* back
     // Reset the fence for use on the next frame
     VK_CHECK(rhi->kvkResetFences(context->device.logical_device, 1, &window_backend->in_flight_fences[window_backend->current_frame]));
 
-    // Reset staging buffer.
-    if (!renderer_renderbuffer_clear(&window_backend->staging[window_backend->current_frame], false)) {
-        KERROR("Failed to clear staging buffer.");
-        return false;
-    }
-
     return true;
 }
 
@@ -731,6 +783,65 @@ b8 vulkan_renderer_frame_command_list_begin(renderer_backend_interface* backend,
     return true;
 }
 
+b8 vulkan_renderer_node_command_list_begin(renderer_backend_interface* backend, u32 slot, struct frame_data* p_frame_data) {
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+    if (thread_node_command_buffer) {
+        KERROR("vulkan_renderer_node_command_list_begin called while this thread is already recording a node command list.");
+        return false;
+    }
+
+    vulkan_command_buffer* command_buffer = get_node_command_buffer(context, slot);
+
+    // A list recorded for a frame which was abandoned before being executed was never submitted, so may be reused as-is.
+    if (command_buffer->state == COMMAND_BUFFER_STATE_RECORDING_ENDED) {
+        command_buffer->state = COMMAND_BUFFER_STATE_READY;
+    }
+    vulkan_command_buffer_reset(command_buffer);
+    vulkan_command_buffer_begin(context, command_buffer, true, false, false);
+
+    // Everything recorded on this thread now goes to the node's command list.
+    thread_node_command_buffer = command_buffer;
+    return true;
+}
+
+b8 vulkan_renderer_node_command_list_end(renderer_backend_interface* backend, u32 slot, struct frame_data* p_frame_data) {
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+    vulkan_command_buffer* command_buffer = get_node_command_buffer(context, slot);
+    if (thread_node_command_buffer != command_buffer) {
+        KERROR("vulkan_renderer_node_command_list_end called for a node command list (slot=%u) not being recorded on this thread.", slot);
+        return false;
+    }
+
+    vulkan_command_buffer_end(context, command_buffer);
+    thread_node_command_buffer = 0;
+    return true;
+}
+
+b8 vulkan_renderer_node_command_lists_execute(renderer_backend_interface* backend, u32 slot_count, const u32* slots, struct frame_data* p_frame_data) {
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_command_buffer* primary = get_current_command_buffer(context);
+    if (!primary->is_primary || primary->in_secondary) {
+        KERROR("vulkan_renderer_node_command_lists_execute must be called on the frame command list, outside of rendering.");
+        return false;
+    }
+
+    VkCommandBuffer* handles = p_frame_data->allocator.allocate(sizeof(VkCommandBuffer) * slot_count);
+    for (u32 i = 0; i < slot_count; ++i) {
+        vulkan_command_buffer* command_buffer = get_node_command_buffer(context, slots[i]);
+        if (command_buffer->state != COMMAND_BUFFER_STATE_RECORDING_ENDED) {
+            KERROR("vulkan_renderer_node_command_lists_execute called with a node command list (slot=%u) which has not been recorded.", slots[i]);
+            return false;
+        }
+        handles[i] = command_buffer->handle;
+        // Considered submitted from here, as it is now part of the frame's command list.
+        command_buffer->state = COMMAND_BUFFER_STATE_SUBMITTED;
+    }
+
+    rhi->kvkCmdExecuteCommands(primary->handle, slot_count, handles);
+    return true;
+}
+
 b8 vulkan_renderer_frame_command_list_end(renderer_backend_interface* backend, struct frame_data* p_frame_data) {
     vulkan_context* context = (vulkan_context*)backend->internal_context;
     krhi_vulkan* rhi = &context->rhi;
@@ -931,17 +1042,49 @@ b8 vulkan_renderer_frame_submit(struct renderer_backend_interface* backend, stru
         return false;
     }
 
+    // Submit any uploads made since the last frame, so this frame sees their results.
+    // Graphics queue uploads are ordered by submission; transfer queue uploads are waited on below.
+    vulkan_upload_flush(context, false);
+    vulkan_upload_manager* upload = &context->upload;
+
+    // Number the frame, so objects released while it was recorded can be destroyed once it completes.
+    window_backend->submitted_frame_numbers[window_backend->current_frame] = ++context->submitted_frame_number;
+
+    // The semaphore(s) to be signaled when the queue is complete. If a dedicated transfer queue
+    // is used for uploads, also signal that this frame is done reading what it may overwrite.
+    VkSemaphore signal_semaphores[2] = {window_backend->queue_complete_semaphores[window_backend->current_frame], upload->graphics_timeline};
+    u64 signal_values[2] = {0, 0};
+    u32 signal_count = 1;
+
+    // Wait semaphore ensures that the operation cannot begin until the image is available.
+    // VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT prevents subsequent colour attachment writes
+    // from executing until the semaphore signals (i.e. one frame is presented at a time).
+    // Also wait on any transfer queue uploads before anything that might read them.
+    VkSemaphore wait_semaphores[2] = {window_backend->image_available_semaphores[window_backend->current_frame], upload->transfer_timeline};
+    VkPipelineStageFlags wait_stages[2] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT};
+    u64 wait_values[2] = {0, upload->transfer_timeline_value};
+    u32 wait_count = 1;
+
+    if (upload->use_transfer_queue) {
+        signal_values[1] = ++upload->graphics_timeline_value;
+        signal_count = 2;
+        if (upload->transfer_timeline_value) {
+            wait_count = 2;
+        }
+    }
+
     // Submit the command buffer for execution.
     b8 result = vulkan_command_buffer_submit(
         context,
         command_buffer,
         context->device.graphics_queue,
-        1,
-        // The semaphore(s) to be signaled when the queue is complete.
-        &window_backend->queue_complete_semaphores[window_backend->current_frame],
-        1,
-        // Wait semaphore ensures that the operation cannot begin until the image is available.
-        &window_backend->image_available_semaphores[window_backend->current_frame],
+        signal_count,
+        signal_semaphores,
+        upload->use_transfer_queue ? signal_values : 0,
+        wait_count,
+        wait_semaphores,
+        wait_stages,
+        upload->use_transfer_queue ? wait_values : 0,
         window_backend->in_flight_fences[window_backend->current_frame]);
 
     if (!result) {
@@ -1210,10 +1353,14 @@ void vulkan_renderer_begin_rendering(struct renderer_backend_interface* backend,
     vulkan_command_buffer* primary = get_current_command_buffer(context);
     u32 image_index = get_current_image_index(context);
 
-    // Anytime we "begin" a render, update the "in-secondary" state and get the appropriate secondary buffer.
-    primary->in_secondary = true;
-    vulkan_command_buffer* secondary = get_current_command_buffer(context);
-    vulkan_command_buffer_begin(context, secondary, false, false, false);
+    // Node command lists are already secondary, so the render is recorded straight into them.
+    vulkan_command_buffer* secondary = primary;
+    if (primary->is_primary) {
+        // Anytime we "begin" a render, update the "in-secondary" state and get the appropriate secondary buffer.
+        primary->in_secondary = true;
+        secondary = get_current_command_buffer(context);
+        vulkan_command_buffer_begin(context, secondary, false, false, false);
+    }
 
     VkRenderingInfo render_info = {VK_STRUCTURE_TYPE_RENDERING_INFO};
     render_info.renderArea.offset.x = render_area.x;
@@ -1303,8 +1450,15 @@ void vulkan_renderer_end_rendering(struct renderer_backend_interface* backend, f
         context->vkCmdEndRenderingKHR(secondary->handle);
     }
 
+    // Barriers go to the primary once the secondary is ended. A node command list has no
+    // primary and is not ended here, so they go after the render within it instead.
+    b8 is_node_command_list = !secondary->parent;
+    VkCommandBuffer barrier_command_buffer = is_node_command_list ? secondary->handle : secondary->parent->handle;
+
     // End secondary command buffer.
-    vulkan_command_buffer_end(context, secondary);
+    if (!is_node_command_list) {
+        vulkan_command_buffer_end(context, secondary);
+    }
 
     // Barrier for vertex buffer
     {
@@ -1320,7 +1474,7 @@ void vulkan_renderer_end_rendering(struct renderer_backend_interface* backend, f
         barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;  // | (is_depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
 
         rhi->kvkCmdPipelineBarrier(
-            secondary->parent->handle,
+            barrier_command_buffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT,     // _LATE_FRAGMENT_TESTS_BIT, //  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,    // VK_PIPELINE_STAGE_TRANSFER_BIT
             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, // _FRAGMENT_SHADER_BIT,     // VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
             0,
@@ -1343,7 +1497,7 @@ void vulkan_renderer_end_rendering(struct renderer_backend_interface* backend, f
         barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;  // | (is_depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
 
         rhi->kvkCmdPipelineBarrier(
-            secondary->parent->handle,
+            barrier_command_buffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT,     // _LATE_FRAGMENT_TESTS_BIT, //  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,    // VK_PIPELINE_STAGE_TRANSFER_BIT
             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, // _FRAGMENT_SHADER_BIT,     // VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
             0,
@@ -1352,8 +1506,10 @@ void vulkan_renderer_end_rendering(struct renderer_backend_interface* backend, f
             0, 0);
     }
 
-    // Execute secondary command buffer.
-    vulkan_command_buffer_execute_secondary(context, secondary);
+    // Execute secondary command buffer. Node command lists are instead executed once all nodes are recorded.
+    if (!is_node_command_list) {
+        vulkan_command_buffer_execute_secondary(context, secondary);
+    }
 }
 
 void vulkan_renderer_set_stencil_compare_mask(struct renderer_backend_interface* backend, u32 compare_mask) {
@@ -1386,21 +1542,6 @@ void vulkan_renderer_clear_colour_set(renderer_backend_interface* backend, vec4
     kcopy_memory(context->colour_clear_value.float32, colour.elements, sizeof(f32) * 4);
 }
 
-void vulkan_renderer_clear_depth_set(renderer_backend_interface* backend, f32 depth) {
-    vulkan_context* context = (vulkan_context*)backend->internal_context;
-
-    // Ensure the value is blamped
-    depth = KCLAMP(depth, 0.0f, 1.0f);
-    // Cache the depth for the next depth clear operation.
-    context->depth_stencil_clear_value.depth = depth;
-}
-
-void vulkan_renderer_clear_stencil_set(renderer_backend_interface* backend, u32 stencil) {
-    vulkan_context* context = (vulkan_context*)backend->internal_context;
-    // Cache the depth for the next stencil clear operation.
-    context->depth_stencil_clear_value.stencil = stencil;
-}
-
 void vulkan_renderer_clear_colour_texture(renderer_backend_interface* backend, khandle renderer_texture_handle) {
     // Cold-cast the context
     vulkan_context* context = (vulkan_context*)backend->internal_context;
@@ -1476,13 +1617,18 @@ void vulkan_renderer_clear_colour_texture(renderer_backend_interface* backend, k
     }
 }
 
-void vulkan_renderer_clear_depth_stencil(renderer_backend_interface* backend, khandle renderer_texture_handle) {
+void vulkan_renderer_clear_depth_stencil(renderer_backend_interface* backend, khandle renderer_texture_handle, f32 depth, u32 stencil) {
     // Cold-cast the context
     vulkan_context* context = (vulkan_context*)backend->internal_context;
     krhi_vulkan* rhi = &context->rhi;
     vulkan_command_buffer* command_buffer = get_current_command_buffer(context);
     u32 image_index = get_current_image_index(context);
 
+    // NOTE: Kept local rather than cached on the context, since nodes may be recorded on several threads at once.
+    VkClearDepthStencilValue clear_value = {0};
+    clear_value.depth = KCLAMP(depth, 0.0f, 1.0f);
+    clear_value.stencil = stencil;
+
     vulkan_texture_handle_data* tex_internal = &context->textures[renderer_texture_handle.handle_index];
 
     // If a per-frame texture, get the appropriate image index. Otherwise it's just the first one.
@@ -1528,7 +1674,7 @@ void vulkan_renderer_clear_depth_stencil(renderer_backend_interface* backend, kh
         command_buffer->handle,
         image->handle,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        &context->depth_stencil_clear_value,
+        &clear_value,
         image->layer_count,
         image->layer_count == 1 ? &image->view_subresource_range : image->layer_view_subresource_ranges);
 
@@ -1655,6 +1801,102 @@ void vulkan_renderer_texture_prepare_for_sampling(renderer_backend_interface* ba
         1, &barrier);
 }
 
+void vulkan_renderer_texture_layer_copy(renderer_backend_interface* backend, khandle source_handle, u32 source_layer, khandle dest_handle, u32 dest_layer) {
+    // Cold-cast the context
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_command_buffer* command_buffer = get_current_command_buffer(context);
+    u32 image_index = get_current_image_index(context);
+
+    vulkan_texture_handle_data* source_internal = &context->textures[source_handle.handle_index];
+    vulkan_texture_handle_data* dest_internal = &context->textures[dest_handle.handle_index];
+
+    // If a per-frame texture, get the appropriate image index. Otherwise it's just the first one.
+    vulkan_image* source = source_internal->image_count == 1 ? &source_internal->images[0] : &source_internal->images[image_index];
+    vulkan_image* dest = dest_internal->image_count == 1 ? &dest_internal->images[0] : &dest_internal->images[image_index];
+    b8 is_depth = FLAG_GET(source->flags, TEXTURE_FLAG_DEPTH);
+
+    // HACK: Must use both because of the internal depth format containing stencil anyway.
+    VkImageAspectFlags aspect_flags = is_depth ? (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT) : VK_IMAGE_ASPECT_COLOR_BIT;
+    VkImageLayout attachment_layout = is_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    VkAccessFlags attachment_access = is_depth
+                                          ? (VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT)
+                                          : (VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+
+    VkImageMemoryBarrier barriers[2] = {0};
+    for (u32 i = 0; i < 2; ++i) {
+        vulkan_image* image = i == 0 ? source : dest;
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].srcQueueFamilyIndex = context->device.graphics_queue_index;
+        barriers[i].dstQueueFamilyIndex = context->device.graphics_queue_index;
+        barriers[i].image = image->handle;
+        barriers[i].subresourceRange.aspectMask = aspect_flags;
+        barriers[i].subresourceRange.baseMipLevel = 0;
+        barriers[i].subresourceRange.levelCount = image->mip_levels;
+        barriers[i].subresourceRange.baseArrayLayer = i == 0 ? source_layer : dest_layer;
+        barriers[i].subresourceRange.layerCount = 1;
+    }
+
+    // Transition the layers for the transfer. The destination layer's contents are thrown away,
+    // since it is about to be overwritten entirely.
+    barriers[0].oldLayout = attachment_layout;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].srcAccessMask = attachment_access;
+    barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    // NOTE: The destination may still be sampled by a previous frame, so wait on everything.
+    rhi->kvkCmdPipelineBarrier(
+        command_buffer->handle,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, 0,
+        0, 0,
+        2, barriers);
+
+    VkImageCopy region = {0};
+    region.srcSubresource.aspectMask = aspect_flags;
+    region.srcSubresource.mipLevel = 0;
+    region.srcSubresource.baseArrayLayer = source_layer;
+    region.srcSubresource.layerCount = 1;
+    region.dstSubresource.aspectMask = aspect_flags;
+    region.dstSubresource.mipLevel = 0;
+    region.dstSubresource.baseArrayLayer = dest_layer;
+    region.dstSubresource.layerCount = 1;
+    region.extent.width = source->width;
+    region.extent.height = source->height;
+    region.extent.depth = 1;
+
+    rhi->kvkCmdCopyImage(
+        command_buffer->handle,
+        source->handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        dest->handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &region);
+
+    // Transition both layers back so they may be rendered to (or cleared) again.
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barriers[0].newLayout = attachment_layout;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = attachment_access;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[1].newLayout = attachment_layout;
+    barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[1].dstAccessMask = attachment_access;
+
+    rhi->kvkCmdPipelineBarrier(
+        command_buffer->handle,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        0, 0,
+        0, 0,
+        2, barriers);
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL
 vk_debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity,
                   VkDebugUtilsMessageTypeFlagsEXT message_types,
@@ -1851,6 +2093,9 @@ void vulkan_renderer_texture_resources_release(renderer_backend_interface* backe
     texture_data->uniqueid = INVALID_ID_U64;
     *renderer_texture_handle = khandle_invalid();
 
+    // Any uploads to these images must be submitted and completed before they're destroyed.
+    vulkan_upload_flush(context, true);
+
     // Release/destroy the internal data.
     for (u32 i = 0; i < texture_data->image_count; ++i) {
         vulkan_image_destroy(context, &texture_data->images[i]);
@@ -1870,6 +2115,9 @@ b8 vulkan_renderer_texture_resize(renderer_backend_interface* backend, khandle r
         return false;
     }
 
+    // Any uploads to the old images must be submitted and completed before they're destroyed.
+    vulkan_upload_flush(context, true);
+
     for (u32 i = 0; i < texture_data->image_count; ++i) {
         // Resizing is really just destroying the old image and creating a new one.
         // Data is not preserved because there's no reliable way to map the old data
@@ -1892,111 +2140,97 @@ b8 vulkan_renderer_texture_resize(renderer_backend_interface* backend, khandle r
         vulkan_image_recreate(context, image);
     }
 
+    // Counts as a texture update, so descriptors referring to the old views are rewritten.
+    texture_data->generation++;
+    // Roll over when at max u16.
+    if (texture_data->generation == INVALID_ID_U16) {
+        texture_data->generation = 0;
+    }
+
     return true;
 }
 
-b8 vulkan_renderer_texture_write_data(renderer_backend_interface* backend, khandle renderer_texture_handle,
-                                      u32 offset, u32 size, const u8* pixels, b8 include_in_frame_workload) {
-    vulkan_context* context = (vulkan_context*)backend->internal_context;
-
-    // Ensure the handle isn't stale.
+// Called by the upload manager once a texture's upload has completed.
+static void texture_upload_complete(vulkan_context* context, khandle renderer_texture_handle) {
     vulkan_texture_handle_data* texture = &context->textures[renderer_texture_handle.handle_index];
     if (texture->uniqueid != renderer_texture_handle.unique_id.uniqueid) {
-        KERROR("Stale handle passed while trying to write data to a texture.");
-        return false;
+        // Released before the upload completed, so there's nothing to update.
+        return;
     }
 
-    // If no window, can't include in a frame workload.
-    if (!context->current_window) {
-        include_in_frame_workload = false;
+    // Counts as a texture update.
+    texture->generation++;
+    // Roll over when at max u16.
+    if (texture->generation == INVALID_ID_U16) {
+        texture->generation = 0;
     }
+}
 
-    // Temporary staging renderbuffer, if needed.
-    renderbuffer temp;
-    // Temporary command buffer, if needed.
-    vulkan_command_buffer temp_command_buffer;
+// Uploads to the given image using a temporary staging buffer and waits for it to complete.
+// Only used for data too large for the upload manager's staging ring.
+static b8 texture_image_write_immediate(renderer_backend_interface* backend, vulkan_image* image, u32 size, const u8* pixels) {
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
 
-    // A pointer to the staging buffer to be used.
-    renderbuffer* staging = 0;
-    // A pointer to the command buffer to be used.
-    vulkan_command_buffer* command_buffer = 0;
-    if (include_in_frame_workload) {
-        // Including in the frame workload means the current window's current-frame staging buffer can be used.
-        u32 current_frame = context->current_window->renderer_state->backend_state->current_frame;
-        staging = &context->current_window->renderer_state->backend_state->staging[current_frame];
-        command_buffer = get_current_command_buffer(context);
-    } else {
-        // Not including in the frame workload means a temporary staging buffer needs to be created and bound.
-        // This buffer is the exact size required for the operation, so no allocation is needed later.
-        renderer_renderbuffer_create("temp_staging", RENDERBUFFER_TYPE_STAGING, size * texture->image_count, RENDERBUFFER_TRACK_TYPE_NONE, &temp);
-        renderer_renderbuffer_bind(&temp, 0);
-        // Set the temp buffer as the staging buffer to be used.
-        staging = &temp;
+    // This buffer is the exact size required for the operation, so no allocation is needed later.
+    renderbuffer temp;
+    if (!renderer_renderbuffer_create("temp_staging", RENDERBUFFER_TYPE_STAGING, size, RENDERBUFFER_TRACK_TYPE_NONE, &temp)) {
+        KERROR("Failed to create temporary staging buffer for texture write.");
+        return false;
     }
-    for (u32 i = 0; i < texture->image_count; ++i) {
-        vulkan_image* image = &texture->images[i];
+    renderer_renderbuffer_bind(&temp, 0);
+    vulkan_buffer_load_range(backend, &temp, 0, size, pixels, false);
 
-        // Staging buffer.
-        u64 staging_offset = 0;
-        if (include_in_frame_workload) {
-            // If including in frame workload, space needs to be allocated from the buffer.
-            renderer_renderbuffer_allocate(staging, size, &staging_offset);
-        }
+    // Submit anything already staged, so it lands first.
+    vulkan_upload_flush(context, false);
 
-        // Results in a wait if not included in frame workload.
-        vulkan_buffer_load_range(backend, staging, staging_offset, size, pixels, include_in_frame_workload);
+    vulkan_command_buffer temp_command_buffer;
+    vulkan_command_buffer_allocate_and_begin_single_use(context, context->device.graphics_command_pool, &temp_command_buffer);
 
-        // Need a temp command buffer if not included in frame workload.
-        // HACK: Not doing this breaks things...
-        // if (!include_in_frame_workload) {
-        vulkan_command_buffer_allocate_and_begin_single_use(
-            context,
-            context->device.graphics_command_pool,
-            &temp_command_buffer);
-        command_buffer = &temp_command_buffer;
-        // }
+    // Transition the layout from whatever it is currently to optimal for recieving data.
+    vulkan_image_transition_layout(context, &temp_command_buffer, image, image->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-        // Transition the layout from whatever it is currently to optimal for recieving data.
-        vulkan_image_transition_layout(context, command_buffer, image, image->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    // Copy the data from the buffer.
+    vulkan_image_copy_from_buffer(context, image, ((vulkan_buffer*)temp.internal_data)->handle, 0, &temp_command_buffer);
 
-        // Copy the data from the buffer.
-        vulkan_image_copy_from_buffer(context, image, ((vulkan_buffer*)staging->internal_data)->handle, staging_offset, command_buffer);
+    if (image->mip_levels <= 1 || !vulkan_image_mipmaps_generate(context, image, &temp_command_buffer)) {
+        // If mip generation isn't needed or fails, fall back to ordinary transition.
+        // Transition from optimal for data reciept to shader-read-only optimal layout.
+        vulkan_image_transition_layout(context, &temp_command_buffer, image, image->format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
 
-        if (image->mip_levels <= 1 || !vulkan_image_mipmaps_generate(context, image, command_buffer)) {
-            // If mip generation isn't needed or fails, fall back to ordinary transition.
-            // Transition from optimal for data reciept to shader-read-only optimal layout.
-            vulkan_image_transition_layout(context, command_buffer, image, image->format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        }
+    // Submit and wait for completion.
+    vulkan_command_buffer_end_single_use(context, context->device.graphics_command_pool, &temp_command_buffer, context->device.graphics_queue);
 
-        // Need to submit temp command buffer.
-        // HACK: Not doing this breaks things...
-        // if (!include_in_frame_workload) {
-        vulkan_command_buffer_end_single_use(
-            context,
-            context->device.graphics_command_pool,
-            command_buffer,
-            context->device.graphics_queue);
-        command_buffer = 0;
-        // }
+    renderer_renderbuffer_destroy(&temp);
+    return true;
+}
+
+b8 vulkan_renderer_texture_write_data(renderer_backend_interface* backend, khandle renderer_texture_handle,
+                                      u32 offset, u32 size, const u8* pixels, b8 include_in_frame_workload) {
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+
+    // Ensure the handle isn't stale.
+    vulkan_texture_handle_data* texture = &context->textures[renderer_texture_handle.handle_index];
+    if (texture->uniqueid != renderer_texture_handle.unique_id.uniqueid) {
+        KERROR("Stale handle passed while trying to write data to a texture.");
+        return false;
     }
 
-    if (!include_in_frame_workload) {
-        renderer_renderbuffer_destroy(&temp);
-
-        // Counts as a texture update. The texture generation here can only really be updated if
-        // we _don't_ include the upload in the frame workload, since that results in a wait.
-        // If we include it in the frame workload, then we must also wait until that frame's queue is complete.
-        texture->generation++;
-        // Roll over when at max u16.
-        if (texture->generation == INVALID_ID_U16) {
-            texture->generation = 0;
+    // NOTE: include_in_frame_workload is ignored. All texture uploads are staged through the
+    // upload manager, which submits them ahead of the next frame without waiting on them.
+    for (u32 i = 0; i < texture->image_count; ++i) {
+        vulkan_image* image = &texture->images[i];
+        if (!vulkan_upload_image(context, image, size, pixels)) {
+            // Too large to be staged, so fall back to an immediate upload.
+            if (!texture_image_write_immediate(backend, image, size, pixels)) {
+                return false;
+            }
         }
-    } else {
-        // Add handle to post-frame-queue-completion list. These will be updated at the end of the frame.
-        u32 current_frame = get_current_frame_index(context);
-        darray_push(context->current_window->renderer_state->backend_state->frame_texture_updated_list[current_frame], renderer_texture_handle);
     }
 
+    // The generation is updated once the upload completes.
+    vulkan_upload_callback_add(context, texture_upload_complete, renderer_texture_handle);
+
     return true;
 }
 
@@ -2034,6 +2268,9 @@ static b8 texture_read_offset_range(
         }
         renderer_renderbuffer_bind(&staging, 0);
 
+        // Submit any staged uploads so they land before the read.
+        vulkan_upload_flush(context, false);
+
         vulkan_command_buffer temp_buffer;
         VkCommandPool pool = context->device.graphics_command_pool;
         VkQueue queue = context->device.graphics_queue;
@@ -2357,22 +2594,26 @@ b8 vulkan_renderer_shader_create(renderer_backend_interface* backend, khandle sh
         types = t;
     }
 
-    // Process attributes
+    // Process attributes. Per-vertex attributes are sourced from binding 0, and per-instance
+    // attributes from binding 1, each packed in the order they are declared.
     internal_shader->attribute_count = shader_resource->attribute_count;
-    u32 offset = 0;
+    internal_shader->attribute_stride = 0;
+    internal_shader->instance_stride = 0;
     for (u32 i = 0; i < internal_shader->attribute_count; ++i) {
+        const shader_attribute_config* config = &shader_resource->attributes[i];
+        u32* stride = config->per_instance ? &internal_shader->instance_stride : &internal_shader->attribute_stride;
+
         // Setup the new attribute.
         VkVertexInputAttributeDescription attribute;
         attribute.location = i;
-        attribute.binding = 0;
-        attribute.offset = offset;
-        attribute.format = types[shader_resource->attributes[i].type];
+        attribute.binding = config->per_instance ? 1 : 0;
+        attribute.offset = *stride;
+        attribute.format = types[config->type];
 
         // Push into the config's attribute collection and add to the stride.
         internal_shader->attributes[i] = attribute;
 
-        offset += shader_resource->attributes[i].size;
-        internal_shader->attribute_stride += shader_resource->attributes[i].size;
+        *stride += config->size;
     }
 
     // Descriptor pool.
@@ -2590,9 +2831,9 @@ void vulkan_renderer_shader_destroy(renderer_backend_interface* backend, khandle
         // Global descriptor sets.
         kzero_memory(internal_shader->per_frame_state.descriptor_sets, sizeof(VkDescriptorSet) * VULKAN_RESOURCE_IMAGE_COUNT);
 
-        // Descriptor pool
+        // Descriptor pool. Sets allocated from it may still be in use by frames in flight.
         if (internal_shader->descriptor_pool) {
-            rhi->kvkDestroyDescriptorPool(logical_device, internal_shader->descriptor_pool, vk_allocator);
+            vulkan_deletion_queue_push_descriptor_pool(context, internal_shader->descriptor_pool);
             internal_shader->descriptor_pool = 0;
         }
 
@@ -2636,13 +2877,13 @@ void vulkan_renderer_shader_destroy(renderer_backend_interface* backend, khandle
         }
         kzero_memory(internal_shader->uniform_buffers, sizeof(renderbuffer) * VULKAN_RESOURCE_IMAGE_COUNT);
 
-        // Pipelines
+        // Pipelines. These may still be in use by frames in flight.
         for (u32 i = 0; i < VULKAN_TOPOLOGY_CLASS_MAX; ++i) {
             if (internal_shader->pipelines[i]) {
-                vulkan_pipeline_destroy(context, internal_shader->pipelines[i]);
+                vulkan_pipeline_destroy_deferred(context, internal_shader->pipelines[i]);
             }
             if (internal_shader->wireframe_pipelines && internal_shader->wireframe_pipelines[i]) {
-                vulkan_pipeline_destroy(context, internal_shader->wireframe_pipelines[i]);
+                vulkan_pipeline_destroy_deferred(context, internal_shader->wireframe_pipelines[i]);
             }
         }
 
@@ -2698,7 +2939,6 @@ b8 vulkan_renderer_shader_use(renderer_backend_interface* backend, khandle shade
     vulkan_pipeline** pipeline_array = wireframe_enabled ? internal_shader->wireframe_pipelines : internal_shader->pipelines;
     vulkan_pipeline_bind(context, command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_array[internal_shader->bound_pipeline_index]);
 
-    context->bound_shader = internal_shader;
     // Make sure to use the current bound type as well.
     if (context->device.support_flags & VULKAN_DEVICE_SUPPORT_FLAG_NATIVE_DYNAMIC_STATE_BIT) {
         rhi->kvkCmdSetPrimitiveTopology(command_buffer->handle, internal_shader->current_topology);
@@ -2773,7 +3013,6 @@ b8 vulkan_renderer_shader_apply_per_frame(renderer_backend_interface* backend, k
 
     if (!vulkan_descriptorset_update_and_bind(
             context,
-            renderer_frame_number, // Frame number is used as the generation for per-frame data.
             internal_shader,
             frequency_info,
             per_frame_state,
@@ -2811,7 +3050,6 @@ b8 vulkan_renderer_shader_apply_per_group(renderer_backend_interface* backend, k
 
     if (!vulkan_descriptorset_update_and_bind(
             context,
-            renderer_frame_number, // Frame number is used as the generation for per-frame data.
             internal_shader,
             frequency_info,
             group_state,
@@ -2863,7 +3101,6 @@ b8 vulkan_renderer_shader_apply_per_draw(renderer_backend_interface* backend, kh
 
         if (!vulkan_descriptorset_update_and_bind(
                 context,
-                renderer_frame_number, // Frame number is used as the generation for per-frame data.
                 internal_shader,
                 frequency_info,
                 per_draw_state,
@@ -2972,13 +3209,11 @@ khandle vulkan_renderer_sampler_acquire(renderer_backend_interface* backend, kna
 
 void vulkan_renderer_sampler_release(renderer_backend_interface* backend, khandle* sampler) {
     vulkan_context* context = (vulkan_context*)backend->internal_context;
-    krhi_vulkan* rhi = &context->rhi;
     if (!khandle_is_invalid(*sampler)) {
         vulkan_sampler_handle_data* s = &context->samplers[sampler->handle_index];
         if (s->sampler && s->handle_uniqueid == sampler->unique_id.uniqueid) {
-            // Make sure there's no way this is in use.
-            rhi->kvkDeviceWaitIdle(context->device.logical_device);
-            rhi->kvkDestroySampler(context->device.logical_device, s->sampler, context->allocator);
+            // Frames in flight may still be using this, so destroy it once they complete.
+            vulkan_deletion_queue_push_sampler(context, s->sampler);
             // Invalidate the entry and the handle.
             s->sampler = 0;
             s->handle_uniqueid = INVALID_ID_U64;
@@ -2989,7 +3224,6 @@ void vulkan_renderer_sampler_release(renderer_backend_interface* backend, khandl
 
 b8 vulkan_renderer_sampler_refresh(renderer_backend_interface* backend, khandle* sampler, texture_filter filter, texture_repeat repeat, f32 anisotropy, u32 mip_levels) {
     vulkan_context* context = (vulkan_context*)backend->internal_context;
-    krhi_vulkan* rhi = &context->rhi;
     if (khandle_is_invalid(*sampler)) {
         KERROR("Attempted to refresh a sampler via an invalid handler.");
         return false;
@@ -3001,17 +3235,14 @@ b8 vulkan_renderer_sampler_refresh(renderer_backend_interface* backend, khandle*
         // Take a copy of the old sampler.
         VkSampler old = s->sampler;
 
-        // Make sure there's no way this is in use.
-        rhi->kvkDeviceWaitIdle(context->device.logical_device);
-
         // Create/assign the new.
         if (!sampler_create_internal(context, filter, repeat, anisotropy, s)) {
             KERROR("Sampler refresh failed to create new internal sampler.");
             return false;
         }
 
-        // Destroy the old.
-        rhi->kvkDestroySampler(context->device.logical_device, old, context->allocator);
+        // Destroy the old once frames in flight which may be using it complete.
+        vulkan_deletion_queue_push_sampler(context, old);
 
         // Update the handle and handle data.
         sampler->unique_id = identifier_create();
@@ -3125,39 +3356,88 @@ b8 vulkan_renderer_shader_uniform_set(renderer_backend_interface* backend, khand
     return true;
 }
 
-static b8 create_shader_module(vulkan_context* context, vulkan_shader* internal_shader, shader_stage stage, const char* source, const char* filename, vulkan_shader_stage* out_stage) {
-    krhi_vulkan* rhi = &context->rhi;
+// Loads the SPIR-V at the given path, if it exists. Returns 0 if not.
+static u32* spirv_cache_load(const char* path, u64* out_size) {
+    *out_size = 0;
+    if (!filesystem_exists(path)) {
+        return 0;
+    }
+
+    file_handle f;
+    if (!filesystem_open(path, FILE_MODE_READ, true, &f)) {
+        return 0;
+    }
+
+    u64 size = 0;
+    // SPIR-V is a stream of 32-bit words, so anything else is corrupt.
+    if (!filesystem_size(&f, &size) || size == 0 || (size % sizeof(u32)) != 0) {
+        KWARN("SPIR-V cache entry '%s' is invalid and will be ignored.", path);
+        filesystem_close(&f);
+        return 0;
+    }
+
+    u32* code = kallocate(size, MEMORY_TAG_RENDERER);
+    u64 read = 0;
+    b8 success = filesystem_read_all_bytes(&f, (u8*)code, &read) && read == size;
+    filesystem_close(&f);
+    if (!success) {
+        KWARN("Failed to read SPIR-V cache entry '%s'. It will be ignored.", path);
+        kfree(code, size, MEMORY_TAG_RENDERER);
+        return 0;
+    }
+
+    *out_size = size;
+    return code;
+}
+
+#if KVULKAN_RUNTIME_SHADER_COMPILATION
+// Stores the given SPIR-V in the cache, so the next run doesn't need to compile it.
+static void spirv_cache_store(const char* path, const u32* code, u64 size) {
+    if (!filesystem_directory_create(VULKAN_SPIRV_CACHE_DIRECTORY)) {
+        KWARN("Unable to create SPIR-V cache directory '%s'. Compiled shaders will not be cached.", VULKAN_SPIRV_CACHE_DIRECTORY);
+        return;
+    }
+
+    file_handle f;
+    if (!filesystem_open(path, FILE_MODE_WRITE, true, &f)) {
+        KWARN("Unable to write SPIR-V cache entry '%s'.", path);
+        return;
+    }
+    u64 written = 0;
+    if (!filesystem_write(&f, size, code, &written) || written != size) {
+        KWARN("Failed to write SPIR-V cache entry '%s'.", path);
+    }
+    filesystem_close(&f);
+}
+
+// Compiles the given GLSL source to SPIR-V using shaderc. Returns 0 on failure.
+static u32* compile_spirv(vulkan_context* context, vulkan_shader* internal_shader, shader_stage stage, const char* source, u64 source_length, const char* filename, u64* out_size) {
     shaderc_shader_kind shader_kind;
-    VkShaderStageFlagBits vulkan_stage;
     switch (stage) {
     case SHADER_STAGE_VERTEX:
         shader_kind = shaderc_glsl_default_vertex_shader;
-        vulkan_stage = VK_SHADER_STAGE_VERTEX_BIT;
         break;
     case SHADER_STAGE_FRAGMENT:
         shader_kind = shaderc_glsl_default_fragment_shader;
-        vulkan_stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         break;
     case SHADER_STAGE_COMPUTE:
         shader_kind = shaderc_glsl_default_compute_shader;
-        vulkan_stage = VK_SHADER_STAGE_COMPUTE_BIT;
         break;
     case SHADER_STAGE_GEOMETRY:
         shader_kind = shaderc_glsl_default_geometry_shader;
-        vulkan_stage = VK_SHADER_STAGE_GEOMETRY_BIT;
         break;
     default:
-        KERROR("Unsupported shader kind. Unable to create module.");
-        return false;
+        KERROR("Unsupported shader kind. Unable to compile.");
+        return 0;
     }
 
     KDEBUG("Compiling stage '%s' for shader '%s'...", shader_stage_to_string(stage), kname_string_get(internal_shader->name));
 
     // Attempt to compile the shader.
+    // NOTE: These options must match SHADER_SPIRV_COMPILE_OPTIONS, since they are part of the cache key.
     shaderc_compile_options_t options = shaderc_compile_options_initialize();
     // shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
     shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
-    u32 source_length = string_length(source);
     shaderc_compilation_result_t compilation_result = shaderc_compile_into_spv(
         context->shader_compiler,
         source,
@@ -3166,10 +3446,11 @@ static b8 create_shader_module(vulkan_context* context, vulkan_shader* internal_
         filename,
         "main",
         options);
+    shaderc_compile_options_release(options);
 
     if (!compilation_result) {
         KERROR("An unknown error occurred while trying to compile the shader. Unable to process futher.");
-        return false;
+        return 0;
     }
     shaderc_compilation_status status = shaderc_result_get_compilation_status(compilation_result);
 
@@ -3180,7 +3461,7 @@ static b8 create_shader_module(vulkan_context* context, vulkan_shader* internal_
         KERROR("Error compiling shader with %llu errors.", error_count);
         KERROR("Error(s):\n%s", error_message);
         shaderc_result_release(compilation_result);
-        return false;
+        return 0;
     }
 
     KDEBUG("Shader compiled successfully.");
@@ -3202,15 +3483,67 @@ static b8 create_shader_module(vulkan_context* context, vulkan_shader* internal_
     // Release the compilation result.
     shaderc_result_release(compilation_result);
 
+    *out_size = result_length;
+    return code;
+}
+#endif
+
+static b8 create_shader_module(vulkan_context* context, vulkan_shader* internal_shader, shader_stage stage, const char* source, const char* filename, vulkan_shader_stage* out_stage) {
+    krhi_vulkan* rhi = &context->rhi;
+    VkShaderStageFlagBits vulkan_stage;
+    switch (stage) {
+    case SHADER_STAGE_VERTEX:
+        vulkan_stage = VK_SHADER_STAGE_VERTEX_BIT;
+        break;
+    case SHADER_STAGE_FRAGMENT:
+        vulkan_stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        break;
+    case SHADER_STAGE_COMPUTE:
+        vulkan_stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        break;
+    case SHADER_STAGE_GEOMETRY:
+        vulkan_stage = VK_SHADER_STAGE_GEOMETRY_BIT;
+        break;
+    default:
+        KERROR("Unsupported shader kind. Unable to create module.");
+        return false;
+    }
+
+    // Look for SPIR-V built from this exact source first. Only sources that were changed since
+    // (i.e. hot-reloaded) or never built offline miss here.
+    u64 source_length = string_length(source);
+    u64 cache_key = shader_spirv_cache_key(stage, SHADER_SPIRV_COMPILE_OPTIONS, source, source_length);
+    char* cache_path = string_format("%s/%016llx.spv", VULKAN_SPIRV_CACHE_DIRECTORY, cache_key);
+
+    u64 code_size = 0;
+    u32* code = spirv_cache_load(cache_path, &code_size);
+    if (code) {
+        KDEBUG("Loaded cached SPIR-V for stage '%s' of shader '%s'.", shader_stage_to_string(stage), kname_string_get(internal_shader->name));
+    } else {
+#if KVULKAN_RUNTIME_SHADER_COMPILATION
+        code = compile_spirv(context, internal_shader, stage, source, source_length, filename, &code_size);
+        if (code) {
+            spirv_cache_store(cache_path, code, code_size);
+        }
+#else
+        KERROR("No SPIR-V found at '%s' for stage '%s' of shader '%s', and runtime shader compilation is disabled. Build shaders with 'kohi.tools buildshaders'.",
+               cache_path, shader_stage_to_string(stage), kname_string_get(internal_shader->name));
+#endif
+    }
+    string_free(cache_path);
+    if (!code) {
+        return false;
+    }
+
     kzero_memory(&out_stage->create_info, sizeof(VkShaderModuleCreateInfo));
     out_stage->create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    out_stage->create_info.codeSize = result_length;
+    out_stage->create_info.codeSize = code_size;
     out_stage->create_info.pCode = code;
 
     VK_CHECK(rhi->kvkCreateShaderModule(context->device.logical_device, &out_stage->create_info, context->allocator, &out_stage->handle));
 
     // Release the copy of the code.
-    kfree(code, result_length, MEMORY_TAG_RENDERER);
+    kfree(code, code_size, MEMORY_TAG_RENDERER);
 
     // Shader stage info
     kzero_memory(&out_stage->shader_stage_create_info, sizeof(VkPipelineShaderStageCreateInfo));
@@ -3239,6 +3572,12 @@ void vulkan_renderer_flag_enabled_set(renderer_backend_interface* backend, rende
     context->render_flag_changed = true;
 }
 
+b8 vulkan_renderer_indirect_draw_supported(renderer_backend_interface* backend) {
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+    // Per-instance data is located using firstInstance, so it must be usable from indirect commands.
+    return context->device.features.drawIndirectFirstInstance;
+}
+
 f32 vulkan_renderer_max_anisotropy_get(renderer_backend_interface* backend) {
     vulkan_context* context = (vulkan_context*)backend->internal_context;
     if (!context->device.features.samplerAnisotropy) {
@@ -3311,6 +3650,26 @@ b8 vulkan_buffer_create_internal(renderer_backend_interface* backend, renderbuff
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
         break;
+    case RENDERBUFFER_TYPE_INSTANCE: {
+        // Rewritten by the host every frame, so keep it host-visible like uniforms.
+        u32 device_local_bits = context->device.supports_device_local_host_visible
+                                    ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                    : 0;
+        internal_buffer.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        internal_buffer.memory_property_flags =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | device_local_bits;
+    } break;
+    case RENDERBUFFER_TYPE_INDIRECT: {
+        // Filled by the host every frame, so keep it host-visible like uniforms.
+        u32 device_local_bits = context->device.supports_device_local_host_visible
+                                    ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                    : 0;
+        internal_buffer.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        internal_buffer.memory_property_flags =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | device_local_bits;
+    } break;
     case RENDERBUFFER_TYPE_STORAGE:
         KERROR("Storage buffer not yet supported.");
         return false;
@@ -3322,8 +3681,12 @@ b8 vulkan_buffer_create_internal(renderer_backend_interface* backend, renderbuff
     VkBufferCreateInfo buffer_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
     buffer_info.size = buffer->total_size;
     buffer_info.usage = internal_buffer.usage;
-    buffer_info.sharingMode =
-        VK_SHARING_MODE_EXCLUSIVE; // NOTE: Only used in one queue.
+    if ((internal_buffer.memory_property_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) {
+        // Loaded via staging, so may be written by the upload manager's transfer queue.
+        vulkan_upload_buffer_sharing_apply(context, &buffer_info);
+    } else {
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // NOTE: Only used in one queue.
+    }
 
     VK_CHECK(rhi->kvkCreateBuffer(context->device.logical_device, &buffer_info,
                                   context->allocator, &internal_buffer.handle));
@@ -3383,28 +3746,17 @@ b8 vulkan_buffer_create_internal(renderer_backend_interface* backend, renderbuff
 
 void vulkan_buffer_destroy_internal(renderer_backend_interface* backend, renderbuffer* buffer) {
     vulkan_context* context = (vulkan_context*)backend->internal_context;
-    krhi_vulkan* rhi = &context->rhi;
-    rhi->kvkDeviceWaitIdle(context->device.logical_device);
     if (buffer) {
         vulkan_buffer* internal_buffer = (vulkan_buffer*)buffer->internal_data;
         if (internal_buffer) {
-            if (internal_buffer->memory) {
-                rhi->kvkFreeMemory(context->device.logical_device, internal_buffer->memory,
-                                   context->allocator);
-                internal_buffer->memory = 0;
-            }
-            if (internal_buffer->handle) {
-                rhi->kvkDestroyBuffer(context->device.logical_device, internal_buffer->handle,
-                                      context->allocator);
-                internal_buffer->handle = 0;
-            }
-
-            // Report the free memory.
+            // Frames in flight may still be using the buffer, so destroy it (and report the
+            // memory free) once they complete.
             b8 is_device_memory = (internal_buffer->memory_property_flags &
                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ==
                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-            kfree_report(internal_buffer->memory_requirements.size,
-                         is_device_memory ? MEMORY_TAG_GPU_LOCAL : MEMORY_TAG_VULKAN);
+            vulkan_deletion_queue_push_buffer(context, internal_buffer->handle, internal_buffer->memory, internal_buffer->memory_requirements.size, is_device_memory);
+            internal_buffer->handle = 0;
+            internal_buffer->memory = 0;
             kzero_memory(&internal_buffer->memory_requirements,
                          sizeof(VkMemoryRequirements));
 
@@ -3431,8 +3783,12 @@ b8 vulkan_buffer_resize(renderer_backend_interface* backend, renderbuffer* buffe
     VkBufferCreateInfo buffer_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
     buffer_info.size = new_size;
     buffer_info.usage = internal_buffer->usage;
-    buffer_info.sharingMode =
-        VK_SHARING_MODE_EXCLUSIVE; // NOTE: Only used in one queue.
+    if ((internal_buffer->memory_property_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) {
+        // Loaded via staging, so may be written by the upload manager's transfer queue.
+        vulkan_upload_buffer_sharing_apply(context, &buffer_info);
+    } else {
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // NOTE: Only used in one queue.
+    }
 
     VkBuffer new_buffer;
     VK_CHECK(rhi->kvkCreateBuffer(context->device.logical_device, &buffer_info,
@@ -3464,34 +3820,19 @@ b8 vulkan_buffer_resize(renderer_backend_interface* backend, renderbuffer* buffe
     VK_CHECK(rhi->kvkBindBufferMemory(context->device.logical_device, new_buffer,
                                       new_memory, 0));
 
-    // Copy over the data.
-    vulkan_buffer_copy_range_internal(context, internal_buffer->handle, 0,
-                                      new_buffer, 0, buffer->total_size, false);
-
-    // Make sure anything potentially using these is finished.
-    // NOTE: We could use vkQueueWaitIdle here if we knew what queue this buffer
-    // would be used with...
-    rhi->kvkDeviceWaitIdle(context->device.logical_device);
-
-    // Destroy the old
-    if (internal_buffer->memory) {
-        rhi->kvkFreeMemory(context->device.logical_device, internal_buffer->memory,
-                           context->allocator);
-        internal_buffer->memory = 0;
-    }
-    if (internal_buffer->handle) {
-        rhi->kvkDestroyBuffer(context->device.logical_device, internal_buffer->handle,
-                              context->allocator);
-        internal_buffer->handle = 0;
-    }
+    // Copy over the data. This is recorded through the upload manager, so it's ordered after
+    // any uploads to the old buffer and submitted ahead of the next frame without waiting.
+    vulkan_upload_copy_buffer(context, internal_buffer->handle, 0, new_buffer, 0, buffer->total_size);
 
-    // Report free of the old, allocate of the new.
+    // Frames in flight may still be using the old buffer, so destroy it (and report the memory
+    // free) once they complete. Report the allocation of the new now.
     b8 is_device_memory = (internal_buffer->memory_property_flags &
                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ==
                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    vulkan_deletion_queue_push_buffer(context, internal_buffer->handle, internal_buffer->memory, internal_buffer->memory_requirements.size, is_device_memory);
+    internal_buffer->memory = 0;
+    internal_buffer->handle = 0;
 
-    kfree_report(internal_buffer->memory_requirements.size,
-                 is_device_memory ? MEMORY_TAG_GPU_LOCAL : MEMORY_TAG_VULKAN);
     internal_buffer->memory_requirements = requirements;
     kallocate_report(internal_buffer->memory_requirements.size,
                      is_device_memory ? MEMORY_TAG_GPU_LOCAL : MEMORY_TAG_VULKAN);
@@ -3645,17 +3986,23 @@ b8 vulkan_buffer_load_range(
     if (vulkan_buffer_is_device_local(backend, internal_buffer) &&
         !vulkan_buffer_is_host_visible(backend, internal_buffer)) {
         // NOTE: If a staging buffer is needed (i.e.) the target buffer's memory is
-        // not host visible but is device-local, create a staging buffer to load the
-        // data into first. Then copy from it to the target buffer.
-
-        // Load the data into the staging buffer.
-        u64 staging_offset = 0;
-        renderbuffer* staging = &context->current_window->renderer_state->backend_state->staging[get_current_frame_index(context)];
-        renderer_renderbuffer_allocate(staging, size, &staging_offset);
-        vulkan_buffer_load_range(backend, staging, staging_offset, size, data, include_in_frame_workload);
-
-        // Perform the copy from staging to the device local buffer.
-        vulkan_buffer_copy_range(backend, staging, staging_offset, buffer, offset, size, include_in_frame_workload);
+        // not host visible but is device-local, load the data into a staging buffer
+        // first. Then copy from it to the target buffer.
+
+        // NOTE: include_in_frame_workload is ignored. All staged loads go through the upload
+        // manager, which submits them ahead of the frame in the order they were made.
+        if (!vulkan_upload_buffer(context, internal_buffer->handle, offset, size, data)) {
+            // Too large to be staged by the upload manager, so use a temporary staging buffer and wait.
+            renderbuffer temp;
+            if (!renderer_renderbuffer_create("temp_staging", RENDERBUFFER_TYPE_STAGING, size, RENDERBUFFER_TRACK_TYPE_NONE, &temp)) {
+                KERROR("vulkan_buffer_load_range() - Failed to create temporary staging buffer.");
+                return false;
+            }
+            renderer_renderbuffer_bind(&temp, 0);
+            vulkan_buffer_load_range(backend, &temp, 0, size, data, false);
+            vulkan_buffer_copy_range(backend, &temp, 0, buffer, offset, size, false);
+            renderer_renderbuffer_destroy(&temp);
+        }
     } else {
         // If no staging buffer is needed, map/copy/unmap.
         void* data_ptr;
@@ -3681,6 +4028,8 @@ static b8 vulkan_buffer_copy_range_internal(
     // If not including in frame workload, then utilize a new temp command buffer as well. Otherwise this should be done
     // as part of the current frame's work.
     if (!include_in_frame_workload) {
+        // Anything staged by the upload manager (i.e. to the source) must complete first.
+        vulkan_upload_flush(context, true);
         rhi->kvkQueueWaitIdle(queue);
         // Create a one-time-use command buffer.
         vulkan_command_buffer_allocate_and_begin_single_use(context, context->device.graphics_command_pool, &temp_command_buffer);
@@ -3776,15 +4125,122 @@ b8 vulkan_buffer_draw(
     }
 }
 
+b8 vulkan_buffer_draw_instanced(
+    renderer_backend_interface* backend,
+    renderbuffer* buffer,
+    u64 offset,
+    u32 element_count,
+    renderbuffer* instance_buffer,
+    u64 instance_offset,
+    u32 instance_count) {
+    //
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_command_buffer* command_buffer = get_current_command_buffer(context);
+
+    if (!instance_buffer || instance_buffer->type != RENDERBUFFER_TYPE_INSTANCE) {
+        KERROR("vulkan_buffer_draw_instanced requires a valid instance buffer.");
+        return false;
+    }
+
+    // Per-instance data is always sourced from binding 1.
+    VkDeviceSize instance_offsets[1] = {instance_offset};
+    rhi->kvkCmdBindVertexBuffers(command_buffer->handle, 1, 1,
+                                 &((vulkan_buffer*)instance_buffer->internal_data)->handle,
+                                 instance_offsets);
+
+    if (buffer->type == RENDERBUFFER_TYPE_VERTEX) {
+        // Bind vertex buffer at offset.
+        VkDeviceSize offsets[1] = {offset};
+        rhi->kvkCmdBindVertexBuffers(command_buffer->handle, 0, 1,
+                                     &((vulkan_buffer*)buffer->internal_data)->handle,
+                                     offsets);
+        rhi->kvkCmdDraw(command_buffer->handle, element_count, instance_count, 0, 0);
+        return true;
+    } else if (buffer->type == RENDERBUFFER_TYPE_INDEX) {
+        // Bind index buffer at offset.
+        rhi->kvkCmdBindIndexBuffer(command_buffer->handle,
+                                   ((vulkan_buffer*)buffer->internal_data)->handle,
+                                   offset, VK_INDEX_TYPE_UINT32);
+        rhi->kvkCmdDrawIndexed(command_buffer->handle, element_count, instance_count, 0, 0, 0);
+        return true;
+    } else {
+        KERROR("Cannot draw buffer of type: %i", buffer->type);
+        return false;
+    }
+}
+
+b8 vulkan_buffer_draw_indexed_indirect(
+    renderer_backend_interface* backend,
+    renderbuffer* indirect_buffer,
+    u64 indirect_offset,
+    u32 draw_count,
+    renderbuffer* vertex_buffer,
+    renderbuffer* index_buffer,
+    renderbuffer* instance_buffer,
+    u64 instance_offset) {
+    //
+    vulkan_context* context = (vulkan_context*)backend->internal_context;
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_command_buffer* command_buffer = get_current_command_buffer(context);
+
+    if (!indirect_buffer || indirect_buffer->type != RENDERBUFFER_TYPE_INDIRECT ||
+        !vertex_buffer || vertex_buffer->type != RENDERBUFFER_TYPE_VERTEX ||
+        !index_buffer || index_buffer->type != RENDERBUFFER_TYPE_INDEX ||
+        !instance_buffer || instance_buffer->type != RENDERBUFFER_TYPE_INSTANCE) {
+        KERROR("vulkan_buffer_draw_indexed_indirect requires valid indirect, vertex, index and instance buffers.");
+        return false;
+    }
+    if (!draw_count) {
+        return true;
+    }
+
+    // Commands address vertices and indices relative to the start of their buffers, and
+    // instances relative to the given offset.
+    VkBuffer vertex_buffers[2] = {
+        ((vulkan_buffer*)vertex_buffer->internal_data)->handle,
+        ((vulkan_buffer*)instance_buffer->internal_data)->handle};
+    VkDeviceSize offsets[2] = {0, instance_offset};
+    rhi->kvkCmdBindVertexBuffers(command_buffer->handle, 0, 2, vertex_buffers, offsets);
+    rhi->kvkCmdBindIndexBuffer(command_buffer->handle, ((vulkan_buffer*)index_buffer->internal_data)->handle, 0, VK_INDEX_TYPE_UINT32);
+
+    VkBuffer indirect_handle = ((vulkan_buffer*)indirect_buffer->internal_data)->handle;
+    u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (context->device.features.multiDrawIndirect) {
+        rhi->kvkCmdDrawIndexedIndirect(command_buffer->handle, indirect_handle, indirect_offset, draw_count, stride);
+    } else {
+        // Without multi-draw support, only one command may be drawn per call.
+        for (u32 i = 0; i < draw_count; ++i) {
+            rhi->kvkCmdDrawIndexedIndirect(command_buffer->handle, indirect_handle, indirect_offset + (u64)stride * i, 1, stride);
+        }
+    }
+
+    return true;
+}
+
 void vulkan_renderer_wait_for_idle(renderer_backend_interface* backend) {
     if (backend) {
         vulkan_context* context = backend->internal_context;
         krhi_vulkan* rhi = &context->rhi;
         VK_CHECK(rhi->kvkDeviceWaitIdle(context->device.logical_device));
+
+        // Everything submitted is now complete.
+        context->completed_frame_number = context->submitted_frame_number;
+        vulkan_deletion_queue_update(context);
     }
 }
 
+static vulkan_command_buffer* get_node_command_buffer(vulkan_context* context, u32 slot) {
+    kwindow_renderer_backend_state* window_backend = context->current_window->renderer_state->backend_state;
+    return &window_backend->node_command_buffers[(window_backend->current_frame * RENDERER_MAX_NODE_COMMAND_LISTS) + slot];
+}
+
 static vulkan_command_buffer* get_current_command_buffer(vulkan_context* context) {
+    // If this thread is recording a node command list, everything goes there.
+    if (thread_node_command_buffer) {
+        return thread_node_command_buffer;
+    }
+
     kwindow_renderer_backend_state* window_backend = context->current_window->renderer_state->backend_state;
     vulkan_command_buffer* primary = &window_backend->graphics_command_buffers[window_backend->current_frame];
 
@@ -3955,15 +4411,19 @@ static b8 vulkan_graphics_pipeline_create(vulkan_context* context, const vulkan_
     dynamic_state_create_info.pDynamicStates = dynamic_states;
 
     // Vertex input
-    VkVertexInputBindingDescription binding_description;
-    binding_description.binding = 0; // Binding index
-    binding_description.stride = config->stride;
-    binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // Move to next data entry for each vertex.
+    VkVertexInputBindingDescription binding_descriptions[2];
+    binding_descriptions[0].binding = 0; // Binding index
+    binding_descriptions[0].stride = config->stride;
+    binding_descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // Move to next data entry for each vertex.
+    // Per-instance data, if used, comes from a second binding.
+    binding_descriptions[1].binding = 1;
+    binding_descriptions[1].stride = config->instance_stride;
+    binding_descriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE; // Move to next data entry for each instance.
 
     // Attributes
     VkPipelineVertexInputStateCreateInfo vertex_input_info = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-    vertex_input_info.vertexBindingDescriptionCount = 1;
-    vertex_input_info.pVertexBindingDescriptions = &binding_description;
+    vertex_input_info.vertexBindingDescriptionCount = config->instance_stride ? 2 : 1;
+    vertex_input_info.pVertexBindingDescriptions = binding_descriptions;
     vertex_input_info.vertexAttributeDescriptionCount = config->attribute_count;
     vertex_input_info.pVertexAttributeDescriptions = config->attributes;
 
@@ -4088,13 +4548,16 @@ static b8 vulkan_graphics_pipeline_create(vulkan_context* context, const vulkan_
 
     pipeline_create_info.pNext = &pipeline_rendering_create_info;
 
+    f64 create_start_time = platform_get_absolute_time();
     VkResult result = rhi->kvkCreateGraphicsPipelines(
         context->device.logical_device,
-        VK_NULL_HANDLE,
+        context->pipeline_cache,
         1,
         &pipeline_create_info,
         context->allocator,
         &out_pipeline->handle);
+    context->pipeline_creation_time += platform_get_absolute_time() - create_start_time;
+    context->pipeline_creation_count++;
 
     // Cleanup
     darray_destroy(dynamic_states);
@@ -4131,6 +4594,15 @@ static void vulkan_pipeline_destroy(vulkan_context* context, vulkan_pipeline* pi
     }
 }
 
+// Queues the pipeline for destruction once frames in flight which may be using it complete.
+static void vulkan_pipeline_destroy_deferred(vulkan_context* context, vulkan_pipeline* pipeline) {
+    if (pipeline) {
+        vulkan_deletion_queue_push_pipeline(context, pipeline->handle, pipeline->pipeline_layout);
+        pipeline->handle = 0;
+        pipeline->pipeline_layout = 0;
+    }
+}
+
 static void vulkan_pipeline_bind(vulkan_context* context, vulkan_command_buffer* command_buffer, VkPipelineBindPoint bind_point, vulkan_pipeline* pipeline) {
     krhi_vulkan* rhi = &context->rhi;
     rhi->kvkCmdBindPipeline(command_buffer->handle, bind_point, pipeline->handle);
@@ -4241,10 +4713,8 @@ static b8 setup_frequency_state(renderer_backend_interface* backend, vulkan_shad
                 // khandle default_sampler = renderer_generic_sampler_get(backend->frontend_state, SHADER_GENERIC_SAMPLER_NEAREST_REPEAT_NO_ANISOTROPY);
                 sampler_state->sampler_handles[d] = default_sampler;
 
-                // Per swapchain image
-                for (u32 j = 0; j < VULKAN_RESOURCE_IMAGE_COUNT; ++j) {
-                    sampler_state->descriptor_states[d].renderer_frame_number[j] = INVALID_ID_U16;
-                }
+                // Invalidate descriptor state.
+                kzero_memory(&sampler_state->descriptor_states[d], sizeof(vulkan_descriptor_state));
             }
         }
     }
@@ -4268,10 +4738,8 @@ static b8 setup_frequency_state(renderer_backend_interface* backend, vulkan_shad
                 // TODO: Make this configurable.
                 texture_state->texture_handles[d] = renderer_default_texture_get(backend->frontend_state, RENDERER_DEFAULT_TEXTURE_BASE_COLOUR);
 
-                // Per swapchain image
-                for (u32 j = 0; j < VULKAN_RESOURCE_IMAGE_COUNT; ++j) {
-                    texture_state->descriptor_states[d].renderer_frame_number[j] = INVALID_ID_U16;
-                }
+                // Invalidate descriptor state.
+                kzero_memory(&texture_state->descriptor_states[d], sizeof(vulkan_descriptor_state));
             }
         }
     }
@@ -4295,11 +4763,11 @@ static b8 setup_frequency_state(renderer_backend_interface* backend, vulkan_shad
     // Temp array for descriptor set layouts.
     VkDescriptorSetLayout layouts[VULKAN_RESOURCE_IMAGE_COUNT] = {0, 0, 0};
 
+    // Invalidate descriptor state.
+    kzero_memory(&frequency_state->ubo_descriptor_state, sizeof(vulkan_descriptor_state));
+
     // Per colour image
     for (u32 j = 0; j < VULKAN_RESOURCE_IMAGE_COUNT; ++j) {
-        // Invalidate descriptor state.
-        frequency_state->ubo_descriptor_state.renderer_frame_number[j] = INVALID_ID_U16;
-
         // Set descriptor set layout for this index.
         layouts[j] = internal->descriptor_set_layouts[descriptor_set_index];
     }
@@ -4333,8 +4801,6 @@ static b8 setup_frequency_state(renderer_backend_interface* backend, vulkan_shad
 }
 
 static b8 release_shader_frequency_state(vulkan_context* context, vulkan_shader* internal_shader, shader_update_frequency frequency, u32 frequency_id) {
-    krhi_vulkan* rhi = &context->rhi;
-
     vulkan_shader_frequency_state* frequency_state = 0;
     vulkan_shader_frequency_info* frequency_info = 0;
     b8 destroy_ubo = false;
@@ -4357,9 +4823,6 @@ static b8 release_shader_frequency_state(vulkan_context* context, vulkan_shader*
         break;
     }
 
-    // Wait for any pending operations using the descriptor set to finish.
-    rhi->kvkDeviceWaitIdle(context->device.logical_device);
-
     // Destroy bindings and their descriptor states/uniforms.
     // UBO, if one exists.
     if (destroy_ubo) {
@@ -4374,11 +4837,10 @@ static b8 release_shader_frequency_state(vulkan_context* context, vulkan_shader*
         }
     }
 
-    // Descriptor sets
-    VkResult result = rhi->kvkFreeDescriptorSets(context->device.logical_device, internal_shader->descriptor_pool, VULKAN_RESOURCE_IMAGE_COUNT, frequency_state->descriptor_sets);
-    if (result != VK_SUCCESS) {
-        KERROR("Error freeing %s shader descriptor sets!", shader_update_frequency_to_string(frequency));
-    }
+    // Descriptor sets. These may still be in use by frames in flight, so free them once those complete.
+    // NOTE: UBO ranges above can be released right away, since each image index has its own
+    // uniform buffer and that image's previous frame is complete by the time it's written again.
+    vulkan_deletion_queue_push_descriptor_sets(context, internal_shader->descriptor_pool, VULKAN_RESOURCE_IMAGE_COUNT, frequency_state->descriptor_sets);
 
     // Samplers
     if (frequency_state->sampler_states) {
@@ -4505,6 +4967,7 @@ static b8 shader_create_modules_and_pipelines(renderer_backend_interface* backen
 
         vulkan_pipeline_config pipeline_config = {0};
         pipeline_config.stride = internal_shader->attribute_stride;
+        pipeline_config.instance_stride = internal_shader->instance_stride;
         pipeline_config.attribute_count = internal_shader->attribute_count;
         pipeline_config.attributes = internal_shader->attributes;
         pipeline_config.descriptor_set_layout_count = internal_shader->descriptor_set_count;
@@ -4598,16 +5061,15 @@ static b8 shader_create_modules_and_pipelines(renderer_backend_interface* backen
         goto shader_module_pipeline_cleanup;
     }
 
-    // In success, destroy the old pipelines and move the new pipelines over.
-    rhi->kvkDeviceWaitIdle(context->device.logical_device);
+    // In success, destroy the old pipelines (once frames in flight using them complete) and move the new pipelines over.
     for (u32 i = 0; i < pipeline_count; ++i) {
         if (internal_shader->pipelines[i]) {
-            vulkan_pipeline_destroy(context, internal_shader->pipelines[i]);
+            vulkan_pipeline_destroy_deferred(context, internal_shader->pipelines[i]);
             kcopy_memory(internal_shader->pipelines[i], &new_pipelines[i], sizeof(vulkan_pipeline));
         }
         if (new_wireframe_pipelines) {
             if (internal_shader->wireframe_pipelines[i]) {
-                vulkan_pipeline_destroy(context, internal_shader->wireframe_pipelines[i]);
+                vulkan_pipeline_destroy_deferred(context, internal_shader->wireframe_pipelines[i]);
                 kcopy_memory(internal_shader->wireframe_pipelines[i], &new_wireframe_pipelines[i], sizeof(vulkan_pipeline));
             }
         }
@@ -4667,9 +5129,23 @@ static void setup_frequency_descriptors(b8 do_ubo, vulkan_shader_frequency_info*
     }
 }
 
+// Records the given resource as written to the descriptor for the given image index. Returns true if it differs from
+// what was last written (meaning the descriptor needs updating), or false if the descriptor is already up to date.
+static b8 descriptor_state_sync(vulkan_descriptor_state* state, u32 image_index, u64 resource_handle, u64 resource_uniqueid, u16 resource_generation) {
+    if (state->resource_handle[image_index] == resource_handle &&
+        state->resource_uniqueid[image_index] == resource_uniqueid &&
+        state->resource_generation[image_index] == resource_generation) {
+        return false;
+    }
+
+    state->resource_handle[image_index] = resource_handle;
+    state->resource_uniqueid[image_index] = resource_uniqueid;
+    state->resource_generation[image_index] = resource_generation;
+    return true;
+}
+
 static b8 vulkan_descriptorset_update_and_bind(
     vulkan_context* context,
-    u16 renderer_frame_number,
     vulkan_shader* internal_shader,
     const vulkan_shader_frequency_info* info,
     vulkan_shader_frequency_state* frequency_state,
@@ -4691,14 +5167,16 @@ static b8 vulkan_descriptorset_update_and_bind(
     u32 descriptor_write_count = 0;
     u32 binding_index = 0;
 
+    // NOTE: Descriptors are only written when what they refer to has changed since they were last written
+    // for this image index (including the resource's generation, so a recreated view/sampler is always
+    // picked up). In the common case of nothing changing, this means no descriptor writes at all.
+
     // Update UBO, if needed. UBO is always first.
     VkDescriptorBufferInfo ubo_buffer_info = {0};
     if (info->uniform_count > 0) {
-        u16* freq_gen = &frequency_state->ubo_descriptor_state.renderer_frame_number[image_index];
-        if ((*freq_gen) == INVALID_ID_U16 || (*freq_gen) != renderer_frame_number) {
-
-            // Only do this if the descriptor has not yet been updated.
-            ubo_buffer_info.buffer = ((vulkan_buffer*)internal_shader->uniform_buffers[image_index].internal_data)->handle;
+        VkBuffer ubo_buffer = ((vulkan_buffer*)internal_shader->uniform_buffers[image_index].internal_data)->handle;
+        if (descriptor_state_sync(&frequency_state->ubo_descriptor_state, image_index, (u64)ubo_buffer, 0, 0)) {
+            ubo_buffer_info.buffer = ubo_buffer;
             KASSERT_MSG((frequency_state->offset % context->device.properties.limits.minUniformBufferOffsetAlignment) == 0, "Ubo offset must be a multiple of device.properties.limits.minUniformBufferOffsetAlignment.");
             ubo_buffer_info.offset = frequency_state->offset;
             ubo_buffer_info.range = info->ubo_stride;
@@ -4712,9 +5190,6 @@ static b8 vulkan_descriptorset_update_and_bind(
 
             descriptor_writes[descriptor_write_count] = ubo_descriptor;
             descriptor_write_count++;
-
-            // Sync the generation.
-            *freq_gen = renderer_frame_number == INVALID_ID_U16 ? 0 : renderer_frame_number;
         }
 
         binding_index++;
@@ -4734,7 +5209,7 @@ static b8 vulkan_descriptorset_update_and_bind(
         u32 texture_binding_index = 0;
         for (u32 i = 0; i < sampler_and_image_count; ++i) {
             u32 binding_descriptor_count = set_config.bindings[binding_index].descriptorCount;
-            u32 update_count = 0;
+            b8 binding_changed = false;
             shader_uniform* u = &internal_shader->uniforms[info->sorted_indices[i]];
             b8 is_texture = uniform_type_is_texture(u->type);
             VkDescriptorType type = is_texture ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLER;
@@ -4766,23 +5241,17 @@ static b8 vulkan_descriptorset_update_and_bind(
 
                     vulkan_texture_handle_data* texture = &context->textures[resource_handle.handle_index];
 
-                    u32 image_index = texture->image_count > 1 ? get_current_image_index(context) : 0;
-                    vulkan_image* image = &texture->images[image_index];
-
-                    // Only update if the descriptor has not been updated this frame.
-                    u16* desc_gen = &descriptor_state->renderer_frame_number[image_index];
-                    if ((*desc_gen) == INVALID_ID_U16 || (*desc_gen) != renderer_frame_number) {
-                        binding_image_infos[i][update_count].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                        binding_image_infos[i][update_count].imageView = image->view;
-                        // NOTE: Not using sampler in this descriptor.
-                        binding_image_infos[i][update_count].sampler = 0;
+                    u32 texture_image_index = texture->image_count > 1 ? image_index : 0;
+                    vulkan_image* image = &texture->images[texture_image_index];
 
-                        update_count++;
+                    binding_image_infos[i][d].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                    binding_image_infos[i][d].imageView = image->view;
+                    // NOTE: Not using sampler in this descriptor.
+                    binding_image_infos[i][d].sampler = 0;
 
-                        // Sync the generation.
-                        (*desc_gen) = renderer_frame_number == INVALID_ID_U16 ? 0 : renderer_frame_number;
+                    if (descriptor_state_sync(descriptor_state, image_index, (u64)image->view, texture->uniqueid, texture->generation)) {
+                        binding_changed = true;
                     }
-
                 } else {
 
                     resource_handle = binding_sampler_state->sampler_handles[d];
@@ -4795,19 +5264,14 @@ static b8 vulkan_descriptorset_update_and_bind(
 
                     vulkan_sampler_handle_data* sampler = &context->samplers[resource_handle.handle_index];
 
-                    // Only update if the descriptor has not been updated this frame.
-                    u16* desc_gen = &descriptor_state->renderer_frame_number[image_index];
-                    if ((*desc_gen) == INVALID_ID_U16 || (*desc_gen) != renderer_frame_number) {
-                        // Not using image for sampler updates.
-                        binding_image_infos[i][update_count].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-                        binding_image_infos[i][update_count].imageView = 0;
-                        // NOTE: Only the sampler is set here.
-                        binding_image_infos[i][update_count].sampler = sampler->sampler;
-
-                        update_count++;
+                    // Not using image for sampler updates.
+                    binding_image_infos[i][d].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    binding_image_infos[i][d].imageView = 0;
+                    // NOTE: Only the sampler is set here.
+                    binding_image_infos[i][d].sampler = sampler->sampler;
 
-                        // Sync the generation.
-                        (*desc_gen) = renderer_frame_number == INVALID_ID_U16 ? 0 : renderer_frame_number;
+                    if (descriptor_state_sync(descriptor_state, image_index, (u64)sampler->sampler, sampler->handle_uniqueid, sampler->generation)) {
+                        binding_changed = true;
                     }
                 }
             }
@@ -4819,13 +5283,13 @@ static b8 vulkan_descriptorset_update_and_bind(
                 sampler_binding_index++;
             }
 
-            // Only include if there is actually an update.
-            if (update_count > 0) {
+            // Only include if there is actually an update. The whole binding is written if any of its descriptors changed.
+            if (binding_changed) {
                 VkWriteDescriptorSet desc_set_write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
                 desc_set_write.dstSet = frequency_state->descriptor_sets[image_index];
                 desc_set_write.dstBinding = binding_index;
                 desc_set_write.descriptorType = type;
-                desc_set_write.descriptorCount = update_count;
+                desc_set_write.descriptorCount = binding_descriptor_count;
                 desc_set_write.pImageInfo = binding_image_infos[i];
 
                 descriptor_writes[descriptor_write_count] = desc_set_write;
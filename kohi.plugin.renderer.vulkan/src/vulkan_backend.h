@@ -36,6 +36,9 @@ b8 vulkan_renderer_frame_prepare(renderer_backend_interface* backend, struct fra
 b8 vulkan_renderer_frame_prepare_window_surface(renderer_backend_interface* backend, struct kwindow* window, struct frame_data* p_frame_data);
 b8 vulkan_renderer_frame_command_list_begin(renderer_backend_interface* backend, struct frame_data* p_frame_data);
 b8 vulkan_renderer_frame_command_list_end(renderer_backend_interface* backend, struct frame_data* p_frame_data);
+b8 vulkan_renderer_node_command_list_begin(renderer_backend_interface* backend, u32 slot, struct frame_data* p_frame_data);
+b8 vulkan_renderer_node_command_list_end(renderer_backend_interface* backend, u32 slot, struct frame_data* p_frame_data);
+b8 vulkan_renderer_node_command_lists_execute(renderer_backend_interface* backend, u32 slot_count, const u32* slots, struct frame_data* p_frame_data);
 b8 vulkan_renderer_frame_submit(struct renderer_backend_interface* backend, struct frame_data* p_frame_data);
 b8 vulkan_renderer_frame_present(renderer_backend_interface* backend, struct kwindow* window, struct frame_data* p_frame_data);
 
@@ -61,12 +64,11 @@ void vulkan_renderer_set_stencil_compare_mask(struct renderer_backend_interface*
 void vulkan_renderer_set_stencil_write_mask(struct renderer_backend_interface* backend, u32 write_mask);
 
 void vulkan_renderer_clear_colour_set(renderer_backend_interface* backend, vec4 clear_colour);
-void vulkan_renderer_clear_depth_set(renderer_backend_interface* backend, f32 depth);
-void vulkan_renderer_clear_stencil_set(renderer_backend_interface* backend, u32 stencil);
 void vulkan_renderer_clear_colour_texture(renderer_backend_interface* backend, khandle texture_handle);
-void vulkan_renderer_clear_depth_stencil(renderer_backend_interface* backend, khandle texture_handle);
+void vulkan_renderer_clear_depth_stencil(renderer_backend_interface* backend, khandle texture_handle, f32 depth, u32 stencil);
 void vulkan_renderer_colour_texture_prepare_for_present(renderer_backend_interface* backend, khandle texture_handle);
 void vulkan_renderer_texture_prepare_for_sampling(renderer_backend_interface* backend, khandle texture_handle, texture_flag_bits flags);
+void vulkan_renderer_texture_layer_copy(renderer_backend_interface* backend, khandle source_handle, u32 source_layer, khandle dest_handle, u32 dest_layer);
 
 b8 vulkan_renderer_texture_resources_acquire(renderer_backend_interface* backend, const char* name, texture_type type, u32 width, u32 height, u8 channel_count, u8 mip_levels, u16 array_size, texture_flag_bits flags, khandle* out_texture_handle);
 void vulkan_renderer_texture_resources_release(renderer_backend_interface* backend, khandle* texture_handle);
@@ -106,6 +108,7 @@ b8 vulkan_renderer_is_multithreaded(renderer_backend_interface* backend);
 b8 vulkan_renderer_flag_enabled_get(renderer_backend_interface* backend, renderer_config_flags flag);
 void vulkan_renderer_flag_enabled_set(renderer_backend_interface* backend, renderer_config_flags flag, b8 enabled);
 
+b8 vulkan_renderer_indirect_draw_supported(renderer_backend_interface* backend);
 f32 vulkan_renderer_max_anisotropy_get(renderer_backend_interface* backend);
 
 b8 vulkan_buffer_create_internal(renderer_backend_interface* backend, renderbuffer* buffer);
@@ -120,5 +123,7 @@ b8 vulkan_buffer_read(renderer_backend_interface* backend, renderbuffer* buffer,
 b8 vulkan_buffer_load_range(renderer_backend_interface* backend, renderbuffer* buffer, u64 offset, u64 size, const void* data, b8 include_in_frame_workload);
 b8 vulkan_buffer_copy_range(renderer_backend_interface* backend, renderbuffer* source, u64 source_offset, renderbuffer* dest, u64 dest_offset, u64 size, b8 include_in_frame_workload);
 b8 vulkan_buffer_draw(renderer_backend_interface* backend, renderbuffer* buffer, u64 offset, u32 element_count, b8 bind_only);
+b8 vulkan_buffer_draw_instanced(renderer_backend_interface* backend, renderbuffer* buffer, u64 offset, u32 element_count, renderbuffer* instance_buffer, u64 instance_offset, u32 instance_count);
+b8 vulkan_buffer_draw_indexed_indirect(renderer_backend_interface* backend, renderbuffer* indirect_buffer, u64 indirect_offset, u32 draw_count, renderbuffer* vertex_buffer, renderbuffer* index_buffer, renderbuffer* instance_buffer, u64 instance_offset);
 
 void vulkan_renderer_wait_for_idle(renderer_backend_interface* backend);
@@ -130,8 +130,11 @@ b8 vulkan_command_buffer_submit(
     VkQueue queue,
     u32 signal_semaphore_count,
     VkSemaphore* signal_semaphores,
+    const u64* signal_values,
     u32 wait_semaphore_count,
     VkSemaphore* wait_semaphores,
+    const VkPipelineStageFlags* wait_stages,
+    const u64* wait_values,
     VkFence fence) {
     krhi_vulkan* rhi = &context->rhi;
     if (command_buffer->state != COMMAND_BUFFER_STATE_RECORDING_ENDED) {
@@ -162,12 +165,18 @@ b8 vulkan_command_buffer_submit(
     submit_info.waitSemaphoreCount = wait_semaphore_count;
     submit_info.pWaitSemaphores = wait_semaphores;
 
-    // Each semaphore waits on the corresponding pipeline stage to complete. 1:1
-    // ratio. VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT prevents subsequent
-    // colour attachment writes from executing until the semaphore signals (i.e.
-    // one frame is presented at a time)
-    VkPipelineStageFlags flags[1] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submit_info.pWaitDstStageMask = flags;
+    // Each semaphore waits on the corresponding pipeline stage to complete. 1:1 ratio.
+    submit_info.pWaitDstStageMask = wait_stages;
+
+    // Values are only needed when timeline semaphores are involved.
+    VkTimelineSemaphoreSubmitInfo timeline_info = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    if (signal_values || wait_values) {
+        timeline_info.signalSemaphoreValueCount = signal_values ? signal_semaphore_count : 0;
+        timeline_info.pSignalSemaphoreValues = signal_values;
+        timeline_info.waitSemaphoreValueCount = wait_values ? wait_semaphore_count : 0;
+        timeline_info.pWaitSemaphoreValues = wait_values;
+        submit_info.pNext = &timeline_info;
+    }
 
     VkResult result = rhi->kvkQueueSubmit(queue, 1, &submit_info, fence);
     if (result != VK_SUCCESS) {
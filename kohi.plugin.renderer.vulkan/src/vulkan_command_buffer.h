@@ -81,8 +81,11 @@ void vulkan_command_buffer_end(vulkan_context* context, vulkan_command_buffer* c
  * @param queue The queue to submit to.
  * @param signal_semaphore_count The number of semaphore(s) to be signaled when the queue is complete.
  * @param signal_semaphores The semaphore(s) to be signaled when the queue is complete.
+ * @param signal_values Optional. The values to signal, one per semaphore. Required if any signal semaphore is a timeline semaphore (ignored for binary ones).
  * @param wait_semaphore_count The number of semaphore(s) to wait on before the command buffer is executed.
  * @param wait_semaphores The semaphore(s) to be waited on before the command buffer is executed.
+ * @param wait_stages The pipeline stage(s) at which each wait occurs, one per semaphore. Required if wait_semaphore_count is nonzero.
+ * @param wait_values Optional. The values to wait for, one per semaphore. Required if any wait semaphore is a timeline semaphore (ignored for binary ones).
  * @param fence An optional handle to a fence to be signaled once all submitted command buffers have completed execution.
  * @return b8 True on success; otherwise false.
  */
@@ -92,8 +95,11 @@ b8 vulkan_command_buffer_submit(
     VkQueue queue,
     u32 signal_semaphore_count,
     VkSemaphore* signal_semaphores,
+    const u64* signal_values,
     u32 wait_semaphore_count,
     VkSemaphore* wait_semaphores,
+    const VkPipelineStageFlags* wait_stages,
+    const u64* wait_values,
     VkFence fence);
 
 /**
@@ -0,0 +1,137 @@
+#include "vulkan_deletion_queue.h"
+
+#include <containers/darray.h>
+#include <debug/kassert.h>
+#include <logger.h>
+#include <memory/kmemory.h>
+
+#include "platform/vulkan_platform.h"
+#include "vulkan/vulkan_core.h"
+#include "vulkan_types.h"
+#include "vulkan_upload.h"
+
+static void entry_destroy(vulkan_context* context, vulkan_deferred_deletion* entry) {
+    krhi_vulkan* rhi = &context->rhi;
+    VkDevice device = context->device.logical_device;
+    switch (entry->type) {
+    case VULKAN_DEFERRED_DELETION_TYPE_BUFFER:
+        if (entry->buffer.memory) {
+            rhi->kvkFreeMemory(device, entry->buffer.memory, context->allocator);
+        }
+        if (entry->buffer.handle) {
+            rhi->kvkDestroyBuffer(device, entry->buffer.handle, context->allocator);
+        }
+        kfree_report(entry->buffer.reported_size, entry->buffer.is_device_memory ? MEMORY_TAG_GPU_LOCAL : MEMORY_TAG_VULKAN);
+        break;
+    case VULKAN_DEFERRED_DELETION_TYPE_SAMPLER:
+        rhi->kvkDestroySampler(device, entry->sampler, context->allocator);
+        break;
+    case VULKAN_DEFERRED_DELETION_TYPE_PIPELINE:
+        if (entry->pipeline.handle) {
+            rhi->kvkDestroyPipeline(device, entry->pipeline.handle, context->allocator);
+        }
+        if (entry->pipeline.layout) {
+            rhi->kvkDestroyPipelineLayout(device, entry->pipeline.layout, context->allocator);
+        }
+        break;
+    case VULKAN_DEFERRED_DELETION_TYPE_DESCRIPTOR_SETS: {
+        VkResult result = rhi->kvkFreeDescriptorSets(device, entry->descriptor_sets.pool, entry->descriptor_sets.count, entry->descriptor_sets.sets);
+        if (result != VK_SUCCESS) {
+            KERROR("Error freeing deferred descriptor sets!");
+        }
+    } break;
+    case VULKAN_DEFERRED_DELETION_TYPE_DESCRIPTOR_POOL:
+        rhi->kvkDestroyDescriptorPool(device, entry->descriptor_pool, context->allocator);
+        break;
+    }
+}
+
+static void push(vulkan_context* context, vulkan_deferred_deletion* entry) {
+    // The frame currently being recorded (if any) is the latest one which may use the object.
+    entry->frame_number = context->submitted_frame_number + 1;
+    darray_push(context->deletion_queue, *entry);
+}
+
+void vulkan_deletion_queue_create(vulkan_context* context) {
+    context->deletion_queue = darray_create(vulkan_deferred_deletion);
+    context->submitted_frame_number = 0;
+    context->completed_frame_number = 0;
+}
+
+void vulkan_deletion_queue_destroy(vulkan_context* context) {
+    if (!context->deletion_queue) {
+        return;
+    }
+    u32 count = darray_length(context->deletion_queue);
+    for (u32 i = 0; i < count; ++i) {
+        entry_destroy(context, &context->deletion_queue[i]);
+    }
+    darray_destroy(context->deletion_queue);
+    context->deletion_queue = 0;
+}
+
+void vulkan_deletion_queue_update(vulkan_context* context) {
+    u32 count = darray_length(context->deletion_queue);
+    // Entries are pushed with nondecreasing frame numbers, so only a prefix can be ready.
+    u32 ready_count = 0;
+    while (ready_count < count && context->deletion_queue[ready_count].frame_number <= context->completed_frame_number) {
+        entry_destroy(context, &context->deletion_queue[ready_count]);
+        ready_count++;
+    }
+    if (!ready_count) {
+        return;
+    }
+
+    // Move the remainder to the front.
+    for (u32 i = ready_count; i < count; ++i) {
+        context->deletion_queue[i - ready_count] = context->deletion_queue[i];
+    }
+    darray_length_set(context->deletion_queue, count - ready_count);
+}
+
+void vulkan_deletion_queue_push_buffer(vulkan_context* context, VkBuffer handle, VkDeviceMemory memory, u64 reported_size, b8 is_device_memory) {
+    // Submit anything referencing the buffer, so it's ordered before the frame the buffer is tagged with.
+    vulkan_upload_flush(context, false);
+
+    vulkan_deferred_deletion entry = {0};
+    entry.type = VULKAN_DEFERRED_DELETION_TYPE_BUFFER;
+    entry.buffer.handle = handle;
+    entry.buffer.memory = memory;
+    entry.buffer.reported_size = reported_size;
+    entry.buffer.is_device_memory = is_device_memory;
+    push(context, &entry);
+}
+
+void vulkan_deletion_queue_push_sampler(vulkan_context* context, VkSampler sampler) {
+    vulkan_deferred_deletion entry = {0};
+    entry.type = VULKAN_DEFERRED_DELETION_TYPE_SAMPLER;
+    entry.sampler = sampler;
+    push(context, &entry);
+}
+
+void vulkan_deletion_queue_push_pipeline(vulkan_context* context, VkPipeline handle, VkPipelineLayout layout) {
+    vulkan_deferred_deletion entry = {0};
+    entry.type = VULKAN_DEFERRED_DELETION_TYPE_PIPELINE;
+    entry.pipeline.handle = handle;
+    entry.pipeline.layout = layout;
+    push(context, &entry);
+}
+
+void vulkan_deletion_queue_push_descriptor_sets(vulkan_context* context, VkDescriptorPool pool, u32 count, const VkDescriptorSet* sets) {
+    KASSERT_MSG(count <= VULKAN_RESOURCE_IMAGE_COUNT, "Too many descriptor sets queued for deletion at once.");
+    vulkan_deferred_deletion entry = {0};
+    entry.type = VULKAN_DEFERRED_DELETION_TYPE_DESCRIPTOR_SETS;
+    entry.descriptor_sets.pool = pool;
+    entry.descriptor_sets.count = count;
+    for (u32 i = 0; i < count; ++i) {
+        entry.descriptor_sets.sets[i] = sets[i];
+    }
+    push(context, &entry);
+}
+
+void vulkan_deletion_queue_push_descriptor_pool(vulkan_context* context, VkDescriptorPool pool) {
+    vulkan_deferred_deletion entry = {0};
+    entry.type = VULKAN_DEFERRED_DELETION_TYPE_DESCRIPTOR_POOL;
+    entry.descriptor_pool = pool;
+    push(context, &entry);
+}
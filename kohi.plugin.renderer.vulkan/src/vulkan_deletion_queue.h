@@ -0,0 +1,90 @@
+/**
+ * @file vulkan_deletion_queue.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief Contains a queue of Vulkan objects whose destruction is deferred until every frame
+ * which may have used them has completed, so that releasing them never requires waiting
+ * for the device to go idle.
+ * @details Objects pushed to the queue are tagged with the number of the frame currently being
+ * recorded. Once that frame's fence has been waited on (see vulkan_context.completed_frame_number),
+ * the object is destroyed.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "vulkan_types.h"
+
+/**
+ * @brief Creates the deletion queue for the given context.
+ *
+ * @param context A pointer to the Vulkan context.
+ */
+void vulkan_deletion_queue_create(vulkan_context* context);
+
+/**
+ * @brief Destroys everything left in the deletion queue, then the queue itself.
+ * The device must be idle when this is called.
+ *
+ * @param context A pointer to the Vulkan context.
+ */
+void vulkan_deletion_queue_destroy(vulkan_context* context);
+
+/**
+ * @brief Destroys everything in the queue which is no longer in use by any frame. Should be
+ * called whenever context->completed_frame_number changes.
+ *
+ * @param context A pointer to the Vulkan context.
+ */
+void vulkan_deletion_queue_update(vulkan_context* context);
+
+/**
+ * @brief Queues a buffer and its memory for destruction. Any pending uploads are submitted
+ * first, so that they are complete by the time the buffer is destroyed.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param handle The buffer handle.
+ * @param memory The memory bound to the buffer.
+ * @param reported_size The size reported when the memory was allocated.
+ * @param is_device_memory Indicates if the memory was reported as device-local.
+ */
+void vulkan_deletion_queue_push_buffer(vulkan_context* context, VkBuffer handle, VkDeviceMemory memory, u64 reported_size, b8 is_device_memory);
+
+/**
+ * @brief Queues a sampler for destruction.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param sampler The sampler handle.
+ */
+void vulkan_deletion_queue_push_sampler(vulkan_context* context, VkSampler sampler);
+
+/**
+ * @brief Queues a pipeline and its layout for destruction.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param handle The pipeline handle.
+ * @param layout The pipeline layout handle.
+ */
+void vulkan_deletion_queue_push_pipeline(vulkan_context* context, VkPipeline handle, VkPipelineLayout layout);
+
+/**
+ * @brief Queues descriptor sets to be freed back to the pool they were allocated from.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param pool The pool the sets were allocated from.
+ * @param count The number of sets. Must not exceed VULKAN_RESOURCE_IMAGE_COUNT.
+ * @param sets An array of the sets to be freed.
+ */
+void vulkan_deletion_queue_push_descriptor_sets(vulkan_context* context, VkDescriptorPool pool, u32 count, const VkDescriptorSet* sets);
+
+/**
+ * @brief Queues a descriptor pool for destruction. Any sets queued to be freed from this
+ * pool beforehand are freed first.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param pool The descriptor pool handle.
+ */
+void vulkan_deletion_queue_push_descriptor_pool(vulkan_context* context, VkDescriptorPool pool);
@@ -165,6 +165,10 @@ b8 vulkan_device_create(vulkan_context* context) {
     if (!device_features.features.shaderClipDistance) {
         KERROR("shaderClipDistance not supported by Vulkan device '%s'!", context->device.properties.deviceName);
     }
+    // Indirect drawing, if supported. Without these, indirect draws are recorded one command at a time,
+    // or not used at all.
+    device_features.features.multiDrawIndirect = context->device.features.multiDrawIndirect;
+    device_features.features.drawIndirectFirstInstance = context->device.features.drawIndirectFirstInstance;
 
     // Dynamic rendering.
     VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering_ext = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES};
@@ -196,6 +200,14 @@ b8 vulkan_device_create(vulkan_context* context) {
         descriptor_indexing_features.pNext = &line_rasterization_ext;
     }
 
+    // Timeline semaphores, if supported. Inserted at the front of the chain, since the tail is optional.
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES};
+    if (context->device.support_flags & VULKAN_DEVICE_SUPPORT_FLAG_TIMELINE_SEMAPHORE_BIT) {
+        timeline_semaphore_features.timelineSemaphore = VK_TRUE;
+        timeline_semaphore_features.pNext = device_features.pNext;
+        device_features.pNext = &timeline_semaphore_features;
+    }
+
     VkDeviceCreateInfo device_create_info = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
     device_create_info.queueCreateInfoCount = index_count;
     device_create_info.pQueueCreateInfos = queue_create_infos;
@@ -468,6 +480,9 @@ static b8 select_physical_device(vulkan_context* context) {
         // Check for smooth line rasterisation support via extension.
         VkPhysicalDeviceLineRasterizationFeaturesEXT smooth_line_next = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_LINE_RASTERIZATION_FEATURES_EXT};
         dynamic_state_next.pNext = &smooth_line_next;
+        // Check for timeline semaphore support (core in 1.2), used by the upload manager.
+        VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_next = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES};
+        smooth_line_next.pNext = &timeline_semaphore_next;
         // Perform the query.
         rhi->kvkGetPhysicalDeviceFeatures2(physical_devices[i], &features2);
 
@@ -568,6 +583,10 @@ static b8 select_physical_device(vulkan_context* context) {
             if (smooth_line_next.smoothLines) {
                 context->device.support_flags |= VULKAN_DEVICE_SUPPORT_FLAG_LINE_SMOOTH_RASTERISATION_BIT;
             }
+            // Check for timeline semaphore support. Only used when core, so the extension doesn't need to be enabled.
+            if (timeline_semaphore_next.timelineSemaphore && context->device.api_major >= 1 && context->device.api_minor >= 2) {
+                context->device.support_flags |= VULKAN_DEVICE_SUPPORT_FLAG_TIMELINE_SEMAPHORE_BIT;
+            }
             break;
         }
     }
@@ -80,6 +80,7 @@ b8 vulkan_loader_load_device(krhi_vulkan* rhi, VkDevice device) {
     RHI_DEVICE_FUNCTION(vkCreateFence);
     RHI_DEVICE_FUNCTION(vkDestroyFence);
     RHI_DEVICE_FUNCTION(vkWaitForFences);
+    RHI_DEVICE_FUNCTION(vkGetFenceStatus);
     RHI_DEVICE_FUNCTION(vkAcquireNextImageKHR);
     RHI_DEVICE_FUNCTION(vkResetFences);
     RHI_DEVICE_FUNCTION(vkCreateDescriptorSetLayout);
@@ -101,6 +102,9 @@ b8 vulkan_loader_load_device(krhi_vulkan* rhi, VkDevice device) {
     RHI_DEVICE_FUNCTION(vkDestroyPipelineLayout);
     RHI_DEVICE_FUNCTION(vkCreateGraphicsPipelines);
     RHI_DEVICE_FUNCTION(vkDestroyPipeline);
+    RHI_DEVICE_FUNCTION(vkCreatePipelineCache);
+    RHI_DEVICE_FUNCTION(vkDestroyPipelineCache);
+    RHI_DEVICE_FUNCTION(vkGetPipelineCacheData);
     RHI_DEVICE_FUNCTION(vkCmdBindPipeline);
     RHI_DEVICE_FUNCTION(vkAllocateDescriptorSets);
     RHI_DEVICE_FUNCTION(vkFreeDescriptorSets);
@@ -111,6 +115,7 @@ b8 vulkan_loader_load_device(krhi_vulkan* rhi, VkDevice device) {
     RHI_DEVICE_FUNCTION(vkCmdCopyBuffer);
     RHI_DEVICE_FUNCTION(vkCmdCopyBufferToImage);
     RHI_DEVICE_FUNCTION(vkCmdCopyImageToBuffer);
+    RHI_DEVICE_FUNCTION(vkCmdCopyImage);
     RHI_DEVICE_FUNCTION(vkCmdExecuteCommands);
     RHI_DEVICE_FUNCTION(vkCmdSetViewport);
     RHI_DEVICE_FUNCTION(vkCmdSetScissor);
@@ -133,6 +138,7 @@ b8 vulkan_loader_load_device(krhi_vulkan* rhi, VkDevice device) {
     RHI_DEVICE_FUNCTION(vkCmdBindIndexBuffer);
     RHI_DEVICE_FUNCTION(vkCmdDraw);
     RHI_DEVICE_FUNCTION(vkCmdDrawIndexed);
+    RHI_DEVICE_FUNCTION(vkCmdDrawIndexedIndirect);
     RHI_DEVICE_FUNCTION(vkCmdBindDescriptorSets);
 
     RHI_DEVICE_FUNCTION(vkQueueSubmit);
@@ -0,0 +1,172 @@
+#include "vulkan_pipeline_cache.h"
+
+#include <logger.h>
+#include <memory/kmemory.h>
+#include <platform/filesystem.h>
+
+#include "platform/vulkan_platform.h"
+#include "vulkan/vulkan_core.h"
+#include "vulkan_types.h"
+#include "vulkan_utils.h"
+
+#define PIPELINE_CACHE_MAGIC 0x4B504C43 // KPLC
+#define PIPELINE_CACHE_VERSION 1
+
+// Written ahead of the driver's cache data. The driver's own header has the vendor, device
+// and cache UUID, but not the driver version, so all of these are kept here instead.
+typedef struct pipeline_cache_file_header {
+    u32 magic;
+    u32 version;
+    u32 vendor_id;
+    u32 device_id;
+    u32 driver_version;
+    u8 pipeline_cache_uuid[VK_UUID_SIZE];
+    u64 data_size;
+} pipeline_cache_file_header;
+
+static void header_fill(const vulkan_context* context, u64 data_size, pipeline_cache_file_header* out_header) {
+    const VkPhysicalDeviceProperties* properties = &context->device.properties;
+    kzero_memory(out_header, sizeof(pipeline_cache_file_header));
+    out_header->magic = PIPELINE_CACHE_MAGIC;
+    out_header->version = PIPELINE_CACHE_VERSION;
+    out_header->vendor_id = properties->vendorID;
+    out_header->device_id = properties->deviceID;
+    out_header->driver_version = properties->driverVersion;
+    kcopy_memory(out_header->pipeline_cache_uuid, properties->pipelineCacheUUID, VK_UUID_SIZE);
+    out_header->data_size = data_size;
+}
+
+static b8 header_matches(const pipeline_cache_file_header* a, const pipeline_cache_file_header* b) {
+    if (a->magic != b->magic || a->version != b->version || a->vendor_id != b->vendor_id ||
+        a->device_id != b->device_id || a->driver_version != b->driver_version || a->data_size != b->data_size) {
+        return false;
+    }
+    for (u32 i = 0; i < VK_UUID_SIZE; ++i) {
+        if (a->pipeline_cache_uuid[i] != b->pipeline_cache_uuid[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads the cache file at the given path. Returns the driver data only if the file was
+// written by the same device and driver; otherwise returns 0. The block returned is
+// the whole file, and must be freed by the caller using out_file_size.
+static u8* read_cache_file(const vulkan_context* context, const char* path, u64* out_file_size, u64* out_data_offset) {
+    *out_file_size = 0;
+    *out_data_offset = 0;
+    if (!filesystem_exists(path)) {
+        return 0;
+    }
+
+    file_handle f;
+    if (!filesystem_open(path, FILE_MODE_READ, true, &f)) {
+        KWARN("Unable to open pipeline cache file '%s' for reading.", path);
+        return 0;
+    }
+
+    u64 size = 0;
+    if (!filesystem_size(&f, &size) || size < sizeof(pipeline_cache_file_header)) {
+        filesystem_close(&f);
+        KWARN("Pipeline cache file '%s' is too small to be valid. It will be rebuilt.", path);
+        return 0;
+    }
+
+    u8* bytes = kallocate(size, MEMORY_TAG_RENDERER);
+    u64 read = 0;
+    b8 success = filesystem_read_all_bytes(&f, bytes, &read) && read == size;
+    filesystem_close(&f);
+    if (!success) {
+        KWARN("Failed to read pipeline cache file '%s'. It will be rebuilt.", path);
+        kfree(bytes, size, MEMORY_TAG_RENDERER);
+        return 0;
+    }
+
+    pipeline_cache_file_header expected;
+    header_fill(context, size - sizeof(pipeline_cache_file_header), &expected);
+    if (!header_matches((const pipeline_cache_file_header*)bytes, &expected)) {
+        KINFO("Pipeline cache file '%s' was created by a different device, driver or engine version. It will be rebuilt.", path);
+        kfree(bytes, size, MEMORY_TAG_RENDERER);
+        return 0;
+    }
+
+    *out_file_size = size;
+    *out_data_offset = sizeof(pipeline_cache_file_header);
+    return bytes;
+}
+
+b8 vulkan_pipeline_cache_create(vulkan_context* context, const char* path) {
+    krhi_vulkan* rhi = &context->rhi;
+
+    u64 file_size = 0;
+    u64 data_offset = 0;
+    u8* file_bytes = read_cache_file(context, path, &file_size, &data_offset);
+
+    VkPipelineCacheCreateInfo create_info = {VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    if (file_bytes) {
+        create_info.initialDataSize = file_size - data_offset;
+        create_info.pInitialData = file_bytes + data_offset;
+    }
+
+    VkResult result = rhi->kvkCreatePipelineCache(context->device.logical_device, &create_info, context->allocator, &context->pipeline_cache);
+    if (!vulkan_result_is_success(result) && file_bytes) {
+        // The driver is free to reject the data. Try again with an empty cache.
+        KWARN("Driver rejected pipeline cache data from '%s' with %s. Starting with an empty cache.", path, vulkan_result_string(result, true));
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = 0;
+        kfree(file_bytes, file_size, MEMORY_TAG_RENDERER);
+        file_bytes = 0;
+        result = rhi->kvkCreatePipelineCache(context->device.logical_device, &create_info, context->allocator, &context->pipeline_cache);
+    }
+
+    context->pipeline_cache_loaded = file_bytes != 0;
+    if (file_bytes) {
+        kfree(file_bytes, file_size, MEMORY_TAG_RENDERER);
+    }
+
+    if (!vulkan_result_is_success(result)) {
+        KERROR("vkCreatePipelineCache failed with %s.", vulkan_result_string(result, true));
+        context->pipeline_cache = VK_NULL_HANDLE;
+        return false;
+    }
+
+    KINFO("Vulkan pipeline cache created (%s).", context->pipeline_cache_loaded ? "loaded from disk" : "empty");
+    return true;
+}
+
+void vulkan_pipeline_cache_destroy(vulkan_context* context, const char* path) {
+    if (!context->pipeline_cache) {
+        return;
+    }
+    krhi_vulkan* rhi = &context->rhi;
+
+    size_t data_size = 0;
+    VkResult result = rhi->kvkGetPipelineCacheData(context->device.logical_device, context->pipeline_cache, &data_size, 0);
+    if (vulkan_result_is_success(result) && data_size) {
+        u64 allocated_size = sizeof(pipeline_cache_file_header) + data_size;
+        u8* file_bytes = kallocate(allocated_size, MEMORY_TAG_RENDERER);
+        result = rhi->kvkGetPipelineCacheData(context->device.logical_device, context->pipeline_cache, &data_size, file_bytes + sizeof(pipeline_cache_file_header));
+        if (result == VK_SUCCESS) {
+            // NOTE: The size can shrink between the two calls, so the header is filled afterward.
+            header_fill(context, data_size, (pipeline_cache_file_header*)file_bytes);
+            u64 file_size = sizeof(pipeline_cache_file_header) + data_size;
+
+            file_handle f;
+            if (filesystem_open(path, FILE_MODE_WRITE, true, &f)) {
+                u64 written = 0;
+                if (!filesystem_write(&f, file_size, file_bytes, &written) || written != file_size) {
+                    KWARN("Failed to write pipeline cache file '%s'.", path);
+                }
+                filesystem_close(&f);
+            } else {
+                KWARN("Unable to open pipeline cache file '%s' for writing.", path);
+            }
+        } else {
+            KWARN("vkGetPipelineCacheData failed with %s. The pipeline cache will not be saved.", vulkan_result_string(result, true));
+        }
+        kfree(file_bytes, allocated_size, MEMORY_TAG_RENDERER);
+    }
+
+    rhi->kvkDestroyPipelineCache(context->device.logical_device, context->pipeline_cache, context->allocator);
+    context->pipeline_cache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file vulkan_pipeline_cache.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief Contains a Vulkan pipeline cache which is persisted to disk between runs,
+ * so that pipelines compiled by the driver on a previous run can be reused.
+ * @details The cache file is prefixed with a small header identifying the device and
+ * driver it was created with. If any of these differ on load (i.e. a driver update or
+ * a different GPU), the file is ignored and an empty cache is created instead.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "vulkan_types.h"
+
+/** @brief The path the pipeline cache is loaded from and saved to, relative to the working directory. */
+#define VULKAN_PIPELINE_CACHE_PATH "vulkan_pipeline_cache.bin"
+
+/**
+ * @brief Creates the pipeline cache for the given context, seeding it with the contents
+ * of the file at the given path if it exists and was created by the same device and driver.
+ * Must be called after the device is created.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param path The path to the cache file.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_pipeline_cache_create(vulkan_context* context, const char* path);
+
+/**
+ * @brief Writes the contents of the context's pipeline cache to the file at the given
+ * path, then destroys the cache. Must be called before the device is destroyed.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param path The path to the cache file.
+ */
+void vulkan_pipeline_cache_destroy(vulkan_context* context, const char* path);
@@ -25,6 +25,9 @@ b8 kplugin_create(kruntime_plugin* out_plugin) {
     backend->frame_prepare_window_surface = vulkan_renderer_frame_prepare_window_surface;
     backend->frame_commands_begin = vulkan_renderer_frame_command_list_begin;
     backend->frame_commands_end = vulkan_renderer_frame_command_list_end;
+    backend->node_commands_begin = vulkan_renderer_node_command_list_begin;
+    backend->node_commands_end = vulkan_renderer_node_command_list_end;
+    backend->node_commands_execute = vulkan_renderer_node_command_lists_execute;
     backend->frame_submit = vulkan_renderer_frame_submit;
     backend->frame_present = vulkan_renderer_frame_present;
 
@@ -33,13 +36,12 @@ b8 kplugin_create(kruntime_plugin* out_plugin) {
     backend->scissor_set = vulkan_renderer_scissor_set;
     backend->scissor_reset = vulkan_renderer_scissor_reset;
 
-    backend->clear_depth_set = vulkan_renderer_clear_depth_set;
     backend->clear_colour_set = vulkan_renderer_clear_colour_set;
-    backend->clear_stencil_set = vulkan_renderer_clear_stencil_set;
     backend->clear_colour = vulkan_renderer_clear_colour_texture;
     backend->clear_depth_stencil = vulkan_renderer_clear_depth_stencil;
     backend->colour_texture_prepare_for_present = vulkan_renderer_colour_texture_prepare_for_present;
     backend->texture_prepare_for_sampling = vulkan_renderer_texture_prepare_for_sampling;
+    backend->texture_layer_copy = vulkan_renderer_texture_layer_copy;
 
     backend->winding_set = vulkan_renderer_winding_set;
     backend->cull_mode_set = vulkan_renderer_cull_mode_set;
@@ -93,6 +95,7 @@ b8 kplugin_create(kruntime_plugin* out_plugin) {
     backend->flag_enabled_get = vulkan_renderer_flag_enabled_get;
     backend->flag_enabled_set = vulkan_renderer_flag_enabled_set;
 
+    backend->indirect_draw_supported = vulkan_renderer_indirect_draw_supported;
     backend->max_anisotropy_get = vulkan_renderer_max_anisotropy_get;
 
     backend->renderbuffer_internal_create = vulkan_buffer_create_internal;
@@ -107,6 +110,8 @@ b8 kplugin_create(kruntime_plugin* out_plugin) {
     backend->renderbuffer_load_range = vulkan_buffer_load_range;
     backend->renderbuffer_copy_range = vulkan_buffer_copy_range;
     backend->renderbuffer_draw = vulkan_buffer_draw;
+    backend->renderbuffer_draw_instanced = vulkan_buffer_draw_instanced;
+    backend->renderbuffer_draw_indexed_indirect = vulkan_buffer_draw_indexed_indirect;
     backend->wait_for_idle = vulkan_renderer_wait_for_idle;
 
     KINFO("Vulkan Renderer Plugin Creation successful (%s).", KVERSION);
@@ -33,6 +33,17 @@
 // triple buffering can be toggled in settings.
 #define VULKAN_RESOURCE_IMAGE_COUNT 3
 
+// Shader stages are loaded from precompiled SPIR-V in this directory (see kohi.tools buildshaders),
+// keyed by a hash of their source. Relative to the working directory.
+#define VULKAN_SPIRV_CACHE_DIRECTORY "spirv_cache"
+
+// When enabled, shader stages missing from the SPIR-V cache (i.e. hot-reloaded or edited sources)
+// are compiled at runtime with shaderc and added to the cache. Shipping builds can define this
+// as 0 and drop the shaderc link dependency, as long as all shaders were built offline.
+#ifndef KVULKAN_RUNTIME_SHADER_COMPILATION
+#    define KVULKAN_RUNTIME_SHADER_COMPILATION 1
+#endif
+
 /**
  * @brief Checks the given expression's return value against VK_SUCCESS.
  * @param expr The expression whose result should be checked.
@@ -87,7 +98,10 @@ typedef enum vulkan_device_support_flag_bits {
 
     /** @brief Indicates if this device supports dynamic state. If not, the renderer will need to generate a separate pipeline per topology type. */
     VULKAN_DEVICE_SUPPORT_FLAG_DYNAMIC_STATE_BIT = 0x02,
-    VULKAN_DEVICE_SUPPORT_FLAG_LINE_SMOOTH_RASTERISATION_BIT = 0x04
+    VULKAN_DEVICE_SUPPORT_FLAG_LINE_SMOOTH_RASTERISATION_BIT = 0x04,
+
+    /** @brief Indicates if the device supports timeline semaphores (i.e. using Vulkan API >= 1.2). */
+    VULKAN_DEVICE_SUPPORT_FLAG_TIMELINE_SEMAPHORE_BIT = 0x08
 } vulkan_device_support_flag_bits;
 
 /** @brief Bitwise flags for device support. @see vulkan_device_support_flag_bits. */
@@ -299,6 +313,8 @@ typedef struct vulkan_pipeline_config {
     char* name;
     /** @brief The stride of the vertex data to be used (ex: sizeof(vertex_3d)) */
     u32 stride;
+    /** @brief The stride of the per-instance data to be used. 0 if not instanced. */
+    u32 instance_stride;
     /** @brief The number of attributes. */
     u32 attribute_count;
     /** @brief An array of attributes. */
@@ -384,13 +400,17 @@ typedef struct vulkan_descriptor_set_config {
 } vulkan_descriptor_set_config;
 
 /**
- * @brief Represents a state for a given descriptor. This is used
- * to determine when a descriptor needs updating. There is a state
- * per frame (with a max of 3).
+ * @brief Represents a state for a given descriptor. This caches what was last
+ * written to the descriptor, which is used to determine when it needs updating.
+ * There is a state per frame (with a max of 3).
  */
 typedef struct vulkan_descriptor_state {
-    /** @brief The renderer frame number on which this descriptor was last updated. One per colour image. INVALID_ID_U16 if never loaded. */
-    u16 renderer_frame_number[VULKAN_RESOURCE_IMAGE_COUNT];
+    /** @brief The Vulkan handle (VkBuffer, VkImageView or VkSampler) last written to this descriptor. One per colour image. 0 if never written. */
+    u64 resource_handle[VULKAN_RESOURCE_IMAGE_COUNT];
+    /** @brief The unique id of the resource last written to this descriptor. One per colour image. */
+    u64 resource_uniqueid[VULKAN_RESOURCE_IMAGE_COUNT];
+    /** @brief The generation of the resource last written to this descriptor. One per colour image. */
+    u16 resource_generation[VULKAN_RESOURCE_IMAGE_COUNT];
 } vulkan_descriptor_state;
 
 typedef struct vulkan_uniform_sampler_state {
@@ -518,9 +538,12 @@ typedef struct vulkan_shader {
     /** @brief An array of uniforms in the shader. */
     shader_uniform* uniforms;
 
-    /** @brief The size of all attributes combined, a.k.a. the size of a vertex. */
+    /** @brief The size of all per-vertex attributes combined, a.k.a. the size of a vertex. */
     u32 attribute_stride;
 
+    /** @brief The size of all per-instance attributes combined. 0 if the shader has none. */
+    u32 instance_stride;
+
     /** @brief Face culling mode, provided by the front end. */
     face_cull_mode cull_mode;
 
@@ -619,6 +642,19 @@ typedef struct kwindow_renderer_backend_state {
     /** @brief The graphics command buffers, one per swapchain image. */
     vulkan_command_buffer* graphics_command_buffers;
 
+    /**
+     * @brief The command pools for node command lists, one per slot (RENDERER_MAX_NODE_COMMAND_LISTS).
+     * Since a slot is only ever recorded by one thread at a time, this satisfies the external
+     * synchronization pools require without needing one per thread.
+     */
+    VkCommandPool* node_command_pools;
+
+    /**
+     * @brief The secondary command buffers for node command lists, indexed by
+     * [frame in flight * RENDERER_MAX_NODE_COMMAND_LISTS + slot].
+     */
+    vulkan_command_buffer* node_command_buffers;
+
     /** @brief The semaphores used to indicate image availability, one per frame in flight. */
     VkSemaphore* image_available_semaphores;
 
@@ -631,14 +667,11 @@ typedef struct kwindow_renderer_backend_state {
      */
     VkFence* in_flight_fences;
 
-    /** @brief Resusable staging buffers (one per frame in flight) to transfer data from a resource to a GPU-only buffer. */
-    renderbuffer* staging;
-
     /**
-     * @brief Array of darrays of handles to textures that were updated as part of a frame's workload.
-     * One list per frame in flight.
+     * @brief The context-wide frame number each frame in flight was submitted as. Once a
+     * frame's fence signals, that frame and every frame before it has completed.
      */
-    khandle** frame_texture_updated_list;
+    u64* submitted_frame_numbers;
 
     u64 framebuffer_size_generation;
     u64 framebuffer_previous_size_generation;
@@ -674,6 +707,132 @@ typedef struct vulkan_texture_handle_data {
     vulkan_image* images;
 } vulkan_texture_handle_data;
 
+/** @brief The types of objects which may have their destruction deferred. */
+typedef enum vulkan_deferred_deletion_type {
+    VULKAN_DEFERRED_DELETION_TYPE_BUFFER,
+    VULKAN_DEFERRED_DELETION_TYPE_SAMPLER,
+    VULKAN_DEFERRED_DELETION_TYPE_PIPELINE,
+    VULKAN_DEFERRED_DELETION_TYPE_DESCRIPTOR_SETS,
+    VULKAN_DEFERRED_DELETION_TYPE_DESCRIPTOR_POOL
+} vulkan_deferred_deletion_type;
+
+/**
+ * @brief An object waiting to be destroyed once all frames which may have used it
+ * have completed.
+ */
+typedef struct vulkan_deferred_deletion {
+    vulkan_deferred_deletion_type type;
+    /** @brief The object can be destroyed once this frame number has completed. */
+    u64 frame_number;
+    union {
+        struct {
+            VkBuffer handle;
+            VkDeviceMemory memory;
+            /** @brief The size reported when the memory was allocated. */
+            u64 reported_size;
+            b8 is_device_memory;
+        } buffer;
+        VkSampler sampler;
+        struct {
+            VkPipeline handle;
+            VkPipelineLayout layout;
+        } pipeline;
+        struct {
+            VkDescriptorPool pool;
+            u32 count;
+            VkDescriptorSet sets[VULKAN_RESOURCE_IMAGE_COUNT];
+        } descriptor_sets;
+        VkDescriptorPool descriptor_pool;
+    };
+} vulkan_deferred_deletion;
+
+/** @brief The size of the persistently-mapped staging ring used by the upload manager. */
+#define VULKAN_UPLOAD_RING_SIZE MEBIBYTES(64)
+/** @brief The number of upload batches which may be in flight at once. */
+#define VULKAN_UPLOAD_BATCH_COUNT 4
+
+struct vulkan_context;
+
+/**
+ * @brief Called once the upload batch a callback was registered with has completed on the GPU.
+ * @param context A pointer to the Vulkan context.
+ * @param handle The handle which was passed when the callback was registered.
+ */
+typedef void (*PFN_vulkan_upload_complete)(struct vulkan_context* context, khandle handle);
+
+/** @brief A registered upload completion callback. */
+typedef struct vulkan_upload_callback {
+    PFN_vulkan_upload_complete callback;
+    khandle handle;
+} vulkan_upload_callback;
+
+/**
+ * @brief A batch of uploads recorded between two flushes. Buffer copies are recorded to
+ * the transfer command buffer if a dedicated transfer queue is in use; everything else is
+ * recorded to the graphics command buffer.
+ */
+typedef struct vulkan_upload_batch {
+    /** @brief Used for buffer copies when a dedicated transfer queue is in use. */
+    vulkan_command_buffer transfer_command_buffer;
+    /** @brief Used for image uploads, and for buffer copies if there is no dedicated transfer queue. */
+    vulkan_command_buffer graphics_command_buffer;
+    /** @brief Signaled when the transfer command buffer completes. */
+    VkFence transfer_fence;
+    /** @brief Signaled when the graphics command buffer completes. */
+    VkFence graphics_fence;
+    /** @brief Indicates if anything was recorded to the transfer command buffer. */
+    b8 transfer_used;
+    /** @brief Indicates if anything was recorded to the graphics command buffer. */
+    b8 graphics_used;
+    /** @brief Indicates if the batch has been submitted and not yet retired. */
+    b8 in_flight;
+    /** @brief The ring head at the time of submission. The ring tail moves here once the batch is retired. */
+    u64 ring_end;
+    /** @brief Callbacks to be made once the batch is retired. darray. */
+    vulkan_upload_callback* callbacks;
+} vulkan_upload_batch;
+
+/**
+ * @brief Stages uploads through a persistently-mapped ring buffer and records them into
+ * batches which are submitted once per frame, so that uploads never stall the graphics queue.
+ */
+typedef struct vulkan_upload_manager {
+    /** @brief The staging ring buffer. */
+    VkBuffer staging_buffer;
+    /** @brief The memory backing the staging ring buffer. */
+    VkDeviceMemory staging_memory;
+    /** @brief The persistently-mapped staging memory. */
+    u8* staging_mapped;
+    /** @brief The size of the staging ring. */
+    u64 ring_size;
+    /** @brief The total number of bytes ever allocated from the ring. Wrapped with ring_size to get an offset. */
+    u64 ring_head;
+    /** @brief The total number of bytes ever freed from the ring. */
+    u64 ring_tail;
+    /** @brief The number of bytes staged in the batch currently being recorded. */
+    u64 recording_bytes;
+
+    /** @brief Indicates if a dedicated transfer queue is used for buffer copies. */
+    b8 use_transfer_queue;
+    /** @brief The graphics and transfer queue family indices, for concurrent sharing. */
+    u32 queue_family_indices[2];
+    /** @brief The command pool for the transfer queue. Only valid if use_transfer_queue is set. */
+    VkCommandPool transfer_command_pool;
+    /** @brief Signaled by transfer queue submissions. Waited on by frame submissions. */
+    VkSemaphore transfer_timeline;
+    /** @brief The last value signaled on transfer_timeline. */
+    u64 transfer_timeline_value;
+    /** @brief Signaled by frame submissions. Waited on by transfer queue submissions. */
+    VkSemaphore graphics_timeline;
+    /** @brief The last value signaled on graphics_timeline. */
+    u64 graphics_timeline_value;
+
+    /** @brief The upload batches. */
+    vulkan_upload_batch batches[VULKAN_UPLOAD_BATCH_COUNT];
+    /** @brief The index of the batch currently being recorded. */
+    u32 recording_index;
+} vulkan_upload_manager;
+
 /**
  * @brief The overall Vulkan context for the backend. Holds and maintains
  * global renderer backend state, Vulkan instance, etc.
@@ -692,8 +851,6 @@ typedef struct vulkan_context {
 
     /** @brief The currently cached colour buffer clear value. */
     VkClearColorValue colour_clear_value;
-    /** @brief The currently cached depth/stencil buffer clear value. */
-    VkClearDepthStencilValue depth_stencil_clear_value;
 
     /** @brief The viewport rectangle. */
     vec4 viewport_rect;
@@ -766,11 +923,29 @@ typedef struct vulkan_context {
     // The render hardware interface.
     krhi_vulkan rhi;
 
-    /** @brief A pointer to the currently bound vulkan shader. */
-    vulkan_shader* bound_shader;
-
     /**
      * Used for dynamic compilation of vulkan shaders (using the shaderc lib.)
      */
     struct shaderc_compiler* shader_compiler;
+
+    /** @brief The pipeline cache used for all pipeline creation. Persisted to disk between runs. */
+    VkPipelineCache pipeline_cache;
+    /** @brief Indicates if the pipeline cache was seeded from a previous run's data. */
+    b8 pipeline_cache_loaded;
+    /** @brief Indicates if the startup pipeline creation metric has been reported yet. */
+    b8 pipeline_metrics_reported;
+    /** @brief The number of graphics pipelines created. */
+    u32 pipeline_creation_count;
+    /** @brief The total time spent creating graphics pipelines, in seconds. */
+    f64 pipeline_creation_time;
+
+    /** @brief Stages and batches texture and buffer uploads. */
+    vulkan_upload_manager upload;
+
+    /** @brief Objects waiting to be destroyed, in the order they were released. darray. */
+    vulkan_deferred_deletion* deletion_queue;
+    /** @brief The number of frames submitted, across all windows. Used as the number of the latest frame. */
+    u64 submitted_frame_number;
+    /** @brief The number of the latest frame known to have completed. */
+    u64 completed_frame_number;
 } vulkan_context;
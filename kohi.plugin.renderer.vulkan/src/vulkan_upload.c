@@ -0,0 +1,423 @@
+#include "vulkan_upload.h"
+
+#include <containers/darray.h>
+#include <logger.h>
+#include <memory/kmemory.h>
+
+#include "platform/vulkan_platform.h"
+#include "vulkan/vulkan_core.h"
+#include "vulkan_command_buffer.h"
+#include "vulkan_image.h"
+#include "vulkan_types.h"
+#include "vulkan_utils.h"
+
+// Staging allocations are aligned to this, which satisfies optimalBufferCopyOffsetAlignment
+// on all known hardware as well as the texel size of every supported format.
+#define UPLOAD_ALIGNMENT 16
+
+static b8 batch_is_complete(vulkan_context* context, vulkan_upload_batch* batch) {
+    krhi_vulkan* rhi = &context->rhi;
+    if (batch->transfer_used && rhi->kvkGetFenceStatus(context->device.logical_device, batch->transfer_fence) != VK_SUCCESS) {
+        return false;
+    }
+    if (batch->graphics_used && rhi->kvkGetFenceStatus(context->device.logical_device, batch->graphics_fence) != VK_SUCCESS) {
+        return false;
+    }
+    return true;
+}
+
+static void batch_wait(vulkan_context* context, vulkan_upload_batch* batch) {
+    krhi_vulkan* rhi = &context->rhi;
+    VkFence fences[2];
+    u32 fence_count = 0;
+    if (batch->transfer_used) {
+        fences[fence_count++] = batch->transfer_fence;
+    }
+    if (batch->graphics_used) {
+        fences[fence_count++] = batch->graphics_fence;
+    }
+    if (fence_count) {
+        VK_CHECK(rhi->kvkWaitForFences(context->device.logical_device, fence_count, fences, VK_TRUE, U64_MAX));
+    }
+}
+
+static void batch_retire(vulkan_context* context, vulkan_upload_batch* batch) {
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_upload_manager* upload = &context->upload;
+
+    if (batch->transfer_used) {
+        VK_CHECK(rhi->kvkResetFences(context->device.logical_device, 1, &batch->transfer_fence));
+        vulkan_command_buffer_reset(&batch->transfer_command_buffer);
+    }
+    if (batch->graphics_used) {
+        VK_CHECK(rhi->kvkResetFences(context->device.logical_device, 1, &batch->graphics_fence));
+        vulkan_command_buffer_reset(&batch->graphics_command_buffer);
+    }
+    batch->transfer_used = false;
+    batch->graphics_used = false;
+    batch->in_flight = false;
+
+    // Batches are retired in submission order, so the staging space up to here is free.
+    upload->ring_tail = batch->ring_end;
+
+    u32 callback_count = darray_length(batch->callbacks);
+    for (u32 i = 0; i < callback_count; ++i) {
+        batch->callbacks[i].callback(context, batch->callbacks[i].handle);
+    }
+    darray_clear(batch->callbacks);
+}
+
+// Retires the oldest batch in flight, if there is one. If wait is set, waits for it to complete
+// first; otherwise only retires it if it is already complete. Returns true if a batch was retired.
+static b8 retire_oldest(vulkan_context* context, b8 wait) {
+    vulkan_upload_manager* upload = &context->upload;
+    // Batches are submitted in order, so the oldest is the first in flight starting from the one to be
+    // recorded next (which is only in flight itself if every batch is).
+    for (u32 i = 0; i < VULKAN_UPLOAD_BATCH_COUNT; ++i) {
+        vulkan_upload_batch* batch = &upload->batches[(upload->recording_index + i) % VULKAN_UPLOAD_BATCH_COUNT];
+        if (!batch->in_flight) {
+            continue;
+        }
+        if (wait) {
+            batch_wait(context, batch);
+        } else if (!batch_is_complete(context, batch)) {
+            return false;
+        }
+        batch_retire(context, batch);
+        return true;
+    }
+    return false;
+}
+
+// Gets the command buffer to record to, beginning it if this is the first use in this batch.
+static vulkan_command_buffer* recording_command_buffer_get(vulkan_context* context, b8 transfer) {
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_upload_manager* upload = &context->upload;
+    vulkan_upload_batch* batch = &upload->batches[upload->recording_index];
+
+    // If every batch is in flight, the one to be recorded is the oldest, so wait for it.
+    if (batch->in_flight) {
+        batch_wait(context, batch);
+        batch_retire(context, batch);
+    }
+
+    if (transfer && upload->use_transfer_queue) {
+        if (!batch->transfer_used) {
+            vulkan_command_buffer_begin(context, &batch->transfer_command_buffer, true, false, false);
+            batch->transfer_used = true;
+        }
+        return &batch->transfer_command_buffer;
+    }
+
+    if (!batch->graphics_used) {
+        vulkan_command_buffer_begin(context, &batch->graphics_command_buffer, true, false, false);
+        batch->graphics_used = true;
+
+        // Ensure previously-submitted work is done reading anything about to be overwritten.
+        rhi->kvkCmdPipelineBarrier(
+            batch->graphics_command_buffer.handle,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, 0, 0, 0, 0, 0);
+    }
+    return &batch->graphics_command_buffer;
+}
+
+// Allocates space from the staging ring, waiting for batches in flight to free it if needed.
+// Returns false if the size can never fit.
+static b8 ring_allocate(vulkan_context* context, u64 size, u64* out_offset) {
+    vulkan_upload_manager* upload = &context->upload;
+    // Anything over half the ring could end up waiting on itself once wrapping is taken into account.
+    if (size > upload->ring_size / 2) {
+        return false;
+    }
+
+    // Submit early if this batch is getting large, so the GPU can start on it.
+    if (upload->recording_bytes + size > upload->ring_size / VULKAN_UPLOAD_BATCH_COUNT) {
+        vulkan_upload_flush(context, false);
+    }
+
+    u64 start = get_aligned(upload->ring_head, UPLOAD_ALIGNMENT);
+    u64 position = start % upload->ring_size;
+    if (position + size > upload->ring_size) {
+        // Doesn't fit before the end, so skip to the beginning of the ring.
+        start += upload->ring_size - position;
+        position = 0;
+    }
+
+    while (start + size - upload->ring_tail > upload->ring_size) {
+        if (!retire_oldest(context, true)) {
+            // Nothing in flight, so the space must be held by the batch being recorded.
+            vulkan_upload_flush(context, false);
+            if (!retire_oldest(context, true)) {
+                KERROR("Upload staging ring is full with nothing in flight. This should not happen.");
+                return false;
+            }
+        }
+    }
+
+    upload->recording_bytes += (start + size) - upload->ring_head;
+    upload->ring_head = start + size;
+    *out_offset = position;
+    return true;
+}
+
+b8 vulkan_upload_manager_create(vulkan_context* context) {
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_upload_manager* upload = &context->upload;
+    kzero_memory(upload, sizeof(vulkan_upload_manager));
+    upload->ring_size = VULKAN_UPLOAD_RING_SIZE;
+
+    // A dedicated transfer queue is only worth using if the frame can wait on it on the GPU.
+    upload->use_transfer_queue =
+        context->device.transfer_queue_index != -1 &&
+        context->device.transfer_queue_index != context->device.graphics_queue_index &&
+        (context->device.support_flags & VULKAN_DEVICE_SUPPORT_FLAG_TIMELINE_SEMAPHORE_BIT);
+    upload->queue_family_indices[0] = (u32)context->device.graphics_queue_index;
+    upload->queue_family_indices[1] = (u32)context->device.transfer_queue_index;
+
+    // Staging ring buffer, mapped for its entire lifetime.
+    VkBufferCreateInfo buffer_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    buffer_info.size = upload->ring_size;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vulkan_upload_buffer_sharing_apply(context, &buffer_info);
+    VK_CHECK(rhi->kvkCreateBuffer(context->device.logical_device, &buffer_info, context->allocator, &upload->staging_buffer));
+
+    VkMemoryRequirements requirements;
+    rhi->kvkGetBufferMemoryRequirements(context->device.logical_device, upload->staging_buffer, &requirements);
+    i32 memory_index = context->find_memory_index(context, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (memory_index == -1) {
+        KERROR("Unable to create upload staging buffer because the required memory type index was not found.");
+        return false;
+    }
+
+    VkMemoryAllocateInfo allocate_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = (u32)memory_index;
+    VkResult result = rhi->kvkAllocateMemory(context->device.logical_device, &allocate_info, context->allocator, &upload->staging_memory);
+    if (!vulkan_result_is_success(result)) {
+        KERROR("Failed to allocate memory for upload staging buffer with error: %s", vulkan_result_string(result, true));
+        return false;
+    }
+    VK_SET_DEBUG_OBJECT_NAME(context, VK_OBJECT_TYPE_DEVICE_MEMORY, upload->staging_memory, "upload_staging_ring");
+    kallocate_report(requirements.size, MEMORY_TAG_VULKAN);
+    VK_CHECK(rhi->kvkBindBufferMemory(context->device.logical_device, upload->staging_buffer, upload->staging_memory, 0));
+    VK_CHECK(rhi->kvkMapMemory(context->device.logical_device, upload->staging_memory, 0, VK_WHOLE_SIZE, 0, (void**)&upload->staging_mapped));
+
+    VkCommandPool transfer_pool = context->device.graphics_command_pool;
+    if (upload->use_transfer_queue) {
+        VkCommandPoolCreateInfo pool_create_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        pool_create_info.queueFamilyIndex = context->device.transfer_queue_index;
+        pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VK_CHECK(rhi->kvkCreateCommandPool(context->device.logical_device, &pool_create_info, context->allocator, &upload->transfer_command_pool));
+        transfer_pool = upload->transfer_command_pool;
+
+        VkSemaphoreTypeCreateInfo type_create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        type_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_create_info.initialValue = 0;
+        VkSemaphoreCreateInfo semaphore_create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        semaphore_create_info.pNext = &type_create_info;
+        VK_CHECK(rhi->kvkCreateSemaphore(context->device.logical_device, &semaphore_create_info, context->allocator, &upload->transfer_timeline));
+        VK_CHECK(rhi->kvkCreateSemaphore(context->device.logical_device, &semaphore_create_info, context->allocator, &upload->graphics_timeline));
+    }
+
+    VkFenceCreateInfo fence_create_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    for (u32 i = 0; i < VULKAN_UPLOAD_BATCH_COUNT; ++i) {
+        vulkan_upload_batch* batch = &upload->batches[i];
+        vulkan_command_buffer_allocate(context, context->device.graphics_command_pool, true, "upload_graphics_command_buffer", &batch->graphics_command_buffer, 0);
+        VK_CHECK(rhi->kvkCreateFence(context->device.logical_device, &fence_create_info, context->allocator, &batch->graphics_fence));
+        if (upload->use_transfer_queue) {
+            vulkan_command_buffer_allocate(context, transfer_pool, true, "upload_transfer_command_buffer", &batch->transfer_command_buffer, 0);
+            VK_CHECK(rhi->kvkCreateFence(context->device.logical_device, &fence_create_info, context->allocator, &batch->transfer_fence));
+        }
+        batch->callbacks = darray_create(vulkan_upload_callback);
+    }
+
+    KINFO("Vulkan upload manager created (%s).", upload->use_transfer_queue ? "using dedicated transfer queue" : "using graphics queue");
+    return true;
+}
+
+void vulkan_upload_manager_destroy(vulkan_context* context) {
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_upload_manager* upload = &context->upload;
+    if (!upload->staging_buffer) {
+        return;
+    }
+
+    vulkan_upload_flush(context, true);
+
+    VkDevice device = context->device.logical_device;
+    for (u32 i = 0; i < VULKAN_UPLOAD_BATCH_COUNT; ++i) {
+        vulkan_upload_batch* batch = &upload->batches[i];
+        vulkan_command_buffer_free(context, context->device.graphics_command_pool, &batch->graphics_command_buffer);
+        rhi->kvkDestroyFence(device, batch->graphics_fence, context->allocator);
+        if (upload->use_transfer_queue) {
+            vulkan_command_buffer_free(context, upload->transfer_command_pool, &batch->transfer_command_buffer);
+            rhi->kvkDestroyFence(device, batch->transfer_fence, context->allocator);
+        }
+        darray_destroy(batch->callbacks);
+    }
+
+    if (upload->use_transfer_queue) {
+        rhi->kvkDestroySemaphore(device, upload->transfer_timeline, context->allocator);
+        rhi->kvkDestroySemaphore(device, upload->graphics_timeline, context->allocator);
+        rhi->kvkDestroyCommandPool(device, upload->transfer_command_pool, context->allocator);
+    }
+
+    VkMemoryRequirements requirements;
+    rhi->kvkGetBufferMemoryRequirements(device, upload->staging_buffer, &requirements);
+    rhi->kvkUnmapMemory(device, upload->staging_memory);
+    rhi->kvkFreeMemory(device, upload->staging_memory, context->allocator);
+    rhi->kvkDestroyBuffer(device, upload->staging_buffer, context->allocator);
+    kfree_report(requirements.size, MEMORY_TAG_VULKAN);
+
+    kzero_memory(upload, sizeof(vulkan_upload_manager));
+}
+
+void vulkan_upload_buffer_sharing_apply(const vulkan_context* context, VkBufferCreateInfo* create_info) {
+    if (context->upload.use_transfer_queue) {
+        // Written on the transfer queue and read on the graphics queue. Concurrent sharing avoids
+        // the need for queue family ownership transfers.
+        create_info->sharingMode = VK_SHARING_MODE_CONCURRENT;
+        create_info->queueFamilyIndexCount = 2;
+        create_info->pQueueFamilyIndices = context->upload.queue_family_indices;
+    } else {
+        create_info->sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        create_info->queueFamilyIndexCount = 0;
+        create_info->pQueueFamilyIndices = 0;
+    }
+}
+
+b8 vulkan_upload_buffer(vulkan_context* context, VkBuffer dest, u64 dest_offset, u64 size, const void* data) {
+    vulkan_upload_manager* upload = &context->upload;
+    u64 staging_offset = 0;
+    if (!ring_allocate(context, size, &staging_offset)) {
+        return false;
+    }
+    kcopy_memory(upload->staging_mapped + staging_offset, data, size);
+
+    vulkan_command_buffer* command_buffer = recording_command_buffer_get(context, true);
+    VkBufferCopy copy_region;
+    copy_region.srcOffset = staging_offset;
+    copy_region.dstOffset = dest_offset;
+    copy_region.size = size;
+    context->rhi.kvkCmdCopyBuffer(command_buffer->handle, upload->staging_buffer, dest, 1, &copy_region);
+    return true;
+}
+
+void vulkan_upload_copy_buffer(vulkan_context* context, VkBuffer source, u64 source_offset, VkBuffer dest, u64 dest_offset, u64 size) {
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_command_buffer* command_buffer = recording_command_buffer_get(context, true);
+
+    // Previously-recorded uploads may have written to the source, and later ones may write
+    // to the destination, so the copy needs to be fenced in on both sides.
+    VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    rhi->kvkCmdPipelineBarrier(command_buffer->handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+
+    VkBufferCopy copy_region;
+    copy_region.srcOffset = source_offset;
+    copy_region.dstOffset = dest_offset;
+    copy_region.size = size;
+    rhi->kvkCmdCopyBuffer(command_buffer->handle, source, dest, 1, &copy_region);
+
+    rhi->kvkCmdPipelineBarrier(command_buffer->handle, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+}
+
+b8 vulkan_upload_image(vulkan_context* context, vulkan_image* image, u64 size, const void* pixels) {
+    vulkan_upload_manager* upload = &context->upload;
+    u64 staging_offset = 0;
+    if (!ring_allocate(context, size, &staging_offset)) {
+        return false;
+    }
+    kcopy_memory(upload->staging_mapped + staging_offset, pixels, size);
+
+    // NOTE: Images always go through the graphics queue, since mip generation requires it.
+    vulkan_command_buffer* command_buffer = recording_command_buffer_get(context, false);
+
+    // Transition the layout from whatever it is currently to optimal for recieving data.
+    vulkan_image_transition_layout(context, command_buffer, image, image->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    // Copy the data from the staging ring.
+    vulkan_image_copy_from_buffer(context, image, upload->staging_buffer, staging_offset, command_buffer);
+
+    if (image->mip_levels <= 1 || !vulkan_image_mipmaps_generate(context, image, command_buffer)) {
+        // If mip generation isn't needed or fails, fall back to ordinary transition.
+        vulkan_image_transition_layout(context, command_buffer, image, image->format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    return true;
+}
+
+void vulkan_upload_callback_add(vulkan_context* context, PFN_vulkan_upload_complete callback, khandle handle) {
+    vulkan_upload_manager* upload = &context->upload;
+    vulkan_upload_batch* batch = &upload->batches[upload->recording_index];
+    if (batch->in_flight || (!batch->transfer_used && !batch->graphics_used)) {
+        // Nothing recorded yet, so attach to the most recently submitted batch instead, if it is still in flight.
+        batch = &upload->batches[(upload->recording_index + VULKAN_UPLOAD_BATCH_COUNT - 1) % VULKAN_UPLOAD_BATCH_COUNT];
+        if (!batch->in_flight) {
+            callback(context, handle);
+            return;
+        }
+    }
+    vulkan_upload_callback entry = {callback, handle};
+    darray_push(batch->callbacks, entry);
+}
+
+void vulkan_upload_flush(vulkan_context* context, b8 wait) {
+    krhi_vulkan* rhi = &context->rhi;
+    vulkan_upload_manager* upload = &context->upload;
+    vulkan_upload_batch* batch = &upload->batches[upload->recording_index];
+
+    if (!batch->in_flight && (batch->transfer_used || batch->graphics_used)) {
+        if (batch->transfer_used) {
+            vulkan_command_buffer_end(context, &batch->transfer_command_buffer);
+
+            // Don't overwrite anything that previously-submitted frames may still be reading.
+            u32 wait_count = upload->graphics_timeline_value ? 1 : 0;
+            VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            u64 signal_value = ++upload->transfer_timeline_value;
+            vulkan_command_buffer_submit(
+                context,
+                &batch->transfer_command_buffer,
+                context->device.transfer_queue,
+                1, &upload->transfer_timeline, &signal_value,
+                wait_count, &upload->graphics_timeline, &wait_stage, &upload->graphics_timeline_value,
+                batch->transfer_fence);
+        }
+        if (batch->graphics_used) {
+            // Make the uploads visible to everything submitted to the graphics queue after this.
+            VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            rhi->kvkCmdPipelineBarrier(
+                batch->graphics_command_buffer.handle,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                0, 1, &barrier, 0, 0, 0, 0);
+            vulkan_command_buffer_end(context, &batch->graphics_command_buffer);
+            vulkan_command_buffer_submit(
+                context,
+                &batch->graphics_command_buffer,
+                context->device.graphics_queue,
+                0, 0, 0,
+                0, 0, 0, 0,
+                batch->graphics_fence);
+        }
+
+        batch->ring_end = upload->ring_head;
+        batch->in_flight = true;
+        upload->recording_bytes = 0;
+        upload->recording_index = (upload->recording_index + 1) % VULKAN_UPLOAD_BATCH_COUNT;
+    }
+
+    if (wait) {
+        while (retire_oldest(context, true)) {
+        }
+    }
+}
+
+void vulkan_upload_update(vulkan_context* context) {
+    while (retire_oldest(context, false)) {
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file vulkan_upload.h
+ * @author Travis Vroman (travis@kohiengine.com)
+ * @brief Contains the upload manager, which stages texture and buffer uploads through a
+ * persistently-mapped ring buffer and submits them in batches without stalling the
+ * graphics queue.
+ * @details Uploads are recorded into the current batch, which is submitted when the frame is
+ * submitted (or earlier if it grows large). Buffer copies go to a dedicated transfer queue
+ * when the device has one and supports timeline semaphores; the frame then waits on the
+ * transfer timeline on the GPU. Image uploads always go to the graphics queue, since they
+ * need layout transitions and mip generation. Completed batches are retired by polling
+ * their fences once per frame, at which point their staging space is reclaimed and any
+ * registered callbacks are made.
+ * @version 1.0
+ * @date 2024-11-02
+ *
+ * @copyright Kohi Game Engine is Copyright (c) Travis Vroman 2021-2024
+ *
+ */
+
+#pragma once
+
+#include "vulkan_types.h"
+
+/**
+ * @brief Creates the upload manager for the given context. Must be called after the device is created.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_upload_manager_create(vulkan_context* context);
+
+/**
+ * @brief Submits any pending uploads, waits for all of them to complete, then destroys
+ * the upload manager. Must be called before the device is destroyed.
+ *
+ * @param context A pointer to the Vulkan context.
+ */
+void vulkan_upload_manager_destroy(vulkan_context* context);
+
+/**
+ * @brief Sets up the sharing mode of the given buffer create info so that the buffer may be
+ * written by the transfer queue and used by the graphics queue, if required.
+ *
+ * @param context A const pointer to the Vulkan context.
+ * @param create_info A pointer to the buffer create info to be modified.
+ */
+void vulkan_upload_buffer_sharing_apply(const vulkan_context* context, VkBufferCreateInfo* create_info);
+
+/**
+ * @brief Stages the given data and records a copy of it to the given buffer.
+ * The data is copied before returning, so it does not need to be kept alive.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param dest The buffer to be uploaded to.
+ * @param dest_offset The offset in bytes into the destination buffer.
+ * @param size The size of the data in bytes.
+ * @param data The data to be uploaded.
+ * @return True on success. False if the data is too large to be staged, in which case the caller must upload it another way.
+ */
+b8 vulkan_upload_buffer(vulkan_context* context, VkBuffer dest, u64 dest_offset, u64 size, const void* data);
+
+/**
+ * @brief Records a copy from one buffer to another. The copy is ordered after all uploads
+ * recorded before it, and before all uploads recorded after it.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param source The buffer to copy from.
+ * @param source_offset The offset in bytes into the source buffer.
+ * @param dest The buffer to copy to.
+ * @param dest_offset The offset in bytes into the destination buffer.
+ * @param size The number of bytes to copy.
+ */
+void vulkan_upload_copy_buffer(vulkan_context* context, VkBuffer source, u64 source_offset, VkBuffer dest, u64 dest_offset, u64 size);
+
+/**
+ * @brief Stages the given pixel data and records an upload of it to the given image, followed
+ * by mip generation (if the image has mips) and a transition to shader-read-only layout.
+ * The data is copied before returning, so it does not need to be kept alive.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param image A pointer to the image to be uploaded to.
+ * @param size The size of the pixel data in bytes.
+ * @param pixels The pixel data to be uploaded.
+ * @return True on success. False if the data is too large to be staged, in which case the caller must upload it another way.
+ */
+b8 vulkan_upload_image(vulkan_context* context, vulkan_image* image, u64 size, const void* pixels);
+
+/**
+ * @brief Registers a callback to be made once everything uploaded so far has completed.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param callback The callback to be made.
+ * @param handle A handle passed along to the callback.
+ */
+void vulkan_upload_callback_add(vulkan_context* context, PFN_vulkan_upload_complete callback, khandle handle);
+
+/**
+ * @brief Submits all uploads recorded so far. Called when the frame is submitted, so that
+ * the frame sees the results of uploads made before it.
+ *
+ * @param context A pointer to the Vulkan context.
+ * @param wait Indicates if this should wait for all submitted uploads to complete before returning.
+ */
+void vulkan_upload_flush(vulkan_context* context, b8 wait);
+
+/**
+ * @brief Retires any completed upload batches without waiting, reclaiming their staging
+ * space and making their callbacks. Should be called once per frame.
+ *
+ * @param context A pointer to the Vulkan context.
+ */
+void vulkan_upload_update(vulkan_context* context);
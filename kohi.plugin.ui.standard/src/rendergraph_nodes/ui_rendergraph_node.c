@@ -127,6 +127,9 @@ b8 ui_rendergraph_node_create(struct rendergraph* graph, struct rendergraph_node
     self->destroy = ui_rendergraph_node_destroy;
     self->execute = ui_rendergraph_node_execute;
 
+    // Uses only its own shader, so may record alongside other nodes.
+    self->concurrent_record = true;
+
     return true;
 }
 
@@ -229,9 +232,6 @@ b8 ui_rendergraph_node_execute(struct rendergraph_node* self, struct frame_data*
                 RENDERER_STENCIL_OP_REPLACE,
                 RENDERER_COMPARE_OP_ALWAYS);
 
-            renderer_clear_depth_set(internal_data->renderer, 1.0f);
-            renderer_clear_stencil_set(internal_data->renderer, 0.0f);
-
             {
                 shader_system_bind_draw_id(internal_data->sui_shader, *renderable->per_draw_id);
                 sui_per_draw_ubo draw_data = {0};
@@ -135,7 +135,6 @@ layout(set = 1, binding = 2) uniform sampler material_samplers[MATERIAL_STANDARD
 
 // per-draw
 layout(push_constant) uniform per_draw_ubo {
-    mat4 model;
     vec4 clipping_plane;
     uint view_index;
     uint irradiance_cubemap_index;
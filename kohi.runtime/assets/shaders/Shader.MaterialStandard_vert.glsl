@@ -62,6 +62,9 @@ layout(location = 2) in vec2 in_texcoord;
 layout(location = 3) in vec4 in_colour;
 layout(location = 4) in vec4 in_tangent;
 
+// Instance inputs
+layout(location = 5) in mat4 in_model; // Occupies locations 5-8.
+
 // per-frame
 layout(std140, set = 0, binding = 0) uniform per_frame_ubo {
     // Light space for shadow mapping. Per cascade
@@ -115,7 +118,6 @@ layout(set = 1, binding = 0) uniform per_group_ubo {
 
 // per-draw
 layout(push_constant) uniform per_draw_ubo {
-    mat4 model;
     vec4 clipping_plane;
     uint view_index;
     uint irradiance_cubemap_index;
@@ -146,15 +148,15 @@ void main() {
 	out_dto.tex_coord = in_texcoord;
     out_dto.vertex_colour = in_colour;
 	// Fragment position in world space.
-	out_dto.frag_position = material_draw_ubo.model * vec4(in_position, 1.0);
+	out_dto.frag_position = in_model * vec4(in_position, 1.0);
 	// Copy the normal over.
-	mat3 m3_model = mat3(material_draw_ubo.model);
+	mat3 m3_model = mat3(in_model);
 	out_dto.normal = normalize(m3_model * in_normal);
 	out_dto.tangent = normalize(m3_model * vec3(in_tangent));
-    gl_Position = material_frame_ubo.projection * material_frame_ubo.views[material_draw_ubo.view_index] * material_draw_ubo.model * vec4(in_position, 1.0);
+    gl_Position = material_frame_ubo.projection * material_frame_ubo.views[material_draw_ubo.view_index] * in_model * vec4(in_position, 1.0);
 
 	// Apply clipping plane
-	vec4 world_position = material_draw_ubo.model * vec4(in_position, 1.0);
+	vec4 world_position = in_model * vec4(in_position, 1.0);
 	gl_ClipDistance[0] = dot(world_position, material_draw_ubo.clipping_plane);
 
 	// Get a light-space-transformed fragment positions.
@@ -20,7 +20,6 @@ layout (set = 1, binding = 1) uniform sampler base_colour_sampler;
 layout(push_constant) uniform per_draw_ubo {
 	
 	// Only guaranteed a total of 128 bytes.
-	mat4 model; // 64 bytes
     uint cascade_index;
 } draw_ubo;
 
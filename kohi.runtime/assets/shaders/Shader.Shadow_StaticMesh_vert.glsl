@@ -13,6 +13,9 @@ layout(location = 2) in vec2 in_texcoord;
 layout(location = 3) in vec4 in_colour;
 layout(location = 4) in vec4 in_tangent;
 
+// Instance input
+layout(location = 5) in mat4 in_model; // Occupies locations 5-8.
+
 // per frame
 layout(set = 0, binding = 0) uniform per_frame_ubo {
     mat4 projections[MAX_CASCADES];
@@ -25,7 +28,6 @@ layout(set = 0, binding = 0) uniform per_frame_ubo {
 layout(push_constant) uniform per_draw_ubo {
 	
 	// Only guaranteed a total of 128 bytes.
-	mat4 model; // 64 bytes
     uint cascade_index;
 } draw_ubo;
 
@@ -40,5 +42,5 @@ layout(location = 1) out struct dto {
 
 void main() {
     out_dto.tex_coord = in_texcoord;
-    gl_Position = (frame_ubo.projections[draw_ubo.cascade_index] * frame_ubo.views[draw_ubo.cascade_index]) * draw_ubo.model * vec4(in_position, 1.0);
+    gl_Position = (frame_ubo.projections[draw_ubo.cascade_index] * frame_ubo.views[draw_ubo.cascade_index]) * in_model * vec4(in_position, 1.0);
 }
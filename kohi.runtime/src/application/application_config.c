@@ -39,6 +39,14 @@ b8 application_config_parse_file_content(const char* file_content, application_c
         out_config->frame_allocator_size = (u64)frame_alloc_size;
     }
 
+    // frame_allocator_thread_size is optional, so use the main thread's size if it isn't defined.
+    i64 frame_alloc_thread_size = 0;
+    if (!kson_object_property_value_get_int(&app_config_tree.root, "frame_allocator_thread_size", &frame_alloc_thread_size)) {
+        out_config->frame_allocator_thread_size = out_config->frame_allocator_size;
+    } else {
+        out_config->frame_allocator_thread_size = (u64)frame_alloc_thread_size;
+    }
+
     // app_frame_data_size is optional, so use a defualt if it isn't defined.
     // NOTE: It's likely the application will want to override this anyway with a sizeof(some_struct).
     i64 iapp_frame_data_size = 0; // kson doesn't do unsigned ints, so convert it after.
@@ -59,9 +59,12 @@ typedef struct application_config {
     // darray of rendergraph configurations.
     application_rendergraph_config* rendergraphs;
 
-    /** @brief The size of the engine's frame allocator. */
+    /** @brief The size of the engine's frame allocator for the main thread, per frame. */
     u64 frame_allocator_size;
 
+    /** @brief The size of the engine's frame allocator for each other thread that uses it, per frame. */
+    u64 frame_allocator_thread_size;
+
     /** @brief The size of the application-specific frame data. Set to 0 if not used. */
     u64 app_frame_data_size;
 } application_config;
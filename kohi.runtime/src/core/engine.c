@@ -7,7 +7,7 @@
 #include <identifiers/khandle.h>
 #include <identifiers/uuid.h>
 #include <logger.h>
-#include <memory/allocators/linear_allocator.h>
+#include <memory/allocators/frame_arena.h>
 #include <memory/kmemory.h>
 #include <platform/platform.h>
 #include <platform/vfs.h>
@@ -54,8 +54,9 @@ typedef struct engine_state_t {
     kclock clock;
     f64 last_time;
 
-    // An allocator used for per-frame allocations, that is reset every frame.
-    linear_allocator frame_allocator;
+    // Per-thread arenas used for per-frame allocations. Each frame's allocations
+    // live until ENGINE_FRAME_ARENA_FRAME_COUNT more frames have started.
+    frame_arena frame_allocator;
 
     frame_data p_frame_data;
 
@@ -82,13 +83,18 @@ typedef struct engine_state_t {
 
 static engine_state_t* engine_state;
 
+// Frame allocations must outlive the frames in flight on the GPU (at most 2) plus the one being built.
+#define ENGINE_FRAME_ARENA_FRAME_COUNT 3
+// The main thread, every job thread and a few spares for other engine threads (i.e. audio).
+#define ENGINE_FRAME_ARENA_MAX_THREADS 32
+
 // frame allocator functions.
 static void* frame_allocator_allocate(u64 size) {
     if (!engine_state) {
         return 0;
     }
 
-    return linear_allocator_allocate(&engine_state->frame_allocator, size);
+    return frame_arena_allocate(&engine_state->frame_allocator, size);
 }
 static void frame_allocator_free(void* block, u64 size) {
     // NOTE: Linear allocator doesn't free, so this is a no-op
@@ -97,8 +103,8 @@ static void frame_allocator_free(void* block, u64 size) {
 }
 static void frame_allocator_free_all(void) {
     if (engine_state) {
-        // Don't wipe the memory each time, to save on performance.
-        linear_allocator_free_all(&engine_state->frame_allocator, false);
+        // Only the oldest frame is reset, so data still in flight stays valid.
+        frame_arena_begin_frame(&engine_state->frame_allocator);
     }
 }
 
@@ -406,10 +412,11 @@ b8 engine_create(application* game_inst) {
             job_thread_types[i] = JOB_TYPE_GENERAL;
         }
 
-        if (max_thread_count == 1 || !renderer_multithreaded) {
+        // NOTE: compare against the actual thread count, so general jobs always have a thread.
+        if (thread_count == 1 || !renderer_multithreaded) {
             // Everything on one job thread.
             job_thread_types[0] |= (JOB_TYPE_GPU_RESOURCE | JOB_TYPE_RESOURCE_LOAD);
-        } else if (max_thread_count == 2) {
+        } else if (thread_count == 2) {
             // Split things between the 2 threads
             job_thread_types[0] |= JOB_TYPE_GPU_RESOURCE;
             job_thread_types[1] |= JOB_TYPE_RESOURCE_LOAD;
@@ -603,7 +610,15 @@ b8 engine_create(application* game_inst) {
     // &game_inst->app_config->font_config
 
     // Setup the frame allocator.
-    linear_allocator_create(game_inst->app_config.frame_allocator_size, 0, &engine_state->frame_allocator);
+    if (!frame_arena_create(
+            game_inst->app_config.frame_allocator_size,
+            game_inst->app_config.frame_allocator_thread_size,
+            ENGINE_FRAME_ARENA_FRAME_COUNT,
+            ENGINE_FRAME_ARENA_MAX_THREADS,
+            &engine_state->frame_allocator)) {
+        KERROR("Failed to create frame allocator.");
+        return false;
+    }
     engine_state->p_frame_data.allocator.allocate = frame_allocator_allocate;
     engine_state->p_frame_data.allocator.free = frame_allocator_free;
     engine_state->p_frame_data.allocator.free_all = frame_allocator_free_all;
@@ -845,6 +860,8 @@ b8 engine_run(application* game_inst) {
         kresource_system_shutdown(systems->kresource_state);
         renderer_system_shutdown(systems->renderer_system);
         job_system_shutdown(systems->job_system);
+        // Job threads are gone, so nothing else can be using the frame allocator.
+        frame_arena_destroy(&engine_state->frame_allocator);
         input_system_shutdown(systems->input_system);
         event_system_shutdown(systems->event_system);
         kvar_system_shutdown(systems->kvar_system);
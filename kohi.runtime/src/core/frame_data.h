@@ -16,7 +16,10 @@ typedef struct frame_data {
     /** @brief The number of meshes drawn in the shadow pass in the last frame. */
     u32 drawn_shadow_mesh_count;
 
-    /** @brief An allocator designed and used for per-frame allocations. */
+    /**
+     * @brief An allocator designed and used for per-frame allocations. Safe to use from job
+     * threads. Allocations stay valid for the frames in flight, so they may be handed to the GPU.
+     */
     frame_allocator_int allocator;
 
     /** @brief Application level frame specific data. Optional, up to the app to know how to use this if needed. */
@@ -11,13 +11,15 @@
 #include "memory/kmemory.h"
 #include "systems/xform_system.h"
 
+// The number of xforms gathered before being handed to the xform system to update together.
+#define HIERARCHY_GRAPH_BATCH_SIZE 256
+
 static khandle node_acquire(hierarchy_graph* graph, u32 parent_index, khandle xform_handle);
 static void node_release(hierarchy_graph* graph, khandle* node_handle, b8 release_transform);
-static void child_levels_update(hierarchy_graph* graph, u32 parent_index);
 static void ensure_allocated(hierarchy_graph* graph, u32 new_node_count);
 static void build_view_tree(hierarchy_graph* graph, hierarchy_graph_view* out_view);
 static void destroy_view_tree(hierarchy_graph* graph, hierarchy_graph_view* out_view);
-static void hierarchy_graph_update_tree_view_node(hierarchy_graph* graph, u32 node_index);
+static b8 hierarchy_graph_update_view_node(hierarchy_graph* graph, hierarchy_graph_view_node* node);
 static u32 hierarchy_graph_parent_index_get(const hierarchy_graph* graph, khandle node_handle);
 
 b8 hierarchy_graph_create(hierarchy_graph* out_graph) {
@@ -57,6 +59,11 @@ void hierarchy_graph_destroy(hierarchy_graph* graph) {
             graph->xform_handles = 0;
         }
 
+        if (graph->xform_versions) {
+            kfree(graph->xform_versions, sizeof(u32) * graph->nodes_allocated, MEMORY_TAG_ARRAY);
+            graph->xform_versions = 0;
+        }
+
         graph->nodes_allocated = 0;
 
         destroy_view_tree(graph, &graph->view);
@@ -64,17 +71,48 @@ void hierarchy_graph_destroy(hierarchy_graph* graph) {
 }
 
 void hierarchy_graph_update(hierarchy_graph* graph) {
-    // Destroy the old tree
-    destroy_view_tree(graph, &graph->view);
+    // Only rebuild the view tree if nodes were added or removed.
+    if (graph->structure_dirty) {
+        destroy_view_tree(graph, &graph->view);
+        build_view_tree(graph, &graph->view);
+        graph->structure_dirty = false;
+    }
+
+    if (!graph->view.nodes) {
+        return;
+    }
 
-    // Build up the view tree.
-    build_view_tree(graph, &graph->view);
+    // Parents always come before their children in the view, so changes propagate
+    // all the way down in a single pass. Xforms needing an update are gathered and updated
+    // in batches. A batch never spans more than one level, so parents are always done first.
+    khandle batch_xforms[HIERARCHY_GRAPH_BATCH_SIZE];
+    khandle batch_parents[HIERARCHY_GRAPH_BATCH_SIZE];
+    u32 batch_count = 0;
+    u8 batch_level = 0;
+
+    u32 node_count = darray_length(graph->view.nodes);
+    for (u32 i = 0; i < node_count; ++i) {
+        hierarchy_graph_view_node* node = &graph->view.nodes[i];
+        u8 level = graph->levels[node->node_handle.handle_index];
+        if (batch_count == HIERARCHY_GRAPH_BATCH_SIZE || (batch_count && level != batch_level)) {
+            xform_world_update_batch(batch_count, batch_xforms, batch_parents);
+            batch_count = 0;
+        }
+
+        if (hierarchy_graph_update_view_node(graph, node)) {
+            batch_xforms[batch_count] = node->xform_handle;
+            batch_parents[batch_count] = node->xform_parent_index == INVALID_ID ? khandle_invalid() : graph->view.nodes[node->xform_parent_index].xform_handle;
+            batch_count++;
+            batch_level = level;
+        }
+    }
+    if (batch_count) {
+        xform_world_update_batch(batch_count, batch_xforms, batch_parents);
+    }
 
-    // Traverse the tree and update the transforms.
-    u32 root_count = darray_length(graph->view.root_indices);
-    for (u32 i = 0; i < root_count; ++i) {
-        // Roots have no parent, so no world matrix is passed.
-        hierarchy_graph_update_tree_view_node(graph, graph->view.root_indices[i]);
+    // Reset the dirty flags for the next update.
+    for (u32 i = 0; i < node_count; ++i) {
+        graph->dirty_flags[graph->view.nodes[i].node_handle.handle_index] = false;
     }
 }
 
@@ -224,8 +262,9 @@ static khandle node_acquire(hierarchy_graph* graph, u32 parent_index, khandle xf
             // nest it below the parent in the hierarchy.
             graph->levels[i] = parent_index == INVALID_ID ? 0 : graph->levels[parent_index] + 1;
             graph->parent_indices[i] = parent_index;
-            graph->dirty_flags[i] = false;
+            graph->dirty_flags[i] = true;
             graph->xform_handles[i] = xform_handle;
+            graph->structure_dirty = true;
 
             return graph->node_handles[i];
         }
@@ -242,8 +281,9 @@ static khandle node_acquire(hierarchy_graph* graph, u32 parent_index, khandle xf
     // nest it below the parent in the hierarchy.
     graph->levels[new_index] = parent_index == INVALID_ID ? 0 : graph->levels[parent_index] + 1;
     graph->parent_indices[new_index] = parent_index;
-    graph->dirty_flags[new_index] = false;
+    graph->dirty_flags[new_index] = true;
     graph->xform_handles[new_index] = xform_handle;
+    graph->structure_dirty = true;
 
     return graph->node_handles[new_index];
 }
@@ -257,9 +297,17 @@ static void node_release(hierarchy_graph* graph, khandle* node_handle, b8 releas
             KERROR("Tried to release a node using a stale handle. Nothing was done.");
         } else {
             // The handle is valid and matching. Take any node that is a child of this node and move it up
-            // in the hierarchy. This may mean these nodes become roots themselves.
-            // Recursively update child levels.This also would mean that children of children would need thier levels updated.
-            child_levels_update(graph, graph->parent_indices[node_handle->handle_index]);
+            // in the hierarchy. This may mean these nodes become roots themselves. Levels of the moved
+            // nodes and their children are recalculated when the view is next rebuilt.
+            u32 index = node_handle->handle_index;
+            u32 new_parent_index = graph->parent_indices[index];
+            for (u32 i = 0; i < graph->nodes_allocated; ++i) {
+                if (graph->parent_indices[i] == index) {
+                    graph->parent_indices[i] = new_parent_index;
+                    graph->dirty_flags[i] = true;
+                }
+            }
+            graph->structure_dirty = true;
 
             // Release the node entry back into the list by invalidating all the fields.
             graph->parent_indices[node_handle->handle_index] = INVALID_ID;
@@ -280,18 +328,6 @@ static void node_release(hierarchy_graph* graph, khandle* node_handle, b8 releas
     }
 }
 
-static void child_levels_update(hierarchy_graph* graph, u32 parent_index) {
-    // If there is no parent, node becomes a root. Otherwise, nest below the parent.
-    u32 new_level = parent_index == INVALID_ID ? 0 : graph->levels[parent_index] + 1;
-    for (u32 i = 0; i < graph->nodes_allocated; ++i) {
-        if (graph->parent_indices[i] == parent_index) {
-            graph->levels[i] = new_level;
-            // Recurse down the tree.
-            child_levels_update(graph, i);
-        }
-    }
-}
-
 static void ensure_allocated(hierarchy_graph* graph, u32 new_node_count) {
     KASSERT(graph);
     if (graph->nodes_allocated <= new_node_count) {
@@ -343,6 +379,13 @@ static void ensure_allocated(hierarchy_graph* graph, u32 new_node_count) {
             graph->xform_handles[xform_handle_index] = khandle_invalid();
         }
 
+        u32* new_xform_versions = kallocate(sizeof(u32) * new_node_count, MEMORY_TAG_ARRAY);
+        if (graph->xform_versions) {
+            kcopy_memory(new_xform_versions, graph->xform_versions, sizeof(u32) * graph->nodes_allocated);
+            kfree(graph->xform_versions, sizeof(u32) * graph->nodes_allocated, MEMORY_TAG_ARRAY);
+        }
+        graph->xform_versions = new_xform_versions;
+
         graph->nodes_allocated = new_node_count;
     }
 }
@@ -353,6 +396,12 @@ static u32 hierarchy_node_create(hierarchy_graph_view* view, khandle node_handle
     node.xform_handle = xform_handle;
     node.children = 0;
     node.parent_index = parent_index;
+    node.xform_parent_index = INVALID_ID;
+    if (parent_index != INVALID_ID) {
+        // Nodes without an xform are skipped over, using the next one up the tree instead.
+        hierarchy_graph_view_node* parent = &view->nodes[parent_index];
+        node.xform_parent_index = khandle_is_invalid(parent->xform_handle) ? parent->xform_parent_index : parent_index;
+    }
 
     darray_push(view->nodes, node);
     u32 node_count = darray_length(view->nodes);
@@ -360,54 +409,57 @@ static u32 hierarchy_node_create(hierarchy_graph_view* view, khandle node_handle
     return node_count - 1;
 }
 
-static void build_view_tree_node_children(hierarchy_graph* graph, u32 parent_index) {
-    for (u32 i = 0; i < graph->nodes_allocated; ++i) {
-        hierarchy_graph_view_node* parent = &graph->view.nodes[parent_index];
-        if (graph->parent_indices[i] == parent->node_handle.handle_index) {
-            // Found a child.
-            if (!parent->children) {
-                parent->children = darray_create(u32);
-            }
-
-            u32 node_index = hierarchy_node_create(&graph->view, graph->node_handles[i], graph->xform_handles[i], parent_index);
+static void build_view_tree(hierarchy_graph* graph, hierarchy_graph_view* out_view) {
+    out_view->nodes = darray_create(hierarchy_graph_view_node);
+    out_view->root_indices = darray_create(u32);
 
-            // Recurse
-            build_view_tree_node_children(graph, node_index);
+    u32 node_count = graph->nodes_allocated;
+    if (!node_count) {
+        return;
+    }
 
-            // Add to children list.
-            darray_push(parent->children, node_index);
+    // Link each node to its children up front, so that they don't need to be searched for.
+    // Built back to front so that children end up in index order.
+    u32* first_children = kallocate(sizeof(u32) * node_count * 2, MEMORY_TAG_ARRAY);
+    u32* next_siblings = first_children + node_count;
+    kset_memory(first_children, 0xFF, sizeof(u32) * node_count * 2);
+    for (u32 i = node_count; i-- > 0;) {
+        u32 parent_index = graph->parent_indices[i];
+        if (!khandle_is_invalid(graph->node_handles[i]) && parent_index != INVALID_ID) {
+            next_siblings[i] = first_children[parent_index];
+            first_children[parent_index] = i;
         }
     }
-}
-
-static void build_view_tree(hierarchy_graph* graph, hierarchy_graph_view* out_view) {
-    out_view->nodes = darray_create(hierarchy_graph_view_node);
-    out_view->root_indices = darray_create(u32);
 
-    for (u32 i = 0; i < graph->nodes_allocated; ++i) {
+    for (u32 i = 0; i < node_count; ++i) {
         // Only work on root nodes.
         if (!khandle_is_invalid(graph->node_handles[i]) && graph->parent_indices[i] == INVALID_ID) {
             u32 root_index = hierarchy_node_create(out_view, graph->node_handles[i], graph->xform_handles[i], INVALID_ID);
-
-            // Recurse
-            build_view_tree_node_children(graph, root_index);
+            graph->levels[i] = 0;
 
             // Add to roots list.
             darray_push(out_view->root_indices, root_index);
         }
     }
-}
 
-static void destroy_view_tree_node(hierarchy_graph_view* view, hierarchy_graph_view_node* node) {
-    // Clean up children first, if any
-    if (node->children) {
-        u32 child_count = darray_length(node->children);
-        for (u32 i = 0; i < child_count; ++i) {
-            hierarchy_graph_view_node* child = &view->nodes[node->children[i]];
-            destroy_view_tree_node(view, child);
+    // Breadth-first, appending the children of each node in the list as it is reached.
+    // This keeps the list ordered by level.
+    for (u32 view_index = 0; view_index < darray_length(out_view->nodes); ++view_index) {
+        u32 index = out_view->nodes[view_index].node_handle.handle_index;
+        for (u32 child = first_children[index]; child != INVALID_ID; child = next_siblings[child]) {
+            u32 child_view_index = hierarchy_node_create(out_view, graph->node_handles[child], graph->xform_handles[child], view_index);
+            graph->levels[child] = graph->levels[index] + 1;
+
+            // NOTE: Creating the node may move the array, so the parent must be looked up again.
+            hierarchy_graph_view_node* parent = &out_view->nodes[view_index];
+            if (!parent->children) {
+                parent->children = darray_create(u32);
+            }
+            darray_push(parent->children, child_view_index);
         }
-        darray_destroy(node->children);
     }
+
+    kfree(first_children, sizeof(u32) * node_count * 2, MEMORY_TAG_ARRAY);
 }
 
 static void destroy_view_tree(hierarchy_graph* graph, hierarchy_graph_view* view) {
@@ -415,69 +467,47 @@ static void destroy_view_tree(hierarchy_graph* graph, hierarchy_graph_view* view
         return;
     }
 
-    if (view->root_indices) {
-        u32 root_count = darray_length(view->root_indices);
-
-        for (u32 i = 0; i < root_count; ++i) {
-            hierarchy_graph_view_node* root = &view->nodes[view->root_indices[i]];
-            destroy_view_tree_node(view, root);
+    if (view->nodes) {
+        u32 node_count = darray_length(view->nodes);
+        for (u32 i = 0; i < node_count; ++i) {
+            if (view->nodes[i].children) {
+                darray_destroy(view->nodes[i].children);
+            }
         }
 
+        darray_destroy(view->nodes);
+        view->nodes = 0;
+    }
+
+    if (view->root_indices) {
         darray_destroy(view->root_indices);
         view->root_indices = 0;
     }
 }
 
-static void hierarchy_graph_update_tree_view_node(hierarchy_graph* graph, u32 node_index) {
-    if (node_index == INVALID_ID) {
-        return;
-    }
-
-    hierarchy_graph_view_node* node = &graph->view.nodes[node_index];
+// Updates the dirty state of the node, returning true if its xform needs its world matrix updated.
+static b8 hierarchy_graph_update_view_node(hierarchy_graph* graph, hierarchy_graph_view_node* node) {
+    u32 index = node->node_handle.handle_index;
 
-    if (khandle_is_invalid(node->xform_handle)) {
-        return;
+    // A node is dirty if it was flagged as such (i.e. newly added or moved), or if its parent is.
+    b8 dirty = graph->dirty_flags[index];
+    if (!dirty && node->parent_index != INVALID_ID) {
+        dirty = graph->dirty_flags[graph->view.nodes[node->parent_index].node_handle.handle_index];
     }
 
-    // Update the local matrix.
-    // TODO: check if dirty
-    xform_calculate_local(node->xform_handle);
-    mat4 node_local = xform_local_get(node->xform_handle);
-
-    // Calculate and assign world matrix.
-    mat4 world;
-    if (node->parent_index != INVALID_ID) {
-        hierarchy_graph_view_node* parent = &graph->view.nodes[node->parent_index];
-        khandle parent_xform_handle = parent->xform_handle;
-        while (khandle_is_invalid(parent_xform_handle)) {
-            u32 parent_index = parent->parent_index;
-            parent = &graph->view.nodes[parent_index];
-            if (parent) {
-                parent_xform_handle = parent->xform_handle;
-            } else {
-                parent_xform_handle = khandle_invalid();
-                break;
-            }
-        }
-        if (khandle_is_invalid(parent_xform_handle)) {
-            // There is no parent with a transform anywhere up the tree. Just use local.
-            world = node_local;
-        } else {
-            mat4 parent_world = xform_world_get(parent_xform_handle);
-            world = mat4_mul(node_local, parent_world);
+    b8 has_xform = !khandle_is_invalid(node->xform_handle);
+    if (has_xform) {
+        // Also dirty if the xform itself has changed since the last update.
+        u32 version = xform_local_version_get(node->xform_handle);
+        if (version != graph->xform_versions[index]) {
+            graph->xform_versions[index] = version;
+            dirty = true;
         }
-    } else {
-        world = node_local;
     }
-    xform_world_set(node->xform_handle, world);
 
-    if (node->children) {
-        u32 child_count = darray_length(node->children);
-        for (u32 i = 0; i < child_count; ++i) {
-            // Proces children based off world matrix of this node.
-            hierarchy_graph_update_tree_view_node(graph, node->children[i]);
-        }
-    }
+    // Children of this node will see this.
+    graph->dirty_flags[index] = dirty;
+    return dirty && has_xform;
 }
 
 static u32 hierarchy_graph_parent_index_get(const hierarchy_graph* graph, khandle node_handle) {
@@ -3,16 +3,17 @@
  * hierarchy. This is managed instead by this graph. The graph then calls to the
  * xform to recalculate based on values it passes.
  *
- * In the update of the graph, the graph is traversed from each root, and recursively updates
- * down the tree. Along the way, the graph reaches out to to the xform system and provides the
- * "parent" (if there is one) and caches that result instead.
- *
- * The steps of this update would be:
- * - Build up a list of dirty nodes.
- * - Mark all of the children of those nodes, recursively, as dirty.
- * - Traverse the graph, starting at roots, and store the result of parent*local as the cached matrix
- *   for that node.
- * - Reset the dirty list.
+ * The graph keeps a flattened view of the tree, ordered by level so that every parent comes
+ * before its children. The view is only rebuilt when the structure of the graph changes (i.e. a
+ * node is added or removed).
+ *
+ * The steps of an update are:
+ * - Rebuild the view if the structure changed. Only nodes that were added, or whose parent was
+ *   released, are flagged as dirty; the rest keep their world matrices.
+ * - Walk the view in order. A node is dirty if it was marked as such, if its parent is dirty, or if
+ *   its xform's local version differs from the one seen last update.
+ * - For dirty nodes only, store the result of local*parent world as the world matrix of its xform.
+ * - Reset the dirty flags.
  */
 
 #ifndef _XFORM_GRAPH_H_
@@ -30,12 +31,15 @@ typedef struct hierarchy_graph_view_node {
     // An index into the view's nodes array. INVALID_ID if no parent.
     u32 parent_index;
 
+    // An index into the view's nodes array of the nearest ancestor with an xform. INVALID_ID if there is none.
+    u32 xform_parent_index;
+
     // darray An array of indices into the view's nodes array.
     u32* children;
 } hierarchy_graph_view_node;
 
 typedef struct hierarchy_graph_view {
-    // darray A collective list of all view nodes.
+    // darray A collective list of all view nodes, ordered by level. Parents always come before their children.
     hierarchy_graph_view_node* nodes;
     // darray An array of indices into the nodes array.
     u32* root_indices;
@@ -59,6 +63,10 @@ typedef struct hierarchy_graph {
     u8* levels;
     // Flags to mark the node as dirty.
     b8* dirty_flags;
+    // The local version of each node's xform as of the last update.
+    u32* xform_versions;
+    // Indicates that nodes have been added or removed since the view was last built.
+    b8 structure_dirty;
 
     // Handles to the transforms.
     // NOTE: This can be an invalid handle, meaning that this node
@@ -88,8 +96,9 @@ KAPI b8 hierarchy_graph_create(hierarchy_graph* out_graph);
 KAPI void hierarchy_graph_destroy(hierarchy_graph* graph);
 
 /**
- * @brief Performs internal update routines on the hierarchy, which includes rebuilding
- * the internal view tree.
+ * @brief Performs internal update routines on the hierarchy. Rebuilds the internal view
+ * tree if nodes were added or removed, then updates world matrices of nodes whose xform
+ * or an ancestor's xform has changed.
  *
  * @param graph A pointer to the graph to update.
  */
@@ -109,6 +109,8 @@ static void asset_to_resource(const kasset_heightmap_terrain* asset, kresource_h
     out_heightmap_terrain_resource->material_count = asset->material_count;
     out_heightmap_terrain_resource->material_names = KALLOC_TYPE_CARRAY(kname, asset->material_count);
     KCOPY_TYPE_CARRAY(out_heightmap_terrain_resource->material_names, asset->material_names, kname, asset->material_count);
+    out_heightmap_terrain_resource->use_quadtree = asset->use_quadtree;
+    out_heightmap_terrain_resource->memory_budget_mb = asset->memory_budget_mb;
 
     out_heightmap_terrain_resource->base.state = KRESOURCE_STATE_LOADED;
 }
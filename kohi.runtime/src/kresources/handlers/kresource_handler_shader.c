@@ -137,6 +137,7 @@ static void asset_to_resource(const kasset_shader* asset, kresource_shader* out_
         config->type = a->type;
         config->size = size_from_shader_attribute_type(a->type);
         config->name = kname_create(a->name);
+        config->per_instance = a->per_instance;
     }
 
     // Uniforms
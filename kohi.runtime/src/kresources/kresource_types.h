@@ -468,6 +468,8 @@ typedef struct kresource_heightmap_terrain {
     vec3 tile_scale;
     u8 material_count;
     kname* material_names;
+    b8 use_quadtree;
+    u32 memory_budget_mb;
 } kresource_heightmap_terrain;
 
 typedef struct kresource_heightmap_terrain_request_info {
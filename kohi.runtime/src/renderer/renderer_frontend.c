@@ -23,6 +23,21 @@
 #include "strings/kstring.h"
 #include "systems/plugin_system.h"
 #include "systems/texture_system.h"
+#include "threads/kmutex.h"
+
+// A host-visible buffer split into one region per frame in flight. Each frame's region is
+// filled linearly, so data written this frame never overwrites data still in use.
+typedef struct renderer_per_frame_buffer {
+    renderbuffer buffer;
+    // The size of each region in bytes.
+    u64 region_size;
+    // The index of the current frame's region.
+    u32 region_index;
+    // The number of bytes written to the current frame's region.
+    u64 region_used;
+    // Guards writes, since node command lists may be recorded on several threads at once.
+    kmutex lock;
+} renderer_per_frame_buffer;
 
 typedef struct renderer_dynamic_state {
     vec4 viewport;
@@ -45,11 +60,16 @@ typedef struct renderer_dynamic_state {
     renderer_cull_mode cull_mode;
 } renderer_dynamic_state;
 
+// State tracked while recording a command list. There is one for the frame command list
+// and one per node command list, so nodes recorded on different threads don't share it.
+typedef struct renderer_recording_state {
+    struct viewport* active_viewport;
+    renderer_dynamic_state dynamic_state;
+} renderer_recording_state;
+
 typedef struct renderer_system_state {
     /** @brief The current frame number. Rolls over about every 18 minutes at 60FPS. */
     u16 frame_number;
-    /** @brief The viewport information for the given window. */
-    struct viewport* active_viewport;
 
     /** @brief The actual loaded plugin obtained from the plugin system. */
     kruntime_plugin* backend_plugin;
@@ -65,6 +85,10 @@ typedef struct renderer_system_state {
     renderbuffer geometry_vertex_buffer;
     /** @brief The object index buffer, used to hold geometry indices. */
     renderbuffer geometry_index_buffer;
+    /** @brief Holds per-instance data for instanced draws. Rewritten every frame. */
+    renderer_per_frame_buffer instance_buffer;
+    /** @brief Holds commands for indirect draws. Rewritten every frame. */
+    renderer_per_frame_buffer indirect_buffer;
 
     /**
      * @brief A darray of pointers to renderbuffers that are considered "registered". These are
@@ -77,8 +101,10 @@ typedef struct renderer_system_state {
     /** @brief Use PCF filtering */
     b8 use_pcf;
 
-    /** @brief Current dynamic state settings. */
-    renderer_dynamic_state dynamic_state;
+    /** @brief Recording state (active viewport and dynamic state) of the frame command list. */
+    renderer_recording_state frame_recording;
+    /** @brief Recording state of each node command list. */
+    renderer_recording_state node_recording[RENDERER_MAX_NODE_COMMAND_LISTS];
     /** @brief Frame defaults - dynamic state settings that are reapplied at the beginning of every frame. */
     renderer_dynamic_state frame_default_dynamic_state;
 
@@ -89,7 +115,16 @@ typedef struct renderer_system_state {
     khandle default_textures[RENDERER_DEFAULT_TEXTURE_COUNT];
 } renderer_system_state;
 
+// The recording state of the node command list being recorded on this thread, if any.
+static KTHREAD_LOCAL renderer_recording_state* thread_node_recording = 0;
+
+static renderer_recording_state* recording_state_get(renderer_system_state* state);
 static void reapply_dynamic_state(renderer_system_state* state, const renderer_dynamic_state* dynamic_state);
+static b8 per_frame_buffer_create(const char* name, renderbuffer_type type, u64 region_size, renderer_per_frame_buffer* out_buffer);
+static void per_frame_buffer_destroy(renderer_per_frame_buffer* buffer);
+static b8 renderbuffer_freelist_resize(renderbuffer* buffer, u64 new_total_size);
+static void per_frame_buffer_advance(renderer_per_frame_buffer* buffer);
+static b8 per_frame_buffer_write(renderer_per_frame_buffer* buffer, u64 size, const void* data, u64* out_offset);
 
 b8 renderer_system_deserialize_config(const char* config_str, renderer_system_config* out_config) {
     if (!config_str || !out_config) {
@@ -176,7 +211,7 @@ b8 renderer_system_initialize(u64* memory_requirement, renderer_system_state* st
     state->backend->frontend_state = state;
 
     state->frame_number = 0;
-    state->active_viewport = 0;
+    state->frame_recording.active_viewport = 0;
 
     // FIXME: Have the backend query the frontend for these properties instead.
     renderer_backend_config renderer_config = {};
@@ -240,22 +275,22 @@ b8 renderer_system_initialize(u64* memory_requirement, renderer_system_state* st
     }
 
     // Default dynamic state settings.
-    state->dynamic_state.viewport = (vec4){0, 0, 1280, 720};
-    state->dynamic_state.scissor = (vec4){0, 0, 1280, 720};
-    state->dynamic_state.depth_test_enabled = true;
-    state->dynamic_state.depth_write_enabled = true;
-    state->dynamic_state.stencil_test_enabled = false;
-    state->dynamic_state.stencil_reference = 0;
-    state->dynamic_state.stencil_write_mask = 0;
-    state->dynamic_state.fail_op = RENDERER_STENCIL_OP_KEEP;
-    state->dynamic_state.pass_op = RENDERER_STENCIL_OP_REPLACE;
-    state->dynamic_state.depth_fail_op = RENDERER_STENCIL_OP_KEEP;
-    state->dynamic_state.compare_op = RENDERER_COMPARE_OP_ALWAYS;
-    state->dynamic_state.winding = RENDERER_WINDING_COUNTER_CLOCKWISE;
-    state->dynamic_state.cull_mode = RENDERER_CULL_MODE_NONE;
+    state->frame_recording.dynamic_state.viewport = (vec4){0, 0, 1280, 720};
+    state->frame_recording.dynamic_state.scissor = (vec4){0, 0, 1280, 720};
+    state->frame_recording.dynamic_state.depth_test_enabled = true;
+    state->frame_recording.dynamic_state.depth_write_enabled = true;
+    state->frame_recording.dynamic_state.stencil_test_enabled = false;
+    state->frame_recording.dynamic_state.stencil_reference = 0;
+    state->frame_recording.dynamic_state.stencil_write_mask = 0;
+    state->frame_recording.dynamic_state.fail_op = RENDERER_STENCIL_OP_KEEP;
+    state->frame_recording.dynamic_state.pass_op = RENDERER_STENCIL_OP_REPLACE;
+    state->frame_recording.dynamic_state.depth_fail_op = RENDERER_STENCIL_OP_KEEP;
+    state->frame_recording.dynamic_state.compare_op = RENDERER_COMPARE_OP_ALWAYS;
+    state->frame_recording.dynamic_state.winding = RENDERER_WINDING_COUNTER_CLOCKWISE;
+    state->frame_recording.dynamic_state.cull_mode = RENDERER_CULL_MODE_NONE;
 
     // Take a copy as the frame default.
-    state->frame_default_dynamic_state = state->dynamic_state;
+    state->frame_default_dynamic_state = state->frame_recording.dynamic_state;
 
     // Setup a default-sized array to hold registered renderbuffers.
     state->registered_renderbuffers = darray_reserve(renderbuffer*, 50);
@@ -278,6 +313,16 @@ b8 renderer_system_initialize(u64* memory_requirement, renderer_system_state* st
     }
     renderer_renderbuffer_bind(&state->geometry_index_buffer, 0);
 
+    // Instance and indirect buffers, one region per frame in flight.
+    if (!per_frame_buffer_create("renderbuffer_instancebuffer_global", RENDERBUFFER_TYPE_INSTANCE, RENDERER_INSTANCE_REGION_SIZE, &state->instance_buffer)) {
+        KERROR("Error creating instance buffer.");
+        return false;
+    }
+    if (!per_frame_buffer_create("renderbuffer_indirectbuffer_global", RENDERBUFFER_TYPE_INDIRECT, RENDERER_INDIRECT_REGION_SIZE, &state->indirect_buffer)) {
+        KERROR("Error creating indirect buffer.");
+        return false;
+    }
+
     return true;
 }
 
@@ -290,6 +335,8 @@ void renderer_system_shutdown(renderer_system_state* state) {
         // Destroy buffers.
         renderer_renderbuffer_destroy(&typed_state->geometry_vertex_buffer);
         renderer_renderbuffer_destroy(&typed_state->geometry_index_buffer);
+        per_frame_buffer_destroy(&typed_state->instance_buffer);
+        per_frame_buffer_destroy(&typed_state->indirect_buffer);
 
         // Destroy generic samplers.
         for (u32 i = 0; i < SHADER_GENERIC_SAMPLER_COUNT; ++i) {
@@ -386,6 +433,10 @@ b8 renderer_frame_prepare(struct renderer_system_state* state, struct frame_data
     // This always occurs no matter what, even if a frame doesn't wind up rendering.
     state->frame_number++;
 
+    // Move on to the next region of per-frame buffers.
+    per_frame_buffer_advance(&state->instance_buffer);
+    per_frame_buffer_advance(&state->indirect_buffer);
+
     return state->backend->frame_prepare(state->backend, p_frame_data);
 }
 
@@ -415,6 +466,10 @@ b8 renderer_frame_command_list_begin(struct renderer_system_state* state, struct
                         // If there is a size, then this needs deletion. If there isn't, it's already deleted.
                         switch (pr->track_type) {
                         case RENDERBUFFER_TRACK_TYPE_FREELIST: {
+                            // Make room to track another free range if needed.
+                            if (freelist_should_grow(&pr->buffer_freelist)) {
+                                renderbuffer_freelist_resize(pr, pr->total_size);
+                            }
                             if (!freelist_free_block(&pr->buffer_freelist, q->range.size, q->range.offset)) {
                                 // If this fails, something may be wrong. Throw an error and skip for now.
                                 // If the issue persists, it's likely something went terribly wrong.
@@ -456,6 +511,35 @@ b8 renderer_frame_command_list_end(struct renderer_system_state* state, struct f
     return state->backend->frame_commands_end(state->backend, p_frame_data);
 }
 
+b8 renderer_node_command_list_begin(struct renderer_system_state* state, u32 slot, struct frame_data* p_frame_data) {
+    KASSERT_MSG(slot < RENDERER_MAX_NODE_COMMAND_LISTS, "renderer_node_command_list_begin slot out of range.");
+
+    if (!state->backend->node_commands_begin(state->backend, slot, p_frame_data)) {
+        return false;
+    }
+
+    // Nodes start with the frame's active viewport and the frame defaults, no matter what
+    // was recorded before them.
+    renderer_recording_state* recording = &state->node_recording[slot];
+    recording->active_viewport = state->frame_recording.active_viewport;
+    thread_node_recording = recording;
+    reapply_dynamic_state(state, &state->frame_default_dynamic_state);
+
+    return true;
+}
+
+b8 renderer_node_command_list_end(struct renderer_system_state* state, u32 slot, struct frame_data* p_frame_data) {
+    thread_node_recording = 0;
+    return state->backend->node_commands_end(state->backend, slot, p_frame_data);
+}
+
+b8 renderer_node_command_lists_execute(struct renderer_system_state* state, u32 slot_count, const u32* slots, struct frame_data* p_frame_data) {
+    if (!slot_count) {
+        return true;
+    }
+    return state->backend->node_commands_execute(state->backend, slot_count, slots, p_frame_data);
+}
+
 b8 renderer_frame_submit(struct renderer_system_state* state, struct frame_data* p_frame_data) {
     return state->backend->frame_submit(state->backend, p_frame_data);
 }
@@ -468,7 +552,7 @@ b8 renderer_frame_present(struct renderer_system_state* state, struct kwindow* w
 
 void renderer_viewport_set(vec4 rect) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.viewport = rect;
+    recording_state_get(state_ptr)->dynamic_state.viewport = rect;
     state_ptr->backend->viewport_set(state_ptr->backend, rect);
 }
 
@@ -479,7 +563,7 @@ void renderer_viewport_reset(void) {
 
 void renderer_scissor_set(vec4 rect) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.scissor = rect;
+    recording_state_get(state_ptr)->dynamic_state.scissor = rect;
     state_ptr->backend->scissor_set(state_ptr->backend, rect);
 }
 
@@ -490,48 +574,49 @@ void renderer_scissor_reset(void) {
 
 void renderer_winding_set(renderer_winding winding) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.winding = winding;
+    recording_state_get(state_ptr)->dynamic_state.winding = winding;
     state_ptr->backend->winding_set(state_ptr->backend, winding);
 }
 
 void renderer_cull_mode_set(renderer_cull_mode cull_mode) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.cull_mode = cull_mode;
+    recording_state_get(state_ptr)->dynamic_state.cull_mode = cull_mode;
     state_ptr->backend->cull_mode_set(state_ptr->backend, cull_mode);
 }
 
 void renderer_set_stencil_test_enabled(b8 enabled) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.stencil_test_enabled = enabled;
+    recording_state_get(state_ptr)->dynamic_state.stencil_test_enabled = enabled;
     state_ptr->backend->set_stencil_test_enabled(state_ptr->backend, enabled);
 }
 
 void renderer_set_stencil_reference(u32 reference) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.stencil_reference = reference;
+    recording_state_get(state_ptr)->dynamic_state.stencil_reference = reference;
     state_ptr->backend->set_stencil_reference(state_ptr->backend, reference);
 }
 
 void renderer_set_depth_test_enabled(b8 enabled) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.depth_test_enabled = enabled;
+    recording_state_get(state_ptr)->dynamic_state.depth_test_enabled = enabled;
     state_ptr->backend->set_depth_test_enabled(state_ptr->backend, enabled);
 }
 
 void renderer_set_depth_write_enabled(b8 enabled) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
     // Cache dynamic state.
-    state_ptr->dynamic_state.depth_write_enabled = enabled;
+    recording_state_get(state_ptr)->dynamic_state.depth_write_enabled = enabled;
     state_ptr->backend->set_depth_write_enabled(state_ptr->backend, enabled);
 }
 
 void renderer_set_stencil_op(renderer_stencil_op fail_op, renderer_stencil_op pass_op, renderer_stencil_op depth_fail_op, renderer_compare_op compare_op) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
     // Cache dynamic state.
-    state_ptr->dynamic_state.fail_op = fail_op;
-    state_ptr->dynamic_state.pass_op = pass_op;
-    state_ptr->dynamic_state.depth_fail_op = depth_fail_op;
-    state_ptr->dynamic_state.compare_op = compare_op;
+    renderer_dynamic_state* dynamic_state = &recording_state_get(state_ptr)->dynamic_state;
+    dynamic_state->fail_op = fail_op;
+    dynamic_state->pass_op = pass_op;
+    dynamic_state->depth_fail_op = depth_fail_op;
+    dynamic_state->compare_op = compare_op;
     state_ptr->backend->set_stencil_op(state_ptr->backend, fail_op, pass_op, depth_fail_op, compare_op);
 }
 
@@ -553,7 +638,7 @@ void renderer_begin_rendering(struct renderer_system_state* state, struct frame_
     state->backend->begin_rendering(state->backend, p_frame_data, render_area, colour_target_count, colour_targets, depth_stencil_target, depth_stencil_layer);
 
     // Dynamic state needs to be reapplied here in case the backend needs it.
-    reapply_dynamic_state(state, &state->dynamic_state);
+    reapply_dynamic_state(state, &recording_state_get(state)->dynamic_state);
 }
 
 void renderer_end_rendering(struct renderer_system_state* state, struct frame_data* p_frame_data) {
@@ -562,13 +647,13 @@ void renderer_end_rendering(struct renderer_system_state* state, struct frame_da
 
 void renderer_set_stencil_compare_mask(u32 compare_mask) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.stencil_compare_mask = compare_mask;
+    recording_state_get(state_ptr)->dynamic_state.stencil_compare_mask = compare_mask;
     state_ptr->backend->set_stencil_compare_mask(state_ptr->backend, compare_mask);
 }
 
 void renderer_set_stencil_write_mask(u32 write_mask) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->dynamic_state.stencil_write_mask = write_mask;
+    recording_state_get(state_ptr)->dynamic_state.stencil_write_mask = write_mask;
     state_ptr->backend->set_stencil_write_mask(state_ptr->backend, write_mask);
 }
 
@@ -765,21 +850,128 @@ void renderer_geometry_draw(geometry_render_data* data) {
     }
 }
 
-void renderer_clear_colour_set(struct renderer_system_state* state, vec4 colour) {
-    if (state) {
-        state->backend->clear_colour_set(state->backend, colour);
+b8 renderer_instance_data_write(struct renderer_system_state* state, u64 size, const void* data, u64* out_offset) {
+    if (!state || !data || !size || !out_offset) {
+        KERROR("renderer_instance_data_write requires a valid pointer to state, data and out_offset, and a nonzero size.");
+        return false;
     }
+
+    return per_frame_buffer_write(&state->instance_buffer, size, data, out_offset);
 }
 
-void renderer_clear_depth_set(struct renderer_system_state* state, f32 depth) {
-    if (state) {
-        state->backend->clear_depth_set(state->backend, depth);
+void renderer_geometry_draw_instanced(const geometry_render_data* data, u64 instance_offset, u32 instance_count) {
+    renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
+    if (!instance_count) {
+        return;
+    }
+
+    b8 includes_index_data = data->index_count > 0;
+    renderer_backend_interface* backend = state_ptr->backend;
+    if (includes_index_data) {
+        // Only bind the vertex buffer, the index buffer does the drawing.
+        if (!renderer_renderbuffer_draw(&state_ptr->geometry_vertex_buffer, data->vertex_buffer_offset, data->vertex_count, true)) {
+            KERROR("renderer_geometry_draw_instanced failed to bind vertex buffer.");
+            return;
+        }
+        if (!backend->renderbuffer_draw_instanced(backend, &state_ptr->geometry_index_buffer, data->index_buffer_offset, data->index_count, &state_ptr->instance_buffer.buffer, instance_offset, instance_count)) {
+            KERROR("renderer_geometry_draw_instanced failed to draw index buffer.");
+        }
+    } else {
+        if (!backend->renderbuffer_draw_instanced(backend, &state_ptr->geometry_vertex_buffer, data->vertex_buffer_offset, data->vertex_count, &state_ptr->instance_buffer.buffer, instance_offset, instance_count)) {
+            KERROR("renderer_geometry_draw_instanced failed to draw vertex buffer.");
+        }
+    }
+}
+
+b8 renderer_indirect_draw_supported(struct renderer_system_state* state) {
+    return state && state->backend->indirect_draw_supported(state->backend);
+}
+
+b8 renderer_indirect_command_from_geometry(const geometry_render_data* data, u32 first_instance, u32 instance_count, renderer_indexed_indirect_command* out_command) {
+    if (!data || !out_command) {
+        return false;
+    }
+
+    // Commands address vertices and indices in elements, so non-indexed geometry and
+    // geometry not starting on an element boundary can't be expressed.
+    if (!data->index_count || !data->vertex_element_size || !data->index_element_size ||
+        data->vertex_buffer_offset % data->vertex_element_size ||
+        data->index_buffer_offset % data->index_element_size) {
+        return false;
+    }
+
+    out_command->index_count = data->index_count;
+    out_command->instance_count = instance_count;
+    out_command->first_index = (u32)(data->index_buffer_offset / data->index_element_size);
+    out_command->vertex_offset = (i32)(data->vertex_buffer_offset / data->vertex_element_size);
+    out_command->first_instance = first_instance;
+    return true;
+}
+
+b8 renderer_geometry_draw_indirect(struct renderer_system_state* state, u32 command_count, const renderer_indexed_indirect_command* commands, u64 instance_offset) {
+    if (!state || !commands) {
+        KERROR("renderer_geometry_draw_indirect requires a valid pointer to state and commands.");
+        return false;
+    }
+    if (!command_count) {
+        return true;
     }
+
+    u64 indirect_offset = 0;
+    if (!per_frame_buffer_write(&state->indirect_buffer, sizeof(renderer_indexed_indirect_command) * command_count, commands, &indirect_offset)) {
+        KERROR("renderer_geometry_draw_indirect failed to write draw commands.");
+        return false;
+    }
+
+    renderer_backend_interface* backend = state->backend;
+    return backend->renderbuffer_draw_indexed_indirect(
+        backend,
+        &state->indirect_buffer.buffer, indirect_offset, command_count,
+        &state->geometry_vertex_buffer, &state->geometry_index_buffer,
+        &state->instance_buffer.buffer, instance_offset);
 }
 
-void renderer_clear_stencil_set(struct renderer_system_state* state, u32 stencil) {
+b8 renderer_geometries_draw_indirect(struct renderer_system_state* state, u32 geometry_count, const geometry_render_data* geometries, u64 instance_offset, u32 instance_stride, u32 first_instance, struct frame_data* p_frame_data) {
+    if (!state || !geometries || !p_frame_data) {
+        KERROR("renderer_geometries_draw_indirect requires a valid pointer to state, geometries and p_frame_data.");
+        return false;
+    }
+    if (!geometry_count) {
+        return true;
+    }
+
+    renderer_indexed_indirect_command* commands = p_frame_data->allocator.allocate(sizeof(renderer_indexed_indirect_command) * geometry_count);
+    u32 command_count = 0;
+    for (u32 i = 0; i < geometry_count;) {
+        const geometry_render_data* g = &geometries[i];
+        // Without element sizes, indexed geometry can never become a command, and would silently always take the direct path.
+        KASSERT_MSG(!g->index_count || (g->vertex_element_size && g->index_element_size), "renderer_geometries_draw_indirect - indexed geometry must have vertex and index element sizes set.");
+
+        // Repeats of the same geometry become instances of one command.
+        u32 instance_count = 1;
+        while (i + instance_count < geometry_count &&
+               geometries[i + instance_count].vertex_buffer_offset == g->vertex_buffer_offset &&
+               geometries[i + instance_count].vertex_count == g->vertex_count &&
+               geometries[i + instance_count].index_buffer_offset == g->index_buffer_offset &&
+               geometries[i + instance_count].index_count == g->index_count) {
+            instance_count++;
+        }
+
+        if (renderer_indirect_command_from_geometry(g, first_instance + i, instance_count, &commands[command_count])) {
+            command_count++;
+        } else {
+            renderer_geometry_draw_instanced(g, instance_offset + ((u64)instance_stride * (first_instance + i)), instance_count);
+        }
+
+        i += instance_count;
+    }
+
+    return renderer_geometry_draw_indirect(state, command_count, commands, instance_offset);
+}
+
+void renderer_clear_colour_set(struct renderer_system_state* state, vec4 colour) {
     if (state) {
-        state->backend->clear_stencil_set(state->backend, stencil);
+        state->backend->clear_colour_set(state->backend, colour);
     }
 }
 
@@ -793,9 +985,9 @@ b8 renderer_clear_colour(struct renderer_system_state* state, khandle texture_ha
     return false;
 }
 
-b8 renderer_clear_depth_stencil(struct renderer_system_state* state, khandle texture_handle) {
+b8 renderer_clear_depth_stencil(struct renderer_system_state* state, khandle texture_handle, f32 depth, u32 stencil) {
     if (state && !khandle_is_invalid(texture_handle)) {
-        state->backend->clear_depth_stencil(state->backend, texture_handle);
+        state->backend->clear_depth_stencil(state->backend, texture_handle, depth, stencil);
         return true;
     }
 
@@ -821,6 +1013,16 @@ void renderer_texture_prepare_for_sampling(struct renderer_system_state* state,
     KERROR("renderer_texture_prepare_for_sampling requires a valid handle to a texture. Nothing was done.");
 }
 
+b8 renderer_texture_layer_copy(struct renderer_system_state* state, khandle source_handle, u32 source_layer, khandle dest_handle, u32 dest_layer) {
+    if (state && !khandle_is_invalid(source_handle) && !khandle_is_invalid(dest_handle)) {
+        state->backend->texture_layer_copy(state->backend, source_handle, source_layer, dest_handle, dest_layer);
+        return true;
+    }
+
+    KERROR("renderer_texture_layer_copy requires valid handles to source and destination textures. Nothing was done.");
+    return false;
+}
+
 b8 renderer_shader_create(struct renderer_system_state* state, khandle shader, const kresource_shader* shader_resource) {
     return state->backend->shader_create(state->backend, shader, shader_resource);
 }
@@ -959,9 +1161,10 @@ b8 renderer_renderbuffer_create(const char* name, renderbuffer_type type, u64 to
 
     // Create the freelist, if needed.
     if (track_type == RENDERBUFFER_TRACK_TYPE_FREELIST) {
-        freelist_create(total_size, &out_buffer->freelist_memory_requirement, 0, 0);
+        // TLSF keeps sub-allocation O(1) as long-lived buffers (i.e. geometry) fragment.
+        freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &out_buffer->freelist_memory_requirement, 0, 0);
         out_buffer->freelist_block = kallocate(out_buffer->freelist_memory_requirement, MEMORY_TAG_RENDERER);
-        freelist_create(total_size, &out_buffer->freelist_memory_requirement, out_buffer->freelist_block, &out_buffer->buffer_freelist);
+        freelist_create_with_mode(total_size, FREELIST_MODE_TLSF, &out_buffer->freelist_memory_requirement, out_buffer->freelist_block, &out_buffer->buffer_freelist);
     } else if (track_type == RENDERBUFFER_TRACK_TYPE_LINEAR) {
         out_buffer->offset = 0;
     }
@@ -1076,22 +1279,9 @@ b8 renderer_renderbuffer_resize(renderbuffer* buffer, u64 new_total_size) {
         return false;
     }
 
-    if (buffer->track_type == RENDERBUFFER_TRACK_TYPE_FREELIST) {
-        // Resize the freelist first, if used.
-        u64 new_memory_requirement = 0;
-        freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, 0, 0, 0);
-        void* new_block = kallocate(new_memory_requirement, MEMORY_TAG_RENDERER);
-        void* old_block = 0;
-        if (!freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, new_block, new_total_size, &old_block)) {
-            KERROR("renderer_renderbuffer_resize failed to resize internal free list.");
-            kfree(new_block, new_memory_requirement, MEMORY_TAG_RENDERER);
-            return false;
-        }
-
-        // Clean up the old memory, then assign the new properties over.
-        kfree(old_block, buffer->freelist_memory_requirement, MEMORY_TAG_RENDERER);
-        buffer->freelist_memory_requirement = new_memory_requirement;
-        buffer->freelist_block = new_block;
+    // Resize the freelist first, if used.
+    if (buffer->track_type == RENDERBUFFER_TRACK_TYPE_FREELIST && !renderbuffer_freelist_resize(buffer, new_total_size)) {
+        return false;
     }
 
     b8 result = state_ptr->backend->renderbuffer_resize(state_ptr->backend, buffer, new_total_size);
@@ -1205,7 +1395,7 @@ b8 renderer_renderbuffer_draw(renderbuffer* buffer, u64 offset, u32 element_coun
 
 void renderer_active_viewport_set(viewport* v) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    state_ptr->active_viewport = v;
+    recording_state_get(state_ptr)->active_viewport = v;
 
     // rect_2d viewport_rect = (vec4){v->rect.x, v->rect.height - v->rect.y, v->rect.width, -v->rect.height};
     rect_2d viewport_rect = (vec4){v->rect.x, v->rect.y + v->rect.height, v->rect.width, -v->rect.height};
@@ -1217,7 +1407,7 @@ void renderer_active_viewport_set(viewport* v) {
 
 viewport* renderer_active_viewport_get(void) {
     renderer_system_state* state_ptr = engine_systems_get()->renderer_system;
-    return state_ptr->active_viewport;
+    return recording_state_get(state_ptr)->active_viewport;
 }
 
 void renderer_wait_for_idle(void) {
@@ -1242,6 +1432,28 @@ u16 renderer_max_bound_sampler_count_get(struct renderer_system_state* state) {
     return 16;
 }
 
+static b8 renderbuffer_freelist_resize(renderbuffer* buffer, u64 new_total_size) {
+    u64 new_memory_requirement = 0;
+    freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, 0, new_total_size, 0);
+    void* new_block = kallocate(new_memory_requirement, MEMORY_TAG_RENDERER);
+    void* old_block = 0;
+    if (!freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, new_block, new_total_size, &old_block)) {
+        KERROR("renderer_renderbuffer_resize failed to resize internal free list.");
+        kfree(new_block, new_memory_requirement, MEMORY_TAG_RENDERER);
+        return false;
+    }
+
+    // Clean up the old memory, then assign the new properties over.
+    kfree(old_block, buffer->freelist_memory_requirement, MEMORY_TAG_RENDERER);
+    buffer->freelist_memory_requirement = new_memory_requirement;
+    buffer->freelist_block = new_block;
+    return true;
+}
+
+static renderer_recording_state* recording_state_get(renderer_system_state* state) {
+    return thread_node_recording ? thread_node_recording : &state->frame_recording;
+}
+
 static void reapply_dynamic_state(renderer_system_state* state, const renderer_dynamic_state* dynamic_state) {
     renderer_set_depth_test_enabled(dynamic_state->depth_test_enabled);
     renderer_set_depth_write_enabled(dynamic_state->depth_write_enabled);
@@ -1260,3 +1472,55 @@ static void reapply_dynamic_state(renderer_system_state* state, const renderer_d
     renderer_viewport_set(dynamic_state->viewport);
     renderer_scissor_set(dynamic_state->scissor);
 }
+
+static b8 per_frame_buffer_create(const char* name, renderbuffer_type type, u64 region_size, renderer_per_frame_buffer* out_buffer) {
+    if (!renderer_renderbuffer_create(name, type, region_size * RENDERER_PER_FRAME_REGION_COUNT, RENDERBUFFER_TRACK_TYPE_NONE, &out_buffer->buffer)) {
+        return false;
+    }
+    out_buffer->region_size = region_size;
+    out_buffer->region_index = 0;
+    out_buffer->region_used = 0;
+    if (!kmutex_create(&out_buffer->lock)) {
+        KERROR("Failed to create lock for per-frame buffer '%s'.", name);
+        return false;
+    }
+    return true;
+}
+
+static void per_frame_buffer_destroy(renderer_per_frame_buffer* buffer) {
+    renderer_renderbuffer_destroy(&buffer->buffer);
+    kmutex_destroy(&buffer->lock);
+}
+
+static void per_frame_buffer_advance(renderer_per_frame_buffer* buffer) {
+    // Only move on if the last frame wrote to its region. This way, frames that are skipped
+    // don't count towards the frames in flight a region must wait for before being reused.
+    if (buffer->region_used) {
+        buffer->region_index = (buffer->region_index + 1) % RENDERER_PER_FRAME_REGION_COUNT;
+        buffer->region_used = 0;
+    }
+}
+
+static b8 per_frame_buffer_write(renderer_per_frame_buffer* buffer, u64 size, const void* data, u64* out_offset) {
+    kmutex_lock(&buffer->lock);
+
+    if (buffer->region_used + size > buffer->region_size) {
+        KERROR("Out of space in per-frame buffer '%s' for this frame (%llu of %llu bytes used, %llu requested).",
+               buffer->buffer.name, buffer->region_used, buffer->region_size, size);
+        kmutex_unlock(&buffer->lock);
+        return false;
+    }
+
+    u64 offset = (buffer->region_size * buffer->region_index) + buffer->region_used;
+    if (!renderer_renderbuffer_load_range(&buffer->buffer, offset, size, data, false)) {
+        KERROR("Failed to write to per-frame buffer '%s'.", buffer->buffer.name);
+        kmutex_unlock(&buffer->lock);
+        return false;
+    }
+
+    buffer->region_used += size;
+    kmutex_unlock(&buffer->lock);
+
+    *out_offset = offset;
+    return true;
+}
@@ -39,6 +39,16 @@ struct shader_uniform;
 struct frame_data;
 struct viewport;
 
+/** @brief The number of bytes of per-instance data which may be written per frame. */
+#define RENDERER_INSTANCE_REGION_SIZE (sizeof(mat4) * 64 * 1024)
+/** @brief The number of bytes of indirect draw commands which may be written per frame. */
+#define RENDERER_INDIRECT_REGION_SIZE (sizeof(renderer_indexed_indirect_command) * 64 * 1024)
+/**
+ * @brief The number of regions per-frame buffers (i.e. instance and indirect buffers) are split
+ * into. Must be at least the maximum number of frames in flight.
+ */
+#define RENDERER_PER_FRAME_REGION_COUNT 3
+
 typedef struct renderer_system_config {
     const char* application_name;
     const char* backend_plugin_name;
@@ -136,6 +146,42 @@ KAPI b8 renderer_frame_command_list_begin(struct renderer_system_state* state, s
  */
 KAPI b8 renderer_frame_command_list_end(struct renderer_system_state* state, struct frame_data* p_frame_data);
 
+/**
+ * @brief Begins recording into a node command list. Until it is ended, everything recorded
+ * on the calling thread goes to that list, starting from the frame default dynamic state and
+ * the frame's active viewport. Different slots may be recorded on different threads at once.
+ * Only valid between the frame command list's begin and end, and only if the renderer is
+ * multithreaded.
+ *
+ * @param state A pointer to the renderer state.
+ * @param slot The index of the node command list. Must be less than RENDERER_MAX_NODE_COMMAND_LISTS.
+ * @param p_frame_data A pointer to the current frame's data.
+ * @return True if successful; otherwise false.
+ */
+KAPI b8 renderer_node_command_list_begin(struct renderer_system_state* state, u32 slot, struct frame_data* p_frame_data);
+
+/**
+ * @brief Ends recording into a node command list. Must be called on the thread which began it.
+ *
+ * @param state A pointer to the renderer state.
+ * @param slot The index of the node command list.
+ * @param p_frame_data A pointer to the current frame's data.
+ * @return True if successful; otherwise false.
+ */
+KAPI b8 renderer_node_command_list_end(struct renderer_system_state* state, u32 slot, struct frame_data* p_frame_data);
+
+/**
+ * @brief Executes the given node command lists as part of the frame command list, in the order given.
+ * Must be called on the thread recording the frame command list.
+ *
+ * @param state A pointer to the renderer state.
+ * @param slot_count The number of slots.
+ * @param slots An array of the slots to be executed.
+ * @param p_frame_data A pointer to the current frame's data.
+ * @return True if successful; otherwise false.
+ */
+KAPI b8 renderer_node_command_lists_execute(struct renderer_system_state* state, u32 slot_count, const u32* slots, struct frame_data* p_frame_data);
+
 KAPI b8 renderer_frame_submit(struct renderer_system_state* state, struct frame_data* p_frame_data);
 
 /**
@@ -393,28 +439,85 @@ KDEPRECATED("The renderer frontend geometry functions will be removed in a futur
 KAPI void renderer_geometry_draw(geometry_render_data* data);
 
 /**
- * @brief Sets the value to be used on the colour buffer clear.
+ * @brief Writes per-instance data for the current frame to the instance buffer.
+ * Data written is only valid until the end of the current frame.
  *
  * @param state A pointer to the renderer system state.
- * @param colour the RGBA colour to be used for the next clear operation. Each element is clamped to [0-1]
+ * @param size The size of the data in bytes.
+ * @param data A constant pointer to the data to be written.
+ * @param out_offset A pointer to hold the offset of the written data within the instance buffer.
+ * @return True on success; otherwise false (i.e. if the current frame has run out of instance buffer space).
  */
-KAPI void renderer_clear_colour_set(struct renderer_system_state* state, vec4 colour);
+KAPI b8 renderer_instance_data_write(struct renderer_system_state* state, u64 size, const void* data, u64* out_offset);
 
 /**
- * @brief Sets the value to be used on the depth buffer clear.
+ * @brief Draws the given geometry once per instance, sourcing per-instance attributes
+ * from the instance buffer at the given offset.
+ *
+ * @param data The render data of the geometry to be drawn.
+ * @param instance_offset The offset into the instance buffer, as obtained from renderer_instance_data_write().
+ * @param instance_count The number of instances to be drawn.
+ */
+KAPI void renderer_geometry_draw_instanced(const geometry_render_data* data, u64 instance_offset, u32 instance_count);
+
+/**
+ * @brief Indicates if indirect draws are supported by the renderer. If not,
+ * renderer_geometry_draw_indirect() should not be used.
  *
  * @param state A pointer to the renderer system state.
- * @param depth The depth value to be used for the next clear operation. Clamped to [0-1].
+ * @return True if supported; otherwise false.
+ */
+KAPI b8 renderer_indirect_draw_supported(struct renderer_system_state* state);
+
+/**
+ * @brief Fills out an indirect draw command for drawing the given geometry. Not all geometry can
+ * be drawn indirectly - it must be indexed, and its buffer offsets must be whole elements. Geometry
+ * which cannot should be drawn with renderer_geometry_draw_instanced() instead.
+ *
+ * @param data The render data of the geometry to be drawn.
+ * @param first_instance The index of the first instance, counted in instances from the instance data offset given when drawing.
+ * @param instance_count The number of instances to be drawn.
+ * @param out_command A pointer to hold the command.
+ * @return True if the geometry can be drawn indirectly; otherwise false.
  */
-KAPI void renderer_clear_depth_set(struct renderer_system_state* state, f32 depth);
+KAPI b8 renderer_indirect_command_from_geometry(const geometry_render_data* data, u32 first_instance, u32 instance_count, renderer_indexed_indirect_command* out_command);
 
 /**
- * @brief Sets the value to be used on the stencil buffer clear.
+ * @brief Draws the given indexed commands from the global geometry buffers, using as few draw
+ * calls as the backend allows. Commands are copied to the current frame's region of the indirect buffer.
  *
  * @param state A pointer to the renderer system state.
- * @param stencil The depth value to be used for the next clear operation.
+ * @param command_count The number of commands to be drawn.
+ * @param commands An array of commands to be drawn.
+ * @param instance_offset The offset into the instance buffer which the first instance of each command is counted from.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 renderer_geometry_draw_indirect(struct renderer_system_state* state, u32 command_count, const renderer_indexed_indirect_command* commands, u64 instance_offset);
+
+/**
+ * @brief Draws the given geometries with as few indirect draws as possible. Repeats of the same
+ * geometry next to each other become instances of one command. Geometry which cannot be drawn
+ * indirectly is drawn directly first, so this should only be used where draw order doesn't
+ * matter (i.e. opaque geometry). All geometries must be drawable with the currently bound state.
+ *
+ * @param state A pointer to the renderer system state.
+ * @param geometry_count The number of geometries to be drawn.
+ * @param geometries An array of geometries to be drawn.
+ * @param instance_offset The offset into the instance buffer of the per-instance data.
+ * @param instance_stride The size of the per-instance data of each geometry.
+ * @param first_instance The index of the per-instance data of the first geometry. Data for each geometry follows in order.
+ * @param p_frame_data A pointer to the current frame's data.
+ * @return True on success; otherwise false.
  */
-KAPI void renderer_clear_stencil_set(struct renderer_system_state* state, u32 stencil);
+KAPI b8 renderer_geometries_draw_indirect(struct renderer_system_state* state, u32 geometry_count, const geometry_render_data* geometries, u64 instance_offset, u32 instance_stride, u32 first_instance, struct frame_data* p_frame_data);
+
+/**
+ * @brief Sets the value to be used on the colour buffer clear.
+ *
+ * @param state A pointer to the renderer system state.
+ * @param colour the RGBA colour to be used for the next clear operation. Each element is clamped to [0-1]
+ */
+KAPI void renderer_clear_colour_set(struct renderer_system_state* state, vec4 colour);
 
 /**
  * @brief Clears the colour buffer using the previously set clear colour.
@@ -426,13 +529,17 @@ KAPI void renderer_clear_stencil_set(struct renderer_system_state* state, u32 st
 KAPI b8 renderer_clear_colour(struct renderer_system_state* state, khandle texture_handle);
 
 /**
- * @brief Clears the depth/stencil buffer using the previously set clear values.
+ * @brief Clears the depth/stencil buffer using the given values. These are passed with the
+ * clear rather than set beforehand, so nodes recording on different threads can't affect
+ * each other's clears.
  *
  * @param state A pointer to the renderer system state.
  * @param texture_handle A handle to the texture to clear.
+ * @param depth The depth value to clear to. Clamped to [0-1].
+ * @param stencil The stencil value to clear to.
  * @returns True if successful; otherwise false.
  */
-KAPI b8 renderer_clear_depth_stencil(struct renderer_system_state* state, khandle texture_handle);
+KAPI b8 renderer_clear_depth_stencil(struct renderer_system_state* state, khandle texture_handle, f32 depth, u32 stencil);
 
 /**
  * @brief Performs operations required on the supplied colour texture before presentation.
@@ -451,6 +558,21 @@ KAPI void renderer_colour_texture_prepare_for_present(struct renderer_system_sta
  */
 KAPI void renderer_texture_prepare_for_sampling(struct renderer_system_state* state, khandle texture_handle, texture_flag_bits flags);
 
+/**
+ * @brief Copies one layer of a texture into one layer of another texture of the same size and format.
+ * Must not be called during rendering. Both textures are expected to be in the layout they are
+ * rendered to in (as after a clear or render), and are left that way. The destination layer is
+ * overwritten entirely.
+ *
+ * @param state A pointer to the renderer system state.
+ * @param source_handle A handle to the texture to copy from.
+ * @param source_layer The layer to copy from.
+ * @param dest_handle A handle to the texture to copy to.
+ * @param dest_layer The layer to copy to.
+ * @returns True if successful; otherwise false.
+ */
+KAPI b8 renderer_texture_layer_copy(struct renderer_system_state* state, khandle source_handle, u32 source_layer, khandle dest_handle, u32 dest_layer);
+
 /**
  * @brief Creates internal shader resources using the provided parameters.
  *
@@ -806,7 +928,8 @@ KAPI b8 renderer_renderbuffer_resize(renderbuffer* buffer, u64 new_total_size);
 KAPI b8 renderer_renderbuffer_allocate(renderbuffer* buffer, u64 size, u64* out_offset);
 
 /**
- * @brief Frees memory from the given buffer.
+ * @brief Frees memory from the given buffer. The range is only released for reuse once
+ * RENDERER_MAX_FRAME_COUNT frames have passed, so frames in flight may keep reading it.
  *
  * @param buffer A pointer to the buffer to be freed from.
  * @param size The size in bytes to free.
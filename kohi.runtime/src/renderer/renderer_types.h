@@ -22,6 +22,10 @@ struct kwindow_renderer_backend_state;
 // this must be always taken into account.
 #define RENDERER_MAX_FRAME_COUNT 3
 
+// The max number of node command lists which may be recorded in a single frame.
+// Each rendergraph node recorded separately uses one.
+#define RENDERER_MAX_NODE_COMMAND_LISTS 32
+
 typedef struct renderbuffer_data {
     /** @brief The element count. */
     u32 element_count;
@@ -63,6 +67,23 @@ typedef struct geometry_render_data {
     u32 ibl_probe_index;
 } geometry_render_data;
 
+/**
+ * @brief A single indexed draw, to be read by the GPU from an indirect buffer.
+ * Laid out to match what graphics APIs expect (i.e. VkDrawIndexedIndirectCommand).
+ */
+typedef struct renderer_indexed_indirect_command {
+    /** @brief The number of indices to draw. */
+    u32 index_count;
+    /** @brief The number of instances to draw. */
+    u32 instance_count;
+    /** @brief The first index to draw, in elements from the start of the index buffer. */
+    u32 first_index;
+    /** @brief Added to each index before fetching vertices, in elements from the start of the vertex buffer. */
+    i32 vertex_offset;
+    /** @brief The first instance to draw, in elements from the instance data offset. */
+    u32 first_instance;
+} renderer_indexed_indirect_command;
+
 typedef enum renderer_debug_view_mode {
     RENDERER_VIEW_MODE_DEFAULT = 0,
     RENDERER_VIEW_MODE_LIGHTING = 1,
@@ -160,7 +181,11 @@ typedef enum renderbuffer_type {
     /** @brief Buffer is used for reading purposes (i.e copy to from device local, then read) */
     RENDERBUFFER_TYPE_READ,
     /** @brief Buffer is used for data storage. */
-    RENDERBUFFER_TYPE_STORAGE
+    RENDERBUFFER_TYPE_STORAGE,
+    /** @brief Buffer is used for per-instance vertex data, written by the host every frame. */
+    RENDERBUFFER_TYPE_INSTANCE,
+    /** @brief Buffer is used for indirect draw commands, written by the host every frame. */
+    RENDERBUFFER_TYPE_INDIRECT
 } renderbuffer_type;
 
 typedef enum renderbuffer_track_type {
@@ -341,6 +366,41 @@ typedef struct renderer_backend_interface {
 
     b8 (*frame_commands_end)(struct renderer_backend_interface* backend, struct frame_data* p_frame_data);
 
+    /**
+     * @brief Begins recording into the node command list in the given slot. Until it is ended,
+     * all commands recorded on the calling thread go to this list instead of the frame's. May
+     * be called from any thread, as long as no two threads use the same slot at once.
+     *
+     * @param backend A pointer to the renderer backend interface.
+     * @param slot The index of the node command list. Must be less than RENDERER_MAX_NODE_COMMAND_LISTS.
+     * @param p_frame_data A pointer to the current frame's data.
+     * @return True on success; otherwise false.
+     */
+    b8 (*node_commands_begin)(struct renderer_backend_interface* backend, u32 slot, struct frame_data* p_frame_data);
+
+    /**
+     * @brief Ends recording into the node command list in the given slot. Must be called on
+     * the same thread which began it.
+     *
+     * @param backend A pointer to the renderer backend interface.
+     * @param slot The index of the node command list.
+     * @param p_frame_data A pointer to the current frame's data.
+     * @return True on success; otherwise false.
+     */
+    b8 (*node_commands_end)(struct renderer_backend_interface* backend, u32 slot, struct frame_data* p_frame_data);
+
+    /**
+     * @brief Records execution of the given (ended) node command lists into the frame's
+     * command list, in the order given.
+     *
+     * @param backend A pointer to the renderer backend interface.
+     * @param slot_count The number of slots.
+     * @param slots An array of the slots to be executed.
+     * @param p_frame_data A pointer to the current frame's data.
+     * @return True on success; otherwise false.
+     */
+    b8 (*node_commands_execute)(struct renderer_backend_interface* backend, u32 slot_count, const u32* slots, struct frame_data* p_frame_data);
+
     b8 (*frame_submit)(struct renderer_backend_interface* backend, struct frame_data* p_frame_data);
     b8 (*frame_present)(struct renderer_backend_interface* backend, struct kwindow* window, struct frame_data* p_frame_data);
 
@@ -453,13 +513,22 @@ typedef struct renderer_backend_interface {
     void (*set_stencil_write_mask)(struct renderer_backend_interface* backend, u32 write_mask);
 
     void (*clear_colour_set)(struct renderer_backend_interface* backend, vec4 clear_colour);
-    void (*clear_depth_set)(struct renderer_backend_interface* backend, f32 depth);
-    void (*clear_stencil_set)(struct renderer_backend_interface* backend, u32 stencil);
     void (*clear_colour)(struct renderer_backend_interface* backend, khandle renderer_texture_handle);
-    void (*clear_depth_stencil)(struct renderer_backend_interface* backend, khandle renderer_texture_handle);
+    void (*clear_depth_stencil)(struct renderer_backend_interface* backend, khandle renderer_texture_handle, f32 depth, u32 stencil);
     void (*colour_texture_prepare_for_present)(struct renderer_backend_interface* backend, khandle renderer_texture_handle);
     void (*texture_prepare_for_sampling)(struct renderer_backend_interface* backend, khandle renderer_texture_handle, texture_flag_bits flags);
 
+    /**
+     * @brief Copies one layer of a texture into one layer of another texture of the same size and format.
+     *
+     * @param backend A pointer to the renderer backend interface.
+     * @param source_handle A handle to the texture to copy from.
+     * @param source_layer The layer to copy from.
+     * @param dest_handle A handle to the texture to copy to.
+     * @param dest_layer The layer to copy to.
+     */
+    void (*texture_layer_copy)(struct renderer_backend_interface* backend, khandle source_handle, u32 source_layer, khandle dest_handle, u32 dest_layer);
+
     b8 (*texture_resources_acquire)(struct renderer_backend_interface* backend, const char* name, texture_type type, u32 width, u32 height, u8 channel_count, u8 mip_levels, u16 array_size, texture_flag_bits flags, khandle* out_renderer_texture_handle);
     void (*texture_resources_release)(struct renderer_backend_interface* backend, khandle* renderer_texture_handle);
 
@@ -769,6 +838,14 @@ typedef struct renderer_backend_interface {
      */
     f32 (*max_anisotropy_get)(struct renderer_backend_interface* backend);
 
+    /**
+     * @brief Indicates if indirect draws are supported, including using the first
+     * instance of each command to locate per-instance data.
+     *
+     * @param backend A pointer to the renderer backend interface.
+     */
+    b8 (*indirect_draw_supported)(struct renderer_backend_interface* backend);
+
     /**
      * @brief Creates and assigns the renderer-backend-specific buffer.
      *
@@ -899,6 +976,40 @@ typedef struct renderer_backend_interface {
      */
     b8 (*renderbuffer_draw)(struct renderer_backend_interface* backend, renderbuffer* buffer, u64 offset, u32 element_count, b8 bind_only);
 
+    /**
+     * @brief Attempts to draw the contents of the provided buffer at the given offset
+     * and element count once per instance, sourcing per-instance attributes from the
+     * given instance buffer. Only meant for use with vertex and index buffers. When
+     * drawing with an index buffer, the vertex buffer must already be bound.
+     *
+     * @param backend A pointer to the renderer backend interface.
+     * @param buffer A pointer to the buffer to be drawn.
+     * @param offset The offset in bytes from the beginning of the buffer.
+     * @param element_count The number of elements to be drawn.
+     * @param instance_buffer A pointer to the buffer holding per-instance data.
+     * @param instance_offset The offset in bytes from the beginning of the instance buffer.
+     * @param instance_count The number of instances to be drawn.
+     * @return True on success; otherwise false.
+     */
+    b8 (*renderbuffer_draw_instanced)(struct renderer_backend_interface* backend, renderbuffer* buffer, u64 offset, u32 element_count, renderbuffer* instance_buffer, u64 instance_offset, u32 instance_count);
+
+    /**
+     * @brief Draws the indexed draw commands held in the given indirect buffer, with as few
+     * calls as the backend is able to. Vertex and index buffers are bound at the start, so
+     * commands must address them in elements from there.
+     *
+     * @param backend A pointer to the renderer backend interface.
+     * @param indirect_buffer A pointer to the buffer holding the draw commands.
+     * @param indirect_offset The offset in bytes of the first command in the indirect buffer.
+     * @param draw_count The number of commands to draw.
+     * @param vertex_buffer A pointer to the vertex buffer to draw from.
+     * @param index_buffer A pointer to the index buffer to draw from.
+     * @param instance_buffer A pointer to the buffer holding per-instance data.
+     * @param instance_offset The offset in bytes from the beginning of the instance buffer.
+     * @return True on success; otherwise false.
+     */
+    b8 (*renderbuffer_draw_indexed_indirect)(struct renderer_backend_interface* backend, renderbuffer* indirect_buffer, u64 indirect_offset, u32 draw_count, renderbuffer* vertex_buffer, renderbuffer* index_buffer, renderbuffer* instance_buffer, u64 instance_offset);
+
     /**
      * Waits for the renderer backend to be completely idle of work before returning.
      * NOTE: This incurs a lot of overhead/waits, and should be used sparingly.
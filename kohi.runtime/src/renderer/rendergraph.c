@@ -9,6 +9,7 @@
 #include "parsers/kson_parser.h"
 #include "renderer/renderer_frontend.h"
 #include "strings/kstring.h"
+#include "systems/job_system.h"
 
 // Known node types
 #include "renderer/rendergraph_nodes/clear_colour_rendergraph_node.h"
@@ -323,11 +324,97 @@ b8 rendergraph_load_resources(rendergraph* graph) {
     return true;
 }
 
+typedef struct rendergraph_record_context {
+    rendergraph* graph;
+    struct renderer_system_state* renderer;
+    frame_data* p_frame_data;
+    // Positions in the execution list of the nodes to be recorded concurrently.
+    u32* positions;
+    // The result of recording each node, indexed by position in the execution list.
+    b8* results;
+} rendergraph_record_context;
+
+// Records the node at the given position in the execution list into the node command list of the same index.
+static b8 rendergraph_node_record(rendergraph* graph, struct renderer_system_state* renderer, u32 position, frame_data* p_frame_data) {
+    rendergraph_node* node = &graph->nodes[graph->execution_list[position]];
+    if (!renderer_node_command_list_begin(renderer, position, p_frame_data)) {
+        KERROR("Failed to begin command list for rendergraph node '%s'.", node->name);
+        return false;
+    }
+
+    b8 result = node->execute(node, p_frame_data);
+    if (!renderer_node_command_list_end(renderer, position, p_frame_data)) {
+        KERROR("Failed to end command list for rendergraph node '%s'.", node->name);
+        result = false;
+    }
+    return result;
+}
+
+static void rendergraph_node_record_range(u32 start, u32 end, void* context) {
+    rendergraph_record_context* record = context;
+    for (u32 i = start; i < end; ++i) {
+        u32 position = record->positions[i];
+        record->results[position] = rendergraph_node_record(record->graph, record->renderer, position, record->p_frame_data);
+    }
+}
+
+// Records each node into its own command list, with concurrent nodes recorded across job
+// threads, then executes the lists in the order of the execution list.
+static b8 rendergraph_execute_frame_multithreaded(rendergraph* graph, frame_data* p_frame_data) {
+    rendergraph_record_context record = {0};
+    record.graph = graph;
+    record.renderer = engine_systems_get()->renderer_system;
+    record.p_frame_data = p_frame_data;
+    record.positions = p_frame_data->allocator.allocate(sizeof(u32) * graph->node_count);
+    record.results = p_frame_data->allocator.allocate(sizeof(b8) * graph->node_count);
+    for (u32 i = 0; i < graph->node_count; ++i) {
+        record.results[i] = false;
+    }
+
+    // Walk the execution list in order. Each run of consecutive concurrent nodes is recorded across
+    // job threads, and the rest are recorded on this thread between runs. This way, any record-time
+    // state a non-concurrent node relies on (or leaves behind) is seen in graph order.
+    u32 position = 0;
+    while (position < graph->node_count) {
+        if (!graph->nodes[graph->execution_list[position]].concurrent_record) {
+            record.results[position] = rendergraph_node_record(graph, record.renderer, position, p_frame_data);
+            position++;
+            continue;
+        }
+
+        u32 concurrent_count = 0;
+        while (position < graph->node_count && graph->nodes[graph->execution_list[position]].concurrent_record) {
+            record.positions[concurrent_count] = position;
+            concurrent_count++;
+            position++;
+        }
+        job_system_parallel_for(concurrent_count, 1, rendergraph_node_record_range, &record);
+    }
+
+    // All lists are ended either way, so it is safe to bail out here.
+    for (u32 i = 0; i < graph->node_count; ++i) {
+        if (!record.results[i]) {
+            KERROR("Error executing rendergraph node '%s'. Check logs for additional details.", graph->nodes[graph->execution_list[i]].name);
+            return false;
+        }
+    }
+
+    // Execution list positions are the slots, so executing them in order preserves the topological order.
+    for (u32 i = 0; i < graph->node_count; ++i) {
+        record.positions[i] = i;
+    }
+    return renderer_node_command_lists_execute(record.renderer, graph->node_count, record.positions, p_frame_data);
+}
+
 b8 rendergraph_execute_frame(rendergraph* graph, frame_data* p_frame_data) {
     if (!graph) {
         return false;
     }
 
+    if (renderer_is_multithreaded() && graph->node_count <= RENDERER_MAX_NODE_COMMAND_LISTS) {
+        return rendergraph_execute_frame_multithreaded(graph, p_frame_data);
+    }
+
     // Execute nodes according to execution list.
     for (u32 i = 0; i < graph->node_count; ++i) {
         u32 current_index = graph->execution_list[i];
@@ -81,6 +81,16 @@ typedef struct rendergraph_node {
 
     void* internal_data;
 
+    /**
+     * @brief Indicates if this node may be recorded on a job thread, concurrently with other
+     * such nodes. Only set this if the node shares no shaders or other per-frame state with
+     * any other node, sets no renderer-wide state which other nodes read while recording,
+     * and creates or destroys no GPU resources while executing (acquiring per-group/per-draw
+     * resources from its own shaders is fine). Runs of concurrent nodes are recorded in graph
+     * order with respect to the other nodes.
+     */
+    b8 concurrent_record;
+
     b8 (*initialize)(struct rendergraph_node* self);
     b8 (*load_resources)(struct rendergraph_node* self);
     b8 (*execute)(struct rendergraph_node* self, struct frame_data* p_frame_data);
@@ -103,10 +103,7 @@ b8 clear_depth_rendergraph_node_execute(struct rendergraph_node* self, struct fr
 
     clear_depth_rendergraph_node_internal_data* internal_data = self->internal_data;
 
-    renderer_clear_depth_set(internal_data->renderer, internal_data->depth_clear_value);
-    renderer_clear_stencil_set(internal_data->renderer, internal_data->stencil_clear_value);
-
-    b8 result = renderer_clear_depth_stencil(internal_data->renderer, internal_data->buffer_texture->renderer_texture_handle);
+    b8 result = renderer_clear_depth_stencil(internal_data->renderer, internal_data->buffer_texture->renderer_texture_handle, internal_data->depth_clear_value, internal_data->stencil_clear_value);
 
     renderer_end_debug_label();
 
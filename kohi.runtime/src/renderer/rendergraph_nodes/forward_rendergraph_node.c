@@ -157,6 +157,8 @@ typedef struct forward_rendergraph_node_internal_data {
 
     u32 geometry_count;
     struct geometry_render_data* geometries;
+    // Offset of the static geometries' model matrices within the renderer's instance buffer.
+    u64 geometry_instance_offset;
 
     u32 terrain_geometry_count;
     struct geometry_render_data* terrain_geometries;
@@ -183,6 +185,16 @@ typedef struct forward_rendergraph_node_internal_data {
 
 } forward_rendergraph_node_internal_data;
 
+// Indicates if b can be drawn as another instance of the draw for a (i.e. same geometry, material and winding).
+static b8 geometry_instanceable(const geometry_render_data* a, const geometry_render_data* b) {
+    return a->material.material.handle_index == b->material.material.handle_index &&
+           a->vertex_buffer_offset == b->vertex_buffer_offset &&
+           a->vertex_count == b->vertex_count &&
+           a->index_buffer_offset == b->index_buffer_offset &&
+           a->index_count == b->index_count &&
+           a->winding_inverted == b->winding_inverted;
+}
+
 b8 forward_rendergraph_node_create(struct rendergraph* graph, struct rendergraph_node* self, const struct rendergraph_node_config* config) {
     if (!self) {
         KERROR("forward_rendergraph_node_create requires a valid pointer to a pass");
@@ -287,6 +299,9 @@ b8 forward_rendergraph_node_create(struct rendergraph* graph, struct rendergraph
     self->load_resources = forward_rendergraph_node_load_resources;
     self->execute = forward_rendergraph_node_execute;
 
+    // Uses only its own shaders and materials, so may record alongside other nodes.
+    self->concurrent_record = true;
+
     return true;
 }
 
@@ -749,13 +764,15 @@ b8 render_scene(forward_rendergraph_node_internal_data* internal_data, kresource
         if (geometry_count > 0) {
 
             khandle current_material = khandle_invalid();
+            b8 current_transparent = false;
+            b8 indirect_supported = renderer_indirect_draw_supported(internal_data->renderer);
             // Draw geometries.
             u32 count = internal_data->geometry_count;
             // Keep track of when transparent rendering begins. The water plane, if drawn,
             // must happen before this. NOTE: This may cause problems with transparent objects behind the water plane.
             b8 transparency_started = false;
 
-            for (u32 i = 0; i < count; ++i) {
+            for (u32 i = 0; i < count;) {
                 geometry_render_data* render_data = &internal_data->geometries[i];
                 material_instance* inst = &render_data->material;
 
@@ -781,6 +798,26 @@ b8 render_scene(forward_rendergraph_node_internal_data* internal_data, kresource
 
                     // Update the current material handle.
                     current_material = inst->material;
+                    current_transparent = has_transparency;
+                }
+
+                // Standard materials take the model matrix per-instance, so consecutive draws of the same
+                // geometry with the same material can be combined into a single instanced draw. The per-draw
+                // data is otherwise the same for all of them. Where supported, all opaque draws sharing the
+                // material and winding are submitted together as a single indirect draw.
+                b8 instanced = material_type_get(internal_data->material_system, inst->material) == KMATERIAL_TYPE_STANDARD;
+                b8 indirect = instanced && indirect_supported && !current_transparent;
+                u32 run_count = 1;
+                if (indirect) {
+                    while (i + run_count < count &&
+                           internal_data->geometries[i + run_count].material.material.handle_index == inst->material.handle_index &&
+                           internal_data->geometries[i + run_count].winding_inverted == render_data->winding_inverted) {
+                        run_count++;
+                    }
+                } else if (instanced) {
+                    while (i + run_count < count && geometry_instanceable(render_data, &internal_data->geometries[i + run_count])) {
+                        run_count++;
+                    }
                 }
 
                 // Apply the per-draw (material instance)
@@ -795,17 +832,28 @@ b8 render_scene(forward_rendergraph_node_internal_data* internal_data, kresource
                 }
 
                 // Invert if needed
-                if (internal_data->geometries[i].winding_inverted) {
+                if (render_data->winding_inverted) {
                     renderer_winding_set(RENDERER_WINDING_CLOCKWISE);
                 }
 
                 // Draw it.
-                renderer_geometry_draw(&internal_data->geometries[i]);
+                if (indirect) {
+                    if (!renderer_geometries_draw_indirect(internal_data->renderer, run_count, render_data, internal_data->geometry_instance_offset, sizeof(mat4), i, p_frame_data)) {
+                        KERROR("Failed to draw static geometries indirectly. See logs for details.");
+                        return false;
+                    }
+                } else if (instanced) {
+                    renderer_geometry_draw_instanced(render_data, internal_data->geometry_instance_offset + (sizeof(mat4) * i), run_count);
+                } else {
+                    renderer_geometry_draw(render_data);
+                }
 
                 // Change back if needed
-                if (internal_data->geometries[i].winding_inverted) {
+                if (render_data->winding_inverted) {
                     renderer_winding_set(RENDERER_WINDING_COUNTER_CLOCKWISE);
                 }
+
+                i += run_count;
             }
         }
     }
@@ -848,6 +896,19 @@ b8 forward_rendergraph_node_execute(struct rendergraph_node* self, struct frame_
     // rect_2d scissor_rect = (vec4){0, 0, (f32)internal_data->colourbuffer_texture->width, (f32)internal_data->colourbuffer_texture->height};
     // renderer_scissor_set(scissor_rect);
 
+    // Write the model matrices of all static geometries to the instance buffer once. These
+    // are shared by every pass below.
+    if (internal_data->geometry_count) {
+        mat4* models = p_frame_data->allocator.allocate(sizeof(mat4) * internal_data->geometry_count);
+        for (u32 i = 0; i < internal_data->geometry_count; ++i) {
+            models[i] = internal_data->geometries[i].model;
+        }
+        if (!renderer_instance_data_write(internal_data->renderer, sizeof(mat4) * internal_data->geometry_count, models, &internal_data->geometry_instance_offset)) {
+            KERROR("Failed to write static geometry instance data.");
+            return false;
+        }
+    }
+
     // Create and use an inverted camera
     camera inverted_camera = camera_copy(*internal_data->current_camera);
     // Invert position across plane.
@@ -881,7 +942,7 @@ b8 forward_rendergraph_node_execute(struct rendergraph_node* self, struct frame_
             vec4 refract_plane = (vec4){0, -1, 0, 0 + 1.0f}; // NOTE: w is distance from origin, in this case the y-coord. Setting this to vec4_zero() effectively disables this.
 
             renderer_clear_colour(internal_data->renderer, refraction_colour->renderer_texture_handle);
-            renderer_clear_depth_stencil(internal_data->renderer, refraction_depth->renderer_texture_handle);
+            renderer_clear_depth_stencil(internal_data->renderer, refraction_depth->renderer_texture_handle, 1.0f, 0);
             if (!render_scene(internal_data, refraction_colour, refraction_depth, 0, 0, false, refract_plane, internal_data->current_camera, &inverted_camera, false, p_frame_data)) {
                 KERROR("Failed to render scene.");
                 return false;
@@ -903,7 +964,7 @@ b8 forward_rendergraph_node_execute(struct rendergraph_node* self, struct frame_
 #endif
 
             renderer_clear_colour(internal_data->renderer, reflection_colour->renderer_texture_handle);
-            renderer_clear_depth_stencil(internal_data->renderer, reflection_depth->renderer_texture_handle);
+            renderer_clear_depth_stencil(internal_data->renderer, reflection_depth->renderer_texture_handle, 1.0f, 0);
             vec4 reflect_plane = (vec4){0, 1, 0, 0}; // NOTE: w is distance from origin, in this case the y-coord. Setting this to vec4_zero() effectively disables this.
             if (!render_scene(internal_data, reflection_colour, reflection_depth, 0, 0, false, reflect_plane, internal_data->current_camera, &inverted_camera, true, p_frame_data)) {
                 KERROR("Failed to render scene.");
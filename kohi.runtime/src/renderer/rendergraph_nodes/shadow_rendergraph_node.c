@@ -19,13 +19,13 @@
 #include "systems/material_system.h"
 #include "systems/shader_system.h"
 #include "systems/texture_system.h"
+#include "utils/crc64.h"
 #include <runtime_defines.h>
 
 // Locations of uniforms within the static mesh shader.
 typedef struct shadow_staticmesh_shader_locations {
     u16 projections;
     u16 views;
-    u16 model;
     u16 cascade_index;
     u16 base_colour_texture;
     u16 base_colour_sampler;
@@ -40,6 +40,19 @@ typedef struct shader_per_draw_data {
     u32 draw_id;
 } shader_per_draw_data;
 
+// The parts of a caster which affect what is rendered for it, hashed to detect changes to static casters.
+typedef struct shadow_caster_key {
+    mat4 model;
+    u64 vertex_buffer_offset;
+    u64 index_buffer_offset;
+    u32 vertex_count;
+    u32 index_count;
+    u32 material_index;
+    u32 texture_generation;
+    u32 winding_inverted;
+    u32 padding;
+} shadow_caster_key;
+
 typedef struct shadow_terrain_shader_locations {
     u16 projections;
     u16 views;
@@ -59,6 +72,16 @@ typedef struct shadow_rendergraph_node_internal_data {
     // The depth texture used for the directional light shadow.
     kresource_texture* depth_texture;
 
+    // Per-cascade depth textures holding only the static casters (static meshes and terrains). Each
+    // is only re-rendered when invalidated, and is copied into its cascade's layer every frame.
+    kresource_texture* static_cache_textures[MATERIAL_MAX_SHADOW_CASCADES];
+    // Indicates if each cascade's static cache holds valid contents.
+    b8 static_cache_valid[MATERIAL_MAX_SHADOW_CASCADES];
+    // Hashes of each cascade's bounds (i.e. its view and projection) as of its static cache being rendered.
+    u64 static_cache_bounds_hashes[MATERIAL_MAX_SHADOW_CASCADES];
+    // Hash of the static casters as of the static caches being rendered.
+    u64 static_casters_hash;
+
     // Static mesh shader and locations.
     khandle shadow_staticmesh_shader;
     shadow_staticmesh_shader_locations staticmesh_shader_locations;
@@ -93,9 +116,28 @@ typedef struct shadow_rendergraph_node_internal_data {
     u32 terrain_geometry_count;
     struct geometry_render_data* terrain_geometries;
 
+    // Collection of dynamic mesh geometries to be rendered on top of the static caches for a frame. Reset every frame. Uses frame allocator.
+    u32 dynamic_mesh_geometry_count;
+    struct geometry_render_data* dynamic_mesh_geometries;
+
 } shadow_rendergraph_node_internal_data;
 
 static b8 deserialize_config(const char* source_str, shadow_rendergraph_node_config* out_config);
+static u64 static_casters_hash(const shadow_rendergraph_node_internal_data* internal_data);
+static b8 per_draw_data_ensure(khandle shader, shader_per_draw_data** per_draw_data, u32 required_count);
+static b8 instance_data_write(shadow_rendergraph_node_internal_data* internal_data, struct frame_data* p_frame_data, u32 geometry_count, const geometry_render_data* geometries, u64* out_offset);
+static b8 staticmesh_casters_draw(shadow_rendergraph_node_internal_data* internal_data, struct frame_data* p_frame_data, u32 cascade_index, u32 geometry_count, geometry_render_data* geometries, u64 instance_offset, u32 per_draw_offset);
+static b8 terrain_casters_draw(shadow_rendergraph_node_internal_data* internal_data, u32 cascade_index);
+
+// Indicates if b can be drawn as another instance of the draw for a (i.e. same geometry, material and winding).
+static b8 geometry_instanceable(const geometry_render_data* a, const geometry_render_data* b) {
+    return a->material.material.handle_index == b->material.material.handle_index &&
+           a->vertex_buffer_offset == b->vertex_buffer_offset &&
+           a->vertex_count == b->vertex_count &&
+           a->index_buffer_offset == b->index_buffer_offset &&
+           a->index_count == b->index_count &&
+           a->winding_inverted == b->winding_inverted;
+}
 
 b8 shadow_rendergraph_node_create(struct rendergraph* graph, struct rendergraph_node* self, const struct rendergraph_node_config* config) {
     if (!self || !config) {
@@ -130,6 +172,9 @@ b8 shadow_rendergraph_node_create(struct rendergraph* graph, struct rendergraph_
     self->load_resources = shadow_rendergraph_node_load_resources;
     self->execute = shadow_rendergraph_node_execute;
 
+    // Uses only its own shaders, so may record alongside other nodes.
+    self->concurrent_record = true;
+
     internal_data->staticmesh_groups = darray_create(shadow_shader_group_data);
     internal_data->staticmesh_per_draw_data = darray_create(shader_per_draw_data);
     internal_data->terrain_per_draw_data = darray_create(shader_per_draw_data);
@@ -152,7 +197,6 @@ b8 shadow_rendergraph_node_initialize(struct rendergraph_node* self) {
     }
     internal_data->staticmesh_shader_locations.projections = shader_system_uniform_location(internal_data->shadow_staticmesh_shader, kname_create("projections"));
     internal_data->staticmesh_shader_locations.views = shader_system_uniform_location(internal_data->shadow_staticmesh_shader, kname_create("views"));
-    internal_data->staticmesh_shader_locations.model = shader_system_uniform_location(internal_data->shadow_staticmesh_shader, kname_create("model"));
     internal_data->staticmesh_shader_locations.cascade_index = shader_system_uniform_location(internal_data->shadow_staticmesh_shader, kname_create("cascade_index"));
     internal_data->staticmesh_shader_locations.base_colour_texture = shader_system_uniform_location(internal_data->shadow_staticmesh_shader, kname_create("base_colour_texture"));
     internal_data->staticmesh_shader_locations.base_colour_sampler = shader_system_uniform_location(internal_data->shadow_staticmesh_shader, kname_create("base_colour_sampler"));
@@ -215,245 +259,406 @@ b8 shadow_rendergraph_node_load_resources(struct rendergraph_node* self) {
     rendergraph_source* shadowmap_source = &self->sources[0];
     shadowmap_source->value.t = internal_data->depth_texture;
 
+    // Create the static caster caches. These are only ever written and read by this node in order
+    // on the GPU, so they don't need renderer buffering.
+    for (u32 i = 0; i < MATERIAL_MAX_SHADOW_CASCADES; ++i) {
+        const char* cache_name = string_format("__shadow_rg_node_static_cache_%u__", i);
+        internal_data->static_cache_textures[i] = texture_system_request_depth(kname_create(cache_name), internal_data->config.resolution, internal_data->config.resolution, false, false);
+        string_free(cache_name);
+        if (!internal_data->static_cache_textures[i]) {
+            KERROR("Failed to request static shadow cache texture for shadow rendergraph node.");
+            return false;
+        }
+        internal_data->static_cache_valid[i] = false;
+    }
+
     return true;
 }
 
-b8 shadow_rendergraph_node_execute(struct rendergraph_node* self, struct frame_data* p_frame_data) {
-    if (!self) {
-        return false;
+// Hashes everything about a caster which affects what is rendered for it.
+static u64 caster_hash(const shadow_rendergraph_node_internal_data* internal_data, u64 hash, const geometry_render_data* geometry) {
+    shadow_caster_key key = {0};
+    key.model = geometry->model;
+    key.vertex_buffer_offset = geometry->vertex_buffer_offset;
+    key.index_buffer_offset = geometry->index_buffer_offset;
+    key.vertex_count = geometry->vertex_count;
+    key.index_count = geometry->index_count;
+    key.material_index = geometry->material.material.handle_index;
+    key.winding_inverted = geometry->winding_inverted;
+    // The base colour texture of transparent materials is sampled, so it reloading must invalidate the cache too.
+    key.texture_generation = INVALID_ID;
+    if (!khandle_is_invalid(geometry->material.material) && material_flag_get(internal_data->material_system, geometry->material.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT)) {
+        kresource_texture* t = material_texture_get(internal_data->material_system, geometry->material.material, MATERIAL_TEXTURE_INPUT_BASE_COLOUR);
+        if (t) {
+            key.texture_generation = t->base.generation;
+        }
     }
+    return crc64(hash, (const u8*)&key, sizeof(shadow_caster_key));
+}
 
-    renderer_begin_debug_label("shadow rendergraph node", (vec3){1.0f, 0.0f, 0.0f});
+// Hashes all static casters (static meshes and terrains) for the frame.
+static u64 static_casters_hash(const shadow_rendergraph_node_internal_data* internal_data) {
+    u64 hash = crc64(0, (const u8*)&internal_data->static_mesh_geometry_count, sizeof(u32));
+    for (u32 i = 0; i < internal_data->static_mesh_geometry_count; ++i) {
+        hash = caster_hash(internal_data, hash, &internal_data->static_mesh_geometries[i]);
+    }
+    hash = crc64(hash, (const u8*)&internal_data->terrain_geometry_count, sizeof(u32));
+    for (u32 i = 0; i < internal_data->terrain_geometry_count; ++i) {
+        hash = caster_hash(internal_data, hash, &internal_data->terrain_geometries[i]);
+    }
+    return hash;
+}
 
-    shadow_rendergraph_node_internal_data* internal_data = self->internal_data;
+// Ensures there are at least required_count per-draw resources acquired from the given shader.
+static b8 per_draw_data_ensure(khandle shader, shader_per_draw_data** per_draw_data, u32 required_count) {
+    u32 current_count = darray_length(*per_draw_data);
+    // Add the new entries for the difference, requesting draw resources along the way.
+    for (u32 i = current_count; i < required_count; ++i) {
+        shader_per_draw_data new_per_draw = {0};
+        if (!shader_system_shader_per_draw_acquire(shader, &new_per_draw.draw_id)) {
+            return false;
+        }
+        darray_push(*per_draw_data, new_per_draw);
+    }
+    return true;
+}
 
-    // Clear the image first.
-    renderer_clear_depth_stencil(engine_systems_get()->renderer_system, internal_data->depth_texture->renderer_texture_handle);
+// Writes the model matrices of the given geometries to the instance buffer.
+static b8 instance_data_write(shadow_rendergraph_node_internal_data* internal_data, struct frame_data* p_frame_data, u32 geometry_count, const geometry_render_data* geometries, u64* out_offset) {
+    if (!geometry_count) {
+        return true;
+    }
+    mat4* models = p_frame_data->allocator.allocate(sizeof(mat4) * geometry_count);
+    for (u32 i = 0; i < geometry_count; ++i) {
+        models[i] = geometries[i].model;
+    }
+    return renderer_instance_data_write(internal_data->renderer, sizeof(mat4) * geometry_count, models, out_offset);
+}
 
-    // One renderpass per cascade - directional light.
-    for (u32 p = 0; p < MATERIAL_MAX_SHADOW_CASCADES; ++p) {
-        {
-            const char* label_text = string_format("shadow_rendergraph_cascade_%u", p);
-            renderer_begin_debug_label(label_text, (vec3){0.8f - (p * 0.1f), 0.0f, 0.0f});
-            string_free(label_text);
-        }
+// Draws the given static mesh geometries into the current cascade. Must be called while rendering.
+static b8 staticmesh_casters_draw(shadow_rendergraph_node_internal_data* internal_data, struct frame_data* p_frame_data, u32 cascade_index, u32 geometry_count, geometry_render_data* geometries, u64 instance_offset, u32 per_draw_offset) {
+    if (!geometry_count) {
+        return true;
+    }
 
-        rect_2d render_area = (rect_2d){0, 0, internal_data->config.resolution, internal_data->config.resolution};
-        renderer_begin_rendering(internal_data->renderer, p_frame_data, render_area, 0, 0, internal_data->depth_texture->renderer_texture_handle, p);
+    b8 indirect_supported = renderer_indirect_draw_supported(internal_data->renderer);
 
-        // Bind the internal viewport - do not use one provided in pass data.
-        renderer_active_viewport_set(&internal_data->camera_viewport);
+    // Apply per-frame updates first.
+    {
+        renderer_begin_debug_label("shadow_rendergraph_staticmesh_per_frame", (vec3){1.0f, 0.0f, 0.0f});
 
-        // Apply per-frame updates first.
-        {
-            renderer_begin_debug_label("shadow_rendergraph_staticmesh_per_frame", (vec3){1.0f, 0.0f, 0.0f});
+        // Use the standard shadowmap shader.
+        shader_system_use(internal_data->shadow_staticmesh_shader);
+        shader_system_bind_frame(internal_data->shadow_staticmesh_shader);
 
-            // Use the standard shadowmap shader.
-            shader_system_use(internal_data->shadow_staticmesh_shader);
-            shader_system_bind_frame(internal_data->shadow_staticmesh_shader);
+        for (u32 i = 0; i < MATERIAL_MAX_SHADOW_CASCADES; ++i) {
+            if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.projections, i, &internal_data->cascade_data[i].projection)) {
+                KERROR("Failed to apply static mesh shadowmap projection uniform (index=%u).", i);
+                return false;
+            }
+            if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.views, i, &internal_data->cascade_data[i].view)) {
+                KERROR("Failed to apply static mesh shadowmap view uniform (index=%u).", i);
+                return false;
+            }
+        }
+        // Apply per-frame uniforms.
+        shader_system_apply_per_frame(internal_data->shadow_staticmesh_shader);
 
-            for (u32 i = 0; i < MATERIAL_MAX_SHADOW_CASCADES; ++i) {
-                if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.projections, i, &internal_data->cascade_data[i].projection)) {
-                    KERROR("Failed to apply static mesh shadowmap projection uniform (index=%u).", i);
-                    return false;
-                }
-                if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.views, i, &internal_data->cascade_data[i].view)) {
-                    KERROR("Failed to apply static mesh shadowmap view uniform (index=%u).", i);
-                    return false;
+        renderer_end_debug_label();
+    }
+
+    // Prepare - Obtain enough shader resources for the frame. Do this by obtaining the count of unique
+    // (but transparent) materials.
+    for (u32 i = 0; i < geometry_count;) {
+        geometry_render_data* geometry = &geometries[i];
+        material_instance mat_inst = geometry->material;
+
+        b8 has_transparency = material_flag_get(internal_data->material_system, mat_inst.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT);
+
+        // Consecutive draws of the same geometry and material are drawn as instances of one draw.
+        // Where supported, opaque draws all use the same group, so all of them up to the next change
+        // in winding are submitted together as a single indirect draw instead.
+        b8 indirect = indirect_supported && !has_transparency;
+        u32 run_count = 1;
+        if (indirect) {
+            while (i + run_count < geometry_count) {
+                geometry_render_data* next = &geometries[i + run_count];
+                if (next->winding_inverted != geometry->winding_inverted ||
+                    material_flag_get(internal_data->material_system, next->material.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT)) {
+                    break;
                 }
+                run_count++;
+            }
+        } else {
+            while (i + run_count < geometry_count &&
+                   geometry_instanceable(geometry, &geometries[i + run_count])) {
+                run_count++;
             }
-            // Apply per-frame uniforms.
-            shader_system_apply_per_frame(internal_data->shadow_staticmesh_shader);
-
-            renderer_end_debug_label();
         }
 
-        // Reset material handle group data for all entries. _NOT_ the group_ids though!
-        {
+        shadow_shader_group_data* selected_group = 0;
+        shader_per_draw_data* selected_per_draw = &internal_data->staticmesh_per_draw_data[per_draw_offset + i];
+        b8 using_default = false;
+        if (has_transparency) {
+
+            // Search the existing group data to see if this group has already been handled.
+            u32 group_index = INVALID_ID;
             u32 group_count = darray_length(internal_data->staticmesh_groups);
             for (u32 g = 0; g < group_count; ++g) {
                 shadow_shader_group_data* group = &internal_data->staticmesh_groups[g];
-                group->base_material.handle_index = INVALID_ID;
-            }
-        }
-
-        // Ensure there are enough static mesh per-draw resources for the frame.
-        {
-            i64 required_per_draw_count = internal_data->static_mesh_geometry_count;
-            u32 current_per_draw_count = darray_length(internal_data->staticmesh_per_draw_data);
-            i64 per_draw_diff = current_per_draw_count - required_per_draw_count;
-            if (per_draw_diff < 0) {
-                // Add the new entries for the difference, requesting draw resources along the way.
-                for (u32 i = current_per_draw_count; i < required_per_draw_count; ++i) {
-                    shader_per_draw_data new_per_draw = {0};
-                    if (!shader_system_shader_per_draw_acquire(internal_data->shadow_staticmesh_shader, &new_per_draw.draw_id)) {
-                        KERROR("Failed to acquire per-draw resources from the static mesh shadow shader. See logs for details.");
-                        return false;
-                    }
-                    darray_push(internal_data->staticmesh_per_draw_data, new_per_draw);
+                if (group->base_material.handle_index == mat_inst.material.handle_index) {
+                    // Exists already, move on to the next material.
+                    group_index = g;
+                    break;
                 }
             }
-        }
 
-        // Prepare - Obtain enough shader resources for the frame. Do this by obtaining the count of unique
-        // (but transparent) materials.
-        for (u32 i = 0; i < internal_data->static_mesh_geometry_count; ++i) {
-            geometry_render_data* geometry = &internal_data->static_mesh_geometries[i];
-            material_instance mat_inst = geometry->material;
-            shadow_shader_group_data* selected_group = 0;
-            shader_per_draw_data* selected_per_draw = &internal_data->staticmesh_per_draw_data[i];
-            b8 using_default = false;
-            if (material_flag_get(internal_data->material_system, mat_inst.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT)) {
-
-                // Search the existing group data to see if this group has already been handled.
-                u32 group_index = INVALID_ID;
-                u32 group_count = darray_length(internal_data->staticmesh_groups);
+            if (group_index == INVALID_ID) {
+                // A unique material has been found. If a shader group already exists at this index, move on.
+                // If not, request group resources, and save it off.
+                // Find an "empty" slot, i.e. one with the group->base_material.handle_index = INVALID_ID.
                 for (u32 g = 0; g < group_count; ++g) {
                     shadow_shader_group_data* group = &internal_data->staticmesh_groups[g];
-                    if (group->base_material.handle_index == mat_inst.material.handle_index) {
-                        // Exists already, move on to the next material.
+                    if (group->base_material.handle_index == INVALID_ID) {
+                        // Found an empty slot. Use it, but don't request group resources.
+                        group->base_material = mat_inst.material;
+
                         group_index = g;
                         break;
                     }
                 }
 
+                // If still not found, create a new entry (requesting group resources) and push into the darray.
                 if (group_index == INVALID_ID) {
-                    // A unique material has been found. If a shader group already exists at this index, move on.
-                    // If not, request group resources, and save it off.
-                    // Find an "empty" slot, i.e. one with the group->base_material.handle_index = INVALID_ID.
-                    for (u32 g = 0; g < group_count; ++g) {
-                        shadow_shader_group_data* group = &internal_data->staticmesh_groups[g];
-                        if (group->base_material.handle_index == INVALID_ID) {
-                            // Found an empty slot. Use it, but don't request group resources.
-                            group->base_material = mat_inst.material;
-
-                            group_index = g;
-                            break;
-                        }
-                    }
-
-                    // If still not found, create a new entry (requesting group resources) and push into the darray.
-                    if (group_index == INVALID_ID) {
-                        shadow_shader_group_data new_group = {0};
-                        new_group.base_material = mat_inst.material;
-                        if (!shader_system_shader_group_acquire(internal_data->shadow_staticmesh_shader, &new_group.group_id)) {
-                            KERROR("Failed to obtain group resources for rendering a transparent material. See logs for details.");
-                            return false;
-                        }
-                        group_index = group_count;
-                        darray_push(internal_data->staticmesh_groups, new_group);
+                    shadow_shader_group_data new_group = {0};
+                    new_group.base_material = mat_inst.material;
+                    if (!shader_system_shader_group_acquire(internal_data->shadow_staticmesh_shader, &new_group.group_id)) {
+                        KERROR("Failed to obtain group resources for rendering a transparent material. See logs for details.");
+                        return false;
                     }
+                    group_index = group_count;
+                    darray_push(internal_data->staticmesh_groups, new_group);
                 }
-
-                selected_group = &internal_data->staticmesh_groups[group_index];
-            } else {
-                // For non-transparent materials, use the "default" group.
-                selected_group = &internal_data->default_group;
-                using_default = true;
             }
 
-            // Update group uniforms.
-            if (!shader_system_bind_group(internal_data->shadow_staticmesh_shader, selected_group->group_id)) {
-                KERROR("Failed to bind static mesh shadow group id %u", selected_group->group_id);
+            selected_group = &internal_data->staticmesh_groups[group_index];
+        } else {
+            // For non-transparent materials, use the "default" group.
+            selected_group = &internal_data->default_group;
+            using_default = true;
+        }
+
+        // Update group uniforms.
+        if (!shader_system_bind_group(internal_data->shadow_staticmesh_shader, selected_group->group_id)) {
+            KERROR("Failed to bind static mesh shadow group id %u", selected_group->group_id);
+            return false;
+        }
+
+        // Bind the appropriate texture.
+        kresource_texture* base_colour_texture = using_default ? internal_data->default_base_colour_texture : material_texture_get(internal_data->material_system, selected_group->base_material, MATERIAL_TEXTURE_INPUT_BASE_COLOUR);
+        if (!base_colour_texture) {
+            // Failsafe in case the given material doesn't have a base colour texture.
+            base_colour_texture = internal_data->default_base_colour_texture;
+        }
+
+        // Since this can (and likely will) change every frame, set this every time.
+        if (!shader_system_uniform_set_by_location(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.base_colour_texture, base_colour_texture)) {
+            KERROR("Failed to apply static mesh shadowmap base_colour_texture uniform to static geometry.");
+            return false;
+        }
+
+        if (!shader_system_apply_per_group(internal_data->shadow_staticmesh_shader)) {
+            KERROR("Failed to apply static mesh shadowmap group id %u", selected_group->group_id);
+            return false;
+        }
+
+        // Update per-draw uniforms.
+        shader_system_bind_draw_id(internal_data->shadow_staticmesh_shader, selected_per_draw->draw_id);
+        shader_system_uniform_set_by_location(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.cascade_index, &cascade_index);
+        shader_system_apply_per_draw(internal_data->shadow_staticmesh_shader);
+
+        // Invert if needed
+        if (geometry->winding_inverted) {
+            renderer_winding_set(RENDERER_WINDING_CLOCKWISE);
+        }
+
+        // Draw it.
+        if (indirect) {
+            if (!renderer_geometries_draw_indirect(internal_data->renderer, run_count, geometry, instance_offset, sizeof(mat4), i, p_frame_data)) {
+                KERROR("Failed to draw static mesh shadows indirectly. See logs for details.");
                 return false;
             }
+        } else {
+            renderer_geometry_draw_instanced(geometry, instance_offset + (sizeof(mat4) * i), run_count);
+        }
 
-            // Bind the appropriate texture.
-            kresource_texture* base_colour_texture = using_default ? internal_data->default_base_colour_texture : material_texture_get(internal_data->material_system, selected_group->base_material, MATERIAL_TEXTURE_INPUT_BASE_COLOUR);
-            if (!base_colour_texture) {
-                // Failsafe in case the given material doesn't have a base colour texture.
-                base_colour_texture = internal_data->default_base_colour_texture;
-            }
+        // Change back if needed
+        if (geometry->winding_inverted) {
+            renderer_winding_set(RENDERER_WINDING_COUNTER_CLOCKWISE);
+        }
+
+        i += run_count;
+    }
+
+    return true;
+}
+
+// Draws the terrain geometries into the current cascade. Must be called while rendering.
+static b8 terrain_casters_draw(shadow_rendergraph_node_internal_data* internal_data, u32 cascade_index) {
+    if (!internal_data->terrain_geometry_count) {
+        return true;
+    }
+
+    // per-frame Terrain shadowmap shader
+    {
+        shader_system_use(internal_data->shadow_terrain_shader);
+
+        shader_system_bind_frame(internal_data->shadow_terrain_shader);
 
-            // Since this can (and likely will) change every frame, set this every time.
-            if (!shader_system_uniform_set_by_location(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.base_colour_texture, base_colour_texture)) {
-                KERROR("Failed to apply static mesh shadowmap base_colour_texture uniform to static geometry.");
+        for (u32 i = 0; i < MATERIAL_MAX_SHADOW_CASCADES; ++i) {
+            // NOTE: using the internal projection matrix, not one passed in.
+            if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.projections, i, &internal_data->cascade_data[i].projection)) {
+                KERROR("Failed to apply terrain shadowmap projection uniform (index=%u).", i);
                 return false;
             }
-
-            if (!shader_system_apply_per_group(internal_data->shadow_staticmesh_shader)) {
-                KERROR("Failed to apply static mesh shadowmap group id %u", selected_group->group_id);
+            if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.views, i, &internal_data->cascade_data[i].view)) {
+                KERROR("Failed to apply terrain shadowmap view uniform (index=%u).", i);
                 return false;
             }
+        }
+        shader_system_apply_per_frame(internal_data->shadow_terrain_shader);
+    }
 
-            // Update per-draw uniforms.
-            shader_system_bind_draw_id(internal_data->shadow_staticmesh_shader, selected_per_draw->draw_id);
-            shader_system_uniform_set_by_location(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.model, &geometry->model);
-            shader_system_uniform_set_by_location(internal_data->shadow_staticmesh_shader, internal_data->staticmesh_shader_locations.cascade_index, &p);
-            shader_system_apply_per_draw(internal_data->shadow_staticmesh_shader);
+    for (u32 i = 0; i < internal_data->terrain_geometry_count; ++i) {
+        geometry_render_data* terrain = &internal_data->terrain_geometries[i];
+        shader_per_draw_data* selected_per_draw = &internal_data->terrain_per_draw_data[i];
 
-            // Invert if needed
-            if (geometry->winding_inverted) {
-                renderer_winding_set(RENDERER_WINDING_CLOCKWISE);
-            }
+        // Apply the locals
+        shader_system_bind_draw_id(internal_data->shadow_terrain_shader, selected_per_draw->draw_id);
+        shader_system_uniform_set_by_location(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.model, &terrain->model);
+        shader_system_uniform_set_by_location(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.cascade_index, &cascade_index);
+        shader_system_apply_per_draw(internal_data->shadow_terrain_shader);
 
-            // Draw it.
-            renderer_geometry_draw(geometry);
+        // Draw it.
+        renderer_geometry_draw(terrain);
+    }
 
-            // Change back if needed
-            if (geometry->winding_inverted) {
-                renderer_winding_set(RENDERER_WINDING_COUNTER_CLOCKWISE);
-            }
-        }
+    return true;
+}
 
-        // Terrain - use the terrain shadowmap shader.
-        //
-        // per-frame Terrain shadowmap shader
-        {
-            shader_system_use(internal_data->shadow_terrain_shader);
+b8 shadow_rendergraph_node_execute(struct rendergraph_node* self, struct frame_data* p_frame_data) {
+    if (!self) {
+        return false;
+    }
 
-            shader_system_bind_frame(internal_data->shadow_terrain_shader);
+    renderer_begin_debug_label("shadow rendergraph node", (vec3){1.0f, 0.0f, 0.0f});
 
-            for (u32 i = 0; i < MATERIAL_MAX_SHADOW_CASCADES; ++i) {
-                // NOTE: using the internal projection matrix, not one passed in.
-                if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.projections, i, &internal_data->cascade_data[i].projection)) {
-                    KERROR("Failed to apply terrain shadowmap projection uniform (index=%u).", i);
-                    return false;
-                }
-                if (!shader_system_uniform_set_by_location_arrayed(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.views, i, &internal_data->cascade_data[i].view)) {
-                    KERROR("Failed to apply terrain shadowmap view uniform (index=%u).", i);
-                    return false;
-                }
-            }
-            shader_system_apply_per_frame(internal_data->shadow_terrain_shader);
+    shadow_rendergraph_node_internal_data* internal_data = self->internal_data;
+
+    // Work out which cascades need their static casters re-rendered. Any change to the static casters
+    // invalidates all of them, while a change to a cascade's bounds only invalidates that cascade.
+    // NOTE: The light direction is part of each cascade's view, so a change to it is caught here as well.
+    u64 casters_hash = static_casters_hash(internal_data);
+    b8 casters_changed = casters_hash != internal_data->static_casters_hash;
+    internal_data->static_casters_hash = casters_hash;
+    b8 any_cache_invalid = false;
+    for (u32 c = 0; c < MATERIAL_MAX_SHADOW_CASCADES; ++c) {
+        u64 bounds_hash = crc64(0, (const u8*)&internal_data->cascade_data[c].projection, sizeof(mat4));
+        bounds_hash = crc64(bounds_hash, (const u8*)&internal_data->cascade_data[c].view, sizeof(mat4));
+        if (casters_changed || bounds_hash != internal_data->static_cache_bounds_hashes[c]) {
+            internal_data->static_cache_valid[c] = false;
         }
+        internal_data->static_cache_bounds_hashes[c] = bounds_hash;
+        any_cache_invalid |= !internal_data->static_cache_valid[c];
+    }
 
-        // Ensure there are enough terrain per-draw resources for the frame.
-        {
-            i64 required_per_draw_count = internal_data->terrain_geometry_count;
-            u32 current_per_draw_count = darray_length(internal_data->terrain_per_draw_data);
-            i64 per_draw_diff = current_per_draw_count - required_per_draw_count;
-            if (per_draw_diff < 0) {
-                // Add the new entries for the difference, requesting draw resources along the way.
-                for (u32 i = current_per_draw_count; i < required_per_draw_count; ++i) {
-                    shader_per_draw_data new_per_draw = {0};
-                    if (!shader_system_shader_per_draw_acquire(internal_data->shadow_terrain_shader, &new_per_draw.draw_id)) {
-                        KERROR("Failed to acquire per-draw resources from the terrain shadow shader. See logs for details.");
-                        return false;
-                    }
-                    darray_push(internal_data->terrain_per_draw_data, new_per_draw);
-                }
-            }
+    // Ensure there are enough per-draw resources for the frame. Dynamic casters use the ones after the static casters.
+    if (!per_draw_data_ensure(internal_data->shadow_staticmesh_shader, &internal_data->staticmesh_per_draw_data, internal_data->static_mesh_geometry_count + internal_data->dynamic_mesh_geometry_count)) {
+        KERROR("Failed to acquire per-draw resources from the static mesh shadow shader. See logs for details.");
+        return false;
+    }
+    if (!per_draw_data_ensure(internal_data->shadow_terrain_shader, &internal_data->terrain_per_draw_data, internal_data->terrain_geometry_count)) {
+        KERROR("Failed to acquire per-draw resources from the terrain shadow shader. See logs for details.");
+        return false;
+    }
+
+    // Reset material handle group data for all entries. _NOT_ the group_ids though!
+    // This is only done once per frame, so a group is never rebound to another material mid-frame.
+    {
+        u32 group_count = darray_length(internal_data->staticmesh_groups);
+        for (u32 g = 0; g < group_count; ++g) {
+            shadow_shader_group_data* group = &internal_data->staticmesh_groups[g];
+            group->base_material.handle_index = INVALID_ID;
         }
+    }
+
+    // Write the model matrices of the casters to the instance buffer once, to be shared by all cascades.
+    // Static casters are only needed if at least one cache is being re-rendered.
+    u64 static_instance_offset = 0;
+    if (any_cache_invalid && !instance_data_write(internal_data, p_frame_data, internal_data->static_mesh_geometry_count, internal_data->static_mesh_geometries, &static_instance_offset)) {
+        KERROR("Failed to write static mesh shadow instance data.");
+        return false;
+    }
+    u64 dynamic_instance_offset = 0;
+    if (!instance_data_write(internal_data, p_frame_data, internal_data->dynamic_mesh_geometry_count, internal_data->dynamic_mesh_geometries, &dynamic_instance_offset)) {
+        KERROR("Failed to write dynamic mesh shadow instance data.");
+        return false;
+    }
+
+    rect_2d render_area = (rect_2d){0, 0, internal_data->config.resolution, internal_data->config.resolution};
 
+    // One renderpass per cascade - directional light.
+    for (u32 p = 0; p < MATERIAL_MAX_SHADOW_CASCADES; ++p) {
         {
+            const char* label_text = string_format("shadow_rendergraph_cascade_%u", p);
+            renderer_begin_debug_label(label_text, (vec3){0.8f - (p * 0.1f), 0.0f, 0.0f});
+            string_free(label_text);
+        }
 
-            for (u32 i = 0; i < internal_data->terrain_geometry_count; ++i) {
-                geometry_render_data* terrain = &internal_data->terrain_geometries[i];
-                shader_per_draw_data* selected_per_draw = &internal_data->staticmesh_per_draw_data[i];
+        kresource_texture* cache_texture = internal_data->static_cache_textures[p];
 
-                // Apply the locals
-                shader_system_bind_draw_id(internal_data->shadow_terrain_shader, selected_per_draw->draw_id);
-                shader_system_uniform_set_by_location(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.model, &terrain->model);
-                shader_system_uniform_set_by_location(internal_data->shadow_terrain_shader, internal_data->terrain_shader_locations.cascade_index, &p);
-                shader_system_apply_per_draw(internal_data->shadow_terrain_shader);
+        // Re-render the static casters for this cascade into its cache if required.
+        if (!internal_data->static_cache_valid[p]) {
+            renderer_begin_debug_label("shadow_rendergraph_static_cache", (vec3){0.5f, 0.0f, 0.0f});
 
-                // Draw it.
-                renderer_geometry_draw(terrain);
+            renderer_clear_depth_stencil(internal_data->renderer, cache_texture->renderer_texture_handle, 1.0f, 0);
+            renderer_begin_rendering(internal_data->renderer, p_frame_data, render_area, 0, 0, cache_texture->renderer_texture_handle, 0);
+
+            // Bind the internal viewport - do not use one provided in pass data.
+            renderer_active_viewport_set(&internal_data->camera_viewport);
+
+            if (!staticmesh_casters_draw(internal_data, p_frame_data, p, internal_data->static_mesh_geometry_count, internal_data->static_mesh_geometries, static_instance_offset, 0)) {
+                return false;
+            }
+            if (!terrain_casters_draw(internal_data, p)) {
+                return false;
             }
+
+            renderer_end_rendering(internal_data->renderer, p_frame_data);
+            internal_data->static_cache_valid[p] = true;
+
+            renderer_end_debug_label();
+        }
+
+        // Start the cascade from the cached static casters. This overwrites the layer entirely, so no clear is needed.
+        if (!renderer_texture_layer_copy(internal_data->renderer, cache_texture->renderer_texture_handle, 0, internal_data->depth_texture->renderer_texture_handle, p)) {
+            KERROR("Failed to copy static shadow cache into cascade %u.", p);
+            return false;
         }
 
-        renderer_end_rendering(internal_data->renderer, p_frame_data);
+        // Composite the dynamic casters on top.
+        if (internal_data->dynamic_mesh_geometry_count) {
+            renderer_begin_rendering(internal_data->renderer, p_frame_data, render_area, 0, 0, internal_data->depth_texture->renderer_texture_handle, p);
+
+            // Bind the internal viewport - do not use one provided in pass data.
+            renderer_active_viewport_set(&internal_data->camera_viewport);
+
+            if (!staticmesh_casters_draw(internal_data, p_frame_data, p, internal_data->dynamic_mesh_geometry_count, internal_data->dynamic_mesh_geometries, dynamic_instance_offset, internal_data->static_mesh_geometry_count)) {
+                return false;
+            }
+
+            renderer_end_rendering(internal_data->renderer, p_frame_data);
+        }
 
         renderer_end_debug_label();
 
@@ -467,12 +672,18 @@ b8 shadow_rendergraph_node_execute(struct rendergraph_node* self, struct frame_d
     return true;
 }
 
+
 void shadow_rendergraph_node_destroy(struct rendergraph_node* self) {
     if (self) {
         if (self->internal_data) {
             shadow_rendergraph_node_internal_data* internal_data = self->internal_data;
 
             texture_system_release_resource(internal_data->depth_texture);
+            for (u32 i = 0; i < MATERIAL_MAX_SHADOW_CASCADES; ++i) {
+                if (internal_data->static_cache_textures[i]) {
+                    texture_system_release_resource(internal_data->static_cache_textures[i]);
+                }
+            }
             texture_system_release_resource(internal_data->default_base_colour_texture);
 
             // Internal data.
@@ -541,6 +752,32 @@ b8 shadow_rendergraph_node_terrain_geometries_set(struct rendergraph_node* self,
     return false;
 }
 
+b8 shadow_rendergraph_node_dynamic_geometries_set(struct rendergraph_node* self, struct frame_data* p_frame_data, u32 geometry_count, const struct geometry_render_data* geometries) {
+    if (!self) {
+        KERROR("shadow_rendergraph_node_dynamic_geometries_set requires a valid pointer to a rendergraph_node.");
+        return false;
+    }
+
+    shadow_rendergraph_node_internal_data* internal_data = self->internal_data;
+
+    // Take a copy of the array. Note that this only lasts for the frame.
+    internal_data->dynamic_mesh_geometry_count = geometry_count;
+    internal_data->dynamic_mesh_geometries = p_frame_data->allocator.allocate(sizeof(geometry_render_data) * geometry_count);
+    kcopy_memory(internal_data->dynamic_mesh_geometries, geometries, sizeof(geometry_render_data) * geometry_count);
+
+    return true;
+}
+
+u16 shadow_rendergraph_node_resolution_get(const struct rendergraph_node* self) {
+    if (!self) {
+        KERROR("shadow_rendergraph_node_resolution_get requires a valid pointer to a rendergraph_node.");
+        return 0;
+    }
+
+    const shadow_rendergraph_node_internal_data* internal_data = self->internal_data;
+    return internal_data->config.resolution;
+}
+
 b8 shadow_rendergraph_node_register_factory(void) {
     rendergraph_node_factory factory = {0};
     factory.type = "shadow";
@@ -32,6 +32,9 @@ KAPI b8 shadow_rendergraph_node_directional_light_set(struct rendergraph_node* s
 KAPI b8 shadow_rendergraph_node_cascade_data_set(struct rendergraph_node* self, shadow_cascade_data data, u8 cascade_index);
 KAPI b8 shadow_rendergraph_node_static_geometries_set(struct rendergraph_node* self, struct frame_data* p_frame_data, u32 geometry_count, const struct geometry_render_data* geometries);
 KAPI b8 shadow_rendergraph_node_terrain_geometries_set(struct rendergraph_node* self, struct frame_data* p_frame_data, u32 geometry_count, const struct geometry_render_data* geometries);
+// Dynamic casters are rendered every frame on top of the cached static casters.
+KAPI b8 shadow_rendergraph_node_dynamic_geometries_set(struct rendergraph_node* self, struct frame_data* p_frame_data, u32 geometry_count, const struct geometry_render_data* geometries);
+KAPI u16 shadow_rendergraph_node_resolution_get(const struct rendergraph_node* self);
 
 b8 shadow_rendergraph_node_register_factory(void);
 
@@ -17,6 +17,7 @@
 #include "identifiers/khandle.h"
 #include "kresources/kresource_types.h"
 #include "logger.h"
+#include "math/bvh.h"
 #include "math/geometry_3d.h"
 #include "math/kmath.h"
 #include "math/math_types.h"
@@ -32,6 +33,7 @@
 #include "strings/kname.h"
 #include "strings/kstring.h"
 #include "strings/kstring_id.h"
+#include "systems/job_system.h"
 #include "systems/kresource_system.h"
 #include "systems/light_system.h"
 #include "systems/material_system.h"
@@ -41,6 +43,21 @@
 
 static void scene_actual_unload(scene* scene);
 static void scene_node_metadata_ensure_allocated(scene* s, u64 handle_index);
+static void scene_mesh_spatial_update(scene* s);
+static void scene_mesh_bounds_release(scene_mesh_bounds* bounds, u32 first, u32 count);
+static void scene_mesh_bounds_destroy(scene_mesh_bounds* bounds);
+static void scene_cull_range(u32 start, u32 end, void* context);
+static u64 scene_draw_key(b8 transparent, kmaterial_type type, u32 material_index, u64 vertex_buffer_offset, f32 distance);
+static void scene_draws_sort_and_push(u32 count, const geometry_render_data* draws, u64* keys, frame_data* p_frame_data, geometry_render_data** out_geometries);
+
+// How far the bounds of static meshes are enlarged in the bvh, so small movements don't require reinserting them.
+#define SCENE_MESH_BVH_MARGIN 0.1f
+
+// The number of submesh bounds tested per job when culling. A multiple of 4 keeps SIMD lanes full.
+#define SCENE_CULL_GRAIN 1024
+
+// Set in the sort key of transparent draws, so they come after all opaque draws.
+#define SCENE_DRAW_KEY_TRANSPARENT_BIT (1ull << 63)
 
 static u32 global_scene_id = 0;
 
@@ -64,26 +81,25 @@ typedef struct scene_audio_emitter {
     b8 is_streaming;
 } scene_audio_emitter;
 
-/** @brief A private structure used to sort geometry by distance from the camera. */
-typedef struct geometry_distance {
-    /** @brief The geometry render data. */
-    geometry_render_data g;
-    /** @brief The distance from the camera. */
-    f32 distance;
-} geometry_distance;
-
-static i32 geometry_render_data_compare(void* a, void* b) {
-    geometry_render_data* a_typed = a;
-    geometry_render_data* b_typed = b;
-    return a_typed->material.material.handle_index - b_typed->material.material.handle_index;
-}
-
-static i32 geometry_distance_compare(void* a, void* b) {
-    geometry_distance* a_typed = a;
-    geometry_distance* b_typed = b;
-    if (a_typed->distance > b_typed->distance) {
+/** @brief A private structure holding the shared state of a frustum culling pass. */
+typedef struct scene_cull_context {
+    /** @brief The frustum to test against. */
+    const frustum* f;
+    /** @brief The bounds being tested. */
+    const scene_mesh_bounds* bounds;
+    /** @brief The indices of the bounds to be tested. */
+    const u32* indices;
+    /** @brief The result for each index. */
+    b8* out_visible;
+} scene_cull_context;
+
+static i32 raycast_hit_distance_compare(void* a, void* b) {
+    raycast_hit* a_typed = a;
+    raycast_hit* b_typed = b;
+    // NOTE: kquick_sort moves items for which this is positive to the front, so nearest hits come first.
+    if (a_typed->distance < b_typed->distance) {
         return 1;
-    } else if (a_typed->distance < b_typed->distance) {
+    } else if (a_typed->distance > b_typed->distance) {
         return -1;
     }
     return 0;
@@ -115,6 +131,7 @@ b8 scene_create(kresource_scene* config, scene_flags flags, scene* out_scene) {
     // Internal lists of attachments.
     /* out_scene->attachments = darray_create(scene_attachment); */
     out_scene->mesh_attachments = darray_create(scene_attachment);
+    out_scene->mesh_spatials = darray_create(scene_static_mesh_spatial);
     out_scene->terrain_attachments = darray_create(scene_attachment);
     out_scene->skybox_attachments = darray_create(scene_attachment);
     out_scene->directional_light_attachments = darray_create(scene_attachment);
@@ -130,6 +147,11 @@ b8 scene_create(kresource_scene* config, scene_flags flags, scene* out_scene) {
         out_scene->water_plane_metadata = darray_create(scene_water_plane_metadata);
     }
 
+    if (!bvh_create(0, SCENE_MESH_BVH_MARGIN, &out_scene->mesh_bvh)) {
+        KERROR("Failed to create static mesh bvh.");
+        return false;
+    }
+
     if (!hierarchy_graph_create(&out_scene->hierarchy)) {
         KERROR("Failed to create hierarchy graph");
         return false;
@@ -201,6 +223,11 @@ void scene_destroy(scene* s) {
         if (s->mesh_metadata) {
             darray_destroy(s->mesh_metadata);
         }
+        if (s->mesh_spatials) {
+            darray_destroy(s->mesh_spatials);
+        }
+        bvh_destroy(&s->mesh_bvh);
+        scene_mesh_bounds_destroy(&s->mesh_bounds);
 
         if (s->terrains) {
             darray_destroy(s->terrains);
@@ -535,6 +562,7 @@ void scene_node_initialize(scene* s, khandle parent_handle, scene_node_config* n
                         // No empty slot found, so push empty entries and obtain pointers.
                         darray_push(s->static_meshes, (static_mesh_instance){0});
                         darray_push(s->mesh_attachments, (scene_attachment){0});
+                        darray_push(s->mesh_spatials, (scene_static_mesh_spatial){.leaf = INVALID_ID});
                         if (!is_readonly) {
                             darray_push(s->mesh_metadata, (scene_static_mesh_metadata){0});
                         }
@@ -550,6 +578,13 @@ void scene_node_initialize(scene* s, khandle parent_handle, scene_node_config* n
                     attachment->hierarchy_node_handle = hierarchy_node_handle;
                     attachment->attachment_type = SCENE_NODE_ATTACHMENT_TYPE_STATIC_MESH;
 
+                    // The mesh is added to the bvh on update, once it has loaded.
+                    scene_static_mesh_spatial* spatial = &s->mesh_spatials[index];
+                    if (spatial->leaf != INVALID_ID) {
+                        bvh_remove(&s->mesh_bvh, spatial->leaf);
+                        spatial->leaf = INVALID_ID;
+                    }
+
                     // For "edit" mode, retain metadata.
                     if (!is_readonly) {
                         scene_static_mesh_metadata* meta = &s->mesh_metadata[index];
@@ -919,6 +954,9 @@ b8 scene_update(scene* scene, const struct frame_data* p_frame_data) {
     if (scene->state == SCENE_STATE_LOADED) {
         hierarchy_graph_update(&scene->hierarchy);
 
+        // Now that world matrices are up to date, bring mesh bounds and winding up to date as well.
+        scene_mesh_spatial_update(scene);
+
         if (scene->dir_lights) {
             u32 directional_light_count = darray_length(scene->dir_lights);
             for (u32 i = 0; i < directional_light_count; ++i) {
@@ -1158,6 +1196,12 @@ void scene_update_lod_from_view_position(scene* scene, const frame_data* p_frame
             khandle xform_handle = hierarchy_graph_xform_handle_get(&scene->hierarchy, attachment->hierarchy_node_handle);
             mat4 model = xform_world_get(xform_handle);
 
+            // Quadtree terrains select their own nodes and stitching based on the view position in local space.
+            if (t->mode == TERRAIN_MODE_QUADTREE) {
+                terrain_view_update(t, vec3_mul_mat4(view_position, mat4_inverse(model)));
+                continue;
+            }
+
             // Calculate LOD splits based on clip range.
             f32 range = far_clip - near_clip;
 
@@ -1206,11 +1250,12 @@ b8 scene_raycast(scene* scene, const struct ray* r, struct raycast_result* out_r
     // Only create if needed.
     out_result->hits = 0;
 
-    // Iterate meshes in the scene.
-    // TODO: This needs to be optimized. We need some sort of spatial partitioning to speed this up.
-    // Otherwise a scene with thousands of objects will be super slow!
-    u32 mesh_count = darray_length(scene->static_meshes);
-    for (u32 i = 0; i < mesh_count; ++i) {
+    // Only meshes whose bounds the ray passes through need to be tested more precisely.
+    u64* candidates = darray_create(u64);
+    bvh_query_ray(&scene->mesh_bvh, r, K_FLOAT_MAX, &candidates);
+    u32 candidate_count = darray_length(candidates);
+    for (u32 c = 0; c < candidate_count; ++c) {
+        u32 i = (u32)candidates[c];
         static_mesh_instance* m = &scene->static_meshes[i];
 
         // Only count loaded meshes.
@@ -1245,25 +1290,11 @@ b8 scene_raycast(scene* scene, const struct ray* r, struct raycast_result* out_r
             darray_push(out_result->hits, hit);
         }
     }
+    darray_destroy(candidates);
 
     // Sort the results based on distance.
     if (out_result->hits) {
-        b8 swapped;
-        u32 length = darray_length(out_result->hits);
-        for (u32 i = 0; i < length - 1; ++i) {
-            swapped = false;
-            for (u32 j = 0; j < length - 1; ++j) {
-                if (out_result->hits[j].distance > out_result->hits[j + 1].distance) {
-                    KSWAP(raycast_hit, out_result->hits[j], out_result->hits[j + 1]);
-                    swapped = true;
-                }
-            }
-
-            // If no 2 elements were swapped, then sort is complete.
-            if (!swapped) {
-                break;
-            }
-        }
+        kquick_sort(sizeof(raycast_hit), out_result->hits, 0, darray_length(out_result->hits) - 1, raycast_hit_distance_compare);
     }
     return out_result->hits != 0;
 }
@@ -1433,11 +1464,18 @@ b8 scene_mesh_render_data_query_from_line(const scene* scene, vec3 direction, ve
         return true;
     }
 
-    geometry_distance* transparent_geometries = darray_create_with_allocator(geometry_distance, &p_frame_data->allocator);
+    struct material_system_state* material_system = engine_systems_get()->material_system;
+    geometry_render_data* draws = darray_create_with_allocator(geometry_render_data, &p_frame_data->allocator);
+    u64* keys = darray_create_with_allocator(u64, &p_frame_data->allocator);
 
-    u32 mesh_count = darray_length(scene->static_meshes);
-    for (u32 i = 0; i < mesh_count; ++i) {
+    // Only visit meshes whose bounds come near the line.
+    u64* candidates = darray_create_with_allocator(u64, &p_frame_data->allocator);
+    bvh_query_line(&scene->mesh_bvh, center, direction, radius, &candidates);
+    u32 candidate_count = darray_length(candidates);
+    for (u32 c = 0; c < candidate_count; ++c) {
+        u32 i = (u32)candidates[c];
         static_mesh_instance* m = &scene->static_meshes[i];
+        const scene_static_mesh_spatial* spatial = &scene->mesh_spatials[i];
 
         // Only count loaded meshes.
         if (m->mesh_resource->base.state < KRESOURCE_STATE_LOADED) {
@@ -1450,25 +1488,18 @@ b8 scene_mesh_render_data_query_from_line(const scene* scene, vec3 direction, ve
         scene_attachment* attachment = &scene->mesh_attachments[i];
         khandle xform_handle = hierarchy_graph_xform_handle_get(&scene->hierarchy, attachment->hierarchy_node_handle);
         mat4 model = xform_world_get(xform_handle);
-
-        // TODO: Cache this somewhere instead of calculating all the time.
-        f32 determinant = mat4_determinant(model);
-        b8 winding_inverted = determinant < 0;
+        b8 winding_inverted = spatial->winding_inverted;
 
         for (u32 j = 0; j < m->mesh_resource->submesh_count; ++j) {
             static_mesh_submesh* submesh = &m->mesh_resource->submeshes[j];
             kgeometry* g = &submesh->geometry;
             material_instance m_inst = m->material_instances[j];
 
-            // TODO: cache this somewhere...
-            //
-            // Translate/scale the extents.
-            vec3 extents_min = vec3_mul_mat4(g->extents.min, model);
-            vec3 extents_max = vec3_mul_mat4(g->extents.max, model);
-            // Translate/scale the center.
-            vec3 transformed_center = vec3_mul_mat4(g->center, model);
-            // Find the one furthest from the center.
-            f32 mesh_radius = KMAX(vec3_distance(extents_min, transformed_center), vec3_distance(extents_max, transformed_center));
+            // Use the bounding sphere of the cached world-space bounds.
+            const scene_mesh_bounds* bounds = &scene->mesh_bounds;
+            u32 b = spatial->first_bounds + j;
+            vec3 transformed_center = {bounds->centers_x[b], bounds->centers_y[b], bounds->centers_z[b]};
+            f32 mesh_radius = vec3_length((vec3){bounds->extents_x[b], bounds->extents_y[b], bounds->extents_z[b]});
 
             f32 dist_to_line = vec3_distance_to_line(transformed_center, center, direction);
 
@@ -1479,45 +1510,28 @@ b8 scene_mesh_render_data_query_from_line(const scene* scene, vec3 direction, ve
                 data.model = model;
                 data.material = m_inst;
                 data.vertex_count = g->vertex_count;
+                data.vertex_element_size = g->vertex_element_size;
                 data.vertex_buffer_offset = g->vertex_buffer_offset;
                 data.index_count = g->index_count;
+                data.index_element_size = g->index_element_size;
                 data.index_buffer_offset = g->index_buffer_offset;
                 data.unique_id = 0; // m->id.uniqueid; FIXME: Need this for pixel selection.
                 data.winding_inverted = winding_inverted;
-
-                // Check if transparent. If so, put into a separate, temp array to be
-                // sorted by distance from the camera. Otherwise, put into the
-                // out_geometries array directly.
-                b8 has_transparency = material_flag_get(engine_systems_get()->material_system, m_inst.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT);
-                if (has_transparency) {
-                    // For meshes _with_ transparency, add them to a separate list to be sorted by distance later.
-                    // Get the center, extract the global position from the model matrix and add it to the center,
-                    // then calculate the distance between it and the camera, and finally save it to a list to be sorted.
-                    // NOTE: This isn't perfect for translucent meshes that intersect, but is enough for our purposes now.
-                    vec3 geometry_center = vec3_transform(g->center, 1.0f, model);
-                    f32 distance = vec3_distance(geometry_center, center);
-
-                    geometry_distance gdist;
-                    gdist.distance = kabs(distance);
-                    gdist.g = data;
-                    darray_push(transparent_geometries, gdist);
-                } else {
-                    darray_push(*out_geometries, data);
-                }
+                darray_push(draws, data);
+
+                // Key the draw for sorting, using the distance from the center of its bounds to the camera.
+                // NOTE: This isn't perfect for translucent meshes that intersect, but is enough for our purposes now.
+                b8 has_transparency = material_flag_get(material_system, m_inst.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT);
+                kmaterial_type type = material_type_get(material_system, m_inst.material);
+                f32 distance = vec3_distance(transformed_center, center);
+                u64 key = scene_draw_key(has_transparency, type, m_inst.material.handle_index, g->vertex_buffer_offset, distance);
+                darray_push(keys, key);
                 p_frame_data->drawn_mesh_count++;
             }
         }
     }
 
-    // Sort opaque geometries by material.
-    kquick_sort(sizeof(geometry_render_data), *out_geometries, 0, darray_length(*out_geometries) - 1, geometry_render_data_compare);
-
-    // Sort transparent geometries, then add them to the ext_data->geometries array.
-    u32 transparent_geometry_count = darray_length(transparent_geometries);
-    kquick_sort(sizeof(geometry_distance), transparent_geometries, 0, transparent_geometry_count - 1, geometry_distance_compare);
-    for (u32 i = 0; i < transparent_geometry_count; ++i) {
-        darray_push(*out_geometries, transparent_geometries[i].g);
-    }
+    scene_draws_sort_and_push(darray_length(draws), draws, keys, p_frame_data, out_geometries);
 
     *out_count = darray_length(*out_geometries);
 
@@ -1569,6 +1583,7 @@ b8 scene_terrain_render_data_query_from_line(const scene* scene, vec3 direction,
                     data.material = chunk->material;
                     data.vertex_count = chunk->total_vertex_count;
                     data.vertex_buffer_offset = chunk->vertex_buffer_offset;
+                    data.vertex_element_size = sizeof(terrain_vertex);
 
                     // Use the indices for the current LOD.
                     data.index_count = chunk->lods[chunk->current_lod].total_index_count;
@@ -1597,123 +1612,110 @@ b8 scene_mesh_render_data_query(const scene* scene, const frustum* f, vec3 cente
         return true;
     }
 
-    geometry_distance* transparent_geometries = darray_create_with_allocator(geometry_distance, &p_frame_data->allocator);
-
-    // Iterate all meshes in the scene.
-    u32 mesh_count = darray_length(scene->static_meshes);
-    for (u32 resource_index = 0; resource_index < mesh_count; ++resource_index) {
+    // Gather the meshes to consider. With a frustum, the bvh rules out whole groups of meshes at once.
+    u64* candidates = 0;
+    u32 candidate_count = darray_length(scene->static_meshes);
+    if (f) {
+        candidates = darray_create_with_allocator(u64, &p_frame_data->allocator);
+        bvh_query_frustum(&scene->mesh_bvh, f, &candidates);
+        candidate_count = darray_length(candidates);
+    }
+
+    // Then gather the bounds of each of their submeshes. Every mesh in the bvh has bounds reserved
+    // for all of its submeshes, so the bounds count is enough to hold them all.
+    u32 item_count = 0;
+    u32* item_bounds = 0;
+    u32* item_meshes = 0;
+    b8* item_visible = 0;
+    if (scene->mesh_bounds.count) {
+        item_bounds = p_frame_data->allocator.allocate(sizeof(u32) * scene->mesh_bounds.count);
+        item_meshes = p_frame_data->allocator.allocate(sizeof(u32) * scene->mesh_bounds.count);
+        item_visible = p_frame_data->allocator.allocate(sizeof(b8) * scene->mesh_bounds.count);
+    }
+    for (u32 c = 0; c < candidate_count; ++c) {
+        u32 resource_index = candidates ? (u32)candidates[c] : c;
         static_mesh_instance* m = &scene->static_meshes[resource_index];
+        const scene_static_mesh_spatial* spatial = &scene->mesh_spatials[resource_index];
 
-        // Only count loaded meshes.
-        if (m->mesh_resource->base.state < KRESOURCE_STATE_LOADED) {
+        // Only count loaded meshes, which have had their bounds calculated.
+        if (spatial->leaf == INVALID_ID || m->mesh_resource->base.state < KRESOURCE_STATE_LOADED) {
             continue;
         }
         if (!m->material_instances) {
             continue;
         }
-        // Attachment lookup - by resource index.
-        scene_attachment* attachment = &scene->mesh_attachments[resource_index];
-        khandle xform_handle = hierarchy_graph_xform_handle_get(&scene->hierarchy, attachment->hierarchy_node_handle);
-        mat4 model = xform_world_get(xform_handle);
-
-        // TODO: Cache this somewhere instead of calculating all the time.
-        f32 determinant = mat4_determinant(model);
-        b8 winding_inverted = determinant < 0;
-
         for (u32 j = 0; j < m->mesh_resource->submesh_count; ++j) {
-            static_mesh_submesh* submesh = &m->mesh_resource->submeshes[j];
-            kgeometry* g = &submesh->geometry;
-            material_instance m_inst = m->material_instances[j];
-
-            // TODO: Distance-from-line detection per object (e.g. light direction and center pos, then distance check from that line.)
-            //
-            // // Bounding sphere calculation.
-            // {
-            //     // Translate/scale the extents.
-            //     vec3 extents_min = vec3_mul_mat4(g->extents.min, model);
-            //     vec3 extents_max = vec3_mul_mat4(g->extents.max, model);
-
-            //     f32 min = KMIN(KMIN(extents_min.x, extents_min.y),
-            //     extents_min.z); f32 max = KMAX(KMAX(extents_max.x,
-            //     extents_max.y), extents_max.z); f32 diff = kabs(max - min);
-            //     f32 radius = diff * 0.5f;
-
-            //     // Translate/scale the center.
-            //     vec3 center = vec3_mul_mat4(g->center, model);
-
-            //     if (frustum_intersects_sphere(&state->camera_frustum,
-            //     &center, radius)) {
-            //         // Add it to the list to be rendered.
-            //         geometry_render_data data = {0};
-            //         data.model = model;
-            //         data.geometry = g;
-            //         data.unique_id = m->unique_id;
-            //         darray_push(game_inst->frame_data.world_geometries,
-            //         data);
-
-            //         draw_count++;
-            //     }
-            // }
-
-            // AABB calculation
-            {
-                // Translate/scale the extents.
-                // vec3 extents_min = vec3_mul_mat4(g->extents.min, model);
-                vec3 extents_max = vec3_mul_mat4(g->extents.max, model);
-
-                // Translate/scale the center.
-                vec3 g_center = vec3_mul_mat4(g->center, model);
-                vec3 half_extents = {
-                    kabs(extents_max.x - g_center.x),
-                    kabs(extents_max.y - g_center.y),
-                    kabs(extents_max.z - g_center.z),
-                };
-
-                if (!f || frustum_intersects_aabb(f, &g_center, &half_extents)) {
-                    // Add it to the list to be rendered.
-                    geometry_render_data data = {0};
-                    data.model = model;
-                    data.material = m_inst;
-                    data.vertex_count = g->vertex_count;
-                    data.vertex_buffer_offset = g->vertex_buffer_offset;
-                    data.index_count = g->index_count;
-                    data.index_buffer_offset = g->index_buffer_offset;
-                    data.unique_id = 0; // m->id.uniqueid; FIXME: needed for per-pixel selection
-                    data.winding_inverted = winding_inverted;
-
-                    // Check if transparent. If so, put into a separate, temp array to be
-                    // sorted by distance from the camera. Otherwise, put into the
-                    // out_geometries array directly.
-                    b8 has_transparency = material_flag_get(engine_systems_get()->material_system, m_inst.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT);
-                    if (has_transparency) {
-                        // For meshes _with_ transparency, add them to a separate list to be sorted by distance later.
-                        // Get the center, extract the global position from the model matrix and add it to the center,
-                        // then calculate the distance between it and the camera, and finally save it to a list to be sorted.
-                        // NOTE: This isn't perfect for translucent meshes that intersect, but is enough for our purposes now.
-                        f32 distance = vec3_distance(g_center, center);
-
-                        geometry_distance gdist;
-                        gdist.distance = kabs(distance);
-                        gdist.g = data;
-                        darray_push(transparent_geometries, gdist);
-                    } else {
-                        darray_push(*out_geometries, data);
-                    }
-                    p_frame_data->drawn_mesh_count++;
-                }
-            }
+            item_bounds[item_count] = spatial->first_bounds + j;
+            item_meshes[item_count] = resource_index;
+            item_count++;
         }
     }
 
-    // Sort opaque geometries by material.
-    kquick_sort(sizeof(geometry_render_data), *out_geometries, 0, darray_length(*out_geometries) - 1, geometry_render_data_compare);
+    // Test each submesh against the frustum, spreading the work across job threads.
+    if (f) {
+        scene_cull_context cull = {0};
+        cull.f = f;
+        cull.bounds = &scene->mesh_bounds;
+        cull.indices = item_bounds;
+        cull.out_visible = item_visible;
+        job_system_parallel_for(item_count, SCENE_CULL_GRAIN, scene_cull_range, &cull);
+    } else {
+        for (u32 i = 0; i < item_count; ++i) {
+            item_visible[i] = true;
+        }
+    }
 
-    // Sort transparent geometries, then add them to the ext_data->geometries array.
-    u32 transparent_geometry_count = darray_length(transparent_geometries);
-    kquick_sort(sizeof(geometry_distance), transparent_geometries, 0, transparent_geometry_count - 1, geometry_distance_compare);
-    for (u32 i = 0; i < transparent_geometry_count; ++i) {
-        darray_push(*out_geometries, transparent_geometries[i].g);
+    // Build the visible draws, along with keys to sort them by.
+    struct material_system_state* material_system = engine_systems_get()->material_system;
+    geometry_render_data* draws = 0;
+    u64* keys = 0;
+    if (item_count) {
+        draws = p_frame_data->allocator.allocate(sizeof(geometry_render_data) * item_count);
+        keys = p_frame_data->allocator.allocate(sizeof(u64) * item_count);
     }
+    u32 draw_count = 0;
+    for (u32 i = 0; i < item_count; ++i) {
+        if (!item_visible[i]) {
+            continue;
+        }
+
+        u32 resource_index = item_meshes[i];
+        static_mesh_instance* m = &scene->static_meshes[resource_index];
+        const scene_static_mesh_spatial* spatial = &scene->mesh_spatials[resource_index];
+        u32 bounds_index = item_bounds[i];
+        u32 j = bounds_index - spatial->first_bounds;
+        kgeometry* g = &m->mesh_resource->submeshes[j].geometry;
+        material_instance m_inst = m->material_instances[j];
+
+        scene_attachment* attachment = &scene->mesh_attachments[resource_index];
+        khandle xform_handle = hierarchy_graph_xform_handle_get(&scene->hierarchy, attachment->hierarchy_node_handle);
+
+        // Add it to the list to be rendered.
+        geometry_render_data* data = &draws[draw_count];
+        kzero_memory(data, sizeof(geometry_render_data));
+        data->model = xform_world_get(xform_handle);
+        data->material = m_inst;
+        data->vertex_count = g->vertex_count;
+        data->vertex_element_size = g->vertex_element_size;
+        data->vertex_buffer_offset = g->vertex_buffer_offset;
+        data->index_count = g->index_count;
+        data->index_element_size = g->index_element_size;
+        data->index_buffer_offset = g->index_buffer_offset;
+        data->unique_id = 0; // m->id.uniqueid; FIXME: needed for per-pixel selection
+        data->winding_inverted = spatial->winding_inverted;
+
+        // Key the draw for sorting, using the distance from the center of its world-space bounds to the camera.
+        // NOTE: This isn't perfect for translucent meshes that intersect, but is enough for our purposes now.
+        b8 has_transparency = material_flag_get(material_system, m_inst.material, KMATERIAL_FLAG_HAS_TRANSPARENCY_BIT);
+        kmaterial_type type = material_type_get(material_system, m_inst.material);
+        vec3 g_center = {scene->mesh_bounds.centers_x[bounds_index], scene->mesh_bounds.centers_y[bounds_index], scene->mesh_bounds.centers_z[bounds_index]};
+        f32 distance = vec3_distance(g_center, center);
+        keys[draw_count] = scene_draw_key(has_transparency, type, m_inst.material.handle_index, g->vertex_buffer_offset, distance);
+        draw_count++;
+        p_frame_data->drawn_mesh_count++;
+    }
+
+    scene_draws_sort_and_push(draw_count, draws, keys, p_frame_data, out_geometries);
 
     *out_count = darray_length(*out_geometries);
 
@@ -1860,6 +1862,13 @@ static void scene_actual_unload(scene* s) {
 
             static_mesh_system_instance_release(engine_systems_get()->static_mesh_system, &s->static_meshes[i]);
 
+            if (s->mesh_spatials[i].leaf != INVALID_ID) {
+                bvh_remove(&s->mesh_bvh, s->mesh_spatials[i].leaf);
+                s->mesh_spatials[i].leaf = INVALID_ID;
+            }
+            scene_mesh_bounds_release(&s->mesh_bounds, s->mesh_spatials[i].first_bounds, s->mesh_spatials[i].bounds_count);
+            s->mesh_spatials[i].bounds_count = 0;
+
             s->static_meshes->instance_id = INVALID_ID_U64;
         }
     }
@@ -2264,3 +2273,202 @@ static void scene_node_metadata_ensure_allocated(scene* s, u64 handle_index) {
         KWARN("scene_node_metadata_ensure_allocated requires a valid pointer to a scene, and a valid handle index.");
     }
 }
+
+// Returns the world-space box which bounds the given local box once transformed.
+static extents_3d extents_3d_transform(extents_3d local, mat4 model) {
+    vec3 center = vec3_transform(extents_3d_half(local), 1.0f, model);
+    vec3 half = vec3_mul_scalar(vec3_sub(local.max, local.min), 0.5f);
+
+    // Each world axis is covered by the absolute contributions of every local axis.
+    vec3 world_half;
+    for (u32 i = 0; i < 3; ++i) {
+        world_half.elements[i] = kabs(model.data[0 + i]) * half.x + kabs(model.data[4 + i]) * half.y + kabs(model.data[8 + i]) * half.z;
+    }
+    return (extents_3d){vec3_sub(center, world_half), vec3_add(center, world_half)};
+}
+
+// Reserves space for the given number of bounds, returning the index of the first.
+static u32 scene_mesh_bounds_reserve(scene_mesh_bounds* bounds, u32 count) {
+    // Take the first released range which is large enough, if any.
+    u32 free_count = bounds->free_ranges ? darray_length(bounds->free_ranges) : 0;
+    for (u32 i = 0; i < free_count; ++i) {
+        scene_mesh_bounds_range* range = &bounds->free_ranges[i];
+        if (range->count >= count) {
+            u32 first = range->first;
+            range->first += count;
+            range->count -= count;
+            if (!range->count) {
+                darray_pop_at(bounds->free_ranges, i, 0);
+            }
+            return first;
+        }
+    }
+
+    u32 required = bounds->count + count;
+    if (required > bounds->capacity) {
+        u32 new_capacity = KMAX(required, KMAX(bounds->capacity * 2, 64));
+        f32** arrays[6] = {&bounds->centers_x, &bounds->centers_y, &bounds->centers_z, &bounds->extents_x, &bounds->extents_y, &bounds->extents_z};
+        for (u32 i = 0; i < 6; ++i) {
+            f32* new_array = kallocate_aligned(sizeof(f32) * new_capacity, 16, MEMORY_TAG_SCENE);
+            if (*arrays[i]) {
+                kcopy_memory(new_array, *arrays[i], sizeof(f32) * bounds->count);
+                kfree_aligned(*arrays[i], sizeof(f32) * bounds->capacity, 16, MEMORY_TAG_SCENE);
+            }
+            *arrays[i] = new_array;
+        }
+        bounds->capacity = new_capacity;
+    }
+
+    u32 first = bounds->count;
+    bounds->count = required;
+    return first;
+}
+
+// Releases the given range of bounds so it can be reused by a later reservation.
+static void scene_mesh_bounds_release(scene_mesh_bounds* bounds, u32 first, u32 count) {
+    if (!count) {
+        return;
+    }
+    if (!bounds->free_ranges) {
+        bounds->free_ranges = darray_create(scene_mesh_bounds_range);
+    }
+
+    // Merge with any released ranges directly before and after this one.
+    for (u32 i = 0; i < darray_length(bounds->free_ranges);) {
+        scene_mesh_bounds_range* range = &bounds->free_ranges[i];
+        if (range->first + range->count == first) {
+            first = range->first;
+            count += range->count;
+        } else if (first + count == range->first) {
+            count += range->count;
+        } else {
+            ++i;
+            continue;
+        }
+        darray_pop_at(bounds->free_ranges, i, 0);
+    }
+
+    if (first + count == bounds->count) {
+        // Nothing is used past this range, so just shrink instead.
+        bounds->count = first;
+    } else {
+        darray_push(bounds->free_ranges, ((scene_mesh_bounds_range){first, count}));
+    }
+}
+
+static void scene_mesh_bounds_destroy(scene_mesh_bounds* bounds) {
+    f32* arrays[6] = {bounds->centers_x, bounds->centers_y, bounds->centers_z, bounds->extents_x, bounds->extents_y, bounds->extents_z};
+    for (u32 i = 0; i < 6; ++i) {
+        if (arrays[i]) {
+            kfree_aligned(arrays[i], sizeof(f32) * bounds->capacity, 16, MEMORY_TAG_SCENE);
+        }
+    }
+    if (bounds->free_ranges) {
+        darray_destroy(bounds->free_ranges);
+    }
+    kzero_memory(bounds, sizeof(scene_mesh_bounds));
+}
+
+static void scene_cull_range(u32 start, u32 end, void* context) {
+    scene_cull_context* cull = context;
+    const scene_mesh_bounds* b = cull->bounds;
+    frustum_intersects_aabb_batch(cull->f, end - start, cull->indices + start, b->centers_x, b->centers_y, b->centers_z, b->extents_x, b->extents_y, b->extents_z, cull->out_visible + start);
+}
+
+static u64 scene_draw_key(b8 transparent, kmaterial_type type, u32 material_index, u64 vertex_buffer_offset, f32 distance) {
+    u32 depth = ksort_key_from_f32(distance);
+    if (transparent) {
+        // Transparent draws must blend back to front, so they are sorted by depth alone, furthest first.
+        return SCENE_DRAW_KEY_TRANSPARENT_BIT | (u64)(~depth);
+    }
+    // Opaque draws are grouped by shader (determined by material type) and then by material to
+    // minimize state changes, then by geometry so repeated draws of it sit next to each other and can be
+    // instanced. Within that, they are drawn roughly front to back to make the most of early depth tests.
+    // The geometry is identified by a hash of its vertex data offset. Collisions only cost some batching.
+    u32 geometry_hash = (u32)(vertex_buffer_offset ^ (vertex_buffer_offset >> 16) ^ (vertex_buffer_offset >> 32)) & 0xFFFF;
+    return ((u64)((u32)type & 0xFF) << 55) | ((u64)(material_index & 0x7FFFFF) << 32) | ((u64)geometry_hash << 16) | (u64)(depth >> 16);
+}
+
+static void scene_draws_sort_and_push(u32 count, const geometry_render_data* draws, u64* keys, frame_data* p_frame_data, geometry_render_data** out_geometries) {
+    if (!count) {
+        return;
+    }
+
+    // Sort the keys along with the index of each draw, so the draws themselves are only copied once, in order.
+    u32* order = p_frame_data->allocator.allocate(sizeof(u32) * count);
+    u64* scratch_keys = p_frame_data->allocator.allocate(sizeof(u64) * count);
+    u32* scratch_order = p_frame_data->allocator.allocate(sizeof(u32) * count);
+    for (u32 i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    kradix_sort_u64(count, keys, order, scratch_keys, scratch_order);
+
+    for (u32 i = 0; i < count; ++i) {
+        darray_push(*out_geometries, draws[order[i]]);
+    }
+}
+
+static void scene_mesh_spatial_update(scene* s) {
+    u32 mesh_count = darray_length(s->static_meshes);
+    for (u32 i = 0; i < mesh_count; ++i) {
+        static_mesh_instance* m = &s->static_meshes[i];
+        scene_static_mesh_spatial* spatial = &s->mesh_spatials[i];
+
+        // Extents aren't known until the mesh has loaded, so it isn't added before then.
+        b8 loaded = m->instance_id != INVALID_ID_U64 && m->mesh_resource && m->mesh_resource->base.state >= KRESOURCE_STATE_LOADED && m->mesh_resource->submesh_count;
+        if (!loaded) {
+            if (spatial->leaf != INVALID_ID) {
+                bvh_remove(&s->mesh_bvh, spatial->leaf);
+                spatial->leaf = INVALID_ID;
+            }
+            continue;
+        }
+
+        // Only recalculate bounds when the world matrix has changed.
+        khandle xform_handle = hierarchy_graph_xform_handle_get(&s->hierarchy, s->mesh_attachments[i].hierarchy_node_handle);
+        u32 world_version = xform_world_version_get(xform_handle);
+        if (spatial->leaf != INVALID_ID && spatial->world_version == world_version) {
+            continue;
+        }
+
+        // Bounds are kept for as many submeshes as the slot has ever needed. A range which is too small is released for reuse.
+        u32 submesh_count = m->mesh_resource->submesh_count;
+        if (spatial->bounds_count < submesh_count) {
+            scene_mesh_bounds_release(&s->mesh_bounds, spatial->first_bounds, spatial->bounds_count);
+            spatial->first_bounds = scene_mesh_bounds_reserve(&s->mesh_bounds, submesh_count);
+            spatial->bounds_count = submesh_count;
+        }
+
+        mat4 model = khandle_is_invalid(xform_handle) ? mat4_identity() : xform_world_get(xform_handle);
+        spatial->winding_inverted = mat4_determinant(model) < 0.0f;
+
+        // Update the bounds of each submesh, and the mesh as a whole.
+        scene_mesh_bounds* bounds = &s->mesh_bounds;
+        extents_3d mesh_extents = {0};
+        for (u32 j = 0; j < submesh_count; ++j) {
+            extents_3d e = extents_3d_transform(m->mesh_resource->submeshes[j].geometry.extents, model);
+            vec3 center = extents_3d_half(e);
+            u32 b = spatial->first_bounds + j;
+            bounds->centers_x[b] = center.x;
+            bounds->centers_y[b] = center.y;
+            bounds->centers_z[b] = center.z;
+            bounds->extents_x[b] = e.max.x - center.x;
+            bounds->extents_y[b] = e.max.y - center.y;
+            bounds->extents_z[b] = e.max.z - center.z;
+
+            if (j == 0) {
+                mesh_extents = e;
+            } else {
+                mesh_extents.min = vec3_min(mesh_extents.min, e.min);
+                mesh_extents.max = vec3_max(mesh_extents.max, e.max);
+            }
+        }
+
+        if (spatial->leaf == INVALID_ID) {
+            spatial->leaf = bvh_insert(&s->mesh_bvh, mesh_extents, i);
+        } else {
+            bvh_update(&s->mesh_bvh, spatial->leaf, mesh_extents);
+        }
+        spatial->world_version = world_version;
+    }
+}
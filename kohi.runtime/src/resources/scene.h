@@ -5,6 +5,7 @@
 #include "graphs/hierarchy_graph.h"
 #include "identifiers/khandle.h"
 #include "kresources/kresource_types.h"
+#include "math/bvh.h"
 #include "math/math_types.h"
 #include "resources/debug/debug_grid.h"
 #include "resources/resource_types.h"
@@ -73,6 +74,42 @@ typedef struct scene_static_mesh_metadata {
     kname package_name;
 } scene_static_mesh_metadata;
 
+typedef struct scene_static_mesh_spatial {
+    // The mesh's leaf in the scene's bvh. INVALID_ID if not in the bvh (i.e. still loading).
+    bvh_id leaf;
+    // The world version of the mesh's xform when its bounds were last calculated.
+    u32 world_version;
+    // The index of the bounds of the mesh's first submesh in the scene's mesh bounds.
+    u32 first_bounds;
+    // The number of submesh bounds reserved for the mesh.
+    u32 bounds_count;
+    // Indicates if the world matrix inverts the winding order (i.e. has a negative determinant).
+    b8 winding_inverted;
+} scene_static_mesh_spatial;
+
+// A contiguous range of entries in the scene's mesh bounds.
+typedef struct scene_mesh_bounds_range {
+    u32 first;
+    u32 count;
+} scene_mesh_bounds_range;
+
+// World-space bounds of static submeshes. Each component is kept in its own array, so many can be culled at once with SIMD.
+typedef struct scene_mesh_bounds {
+    // The number of bounds in use, including any in free ranges.
+    u32 count;
+    // The number of bounds allocated.
+    u32 capacity;
+    f32* centers_x;
+    f32* centers_y;
+    f32* centers_z;
+    // Half-extents.
+    f32* extents_x;
+    f32* extents_y;
+    f32* extents_z;
+    // Released ranges below count, reused by later reservations. darray
+    scene_mesh_bounds_range* free_ranges;
+} scene_mesh_bounds;
+
 typedef struct scene_terrain_metadata {
     kname name;
     kname resource_name;
@@ -121,6 +158,12 @@ typedef struct scene {
     scene_attachment* mesh_attachments;
     // Array of mesh metadata.
     scene_static_mesh_metadata* mesh_metadata;
+    // Array of mesh spatial data, indexed the same as static_meshes.
+    scene_static_mesh_spatial* mesh_spatials;
+    // A bounding volume hierarchy over the world bounds of static meshes. Leaf user data is the index into static_meshes.
+    bvh mesh_bvh;
+    // The world-space bounds of each static submesh, refit along with the bvh.
+    scene_mesh_bounds mesh_bounds;
 
     // darray of terrains.
     struct terrain* terrains;
@@ -8,19 +8,59 @@
 #include <identifiers/khandle.h>
 #include <logger.h>
 #include <math/kmath.h>
+#include <math/ksimd.h>
 #include <memory/kmemory.h>
 
 #include "kresources/kresource_types.h"
 #include "renderer/renderer_frontend.h"
 #include "renderer/renderer_types.h"
 #include "systems/asset_system.h"
+#include "systems/job_system.h"
 #include "systems/material_system.h"
 
+// The memory budget for quadtree terrain geometry if none is configured, in MiB.
+#define TERRAIN_QUADTREE_DEFAULT_MEMORY_BUDGET_MB 256
+// Quadtree nodes are split when the view is closer than their size times this.
+#define TERRAIN_QUADTREE_DEFAULT_SPLIT_DISTANCE_FACTOR 2.0f
+// The most quadtree node generation jobs which may be in flight at once.
+#define TERRAIN_QUADTREE_MAX_PENDING_JOBS 16
+// Quadtree nodes which haven't been needed for this many view updates are evicted.
+#define TERRAIN_QUADTREE_EVICT_AGE 300
+// The deepest a quadtree may be. Limits the node count to a few million.
+#define TERRAIN_QUADTREE_MAX_LEVEL_COUNT 12
+
+// A pending quadtree node generation job.
+typedef struct terrain_node_job {
+    terrain* t;
+    u32 node_index;
+    u16 job_id;
+    // Set if the terrain is unloaded while the job is pending, in which case the results are discarded.
+    b8 cancelled;
+    // The area to generate, in tiles.
+    u32 tile_offset_x;
+    u32 tile_offset_z;
+    u32 tile_step;
+    // Kept here so the vertices can be freed even if the terrain is gone.
+    u32 vertex_count;
+    terrain_vertex* vertices;
+} terrain_node_job;
+
 static void terrain_chunk_destroy(terrain* t, terrain_chunk* chunk);
 static void terrain_chunk_calculate_geometry(terrain* t, terrain_chunk* chunk, u32 chunk_offset_x, u32 chunk_offset_z);
+static void terrain_vertices_generate(const terrain* t, u32 tile_offset_x, u32 tile_offset_z, u32 tile_step, terrain_vertex* vertices, extents_3d* out_extents);
+static void terrain_lod_counts_set(u32 chunk_size, u32 lod_level, terrain_chunk_lod* lod);
+static void terrain_lod_indices_generate(u32 chunk_size, u32 lod_level, terrain_chunk_lod* lod);
 static void generate_and_load_geometry(terrain* t);
 static void kasset_heightmap_result(asset_request_result result, const struct kasset* asset, void* listener_inst);
 
+static b8 quadtree_supported(const terrain* t);
+static b8 quadtree_create(terrain* t);
+static void quadtree_unload(terrain* t);
+static void quadtree_destroy(terrain* t);
+static b8 terrain_lods_create(terrain* t);
+static void terrain_lods_unload(terrain* t);
+static void terrain_lods_destroy(terrain* t);
+
 typedef enum terrain_skirt_side {
     TSS_LEFT = 0,
     TSS_RIGHT = 1,
@@ -52,7 +92,9 @@ void terrain_destroy(terrain* t) {
         }
     }
 
-    if (t->chunks) {
+    if (t->mode == TERRAIN_MODE_QUADTREE) {
+        quadtree_destroy(t);
+    } else if (t->chunks) {
         for (u32 i = 0; i < t->chunk_count; ++i) {
             terrain_chunk* chunk = &t->chunks[i];
             terrain_chunk_destroy(t, chunk);
@@ -62,6 +104,7 @@ void terrain_destroy(terrain* t) {
         t->chunks = 0;
         t->chunk_count = 0;
     }
+    terrain_lods_destroy(t);
 
     if (t->material_names) {
         kfree(t->material_names, sizeof(char*) * t->material_count, MEMORY_TAG_ARRAY);
@@ -112,6 +155,10 @@ b8 terrain_load(terrain* t) {
 
     t->chunk_size = typed_resource->chunk_size;
 
+    t->mode = typed_resource->use_quadtree ? TERRAIN_MODE_QUADTREE : TERRAIN_MODE_CHUNKED;
+    u32 memory_budget_mb = typed_resource->memory_budget_mb ? typed_resource->memory_budget_mb : TERRAIN_QUADTREE_DEFAULT_MEMORY_BUDGET_MB;
+    t->quadtree.memory_budget = (u64)memory_budget_mb * 1024 * 1024;
+
     t->extents = (extents_3d){0};
     t->origin = vec3_zero();
 
@@ -149,8 +196,9 @@ b8 terrain_load(terrain* t) {
         KWARN("No heightmap was included, using reasonable defaults for terrain generation.");
         t->tile_count_x = t->tile_count_z = 128;
         t->chunk_size = 16;
-        t->vertex_data_length = t->tile_count_x * t->tile_count_z;
-        t->vertex_datas = darray_reserve(terrain_vertex_data, t->vertex_data_length);
+        // NOTE: One more row/column of vertices than tiles.
+        t->vertex_data_length = (t->tile_count_x + 1) * (t->tile_count_z + 1);
+        t->vertex_datas = KALLOC_TYPE_CARRAY(terrain_vertex_data, t->vertex_data_length);
 
         generate_and_load_geometry(t);
     }
@@ -176,22 +224,7 @@ b8 terrain_chunk_load(terrain* t, terrain_chunk* chunk) {
         return false;
     }
 
-    // Upload index data for all LODs.
-    renderbuffer* index_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_INDEX);
-    for (u32 i = 0; i < t->lod_count; ++i) {
-        terrain_chunk_lod* lod = &chunk->lods[i];
-        u32 total_size = sizeof(u32) * lod->total_index_count;
-        if (!renderer_renderbuffer_allocate(index_buffer, total_size, &lod->index_buffer_offset)) {
-            KERROR("Failed to allocate memory for terrain chunk lod index data.");
-            return false;
-        }
-
-        // TODO: Passing false here produces a queue wait and should be offloaded to another queue.
-        if (!renderer_renderbuffer_load_range(index_buffer, lod->index_buffer_offset, total_size, lod->indices, false)) {
-            KERROR("Failed to upload index data for terrain chunk lod.");
-            return false;
-        }
-    }
+    // NOTE: Index data is shared by all chunks, and is uploaded once for the terrain.
 
     // Create a terrain material by copying the properties of these materials to a new terrain material.
     // FIXME: Need layered materials for this. This is just using the default standard material for now if nothing exists.
@@ -217,6 +250,11 @@ b8 terrain_unload(terrain* t) {
     // Immediately invalidate the terrain.
     t->generation = INVALID_ID;
 
+    if (t->mode == TERRAIN_MODE_QUADTREE) {
+        quadtree_unload(t);
+        return true;
+    }
+
     b8 has_error = false;
     // Unload all chunks.
     for (u32 i = 0; i < t->chunk_count; ++i) {
@@ -226,6 +264,7 @@ b8 terrain_unload(terrain* t) {
             has_error = true; // Flag the error, but continue.
         }
     }
+    terrain_lods_unload(t);
 
     return !has_error;
 }
@@ -256,20 +295,6 @@ b8 terrain_chunk_unload(terrain* t, terrain_chunk* chunk) {
         }
     }
 
-    // Release each LOD.
-    if (chunk->lods) {
-        renderbuffer* index_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_INDEX);
-        for (u32 j = 0; j < t->lod_count; ++j) {
-            terrain_chunk_lod* lod = &chunk->lods[j];
-            if (lod->indices) {
-                if (!renderer_renderbuffer_free(index_buffer, sizeof(u32) * lod->total_index_count, lod->index_buffer_offset)) {
-                    KERROR("Error freeing vertex data for terrain chunk, lod level=%u. See logs for details.", j);
-                    has_error = true; // Flag that an error occurred.
-                }
-            }
-        }
-    }
-
     return !has_error;
 }
 
@@ -298,56 +323,43 @@ static void terrain_chunk_destroy(terrain* t, terrain_chunk* chunk) {
         chunk->total_vertex_count = 0;
     }
 
-    // Destroy each LOD.
-    if (chunk->lods) {
-        for (u32 j = 0; j < t->lod_count; ++j) {
-            terrain_chunk_lod* lod = &chunk->lods[j];
-            if (lod->indices) {
-                kfree(lod->indices, sizeof(u32) * lod->total_index_count, MEMORY_TAG_ARRAY);
-            }
-        }
-        // Make sure to clean up the lods data as well.
-        kfree(chunk->lods, sizeof(terrain_chunk_lod) * t->lod_count, MEMORY_TAG_ARRAY);
-        chunk->lods = 0;
-    }
+    // NOTE: LODs are owned by the terrain.
+    chunk->lods = 0;
 }
 
-// Calculates vertex data as well as sets up index data for each LOD for the given chunk.
+// Calculates vertex data for the given chunk. Only writes to the chunk, so may be called from any thread.
 static void terrain_chunk_calculate_geometry(terrain* t, terrain_chunk* chunk, u32 chunk_offset_x, u32 chunk_offset_z) {
-    // The base x/z position of the first vertex within the chunk.
-    f32 chunk_base_pos_x = chunk_offset_x * t->chunk_size * t->tile_scale_x;
-    f32 chunk_base_pos_z = chunk_offset_z * t->chunk_size * t->tile_scale_z;
+    terrain_vertices_generate(t, chunk_offset_x * t->chunk_size, chunk_offset_z * t->chunk_size, 1, chunk->vertices, &chunk->extents);
+    chunk->center = extents_3d_half(chunk->extents);
+
+    // Only generate based on first LOD, others should naturally interpolate as verts are skipped.
+    terrain_geometry_generate_normals(chunk->surface_vertex_count, chunk->vertices, chunk->lods[0].surface_index_count, chunk->lods[0].indices);
+    terrain_geometry_generate_tangents(chunk->surface_vertex_count, chunk->vertices, chunk->lods[0].surface_index_count, chunk->lods[0].indices);
+}
 
+// Generates surface and skirt vertices for an area of chunk_size tiles square, starting at the given
+// tile and sampling every tile_step tiles. Only reads the terrain, so may be called from any thread.
+static void terrain_vertices_generate(const terrain* t, u32 tile_offset_x, u32 tile_offset_z, u32 tile_step, terrain_vertex* vertices, extents_3d* out_extents) {
     f32 y_min = 99999.0f;
     f32 y_max = -99999.0f;
 
     // Generate surface data.
     // NOTE: One more row/column at the end so there are chunk_size number of tiles.
     u32 vertex_stride = t->chunk_size + 1;
+    u32 surface_vertex_count = vertex_stride * vertex_stride;
     for (u32 z = 0, i = 0; z < vertex_stride; ++z) {
         for (u32 x = 0; x < vertex_stride; ++x, ++i) {
-            terrain_vertex* v = &chunk->vertices[i];
-            v->position.x = chunk_base_pos_x + (x * t->tile_scale_x);
-            v->position.z = chunk_base_pos_z + (z * t->tile_scale_z);
-
-            // Get global x/y offset into the terrain tile array.
-            // NOTE: Because of the extra row and
-            // column of vertices, the first row/column of this chunk must be the
-            // same as the previous in that direction.
-            i32 globalx = x + (chunk_offset_x * (vertex_stride));
-            if (chunk_offset_x > 0) {
-                globalx -= chunk_offset_x;
-            }
-            i32 globalz = z + (chunk_offset_z * (vertex_stride));
-            if (chunk_offset_z > 0) {
-                globalz -= chunk_offset_z;
-            }
+            terrain_vertex* v = &vertices[i];
 
-            u32 global_terrain_index = globalx + (globalz * (t->tile_count_x + 1));
-            if (global_terrain_index < 0) {
-                global_terrain_index = 0;
-            }
+            // Get global x/z offset into the terrain tile array.
+            // NOTE: Because of the extra row and column of vertices, the first row/column of this
+            // area is the same as the last of the previous one in that direction.
+            u32 tile_x = tile_offset_x + (x * tile_step);
+            u32 tile_z = tile_offset_z + (z * tile_step);
+            v->position.x = tile_x * t->tile_scale_x;
+            v->position.z = tile_z * t->tile_scale_z;
 
+            u32 global_terrain_index = tile_x + (tile_z * (t->tile_count_x + 1));
             terrain_vertex_data* vert_data = &t->vertex_datas[global_terrain_index];
             f32 point_height = vert_data->height;
 
@@ -357,8 +369,8 @@ static void terrain_chunk_calculate_geometry(terrain* t, terrain_chunk* chunk, u
 
             v->colour = vec4_one(); // white;
             v->normal = (vec3){0, 1, 0};
-            v->texcoord.x = chunk_offset_x + (f32)x;
-            v->texcoord.y = chunk_offset_z + (f32)z;
+            v->texcoord.x = (f32)tile_x;
+            v->texcoord.y = (f32)tile_z;
 
             // NOTE: Assigning default weights based on overall height. Lower material indices are
             // lower in altitude.
@@ -370,189 +382,379 @@ static void terrain_chunk_calculate_geometry(terrain* t, terrain_chunk* chunk, u
         }
     }
 
+    // Coarser areas can leave larger gaps between themselves and their neighbours, so need deeper skirts.
+    f32 skirt_depth = 0.1f * tile_step * t->scale_y;
+
     // Generate skirt data for each side.
-    u32 vvi = chunk->surface_vertex_count;
+    u32 vvi = surface_vertex_count;
     // Order is important here: Left, right, top, then bottom.
     for (u8 s = 0; s < TSS_COUNT; ++s) {
         // Left
         for (u32 i = 0; i < vertex_stride; ++i, ++vvi) {
             // Source vertex
-            terrain_vertex* sv;
+            const terrain_vertex* sv;
             if (s == TSS_LEFT) {
-                sv = &chunk->vertices[i * vertex_stride];
+                sv = &vertices[i * vertex_stride];
             } else if (s == TSS_RIGHT) {
-                sv = &chunk->vertices[(i * vertex_stride) + t->chunk_size];
+                sv = &vertices[(i * vertex_stride) + t->chunk_size];
             } else if (s == TSS_TOP) {
-                sv = &chunk->vertices[i];
+                sv = &vertices[i];
             } else { // TSS_BOTTOM
-                sv = &chunk->vertices[i + (vertex_stride * t->chunk_size)];
+                sv = &vertices[i + (vertex_stride * t->chunk_size)];
             }
 
             // Target vertex
-            terrain_vertex* v = &chunk->vertices[vvi];
+            terrain_vertex* v = &vertices[vvi];
 
             // Copy the source vertex data to the target, then change the height.
             kcopy_memory(v, sv, sizeof(terrain_vertex));
-            v->position.y -= 0.1f * t->scale_y;
+            v->position.y -= skirt_depth;
         }
     }
 
-    // Calculate extents for this chunk.
+    // Calculate extents for this area.
     // Use the first surface vertex for the min extents.
-    chunk->extents.min = chunk->vertices[0].position;
-    chunk->extents.min.y = y_min;
+    out_extents->min = vertices[0].position;
+    out_extents->min.y = y_min;
     // Use the last surface vertex for the max extents.
-    chunk->extents.max = chunk->vertices[chunk->surface_vertex_count - 1].position;
-    chunk->extents.max.y = y_max;
+    out_extents->max = vertices[surface_vertex_count - 1].position;
+    out_extents->max.y = y_max;
+}
 
-    chunk->center = extents_3d_half(chunk->extents);
+// Sets the index counts of the given LOD for an area of chunk_size tiles square.
+static void terrain_lod_counts_set(u32 chunk_size, u32 lod_level, terrain_chunk_lod* lod) {
+    // The number of tiles along each side at this LOD, matching the loops in terrain_lod_indices_generate.
+    u32 lod_tile_stride = (chunk_size + (1 << lod_level) - 1) >> lod_level;
+    lod->surface_index_count = (lod_tile_stride * lod_tile_stride) * 6;
+    lod->total_index_count = lod->surface_index_count + (lod_tile_stride * 6 * 4);
+}
 
-    // Generate indices for each LOD.
-    for (u32 j = 0; j < t->lod_count; ++j) {
-        terrain_chunk_lod* lod = &chunk->lods[j];
-
-        // The number of vertices that loops move forward per loop for this LOD.
-        u32 lod_skip_rate = (1 << j);
-
-        // Surface indices. Generate 1 set of 6 per tile.
-        for (u32 row = 0, i = 0; row < t->chunk_size; row += lod_skip_rate) {
-            for (u32 col = 0; col < t->chunk_size; col += lod_skip_rate, i += 6) {
-                u32 next_row = row + lod_skip_rate;
-                u32 next_col = col + lod_skip_rate;
-                u32 v0 = (row * vertex_stride) + col;
-                u32 v1 = (row * vertex_stride) + next_col;
-                u32 v2 = (next_row * vertex_stride) + col;
-                u32 v3 = (next_row * vertex_stride) + next_col;
-
-                lod->indices[i + 0] = v2;
-                lod->indices[i + 1] = v1;
-                lod->indices[i + 2] = v0;
-                lod->indices[i + 3] = v3;
-                lod->indices[i + 4] = v1;
-                lod->indices[i + 5] = v2;
-            }
+// Generates the surface and skirt indices of the given LOD for an area of chunk_size tiles square.
+// The LOD's counts must already be set, and its index array allocated.
+static void terrain_lod_indices_generate(u32 chunk_size, u32 lod_level, terrain_chunk_lod* lod) {
+    u32 vertex_stride = chunk_size + 1;
+    u32 surface_vertex_count = vertex_stride * vertex_stride;
+
+    // The number of vertices that loops move forward per loop for this LOD.
+    u32 lod_skip_rate = (1 << lod_level);
+
+    // Surface indices. Generate 1 set of 6 per tile.
+    for (u32 row = 0, i = 0; row < chunk_size; row += lod_skip_rate) {
+        for (u32 col = 0; col < chunk_size; col += lod_skip_rate, i += 6) {
+            u32 next_row = row + lod_skip_rate;
+            u32 next_col = col + lod_skip_rate;
+            u32 v0 = (row * vertex_stride) + col;
+            u32 v1 = (row * vertex_stride) + next_col;
+            u32 v2 = (next_row * vertex_stride) + col;
+            u32 v3 = (next_row * vertex_stride) + next_col;
+
+            lod->indices[i + 0] = v2;
+            lod->indices[i + 1] = v1;
+            lod->indices[i + 2] = v0;
+            lod->indices[i + 3] = v3;
+            lod->indices[i + 4] = v1;
+            lod->indices[i + 5] = v2;
         }
+    }
 
-        // Generate skirt indices starting at the end of the vertex and index arrays.
-        u32 ii = lod->surface_index_count;
-        u32 vi = chunk->surface_vertex_count;
-
-        // Order is important here: Left, right, top, then bottom.
-        for (u8 s = 0; s < TSS_COUNT; ++s) {
-            // Iterate vertices at the lod skip rate.
-            for (u32 i = 0; i < t->chunk_size; i += lod_skip_rate, ii += 6, vi += lod_skip_rate) {
-                // Find the 2 verts along the surface's edge.
-                u32 v0, v1;
-                if (s == TSS_LEFT) {
-                    v0 = i * vertex_stride;
-                    v1 = (i + lod_skip_rate) * vertex_stride;
-                } else if (s == TSS_RIGHT) {
-                    v0 = (i * vertex_stride) + (vertex_stride - 1);
-                    v1 = ((i + lod_skip_rate) * vertex_stride) + (vertex_stride - 1);
-                } else if (s == TSS_TOP) {
-                    v0 = i;
-                    v1 = i + lod_skip_rate;
-                } else { // Bottom
-                    v0 = i + (vertex_stride * t->chunk_size);
-                    v1 = (i + lod_skip_rate) + (vertex_stride * t->chunk_size);
-                }
+    // Generate skirt indices starting at the end of the vertex and index arrays.
+    u32 ii = lod->surface_index_count;
+    u32 vi = surface_vertex_count;
 
-                // The other 2 are the verts directly below that.
-                u32 v2 = vi;
-                u32 v3 = vi + lod_skip_rate;
-
-                if (s == TSS_LEFT || s == TSS_BOTTOM) {
-                    // Counter-clockwise for left and bottom.
-                    lod->indices[ii + 0] = v0;
-                    lod->indices[ii + 1] = v3;
-                    lod->indices[ii + 2] = v1;
-                    lod->indices[ii + 3] = v0;
-                    lod->indices[ii + 4] = v2;
-                    lod->indices[ii + 5] = v3;
-                } else { // Right, top
-                    // Clockwise for right and top.
-                    lod->indices[ii + 0] = v0;
-                    lod->indices[ii + 1] = v1;
-                    lod->indices[ii + 2] = v2;
-                    lod->indices[ii + 3] = v1;
-                    lod->indices[ii + 4] = v3;
-                    lod->indices[ii + 5] = v2;
-                }
+    // Order is important here: Left, right, top, then bottom.
+    for (u8 s = 0; s < TSS_COUNT; ++s) {
+        // Iterate vertices at the lod skip rate.
+        for (u32 i = 0; i < chunk_size; i += lod_skip_rate, ii += 6, vi += lod_skip_rate) {
+            // Find the 2 verts along the surface's edge.
+            u32 v0, v1;
+            if (s == TSS_LEFT) {
+                v0 = i * vertex_stride;
+                v1 = (i + lod_skip_rate) * vertex_stride;
+            } else if (s == TSS_RIGHT) {
+                v0 = (i * vertex_stride) + (vertex_stride - 1);
+                v1 = ((i + lod_skip_rate) * vertex_stride) + (vertex_stride - 1);
+            } else if (s == TSS_TOP) {
+                v0 = i;
+                v1 = i + lod_skip_rate;
+            } else { // Bottom
+                v0 = i + (vertex_stride * chunk_size);
+                v1 = (i + lod_skip_rate) + (vertex_stride * chunk_size);
             }
 
-            // Skip the last vertex since the loop above takes i and i + 1.
-            vi++;
+            // The other 2 are the verts directly below that.
+            u32 v2 = vi;
+            u32 v3 = vi + lod_skip_rate;
+
+            if (s == TSS_LEFT || s == TSS_BOTTOM) {
+                // Counter-clockwise for left and bottom.
+                lod->indices[ii + 0] = v0;
+                lod->indices[ii + 1] = v3;
+                lod->indices[ii + 2] = v1;
+                lod->indices[ii + 3] = v0;
+                lod->indices[ii + 4] = v2;
+                lod->indices[ii + 5] = v3;
+            } else { // Right, top
+                // Clockwise for right and top.
+                lod->indices[ii + 0] = v0;
+                lod->indices[ii + 1] = v1;
+                lod->indices[ii + 2] = v2;
+                lod->indices[ii + 3] = v1;
+                lod->indices[ii + 4] = v3;
+                lod->indices[ii + 5] = v2;
+            }
         }
-    }
 
-    // Only generate based on first LOD, others should naturally interpolate as verts are skipped.
-    terrain_geometry_generate_normals(chunk->surface_vertex_count, chunk->vertices, chunk->lods[0].surface_index_count, chunk->lods[0].indices);
-    terrain_geometry_generate_tangents(chunk->surface_vertex_count, chunk->vertices, chunk->lods[0].surface_index_count, chunk->lods[0].indices);
+        // Skip the last vertex since the loop above takes i and i + 1.
+        vi++;
+    }
 }
 
 // FIXME: These should be made more generic and be rolled back into geometry utils in core.
-void terrain_geometry_generate_normals(u32 vertex_count, terrain_vertex* vertices, u32 index_count, u32* indices) {
-    for (u32 i = 0; i < index_count; i += 3) {
-        u32 i0 = indices[i + 0];
-        u32 i1 = indices[i + 1];
-        u32 i2 = indices[i + 2];
+// Gathers the position of the given corner of up to 4 consecutive triangles into lanes, one per
+// component. The last triangle is repeated to fill any remaining lanes.
+static void triangle_corner_positions_gather(const terrain_vertex* vertices, const u32* indices, u32 first_index, u32 lane_count, u32 corner, ksimd_f32x4* out_x, ksimd_f32x4* out_y, ksimd_f32x4* out_z) {
+    f32 x[4], y[4], z[4];
+    for (u32 l = 0; l < 4; ++l) {
+        const terrain_vertex* v = &vertices[indices[first_index + (KMIN(l, lane_count - 1) * 3) + corner]];
+        x[l] = v->position.x;
+        y[l] = v->position.y;
+        z[l] = v->position.z;
+    }
+    *out_x = ksimd_f32x4_load(x);
+    *out_y = ksimd_f32x4_load(y);
+    *out_z = ksimd_f32x4_load(z);
+}
 
-        vec3 edge1 = vec3_sub(vertices[i1].position, vertices[i0].position);
-        vec3 edge2 = vec3_sub(vertices[i2].position, vertices[i0].position);
+// Gathers the texture coordinate of the given corner of up to 4 consecutive triangles into lanes.
+static void triangle_corner_texcoords_gather(const terrain_vertex* vertices, const u32* indices, u32 first_index, u32 lane_count, u32 corner, ksimd_f32x4* out_u, ksimd_f32x4* out_v) {
+    f32 u[4], v[4];
+    for (u32 l = 0; l < 4; ++l) {
+        const terrain_vertex* vert = &vertices[indices[first_index + (KMIN(l, lane_count - 1) * 3) + corner]];
+        u[l] = vert->texcoord.x;
+        v[l] = vert->texcoord.y;
+    }
+    *out_u = ksimd_f32x4_load(u);
+    *out_v = ksimd_f32x4_load(v);
+}
 
-        vec3 normal = vec3_normalized(vec3_cross(edge1, edge2));
+// Normalizes the given vectors, one per lane.
+static void lanes_normalize(ksimd_f32x4* x, ksimd_f32x4* y, ksimd_f32x4* z) {
+    ksimd_f32x4 length_sq = ksimd_f32x4_mul(*x, *x);
+    length_sq = ksimd_f32x4_mul_add(*y, *y, length_sq);
+    length_sq = ksimd_f32x4_mul_add(*z, *z, length_sq);
+    ksimd_f32x4 length = ksimd_f32x4_sqrt(length_sq);
+    *x = ksimd_f32x4_div(*x, length);
+    *y = ksimd_f32x4_div(*y, length);
+    *z = ksimd_f32x4_div(*z, length);
+}
+
+void terrain_geometry_generate_normals(u32 vertex_count, terrain_vertex* vertices, u32 index_count, u32* indices) {
+    // Triangles are processed 4 at a time, one per lane.
+    u32 triangle_count = index_count / 3;
+    for (u32 tri = 0; tri < triangle_count; tri += 4) {
+        u32 lane_count = KMIN(triangle_count - tri, 4);
+        u32 first_index = tri * 3;
+
+        ksimd_f32x4 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+        triangle_corner_positions_gather(vertices, indices, first_index, lane_count, 0, &x0, &y0, &z0);
+        triangle_corner_positions_gather(vertices, indices, first_index, lane_count, 1, &x1, &y1, &z1);
+        triangle_corner_positions_gather(vertices, indices, first_index, lane_count, 2, &x2, &y2, &z2);
+
+        ksimd_f32x4 e1x = ksimd_f32x4_sub(x1, x0);
+        ksimd_f32x4 e1y = ksimd_f32x4_sub(y1, y0);
+        ksimd_f32x4 e1z = ksimd_f32x4_sub(z1, z0);
+        ksimd_f32x4 e2x = ksimd_f32x4_sub(x2, x0);
+        ksimd_f32x4 e2y = ksimd_f32x4_sub(y2, y0);
+        ksimd_f32x4 e2z = ksimd_f32x4_sub(z2, z0);
+
+        // cross(edge1, edge2)
+        ksimd_f32x4 nx = ksimd_f32x4_sub(ksimd_f32x4_mul(e1y, e2z), ksimd_f32x4_mul(e1z, e2y));
+        ksimd_f32x4 ny = ksimd_f32x4_sub(ksimd_f32x4_mul(e1z, e2x), ksimd_f32x4_mul(e1x, e2z));
+        ksimd_f32x4 nz = ksimd_f32x4_sub(ksimd_f32x4_mul(e1x, e2y), ksimd_f32x4_mul(e1y, e2x));
+        lanes_normalize(&nx, &ny, &nz);
+
+        f32 out_x[4], out_y[4], out_z[4];
+        ksimd_f32x4_store(out_x, nx);
+        ksimd_f32x4_store(out_y, ny);
+        ksimd_f32x4_store(out_z, nz);
 
         // NOTE: This just generates a face normal. Smoothing out should be done in
-        // a separate pass if desired.
-        vertices[i0].normal = normal;
-        vertices[i1].normal = normal;
-        vertices[i2].normal = normal;
+        // a separate pass if desired. Written back in triangle order, so shared vertices
+        // take the normal of the last triangle using them, as they always have.
+        for (u32 l = 0; l < lane_count; ++l) {
+            vec3 normal = (vec3){out_x[l], out_y[l], out_z[l]};
+            vertices[indices[first_index + (l * 3) + 0]].normal = normal;
+            vertices[indices[first_index + (l * 3) + 1]].normal = normal;
+            vertices[indices[first_index + (l * 3) + 2]].normal = normal;
+        }
     }
 }
 
 void terrain_geometry_generate_tangents(u32 vertex_count, terrain_vertex* vertices, u32 index_count, u32* indices) {
-    for (u32 i = 0; i < index_count; i += 3) {
-        u32 i0 = indices[i + 0];
-        u32 i1 = indices[i + 1];
-        u32 i2 = indices[i + 2];
+    // Triangles are processed 4 at a time, one per lane.
+    u32 triangle_count = index_count / 3;
+    for (u32 tri = 0; tri < triangle_count; tri += 4) {
+        u32 lane_count = KMIN(triangle_count - tri, 4);
+        u32 first_index = tri * 3;
+
+        ksimd_f32x4 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+        triangle_corner_positions_gather(vertices, indices, first_index, lane_count, 0, &x0, &y0, &z0);
+        triangle_corner_positions_gather(vertices, indices, first_index, lane_count, 1, &x1, &y1, &z1);
+        triangle_corner_positions_gather(vertices, indices, first_index, lane_count, 2, &x2, &y2, &z2);
+        ksimd_f32x4 u0, v0, u1, v1, u2, v2;
+        triangle_corner_texcoords_gather(vertices, indices, first_index, lane_count, 0, &u0, &v0);
+        triangle_corner_texcoords_gather(vertices, indices, first_index, lane_count, 1, &u1, &v1);
+        triangle_corner_texcoords_gather(vertices, indices, first_index, lane_count, 2, &u2, &v2);
+
+        ksimd_f32x4 e1x = ksimd_f32x4_sub(x1, x0);
+        ksimd_f32x4 e1y = ksimd_f32x4_sub(y1, y0);
+        ksimd_f32x4 e1z = ksimd_f32x4_sub(z1, z0);
+        ksimd_f32x4 e2x = ksimd_f32x4_sub(x2, x0);
+        ksimd_f32x4 e2y = ksimd_f32x4_sub(y2, y0);
+        ksimd_f32x4 e2z = ksimd_f32x4_sub(z2, z0);
+
+        ksimd_f32x4 delta_u1 = ksimd_f32x4_sub(u1, u0);
+        ksimd_f32x4 delta_v1 = ksimd_f32x4_sub(v1, v0);
+        ksimd_f32x4 delta_u2 = ksimd_f32x4_sub(u2, u0);
+        ksimd_f32x4 delta_v2 = ksimd_f32x4_sub(v2, v0);
+
+        ksimd_f32x4 dividend = ksimd_f32x4_sub(ksimd_f32x4_mul(delta_u1, delta_v2), ksimd_f32x4_mul(delta_u2, delta_v1));
+        ksimd_f32x4 fc = ksimd_f32x4_div(ksimd_f32x4_set1(1.0f), dividend);
+
+        ksimd_f32x4 tx = ksimd_f32x4_mul(fc, ksimd_f32x4_sub(ksimd_f32x4_mul(delta_v2, e1x), ksimd_f32x4_mul(delta_v1, e2x)));
+        ksimd_f32x4 ty = ksimd_f32x4_mul(fc, ksimd_f32x4_sub(ksimd_f32x4_mul(delta_v2, e1y), ksimd_f32x4_mul(delta_v1, e2y)));
+        ksimd_f32x4 tz = ksimd_f32x4_mul(fc, ksimd_f32x4_sub(ksimd_f32x4_mul(delta_v2, e1z), ksimd_f32x4_mul(delta_v1, e2z)));
+        lanes_normalize(&tx, &ty, &tz);
+
+        f32 out_x[4], out_y[4], out_z[4], out_dividend[4];
+        ksimd_f32x4_store(out_x, tx);
+        ksimd_f32x4_store(out_y, ty);
+        ksimd_f32x4_store(out_z, tz);
+        ksimd_f32x4_store(out_dividend, dividend);
+
+        for (u32 l = 0; l < lane_count; ++l) {
+            // The texture space is mirrored when the winding of the texture coordinates is reversed.
+            f32 handedness = (out_dividend[l] > 0.0f) ? -1.0f : 1.0f;
+            vec4 t4 = (vec4){out_x[l] * handedness, out_y[l] * handedness, out_z[l] * handedness, 0.0f};
+            vertices[indices[first_index + (l * 3) + 0]].tangent = t4;
+            vertices[indices[first_index + (l * 3) + 1]].tangent = t4;
+            vertices[indices[first_index + (l * 3) + 2]].tangent = t4;
+        }
+    }
+}
 
-        vec3 edge1 = vec3_sub(vertices[i1].position, vertices[i0].position);
-        vec3 edge2 = vec3_sub(vertices[i2].position, vertices[i0].position);
+// Calculates the geometry of a range of chunks. Invoked across job threads.
+static void terrain_chunks_calculate_geometry(u32 start, u32 end, void* context) {
+    terrain* t = context;
+    u32 chunk_col_count = t->tile_count_x / t->chunk_size;
+    for (u32 i = start; i < end; ++i) {
+        // x/z chunk indices within terrain grid.
+        u32 chunk_offset_x = i % chunk_col_count;
+        u32 chunk_offset_z = i / chunk_col_count;
+        terrain_chunk_calculate_geometry(t, &t->chunks[i], chunk_offset_x, chunk_offset_z);
+    }
+}
 
-        f32 deltaU1 = vertices[i1].texcoord.x - vertices[i0].texcoord.x;
-        f32 deltaV1 = vertices[i1].texcoord.y - vertices[i0].texcoord.y;
+// Generates and uploads the index data of each LOD, shared by all chunks.
+static b8 terrain_lods_create(terrain* t) {
+    t->lods = KALLOC_TYPE_CARRAY(terrain_chunk_lod, t->lod_count);
+    renderbuffer* index_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_INDEX);
+    for (u32 i = 0; i < t->lod_count; ++i) {
+        terrain_chunk_lod* lod = &t->lods[i];
+        terrain_lod_counts_set(t->chunk_size, i, lod);
+        lod->indices = KALLOC_TYPE_CARRAY(u32, lod->total_index_count);
+        terrain_lod_indices_generate(t->chunk_size, i, lod);
 
-        f32 deltaU2 = vertices[i2].texcoord.x - vertices[i0].texcoord.x;
-        f32 deltaV2 = vertices[i2].texcoord.y - vertices[i0].texcoord.y;
+        u64 total_size = sizeof(u32) * lod->total_index_count;
+        if (!renderer_renderbuffer_allocate(index_buffer, total_size, &lod->index_buffer_offset)) {
+            KERROR("Failed to allocate memory for terrain lod index data.");
+            lod->index_buffer_offset = INVALID_ID_U64;
+            return false;
+        }
 
-        f32 dividend = (deltaU1 * deltaV2 - deltaU2 * deltaV1);
-        f32 fc = 1.0f / dividend;
+        // TODO: Passing false here produces a queue wait and should be offloaded to another queue.
+        if (!renderer_renderbuffer_load_range(index_buffer, lod->index_buffer_offset, total_size, lod->indices, false)) {
+            KERROR("Failed to upload index data for terrain lod.");
+            return false;
+        }
+    }
 
-        vec3 tangent = (vec3){(fc * (deltaV2 * edge1.x - deltaV1 * edge2.x)),
-                              (fc * (deltaV2 * edge1.y - deltaV1 * edge2.y)),
-                              (fc * (deltaV2 * edge1.z - deltaV1 * edge2.z))};
+    return true;
+}
 
-        tangent = vec3_normalized(tangent);
+// Releases the shared LOD index data from the GPU, keeping the host copy.
+static void terrain_lods_unload(terrain* t) {
+    if (!t->lods) {
+        return;
+    }
 
-        f32 sx = deltaU1, sy = deltaU2;
-        f32 tx = deltaV1, ty = deltaV2;
-        f32 handedness = ((tx * sy - ty * sx) < 0.0f) ? -1.0f : 1.0f;
+    renderbuffer* index_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_INDEX);
+    for (u32 i = 0; i < t->lod_count; ++i) {
+        terrain_chunk_lod* lod = &t->lods[i];
+        if (lod->indices && lod->index_buffer_offset != INVALID_ID_U64) {
+            if (!renderer_renderbuffer_free(index_buffer, sizeof(u32) * lod->total_index_count, lod->index_buffer_offset)) {
+                KERROR("Error freeing index data for terrain, lod level=%u. See logs for details.", i);
+            }
+            lod->index_buffer_offset = INVALID_ID_U64;
+        }
+    }
+}
 
-        vec4 t4 = vec4_from_vec3(vec3_mul_scalar(tangent, handedness), 0.0f);
-        vertices[i0].tangent = t4;
-        vertices[i1].tangent = t4;
-        vertices[i2].tangent = t4;
+// Destroys the shared LOD index data, unloading it first if needed.
+static void terrain_lods_destroy(terrain* t) {
+    if (!t->lods) {
+        return;
+    }
+
+    terrain_lods_unload(t);
+    for (u32 i = 0; i < t->lod_count; ++i) {
+        terrain_chunk_lod* lod = &t->lods[i];
+        if (lod->indices) {
+            KFREE_TYPE_CARRAY(lod->indices, u32, lod->total_index_count);
+        }
     }
+    KFREE_TYPE_CARRAY(t->lods, terrain_chunk_lod, t->lod_count);
+    t->lods = 0;
 }
 
 static void generate_and_load_geometry(terrain* t) {
+    if (t->mode == TERRAIN_MODE_QUADTREE) {
+        if (quadtree_supported(t)) {
+            t->id = identifier_create();
+            if (!quadtree_create(t)) {
+                // Clean up the failure.
+                terrain_destroy(t);
+                KERROR("Terrain quadtree failed to load, thus the terrain cannot be loaded.");
+                return;
+            }
+
+            // Mark it as valid for rendering. Nodes are rendered as they become resident.
+            t->generation++;
+
+            t->state = TERRAIN_STATE_LOADED;
+            return;
+        }
+
+        KWARN("Quadtree terrains require a square heightmap whose size is a power-of-two multiple of a power-of-two chunk size. Loading '%s' as a chunked terrain instead.", kname_string_get(t->name));
+        t->mode = TERRAIN_MODE_CHUNKED;
+    }
 
     // The number of detail levels  (LOD) is calculated by first taking the dimension
     // figuring out how many times that number can be divided
     // by 2, taking the floor value (rounding down) and adding 1 to represent the
     // base level. This always leaves a value of at least 1.
+    // NOTE: Any LODs left over from a previous load are destroyed first, while lod_count still matches them.
+    terrain_lods_destroy(t);
     t->lod_count = (u32)(kfloor(klog2(t->chunk_size)) + 1);
 
+    // Index data is the same for every chunk, so only needs to be generated and uploaded once.
+    if (!terrain_lods_create(t)) {
+        // Clean up the failure.
+        terrain_destroy(t);
+        KERROR("Terrain LODs failed to load, thus the terrain cannot be loaded.");
+        return;
+    }
+
     // Setup memory for the chunks.
     t->chunk_count = (t->tile_count_x / t->chunk_size) * (t->tile_count_z / t->chunk_size);
     t->chunks = kallocate(sizeof(terrain_chunk) * t->chunk_count, MEMORY_TAG_ARRAY);
@@ -566,36 +768,15 @@ static void generate_and_load_geometry(terrain* t) {
         chunk->total_vertex_count = chunk->surface_vertex_count + (vertex_stride * 4);
         chunk->vertices = kallocate(sizeof(terrain_vertex) * chunk->total_vertex_count, MEMORY_TAG_ARRAY);
 
-        chunk->lods = kallocate(sizeof(terrain_chunk_lod) * t->lod_count, MEMORY_TAG_ARRAY);
-        for (u32 j = 0; j < t->lod_count; ++j) {
-            terrain_chunk_lod* lod = &chunk->lods[j];
-
-            u32 lod_tile_stride = (j == 0 ? t->chunk_size : (u32)(t->chunk_size * (1.0f / (j * 2))));
-            lod->surface_index_count = (lod_tile_stride * lod_tile_stride) * 6;
-            lod->total_index_count = lod->surface_index_count + (lod_tile_stride * 6 * 4);
-            lod->indices = kallocate(sizeof(u32) * lod->total_index_count, MEMORY_TAG_ARRAY);
-        }
+        chunk->lods = t->lods;
 
         // Invalidate the chunk.
         chunk->generation = INVALID_ID_U16;
     }
 
-    // Height data.
-    t->vertex_data_length = t->vertex_data_length;
-    t->vertex_datas = kallocate(sizeof(terrain_vertex_data) * t->vertex_data_length, MEMORY_TAG_ARRAY);
-    kcopy_memory(t->vertex_datas, t->vertex_datas, t->vertex_data_length * sizeof(terrain_vertex_data));
-
-    u32 chunk_row_count = t->tile_count_z / t->chunk_size;
-    u32 chunk_col_count = t->tile_count_x / t->chunk_size;
-
-    for (u32 z = 0, i = 0; z < chunk_row_count; z++) {
-        for (u32 x = 0; x < chunk_col_count; ++x, ++i) {
-            // x/z chunk indices within terrain grid.
-            u32 chunk_offset_x = i % chunk_col_count;
-            u32 chunk_offset_z = i / chunk_col_count;
-            terrain_chunk_calculate_geometry(t, &t->chunks[i], chunk_offset_x, chunk_offset_z);
-        }
-    }
+    // Chunks are independent of each other, so generate them across job threads.
+    // Uploads still happen below on this thread.
+    job_system_parallel_for(t->chunk_count, 0, terrain_chunks_calculate_geometry, t);
 
     t->id = identifier_create();
 
@@ -623,7 +804,7 @@ static void kasset_heightmap_result(asset_request_result result, const struct ka
         // Process loaded image.
 
         t->vertex_data_length = (typed_asset->width + 1) * (typed_asset->height + 1);
-        t->vertex_datas = darray_reserve(terrain_vertex_data, t->vertex_data_length);
+        t->vertex_datas = KALLOC_TYPE_CARRAY(terrain_vertex_data, t->vertex_data_length);
 
         t->tile_count_x = typed_asset->width;
         t->tile_count_z = typed_asset->height;
@@ -692,9 +873,674 @@ static void kasset_heightmap_result(asset_request_result result, const struct ka
         KWARN("No heightmap was included, using reasonable defaults for terrain generation.");
         t->tile_count_x = t->tile_count_z = 128;
         t->chunk_size = 16;
-        t->vertex_data_length = t->tile_count_x * t->tile_count_z;
-        t->vertex_datas = darray_reserve(terrain_vertex_data, t->vertex_data_length);
+        // NOTE: One more row/column of vertices than tiles.
+        t->vertex_data_length = (t->tile_count_x + 1) * (t->tile_count_z + 1);
+        t->vertex_datas = KALLOC_TYPE_CARRAY(terrain_vertex_data, t->vertex_data_length);
     }
 
     generate_and_load_geometry(t);
 }
+
+// Gets the index of the first node of the given quadtree level. Equal to the node count of all levels above it.
+static u32 quadtree_level_offset(u32 level) {
+    return ((1u << (level * 2)) - 1) / 3;
+}
+
+// Gets the index of the node at the given position within the given level.
+static u32 quadtree_node_index(u32 level, u32 x, u32 z) {
+    return quadtree_level_offset(level) + (z * (1u << level)) + x;
+}
+
+// The size in bytes of the vertex data of a single node.
+static u64 quadtree_node_size(const terrain_quadtree* qt) {
+    return sizeof(terrain_vertex) * qt->node_vertex_count;
+}
+
+// Gets the index of the vertex i along the given side of an area of chunk_size tiles square.
+static u32 side_vertex_index(u32 chunk_size, terrain_skirt_side side, u32 i) {
+    u32 vertex_stride = chunk_size + 1;
+    if (side == TSS_LEFT) {
+        return i * vertex_stride;
+    } else if (side == TSS_RIGHT) {
+        return (i * vertex_stride) + chunk_size;
+    } else if (side == TSS_TOP) {
+        return i;
+    } else { // TSS_BOTTOM
+        return i + (vertex_stride * chunk_size);
+    }
+}
+
+// Builds a vertex remapping for the given stitch mask (one bit per terrain_skirt_side). Every other vertex
+// along a stitched side, as well as the skirt below it, is collapsed into the one before it. This makes
+// the side match the edge of a node one level coarser. Selection keeps neighbouring nodes within one
+// level of each other, so that is the only difference which ever needs stitching.
+static void quadtree_stitch_remap_build(u32 chunk_size, u32 mask, u32* remap) {
+    u32 vertex_stride = chunk_size + 1;
+    u32 surface_vertex_count = vertex_stride * vertex_stride;
+    u32 vertex_count = surface_vertex_count + (vertex_stride * TSS_COUNT);
+    for (u32 i = 0; i < vertex_count; ++i) {
+        remap[i] = i;
+    }
+
+    for (u32 s = 0; s < TSS_COUNT; ++s) {
+        if (!(mask & (1 << s))) {
+            continue;
+        }
+
+        // NOTE: chunk_size is even, so the corners are never collapsed.
+        u32 skirt_start = surface_vertex_count + (s * vertex_stride);
+        for (u32 i = 1; i < vertex_stride; i += 2) {
+            remap[side_vertex_index(chunk_size, s, i)] = side_vertex_index(chunk_size, s, i - 1);
+            remap[skirt_start + i] = skirt_start + i - 1;
+        }
+    }
+}
+
+// Calculates the height range of a range of leaf nodes from the heightmap.
+static void quadtree_leaf_height_ranges_calculate(u32 start, u32 end, void* context) {
+    terrain* t = context;
+    terrain_quadtree* qt = &t->quadtree;
+    u32 leaf_level = qt->level_count - 1;
+    u32 first_leaf = quadtree_level_offset(leaf_level);
+    for (u32 i = start; i < end; ++i) {
+        terrain_quadtree_node* node = &qt->nodes[first_leaf + i];
+        u32 tile_offset_x = node->x * t->chunk_size;
+        u32 tile_offset_z = node->z * t->chunk_size;
+
+        f32 height_min = K_FLOAT_MAX;
+        f32 height_max = -K_FLOAT_MAX;
+        for (u32 z = 0; z <= t->chunk_size; ++z) {
+            for (u32 x = 0; x <= t->chunk_size; ++x) {
+                f32 height = t->vertex_datas[(tile_offset_x + x) + ((tile_offset_z + z) * (t->tile_count_x + 1))].height;
+                height_min = KMIN(height_min, height);
+                height_max = KMAX(height_max, height);
+            }
+        }
+
+        node->extents.min.y = height_min * t->scale_y;
+        node->extents.max.y = height_max * t->scale_y;
+    }
+}
+
+static b8 quadtree_supported(const terrain* t) {
+    u32 chunks_per_side = t->tile_count_x / t->chunk_size;
+    return t->tile_count_x == t->tile_count_z &&
+           t->chunk_size >= 2 && is_power_of_2(t->chunk_size) &&
+           is_power_of_2(chunks_per_side);
+}
+
+static b8 quadtree_create(terrain* t) {
+    terrain_quadtree* qt = &t->quadtree;
+    // Left over from a previous load.
+    if (qt->nodes) {
+        quadtree_destroy(t);
+    }
+
+    // One level per halving of the number of chunks per side, down to a single root node.
+    u32 chunks_per_side = t->tile_count_x / t->chunk_size;
+    qt->level_count = 1;
+    while ((1u << (qt->level_count - 1)) < chunks_per_side) {
+        qt->level_count++;
+    }
+    if (qt->level_count > TERRAIN_QUADTREE_MAX_LEVEL_COUNT) {
+        KERROR("Terrain '%s' is too large for a quadtree (%u levels, max is %u). Use a larger chunk size.", kname_string_get(t->name), qt->level_count, TERRAIN_QUADTREE_MAX_LEVEL_COUNT);
+        return false;
+    }
+    qt->split_distance_factor = TERRAIN_QUADTREE_DEFAULT_SPLIT_DISTANCE_FACTOR;
+    qt->memory_used = 0;
+    qt->pending_job_count = 0;
+    qt->update_count = 0;
+    qt->material.material = khandle_invalid();
+    qt->material.instance = khandle_invalid();
+
+    // Setup the nodes, level by level.
+    qt->node_count = quadtree_level_offset(qt->level_count);
+    qt->nodes = KALLOC_TYPE_CARRAY(terrain_quadtree_node, qt->node_count);
+    for (u32 l = 0; l < qt->level_count; ++l) {
+        u32 side_node_count = 1u << l;
+        // The number of tiles along each side of nodes on this level.
+        u32 node_tile_span = t->chunk_size << (qt->level_count - 1 - l);
+        for (u32 z = 0; z < side_node_count; ++z) {
+            for (u32 x = 0; x < side_node_count; ++x) {
+                terrain_quadtree_node* node = &qt->nodes[quadtree_node_index(l, x, z)];
+                node->state = TERRAIN_NODE_STATE_EMPTY;
+                node->level = (u8)l;
+                node->x = (u16)x;
+                node->z = (u16)z;
+                node->extents.min.x = (x * node_tile_span) * t->tile_scale_x;
+                node->extents.min.z = (z * node_tile_span) * t->tile_scale_z;
+                node->extents.max.x = ((x + 1) * node_tile_span) * t->tile_scale_x;
+                node->extents.max.z = ((z + 1) * node_tile_span) * t->tile_scale_z;
+            }
+        }
+    }
+
+    // Work out the height ranges of the leaves from the heightmap across job threads, then
+    // those of each level above from the level below.
+    job_system_parallel_for(chunks_per_side * chunks_per_side, 0, quadtree_leaf_height_ranges_calculate, t);
+    for (i32 l = (i32)qt->level_count - 2; l >= 0; --l) {
+        u32 side_node_count = 1u << l;
+        for (u32 z = 0; z < side_node_count; ++z) {
+            for (u32 x = 0; x < side_node_count; ++x) {
+                terrain_quadtree_node* node = &qt->nodes[quadtree_node_index(l, x, z)];
+                node->extents.min.y = K_FLOAT_MAX;
+                node->extents.max.y = -K_FLOAT_MAX;
+                for (u32 c = 0; c < 4; ++c) {
+                    const terrain_quadtree_node* child = &qt->nodes[quadtree_node_index(l + 1, (x * 2) + (c & 1), (z * 2) + (c >> 1))];
+                    node->extents.min.y = KMIN(node->extents.min.y, child->extents.min.y);
+                    node->extents.max.y = KMAX(node->extents.max.y, child->extents.max.y);
+                }
+            }
+        }
+    }
+    for (u32 i = 0; i < qt->node_count; ++i) {
+        qt->nodes[i].center = extents_3d_half(qt->nodes[i].extents);
+    }
+
+    // Every node has the same vertex layout as a chunk, so index data can be shared between all of them.
+    // One set is made for each combination of sides which need stitching to a coarser neighbour.
+    u32 vertex_stride = t->chunk_size + 1;
+    qt->node_vertex_count = (vertex_stride * vertex_stride) + (vertex_stride * TSS_COUNT);
+    terrain_chunk_lod base = {0};
+    terrain_lod_counts_set(t->chunk_size, 0, &base);
+    base.indices = KALLOC_TYPE_CARRAY(u32, base.total_index_count);
+    terrain_lod_indices_generate(t->chunk_size, 0, &base);
+
+    u32* remap = KALLOC_TYPE_CARRAY(u32, qt->node_vertex_count);
+    renderbuffer* index_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_INDEX);
+    b8 success = true;
+    for (u32 v = 0; v < TERRAIN_STITCH_VARIANT_COUNT && success; ++v) {
+        terrain_chunk_lod* variant = &qt->stitch_variants[v];
+        variant->surface_index_count = base.surface_index_count;
+        variant->total_index_count = base.total_index_count;
+
+        quadtree_stitch_remap_build(t->chunk_size, v, remap);
+        u32* indices = KALLOC_TYPE_CARRAY(u32, variant->total_index_count);
+        for (u32 i = 0; i < variant->total_index_count; ++i) {
+            indices[i] = remap[base.indices[i]];
+        }
+
+        u64 total_size = sizeof(u32) * variant->total_index_count;
+        if (!renderer_renderbuffer_allocate(index_buffer, total_size, &variant->index_buffer_offset)) {
+            KERROR("Failed to allocate memory for terrain quadtree index data.");
+            KFREE_TYPE_CARRAY(indices, u32, variant->total_index_count);
+            success = false;
+        } else if (!renderer_renderbuffer_load_range(index_buffer, variant->index_buffer_offset, total_size, indices, false)) {
+            KERROR("Failed to upload index data for terrain quadtree.");
+            renderer_renderbuffer_free(index_buffer, total_size, variant->index_buffer_offset);
+            KFREE_TYPE_CARRAY(indices, u32, variant->total_index_count);
+            success = false;
+        } else {
+            // NOTE: Only kept while uploaded. The first is also used to generate node normals and tangents.
+            variant->indices = indices;
+        }
+    }
+    KFREE_TYPE_CARRAY(remap, u32, qt->node_vertex_count);
+    KFREE_TYPE_CARRAY(base.indices, u32, base.total_index_count);
+
+    qt->live_nodes = darray_create(u32);
+    qt->selected_nodes = darray_create(u32);
+    qt->requested_nodes = darray_create(u32);
+    qt->visit_nodes = darray_create(u32);
+    qt->next_visit_nodes = darray_create(u32);
+    t->chunks = darray_create(terrain_chunk);
+    t->chunk_count = 0;
+    t->lod_count = 1;
+
+    if (!success) {
+        return false;
+    }
+
+    // Create a terrain material by copying the properties of these materials to a new terrain material.
+    // FIXME: Need layered materials for this. This is just using the default standard material for now if nothing exists.
+    material_system_acquire(engine_systems_get()->material_system, t->material_name ? t->material_name : kname_create(MATERIAL_DEFAULT_NAME_STANDARD), &qt->material);
+    if (khandle_is_invalid(qt->material.material) || khandle_is_invalid(qt->material.instance)) {
+        KWARN("Failed to acquire terrain material. Using defualt instead.");
+        qt->material = material_system_get_default_blended(engine_systems_get()->material_system);
+    }
+
+    return true;
+}
+
+// Generates a node's geometry on a job thread.
+static b8 quadtree_node_job_entry(void* params, void* result_data) {
+    terrain_node_job* job = *(terrain_node_job**)params;
+    *(terrain_node_job**)result_data = job;
+
+    const terrain* t = job->t;
+    extents_3d extents;
+    terrain_vertices_generate(t, job->tile_offset_x, job->tile_offset_z, job->tile_step, job->vertices, &extents);
+
+    // Only generate based on the full surface, as with chunks.
+    const terrain_chunk_lod* surface = &t->quadtree.stitch_variants[0];
+    u32 surface_vertex_count = (t->chunk_size + 1) * (t->chunk_size + 1);
+    terrain_geometry_generate_normals(surface_vertex_count, job->vertices, surface->surface_index_count, surface->indices);
+    terrain_geometry_generate_tangents(surface_vertex_count, job->vertices, surface->surface_index_count, surface->indices);
+
+    return true;
+}
+
+static void quadtree_node_job_free(terrain_node_job* job) {
+    KFREE_TYPE_CARRAY(job->vertices, terrain_vertex, job->vertex_count);
+    kfree(job, sizeof(terrain_node_job), MEMORY_TAG_JOB);
+}
+
+// Removes the given node from the live nodes.
+static void quadtree_live_node_remove(terrain_quadtree* qt, u32 node_index) {
+    u32 live_count = darray_length(qt->live_nodes);
+    for (u32 i = 0; i < live_count; ++i) {
+        if (qt->live_nodes[i] == node_index) {
+            qt->live_nodes[i] = qt->live_nodes[live_count - 1];
+            darray_length_set(qt->live_nodes, live_count - 1);
+            return;
+        }
+    }
+}
+
+// Uploads a node's generated geometry. Invoked on the main thread.
+static void quadtree_node_job_on_success(void* result_data) {
+    terrain_node_job* job = *(terrain_node_job**)result_data;
+    if (job->cancelled) {
+        // NOTE: The terrain may have been destroyed since, so nothing of it may be touched.
+        quadtree_node_job_free(job);
+        return;
+    }
+
+    terrain* t = job->t;
+    terrain_quadtree* qt = &t->quadtree;
+    terrain_quadtree_node* node = &qt->nodes[job->node_index];
+    qt->pending_job_count--;
+    node->job = 0;
+
+    renderbuffer* vertex_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_VERTEX);
+    u64 size = quadtree_node_size(qt);
+    b8 uploaded = false;
+    if (!renderer_renderbuffer_allocate(vertex_buffer, size, &node->vertex_buffer_offset)) {
+        KERROR("Failed to allocate memory for terrain node vertex data.");
+    } else if (!renderer_renderbuffer_load_range(vertex_buffer, node->vertex_buffer_offset, size, job->vertices, false)) {
+        KERROR("Failed to upload vertex data for terrain node.");
+        renderer_renderbuffer_free(vertex_buffer, size, node->vertex_buffer_offset);
+    } else {
+        uploaded = true;
+    }
+
+    if (uploaded) {
+        node->state = TERRAIN_NODE_STATE_RESIDENT;
+    } else {
+        // Give up on the node for now. It will be requested again if still needed.
+        node->state = TERRAIN_NODE_STATE_EMPTY;
+        qt->memory_used -= size;
+        quadtree_live_node_remove(qt, job->node_index);
+    }
+
+    quadtree_node_job_free(job);
+}
+
+static void quadtree_node_job_on_fail(void* result_data) {
+    // NOTE: The entry point never fails, but handle it the same as a failed upload anyway.
+    terrain_node_job* job = *(terrain_node_job**)result_data;
+    if (!job->cancelled) {
+        terrain_quadtree* qt = &job->t->quadtree;
+        qt->nodes[job->node_index].state = TERRAIN_NODE_STATE_EMPTY;
+        qt->nodes[job->node_index].job = 0;
+        qt->pending_job_count--;
+        qt->memory_used -= quadtree_node_size(qt);
+        quadtree_live_node_remove(qt, job->node_index);
+    }
+    quadtree_node_job_free(job);
+}
+
+// Kicks off generation of the given node's geometry on a job thread.
+static void quadtree_node_request(terrain* t, u32 node_index) {
+    terrain_quadtree* qt = &t->quadtree;
+    terrain_quadtree_node* node = &qt->nodes[node_index];
+
+    terrain_node_job* job = kallocate(sizeof(terrain_node_job), MEMORY_TAG_JOB);
+    job->t = t;
+    job->node_index = node_index;
+    // Nodes all have the same number of vertices, spread further apart the coarser the level.
+    job->tile_step = 1u << (qt->level_count - 1 - node->level);
+    job->tile_offset_x = node->x * t->chunk_size * job->tile_step;
+    job->tile_offset_z = node->z * t->chunk_size * job->tile_step;
+    job->vertex_count = qt->node_vertex_count;
+    job->vertices = KALLOC_TYPE_CARRAY(terrain_vertex, job->vertex_count);
+
+    node->state = TERRAIN_NODE_STATE_GENERATING;
+    node->job = job;
+    qt->memory_used += quadtree_node_size(qt);
+    qt->pending_job_count++;
+    darray_push(qt->live_nodes, node_index);
+
+    // NOTE: Only the pointer is passed, as the job is shared with the main thread in case it gets cancelled.
+    job_info info = job_create(quadtree_node_job_entry, quadtree_node_job_on_success, quadtree_node_job_on_fail, &job, sizeof(terrain_node_job*), sizeof(terrain_node_job*));
+    job->job_id = info.id;
+    job_system_submit(info);
+}
+
+// Evicts the given resident node. The renderer queues the free of its vertex data until no
+// frame in flight can be using it, so the range is not reused while it may still be drawn.
+static void quadtree_node_evict(terrain_quadtree* qt, u32 node_index) {
+    terrain_quadtree_node* node = &qt->nodes[node_index];
+    node->state = TERRAIN_NODE_STATE_EMPTY;
+    qt->memory_used -= quadtree_node_size(qt);
+    quadtree_live_node_remove(qt, node_index);
+
+    renderer_renderbuffer_free(renderer_renderbuffer_get(RENDERBUFFER_TYPE_VERTEX), quadtree_node_size(qt), node->vertex_buffer_offset);
+    node->vertex_buffer_offset = 0;
+}
+
+// Gets the squared distance from the given point to the nearest point of the given extents.
+static f32 extents_distance_squared(extents_3d extents, vec3 point) {
+    f32 dx = KMAX(KMAX(extents.min.x - point.x, 0.0f), point.x - extents.max.x);
+    f32 dy = KMAX(KMAX(extents.min.y - point.y, 0.0f), point.y - extents.max.y);
+    f32 dz = KMAX(KMAX(extents.min.z - point.z, 0.0f), point.z - extents.max.z);
+    return (dx * dx) + (dy * dy) + (dz * dz);
+}
+
+// The offsets to the neighbouring node on each terrain_skirt_side.
+static const i32 quadtree_side_offsets[TSS_COUNT][2] = {
+    {-1, 0}, // TSS_LEFT
+    {1, 0},  // TSS_RIGHT
+    {0, -1}, // TSS_TOP
+    {0, 1},  // TSS_BOTTOM
+};
+
+// Indicates if all nodes bordering the given node on the same level were visited on this update. Only then
+// may it be split, otherwise its children could border a node two levels coarser, which can't be stitched.
+static b8 quadtree_node_neighbours_visited(const terrain_quadtree* qt, const terrain_quadtree_node* node) {
+    i32 side_node_count = 1 << node->level;
+    for (u32 s = 0; s < TSS_COUNT; ++s) {
+        i32 x = node->x + quadtree_side_offsets[s][0];
+        i32 z = node->z + quadtree_side_offsets[s][1];
+        if (x < 0 || z < 0 || x >= side_node_count || z >= side_node_count) {
+            continue;
+        }
+        if (qt->nodes[quadtree_node_index(node->level, x, z)].visited_update != qt->update_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Either selects the given node to be drawn or splits it, queueing its children to be visited on the next level.
+// Requests any missing nodes along the way.
+static void quadtree_node_select(terrain* t, u32 node_index, vec3 view_position) {
+    terrain_quadtree* qt = &t->quadtree;
+    terrain_quadtree_node* node = &qt->nodes[node_index];
+    node->last_used_update = qt->update_count;
+
+    b8 split = false;
+    if (node->level < qt->level_count - 1) {
+        f32 size = node->extents.max.x - node->extents.min.x;
+        f32 split_distance = size * qt->split_distance_factor;
+        if (extents_distance_squared(node->extents, view_position) < split_distance * split_distance) {
+            // Only split once all children are ready, so there is never a hole. Until then this node is drawn instead.
+            // Children are still requested while a neighbour holds back the split, so they are ready once it doesn't.
+            split = quadtree_node_neighbours_visited(qt, node);
+            u32 child_indices[4];
+            for (u32 c = 0; c < 4; ++c) {
+                child_indices[c] = quadtree_node_index(node->level + 1, (node->x * 2) + (c & 1), (node->z * 2) + (c >> 1));
+                terrain_quadtree_node* child = &qt->nodes[child_indices[c]];
+                child->last_used_update = qt->update_count;
+                if (child->state != TERRAIN_NODE_STATE_RESIDENT) {
+                    split = false;
+                    if (child->state == TERRAIN_NODE_STATE_EMPTY) {
+                        darray_push(qt->requested_nodes, child_indices[c]);
+                    }
+                }
+            }
+            if (split) {
+                for (u32 c = 0; c < 4; ++c) {
+                    qt->nodes[child_indices[c]].visited_update = qt->update_count;
+                    darray_push(qt->next_visit_nodes, child_indices[c]);
+                }
+            }
+        }
+    }
+
+    if (!split) {
+        if (node->state == TERRAIN_NODE_STATE_RESIDENT) {
+            node->selected_update = qt->update_count;
+            darray_push(qt->selected_nodes, node_index);
+        } else if (node->state == TERRAIN_NODE_STATE_EMPTY) {
+            darray_push(qt->requested_nodes, node_index);
+        }
+    }
+}
+
+// Selects the nodes to be drawn for the given view position. The tree is walked a level at a time, so that
+// every node on a level is known to be visited or not before any of them are split. A node is only split if
+// all of its neighbours were visited, which keeps selected nodes within one level of their neighbours.
+static void quadtree_select(terrain* t, vec3 view_position) {
+    terrain_quadtree* qt = &t->quadtree;
+    darray_clear(qt->visit_nodes);
+    darray_clear(qt->next_visit_nodes);
+
+    qt->nodes[0].visited_update = qt->update_count;
+    darray_push(qt->visit_nodes, (u32)0);
+    while (darray_length(qt->visit_nodes)) {
+        u32 visit_count = darray_length(qt->visit_nodes);
+        for (u32 i = 0; i < visit_count; ++i) {
+            quadtree_node_select(t, qt->visit_nodes[i], view_position);
+        }
+
+        // The next level becomes the current one.
+        u32* temp = qt->visit_nodes;
+        qt->visit_nodes = qt->next_visit_nodes;
+        qt->next_visit_nodes = temp;
+        darray_clear(qt->next_visit_nodes);
+    }
+}
+
+// Works out which sides of the given selected node border a coarser selected node, one bit per terrain_skirt_side.
+static u32 quadtree_node_stitch_mask(const terrain_quadtree* qt, const terrain_quadtree_node* node) {
+    if (node->level == 0) {
+        return 0;
+    }
+
+    u32 mask = 0;
+    i32 side_node_count = 1 << node->level;
+    for (u32 s = 0; s < TSS_COUNT; ++s) {
+        i32 x = node->x + quadtree_side_offsets[s][0];
+        i32 z = node->z + quadtree_side_offsets[s][1];
+        if (x < 0 || z < 0 || x >= side_node_count || z >= side_node_count) {
+            continue;
+        }
+        // NOTE: Selection never lets neighbours differ by more than one level, so only the parent level is checked.
+        if (qt->nodes[quadtree_node_index(node->level - 1, x >> 1, z >> 1)].selected_update == qt->update_count) {
+            mask |= (1 << s);
+        }
+    }
+
+    return mask;
+}
+
+// Finds the least recently used resident node which can be evicted, if any.
+static b8 quadtree_lru_node_find(const terrain_quadtree* qt, u32* out_node_index) {
+    b8 found = false;
+    u32 oldest_update = qt->update_count;
+    u32 live_count = darray_length(qt->live_nodes);
+    for (u32 i = 0; i < live_count; ++i) {
+        const terrain_quadtree_node* node = &qt->nodes[qt->live_nodes[i]];
+        // The root is always kept so there is something to draw.
+        if (node->state == TERRAIN_NODE_STATE_RESIDENT && qt->live_nodes[i] != 0 && node->last_used_update < oldest_update) {
+            oldest_update = node->last_used_update;
+            *out_node_index = qt->live_nodes[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+void terrain_view_update(terrain* t, vec3 local_view_position) {
+    if (!t || t->mode != TERRAIN_MODE_QUADTREE || t->state != TERRAIN_STATE_LOADED) {
+        return;
+    }
+
+    terrain_quadtree* qt = &t->quadtree;
+    qt->update_count++;
+
+    darray_clear(qt->selected_nodes);
+    darray_clear(qt->requested_nodes);
+    quadtree_select(t, local_view_position);
+
+    // Evict nodes which have not been needed for a while.
+    for (u32 i = 0; i < darray_length(qt->live_nodes);) {
+        u32 node_index = qt->live_nodes[i];
+        const terrain_quadtree_node* node = &qt->nodes[node_index];
+        if (node_index != 0 && node->state == TERRAIN_NODE_STATE_RESIDENT && (qt->update_count - node->last_used_update) > TERRAIN_QUADTREE_EVICT_AGE) {
+            // NOTE: Swaps the last live node into this slot, so don't advance.
+            quadtree_node_evict(qt, node_index);
+        } else {
+            ++i;
+        }
+    }
+
+    // Request missing nodes, coarsest first, within the memory budget.
+    u32 request_count = darray_length(qt->requested_nodes);
+    for (u32 l = 0; l < qt->level_count && qt->pending_job_count < TERRAIN_QUADTREE_MAX_PENDING_JOBS; ++l) {
+        for (u32 i = 0; i < request_count && qt->pending_job_count < TERRAIN_QUADTREE_MAX_PENDING_JOBS; ++i) {
+            u32 node_index = qt->requested_nodes[i];
+            if (qt->nodes[node_index].level != l || qt->nodes[node_index].state != TERRAIN_NODE_STATE_EMPTY) {
+                continue;
+            }
+
+            // Make room by dropping nodes not used this update. If there aren't any, everything resident is needed.
+            b8 has_room = true;
+            while (qt->memory_used + quadtree_node_size(qt) > qt->memory_budget) {
+                u32 lru_index;
+                if (!quadtree_lru_node_find(qt, &lru_index)) {
+                    has_room = false;
+                    break;
+                }
+                quadtree_node_evict(qt, lru_index);
+            }
+            if (!has_room) {
+                break;
+            }
+
+            quadtree_node_request(t, node_index);
+        }
+    }
+
+    // Rebuild the list of chunks to be drawn from the selected nodes.
+    u32 selected_count = darray_length(qt->selected_nodes);
+    darray_length_set(t->chunks, selected_count);
+    for (u32 i = 0; i < selected_count; ++i) {
+        const terrain_quadtree_node* node = &qt->nodes[qt->selected_nodes[i]];
+        terrain_chunk* chunk = &t->chunks[i];
+        kzero_memory(chunk, sizeof(terrain_chunk));
+        chunk->generation = 0;
+        chunk->total_vertex_count = qt->node_vertex_count;
+        chunk->surface_vertex_count = (t->chunk_size + 1) * (t->chunk_size + 1);
+        chunk->vertex_buffer_offset = node->vertex_buffer_offset;
+        chunk->lods = qt->stitch_variants;
+        chunk->current_lod = (u8)quadtree_node_stitch_mask(qt, node);
+        chunk->center = node->center;
+        chunk->extents = node->extents;
+        chunk->material = qt->material;
+    }
+    t->chunk_count = selected_count;
+}
+
+static void quadtree_unload(terrain* t) {
+    terrain_quadtree* qt = &t->quadtree;
+    if (!qt->nodes) {
+        return;
+    }
+
+    // Cancel any generation in progress and wait for it to finish, since it reads from the terrain.
+    u16 job_ids[255];
+    u8 job_id_count = 0;
+    u32 live_count = qt->live_nodes ? darray_length(qt->live_nodes) : 0;
+    for (u32 i = 0; i < live_count; ++i) {
+        terrain_quadtree_node* node = &qt->nodes[qt->live_nodes[i]];
+        if (node->state == TERRAIN_NODE_STATE_GENERATING && node->job) {
+            node->job->cancelled = true;
+            job_ids[job_id_count++] = node->job->job_id;
+            node->job = 0;
+            if (job_id_count == 255) {
+                job_system_wait_for_jobs(job_id_count, job_ids);
+                job_id_count = 0;
+            }
+        }
+    }
+    if (job_id_count) {
+        job_system_wait_for_jobs(job_id_count, job_ids);
+    }
+
+    // Like evictions, these frees are held back by the renderer until the frames in flight are done.
+    renderbuffer* vertex_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_VERTEX);
+    u64 node_size = quadtree_node_size(qt);
+    for (u32 i = 0; i < live_count; ++i) {
+        terrain_quadtree_node* node = &qt->nodes[qt->live_nodes[i]];
+        if (node->state == TERRAIN_NODE_STATE_RESIDENT) {
+            renderer_renderbuffer_free(vertex_buffer, node_size, node->vertex_buffer_offset);
+        }
+        node->state = TERRAIN_NODE_STATE_EMPTY;
+        node->vertex_buffer_offset = 0;
+    }
+    if (qt->live_nodes) {
+        darray_clear(qt->live_nodes);
+    }
+    qt->memory_used = 0;
+    qt->pending_job_count = 0;
+
+    renderbuffer* index_buffer = renderer_renderbuffer_get(RENDERBUFFER_TYPE_INDEX);
+    for (u32 v = 0; v < TERRAIN_STITCH_VARIANT_COUNT; ++v) {
+        terrain_chunk_lod* variant = &qt->stitch_variants[v];
+        if (variant->indices) {
+            renderer_renderbuffer_free(index_buffer, sizeof(u32) * variant->total_index_count, variant->index_buffer_offset);
+            KFREE_TYPE_CARRAY(variant->indices, u32, variant->total_index_count);
+            variant->indices = 0;
+        }
+        variant->index_buffer_offset = INVALID_ID_U64;
+    }
+
+    if (!khandle_is_invalid(qt->material.material)) {
+        material_system_release(engine_systems_get()->material_system, &qt->material);
+        qt->material.material = khandle_invalid();
+        qt->material.instance = khandle_invalid();
+    }
+
+    if (t->chunks) {
+        darray_clear(t->chunks);
+    }
+    t->chunk_count = 0;
+}
+
+static void quadtree_destroy(terrain* t) {
+    terrain_quadtree* qt = &t->quadtree;
+    quadtree_unload(t);
+
+    if (qt->nodes) {
+        KFREE_TYPE_CARRAY(qt->nodes, terrain_quadtree_node, qt->node_count);
+        qt->nodes = 0;
+        qt->node_count = 0;
+    }
+    if (qt->live_nodes) {
+        darray_destroy(qt->live_nodes);
+        qt->live_nodes = 0;
+    }
+    if (qt->selected_nodes) {
+        darray_destroy(qt->selected_nodes);
+        qt->selected_nodes = 0;
+    }
+    if (qt->requested_nodes) {
+        darray_destroy(qt->requested_nodes);
+        qt->requested_nodes = 0;
+    }
+    if (qt->visit_nodes) {
+        darray_destroy(qt->visit_nodes);
+        qt->visit_nodes = 0;
+    }
+    if (qt->next_visit_nodes) {
+        darray_destroy(qt->next_visit_nodes);
+        qt->next_visit_nodes = 0;
+    }
+    if (t->chunks) {
+        darray_destroy(t->chunks);
+        t->chunks = 0;
+    }
+    t->chunk_count = 0;
+}
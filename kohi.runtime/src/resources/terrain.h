@@ -71,6 +71,94 @@ typedef struct terrain_chunk {
     u8 current_lod;
 } terrain_chunk;
 
+typedef enum terrain_mode {
+    /** @brief Every chunk is generated at every LOD, and all are kept resident while the terrain is loaded. */
+    TERRAIN_MODE_CHUNKED,
+    /**
+     * @brief The terrain is a quadtree of nodes which all have the same number of vertices, but cover
+     * areas of different sizes. Nodes are generated on job threads as the view approaches them, and
+     * are evicted once no longer needed or when over the memory budget.
+     */
+    TERRAIN_MODE_QUADTREE
+} terrain_mode;
+
+/** @brief The number of ways quadtree node edges may be stitched. One per combination of sides bordering a coarser node. */
+#define TERRAIN_STITCH_VARIANT_COUNT 16
+
+typedef enum terrain_node_state {
+    /** @brief The node has no geometry. */
+    TERRAIN_NODE_STATE_EMPTY,
+    /** @brief The node's geometry is being generated on a job thread. */
+    TERRAIN_NODE_STATE_GENERATING,
+    /** @brief The node's geometry has been uploaded, and may be rendered. */
+    TERRAIN_NODE_STATE_RESIDENT
+} terrain_node_state;
+
+typedef struct terrain_quadtree_node {
+    terrain_node_state state;
+    /** @brief The depth of the node within the tree, where the root is 0. */
+    u8 level;
+    /** @brief The position of the node within the grid of nodes on its level. */
+    u16 x;
+    u16 z;
+
+    /** @brief The center of the node in local coordinates. */
+    vec3 center;
+    /** @brief The extents of the node in local coordinates. */
+    extents_3d extents;
+
+    /** @brief The offset from the beginning of the vertex buffer. Only valid while resident. */
+    u64 vertex_buffer_offset;
+
+    /** @brief The view update on which the node was last needed. */
+    u32 last_used_update;
+    /** @brief The view update on which the node was last selected for rendering. */
+    u32 selected_update;
+    /** @brief The view update on which the node was last visited by selection, i.e. its parent was split. */
+    u32 visited_update;
+
+    /** @brief The generation job for this node, if one is pending. */
+    struct terrain_node_job* job;
+} terrain_quadtree_node;
+
+typedef struct terrain_quadtree {
+    /** @brief The number of levels in the tree. The last is at full resolution. */
+    u8 level_count;
+    /** @brief The total number of nodes across all levels. */
+    u32 node_count;
+    /** @brief All nodes, level by level, each level row by row. */
+    terrain_quadtree_node* nodes;
+
+    /** @brief The number of vertices for every node, including side skirts. */
+    u32 node_vertex_count;
+    /** @brief Index data shared by all nodes, indexed by which sides border a coarser node. */
+    terrain_chunk_lod stitch_variants[TERRAIN_STITCH_VARIANT_COUNT];
+    /** @brief The material instance used by all nodes. */
+    material_instance material;
+
+    /** @brief A node is split into its children when the view is closer to it than its size times this. */
+    f32 split_distance_factor;
+    /** @brief The most GPU memory node geometry may use, in bytes. */
+    u64 memory_budget;
+    /** @brief GPU memory used by resident nodes and reserved by generating nodes, in bytes. */
+    u64 memory_used;
+    /** @brief The number of generation jobs in flight. */
+    u32 pending_job_count;
+
+    /** @brief Incremented on every view update. */
+    u32 update_count;
+    /** @brief Indices of all resident and generating nodes. darray */
+    u32* live_nodes;
+    /** @brief Indices of the nodes selected for rendering by the last view update. darray */
+    u32* selected_nodes;
+    /** @brief Indices of the nodes requested by the current view update. darray */
+    u32* requested_nodes;
+    /** @brief Indices of the nodes visited on the level being selected. Only used during a view update. darray */
+    u32* visit_nodes;
+    /** @brief Indices of the nodes to be visited on the next level. Only used during a view update. darray */
+    u32* next_visit_nodes;
+} terrain_quadtree;
+
 typedef enum terrain_state {
     TERRAIN_STATE_UNDEFINED,
     TERRAIN_STATE_CREATED,
@@ -103,17 +191,28 @@ typedef struct terrain {
     extents_3d extents;
     vec3 origin;
 
+    terrain_mode mode;
+
     u32 chunk_count;
     // row by row, then column
     // 0, 1, 2, 3
     // 4, 5, 6, 7
     // 8, 9, ...
+    // NOTE: In quadtree mode, this is instead a darray of the nodes selected for rendering by the last
+    // view update, rebuilt each time. Their lods point to the shared stitch variants, and current_lod
+    // is the index of the variant to use.
     terrain_chunk* chunks;
 
     u8 lod_count;
+    // Index data for each LOD, lod_count in length. Only depends on the chunk size, so in chunked mode
+    // it is generated and uploaded once and shared by all chunks.
+    terrain_chunk_lod* lods;
 
     u32 material_count;
     kname* material_names;
+
+    // Only used in quadtree mode.
+    terrain_quadtree quadtree;
 } terrain;
 
 KAPI b8 terrain_create(kresource_heightmap_terrain* terrain_resource, terrain* out_terrain);
@@ -127,6 +226,16 @@ KAPI b8 terrain_chunk_unload(terrain* t, terrain_chunk* chunk);
 
 KAPI b8 terrain_update(terrain* t);
 
+/**
+ * @brief Updates the terrain for the given view position. In quadtree mode, this selects the nodes
+ * to be rendered, requests generation of those the view is approaching and evicts those no longer
+ * needed. Does nothing in chunked mode.
+ *
+ * @param t A pointer to the terrain.
+ * @param local_view_position The view position, in the terrain's local coordinates.
+ */
+KAPI void terrain_view_update(terrain* t, vec3 local_view_position);
+
 KAPI void terrain_geometry_generate_normals(u32 vertex_count, struct terrain_vertex* vertices, u32 index_count, u32* indices);
 
 KAPI void terrain_geometry_generate_tangents(u32 vertex_count, struct terrain_vertex* vertices, u32 index_count, u32* indices);
@@ -1,6 +1,6 @@
 #include "camera_system.h"
 
-#include "containers/hashtable.h"
+#include "containers/hashmap.h"
 #include "strings/kstring.h"
 #include "logger.h"
 #include "renderer/camera.h"
@@ -13,8 +13,8 @@ typedef struct camera_lookup {
 
 typedef struct camera_system_state {
     camera_system_config config;
-    hashtable lookup;
-    void* hashtable_block;
+    // Lookup of camera ids, keyed by name.
+    hashmap lookup;
     camera_lookup* cameras;
 
     // A default, non-registered camera that always exists as a fallback.
@@ -30,11 +30,10 @@ b8 camera_system_initialize(u64* memory_requirement, void* state, void* config)
         return false;
     }
 
-    // Block of memory will contain state structure, then block for array, then block for hashtable.
+    // Block of memory will contain state structure, then block for array.
     u64 struct_requirement = sizeof(camera_system_state);
     u64 array_requirement = sizeof(camera_lookup) * typed_config->max_camera_count;
-    u64 hashtable_requirement = sizeof(camera_lookup) * typed_config->max_camera_count;
-    *memory_requirement = struct_requirement + array_requirement + hashtable_requirement;
+    *memory_requirement = struct_requirement + array_requirement;
 
     if (!state) {
         return true;
@@ -47,15 +46,11 @@ b8 camera_system_initialize(u64* memory_requirement, void* state, void* config)
     void* array_block = state + struct_requirement;
     state_ptr->cameras = array_block;
 
-    // Hashtable block is after array.
-    void* hashtable_block = array_block + array_requirement;
-
-    // Create a hashtable for camera lookups.
-    hashtable_create(sizeof(u16), typed_config->max_camera_count, hashtable_block, false, &state_ptr->lookup);
-
-    // Fill the hashtable with invalid references to use as a default.
-    u16 invalid_id = INVALID_ID_U16;
-    hashtable_fill(&state_ptr->lookup, &invalid_id);
+    // Create a hashmap for camera lookups.
+    if (!hashmap_create(sizeof(u16), typed_config->max_camera_count, &state_ptr->lookup)) {
+        KFATAL("camera_system_initialize - failed to create camera lookup.");
+        return false;
+    }
 
     // Invalidate all cameras in the array.
     u32 count = state_ptr->config.max_camera_count;
@@ -73,6 +68,8 @@ b8 camera_system_initialize(u64* memory_requirement, void* state, void* config)
 void camera_system_shutdown(void* state) {
     camera_system_state* s = (camera_system_state*)state;
     if (s) {
+        hashmap_destroy(&s->lookup);
+
         // NOTE: If cameras need to be destroyed, do it here.
         // // Invalidate all cameras in the array.
         // u32 count = s->config.max_camera_count;
@@ -91,11 +88,9 @@ camera* camera_system_acquire(const char* name) {
         if (strings_equali(name, DEFAULT_CAMERA_NAME)) {
             return &state_ptr->default_camera;
         }
+        u64 key = hashmap_key_from_string(name);
         u16 id = INVALID_ID_U16;
-        if (!hashtable_get(&state_ptr->lookup, name, &id)) {
-            KERROR("camera_system_acquire failed lookup. Null returned.");
-            return 0;
-        }
+        hashmap_get(&state_ptr->lookup, key, &id);
 
         if (id == INVALID_ID_U16) {
             // Find free slot
@@ -115,8 +110,12 @@ camera* camera_system_acquire(const char* name) {
             state_ptr->cameras[id].c = camera_create();
             state_ptr->cameras[id].id = id;
 
-            // Update the hashtable.
-            hashtable_set(&state_ptr->lookup, name, &id);
+            // Update the lookup.
+            if (!hashmap_set(&state_ptr->lookup, key, &id)) {
+                KERROR("camera_system_acquire failed to register camera lookup. Null returned.");
+                state_ptr->cameras[id].id = INVALID_ID_U16;
+                return 0;
+            }
         }
         state_ptr->cameras[id].reference_count++;
         return &state_ptr->cameras[id].c;
@@ -132,8 +131,9 @@ void camera_system_release(const char* name) {
             KTRACE("Cannot release default camera. Nothing was done.");
             return;
         }
+        u64 key = hashmap_key_from_string(name);
         u16 id = INVALID_ID_U16;
-        if (!hashtable_get(&state_ptr->lookup, name, &id)) {
+        if (!hashmap_get(&state_ptr->lookup, key, &id)) {
             KWARN("camera_system_release failed lookup. Nothing was done.");
         }
 
@@ -143,7 +143,7 @@ void camera_system_release(const char* name) {
             if (state_ptr->cameras[id].reference_count < 1) {
                 camera_reset(&state_ptr->cameras[id].c);
                 state_ptr->cameras[id].id = INVALID_ID_U16;
-                hashtable_set(&state_ptr->lookup, name, &state_ptr->cameras[id].id);
+                hashmap_remove(&state_ptr->lookup, key, 0);
             }
         }
     }
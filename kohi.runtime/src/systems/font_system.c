@@ -2,6 +2,7 @@
 
 #include <assets/kasset_types.h>
 #include <containers/darray.h>
+#include <containers/hashmap.h>
 #include <debug/kassert.h>
 #include <defines.h>
 #include <identifiers/khandle.h>
@@ -40,6 +41,9 @@
 #define SYSTEM_FONT_SIZE_MIN 1U
 #define SYSTEM_FONT_SIZE_MAX U16_MAX
 
+// The largest codepoint looked up through a font's glyph table. This covers the Basic Multilingual Plane.
+#define FONT_GLYPH_TABLE_CODEPOINT_MAX 0xFFFF
+
 // For system fonts.
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "vendor/stb_truetype.h"
@@ -58,6 +62,14 @@ typedef struct font_data {
     u32 kerning_count;
     font_kerning* kernings;
     f32 tab_x_advance;
+    // Glyph indices indexed directly by codepoint, for codepoints in the BMP. Only as long as the
+    // largest such codepoint in the font. INVALID_ID where the font has no glyph.
+    u32 glyph_table_length;
+    u32* glyph_table;
+    // Glyph indices of any codepoints outside of the glyph table (i.e. -1 for the unknown glyph).
+    hashmap glyph_map;
+    // Kerning indices, keyed by codepoint pair.
+    hashmap kerning_map;
 } font_data;
 
 typedef struct bitmap_font_page {
@@ -111,6 +123,8 @@ static system_font_variant_data* get_system_font_variant_by_size(font_system_sta
 static vec2 measure_string(font_data* font, const char* text);
 static void setup_tab_xadvance(font_data* font);
 static void cleanup_font_data(font_data* font);
+static void build_font_lookups(font_data* font);
+static void destroy_font_lookups(font_data* font);
 static b8 create_system_font_variant(system_font_lookup* lookup, u16 size, kname font_name, system_font_variant_data* out_variant);
 static b8 rebuild_system_font_variant_atlas(system_font_lookup* lookup, system_font_variant_data* variant);
 static b8 verify_system_font_size_variant(system_font_lookup* lookup, system_font_variant_data* variant, const char* text);
@@ -417,6 +431,7 @@ b8 font_system_bitmap_font_load(font_system_state* state, kname resource_name, k
     }
 
     // Setup the font data.
+    build_font_lookups(&lookup->data);
     setup_tab_xadvance(&lookup->data);
 
     // Release the font resource.
@@ -823,23 +838,11 @@ static vec2 measure_string(font_data* font, const char* text) {
             codepoint = -1;
         }
 
-        font_glyph* g = 0;
-        for (u32 i = 0; i < font->glyph_count; ++i) {
-            if (font->glyphs[i].codepoint == codepoint) {
-                g = &font->glyphs[i];
-                break;
-            }
-        }
-
+        font_glyph* g = glyph_from_codepoint(font, codepoint);
         if (!g) {
             // If not found, use the codepoint -1
             codepoint = -1;
-            for (u32 i = 0; i < font->glyph_count; ++i) {
-                if (font->glyphs[i].codepoint == codepoint) {
-                    g = &font->glyphs[i];
-                    break;
-                }
-            }
+            g = glyph_from_codepoint(font, codepoint);
         }
 
         if (g) {
@@ -858,11 +861,9 @@ static vec2 measure_string(font_data* font, const char* text) {
                     KWARN("Invalid UTF-8 found in string, using unknown codepoint of -1");
                     codepoint = -1;
                 } else {
-                    for (u32 i = 0; i < font->kerning_count; ++i) {
-                        font_kerning* k = &font->kernings[i];
-                        if (k->codepoint_0 == codepoint && k->codepoint_1 == next_codepoint) {
-                            kerning = k->amount;
-                        }
+                    font_kerning* k = kerning_from_codepoints(font, codepoint, next_codepoint);
+                    if (k) {
+                        kerning = k->amount;
                     }
                 }
             }
@@ -894,20 +895,16 @@ static void setup_tab_xadvance(font_data* font) {
     // Check for a t{ab glyph, as there may not always be one exported. If there is, store its
     // x_advance and just use that. If there is not, then create one based off spacex4
     if (!font->tab_x_advance) {
-        for (u32 i = 0; i < font->glyph_count; ++i) {
-            if (font->glyphs[i].codepoint == '\t') {
-                font->tab_x_advance = font->glyphs[i].x_advance;
-                break;
-            }
+        font_glyph* tab = glyph_from_codepoint(font, '\t');
+        if (tab) {
+            font->tab_x_advance = tab->x_advance;
         }
         // If still not found, use space x 4.
         if (!font->tab_x_advance) {
-            for (u32 i = 0; i < font->glyph_count; ++i) {
-                // Search for space
-                if (font->glyphs[i].codepoint == ' ') {
-                    font->tab_x_advance = font->glyphs[i].x_advance * 4;
-                    break;
-                }
+            // Search for space
+            font_glyph* space = glyph_from_codepoint(font, ' ');
+            if (space) {
+                font->tab_x_advance = space->x_advance * 4;
             }
             if (!font->tab_x_advance) {
                 // If _still_ not there, then a space wasn't present either, so just
@@ -919,6 +916,7 @@ static void setup_tab_xadvance(font_data* font) {
 }
 
 static void cleanup_font_data(font_data* font) {
+    destroy_font_lookups(font);
 
     if (font->glyphs && font->glyph_count) {
         KFREE_TYPE_CARRAY(font->glyphs, font_glyph, font->glyph_count);
@@ -1076,6 +1074,8 @@ static b8 rebuild_system_font_variant_atlas(system_font_lookup* lookup, system_f
         variant->data.kernings = 0;
     }
 
+    build_font_lookups(&variant->data);
+
     return true;
 }
 
@@ -1167,27 +1167,75 @@ static void system_font_release(font_system_state* state, system_font_lookup* lo
     }
 }
 
-static font_glyph* glyph_from_codepoint(const font_data* font, i32 codepoint) {
+static u64 kerning_key(i32 codepoint_0, i32 codepoint_1) {
+    return ((u64)(u32)codepoint_0 << 32) | (u32)codepoint_1;
+}
+
+static void build_font_lookups(font_data* font) {
+    // Glyphs or kernings may have been regenerated, so start over.
+    destroy_font_lookups(font);
+
+    // Only make the table as large as the largest codepoint actually present requires.
+    u32 table_length = 0;
     for (u32 i = 0; i < font->glyph_count; ++i) {
-        if (font->glyphs[i].codepoint == codepoint) {
-            return &font->glyphs[i];
+        i32 codepoint = font->glyphs[i].codepoint;
+        if (codepoint >= 0 && codepoint <= FONT_GLYPH_TABLE_CODEPOINT_MAX) {
+            table_length = KMAX(table_length, (u32)codepoint + 1);
         }
     }
+    if (table_length) {
+        font->glyph_table_length = table_length;
+        font->glyph_table = KALLOC_TYPE_CARRAY(u32, table_length);
+        kset_memory(font->glyph_table, 0xFF, sizeof(u32) * table_length);
+    }
+    hashmap_create(sizeof(u32), 0, &font->glyph_map);
+    hashmap_create(sizeof(u32), font->kerning_count, &font->kerning_map);
 
-    KERROR("Unable to find font glyph for codepoint: %s", codepoint);
-    return 0;
-}
-
-static font_kerning* kerning_from_codepoints(const font_data* font, i32 codepoint_0, i32 codepoint_1) {
+    // NOTE: Where a codepoint (or pair) appears more than once, the first one wins, as it did with a linear search.
+    for (u32 i = 0; i < font->glyph_count; ++i) {
+        i32 codepoint = font->glyphs[i].codepoint;
+        if (codepoint >= 0 && (u32)codepoint < font->glyph_table_length) {
+            if (font->glyph_table[codepoint] == INVALID_ID) {
+                font->glyph_table[codepoint] = i;
+            }
+        } else if (!hashmap_contains(&font->glyph_map, (u64)(u32)codepoint)) {
+            hashmap_set(&font->glyph_map, (u64)(u32)codepoint, &i);
+        }
+    }
     for (u32 i = 0; i < font->kerning_count; ++i) {
-        font_kerning* k = &font->kernings[i];
-        if (k->codepoint_0 == codepoint_0 && k->codepoint_1 == codepoint_1) {
-            return k;
+        u64 key = kerning_key(font->kernings[i].codepoint_0, font->kernings[i].codepoint_1);
+        if (!hashmap_contains(&font->kerning_map, key)) {
+            hashmap_set(&font->kerning_map, key, &i);
         }
     }
+}
+
+static void destroy_font_lookups(font_data* font) {
+    if (font->glyph_table) {
+        KFREE_TYPE_CARRAY(font->glyph_table, u32, font->glyph_table_length);
+        font->glyph_table = 0;
+    }
+    font->glyph_table_length = 0;
+    hashmap_destroy(&font->glyph_map);
+    hashmap_destroy(&font->kerning_map);
+}
+
+static font_glyph* glyph_from_codepoint(const font_data* font, i32 codepoint) {
+    if (codepoint >= 0 && (u32)codepoint < font->glyph_table_length) {
+        u32 index = font->glyph_table[codepoint];
+        return index == INVALID_ID ? 0 : &font->glyphs[index];
+    }
+
+    u32* index = hashmap_get_ref(&font->glyph_map, (u64)(u32)codepoint);
+    // NOTE: Not found is left to the caller to handle, since most fall back to another glyph.
+    return index ? &font->glyphs[*index] : 0;
+}
+
+static font_kerning* kerning_from_codepoints(const font_data* font, i32 codepoint_0, i32 codepoint_1) {
+    u32* index = hashmap_get_ref(&font->kerning_map, kerning_key(codepoint_0, codepoint_1));
 
     // No kerning found. This is okay, not necessarily an error.
-    return 0;
+    return index ? &font->kernings[*index] : 0;
 }
 
 static b8 generate_font_geometry(const font_data* data, font_type type, const char* text, font_geometry* out_geometry) {
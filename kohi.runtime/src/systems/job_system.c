@@ -1,244 +1,737 @@
 #include "job_system.h"
 
+#include "containers/darray.h"
 #include "containers/ring_queue.h"
 #include "core/frame_data.h"
 #include "defines.h"
 #include "debug/kassert.h"
+#include "memory/allocators/pool_allocator.h"
 #include "memory/kmemory.h"
+#include "platform/platform.h"
+#include "threads/katomic.h"
 #include "threads/kmutex.h"
 #include "threads/ksemaphore.h"
 #include "threads/kthread.h"
 #include "logger.h"
 
+// The number of distinct job types. Each job_type is a single bit, which maps to a slot index.
+#define JOB_TYPE_SLOT_COUNT 3
+// The number of job priority levels.
+#define JOB_PRIORITY_COUNT 3
+
+// The capacity of each per-thread work-stealing deque. Must be a power of 2.
+#define JOB_DEQUE_CAPACITY 256
+#define JOB_DEQUE_MASK (JOB_DEQUE_CAPACITY - 1)
+
+// The total number of jobs which can live in thread deques at once. Overflow goes to the injection queues.
+#define MAX_JOB_SLOTS 4096
+
+// The capacity of each injection queue (one per type/priority combination).
+#define JOB_INJECTION_QUEUE_CAPACITY 1024
+
+// The max number of jobs a thread will move from an injection queue to its own deque at once,
+// which makes them available to be stolen by other threads.
+#define JOB_INJECTION_BATCH_SIZE 16
+
+// The max number of threads the job system supports.
+#define MAX_JOB_THREADS 32
+
+// The most parallel_for calls which can be in progress at once, across all threads.
+#define MAX_PARALLEL_FOR_TASKS 128
+
+// The alignment of the state within the memory it is given. The state is full of atomics, which
+// must not straddle cache lines, and the memory given to the job system is not necessarily aligned.
+#define JOB_STATE_ALIGNMENT 64
+
+// The number of times a waiting thread spins before it starts yielding its time slice.
+#define JOB_WAIT_SPIN_COUNT 256
+
+// The number of job identifiers available before they wrap around.
+#define MAX_JOB_IDS INVALID_ID_U16
+
+// Param/result data up to this size comes from a pool instead of the general allocator.
+#define JOB_PAYLOAD_POOL_BLOCK_SIZE 128
+// The number of blocks each job pool grows by at once.
+#define JOB_POOL_BLOCKS_PER_PAGE 256
+
+/**
+ * A fixed-size Chase-Lev work-stealing deque of job slot indices. Only the
+ * owning thread may push or pop (from the bottom), while any thread may
+ * steal (from the top).
+ */
+typedef struct job_deque {
+    volatile i64 top;
+    volatile i64 bottom;
+    volatile u32 slots[JOB_DEQUE_CAPACITY];
+} job_deque;
+
 typedef struct job_thread {
     u8 index;
     kthread thread;
-    job_info info;
-    // A mutex to guard access to this thread's info.
-    kmutex info_mutex;
+
+    // Per-type, per-priority deques owned by this thread.
+    job_deque deques[JOB_TYPE_SLOT_COUNT][JOB_PRIORITY_COUNT];
+
+    // Set while the thread is (about to be) blocked waiting for work.
+    volatile u32 sleeping;
 
     // Used to cause a thread to block until work is available.
     ksemaphore semaphore;
 
+    // State for picking steal victims.
+    u32 rng_state;
+
     // The types of jobs this thread can handle.
     u32 type_mask;
 } job_thread;
 
+// A job waiting on another job to complete.
+typedef struct job_continuation {
+    u16 job_id;
+    struct job_continuation* next;
+} job_continuation;
+
+/**
+ * Tracks the completion of a single job, along with the jobs which depend on it.
+ * Indexed by job identifier.
+ */
+typedef struct job_record {
+    // The number of dependencies not yet complete, plus one while the job is being submitted.
+    volatile u32 pending_count;
+    // Set once the job has finished executing.
+    volatile u32 complete;
+    // A spin lock guarding the completion flag and continuations.
+    volatile u32 lock;
+    // Jobs to be released once this one completes.
+    job_continuation* continuations;
+    // A copy of the job while it waits on its dependencies. Null for job groups.
+    job_info* waiting_info;
+} job_record;
+
+/**
+ * Shared state of a single job_system_parallel_for call. Taken from a fixed set held by the job system,
+ * and referenced directly by the helper jobs instead of being copied. Helpers which only start after
+ * the whole range was processed find nothing to do, so the caller never waits on them.
+ */
+typedef struct parallel_for_task {
+    pfn_job_parallel_for fn;
+    void* context;
+    u32 count;
+    u32 grain;
+    // The start of the next range to be claimed.
+    volatile u32 next;
+    // The number of elements not yet processed.
+    volatile u32 remaining;
+    // The number of references to the task: one for the caller, plus one per queued helper job.
+    // The last to let go of it returns it to the free list.
+    volatile u32 ref_count;
+} parallel_for_task;
+
 typedef struct job_result_entry {
-    u16 id;
     pfn_job_on_complete callback;
     u32 param_size;
     void* params;
 } job_result_entry;
 
-// The max number of job results that can be stored at once.
-#define MAX_JOB_RESULTS 512
-
 typedef struct job_system_state {
-    b8 running;
+    volatile u32 running;
     u8 thread_count;
-    job_thread job_threads[32];
-
-    u16 current_job_id;
-    // TODO: This is a massive waste of memory - combine 8 at a time into each bool.
-    b8* job_statuses;
-    kmutex job_status_mutex;
-
-    ring_queue low_priority_queue;
-    ring_queue normal_priority_queue;
-    ring_queue high_priority_queue;
-
+    // The number of threads which can run general jobs.
+    u8 general_thread_count;
+    job_thread job_threads[MAX_JOB_THREADS];
+
+    // Incremented for each created job. Job identifiers wrap around at MAX_JOB_IDS.
+    volatile u32 current_job_id;
+    // Completion tracking for each job identifier. Array of MAX_JOB_IDS.
+    job_record* records;
+
+    // Storage for jobs held in thread deques, along with a lock-free free list of them.
+    job_info job_slots[MAX_JOB_SLOTS];
+    volatile u32 job_slot_next[MAX_JOB_SLOTS];
+    // The free list head. The low 32 bits are the slot index, the high 32 bits are a tag to avoid ABA issues.
+    volatile u64 free_slot_head;
+
+    // Storage for the state of parallel_for calls in progress, along with a lock-free free list of them.
+    parallel_for_task parallel_for_tasks[MAX_PARALLEL_FOR_TASKS];
+    volatile u32 parallel_for_task_next[MAX_PARALLEL_FOR_TASKS];
+    // The free list head, the same as free_slot_head.
+    volatile u64 free_parallel_for_task_head;
+
+    // Queues used for jobs submitted from outside job threads (or that do not fit into a deque).
+    // Job threads pull from these directly.
+    ring_queue injection_queues[JOB_TYPE_SLOT_COUNT][JOB_PRIORITY_COUNT];
     // Mutexes for each queue, since a job could be kicked off from another job (thread).
-    kmutex low_pri_queue_mutex;
-    kmutex normal_pri_queue_mutex;
-    kmutex high_pri_queue_mutex;
+    kmutex injection_queue_mutexes[JOB_TYPE_SLOT_COUNT][JOB_PRIORITY_COUNT];
 
-    job_result_entry pending_results[MAX_JOB_RESULTS];
+    // Results waiting to be handled on the main thread. Double-buffered so
+    // job threads can keep adding results while callbacks are executed. darrays.
+    job_result_entry* pending_results;
+    job_result_entry* processing_results;
+    // A mutex for the pending result array
     kmutex result_mutex;
-    // A mutex for the result array
+
+    // Pools for the small, short-lived allocations made for every job.
+    pool_allocator info_pool;
+    pool_allocator continuation_pool;
+    pool_allocator payload_pool;
 } job_system_state;
 
 static job_system_state* state_ptr;
 
+// The job thread the current thread is, if any.
+static KTHREAD_LOCAL job_thread* current_job_thread = 0;
+
+static u32 job_type_slot(job_type type) {
+    switch (type) {
+    default:
+    case JOB_TYPE_GENERAL:
+        return 0;
+    case JOB_TYPE_RESOURCE_LOAD:
+        return 1;
+    case JOB_TYPE_GPU_RESOURCE:
+        return 2;
+    }
+}
+
+static const job_type job_slot_types[JOB_TYPE_SLOT_COUNT] = {JOB_TYPE_GENERAL, JOB_TYPE_RESOURCE_LOAD, JOB_TYPE_GPU_RESOURCE};
+
+// Pops an index from a lock-free free list of indices. next holds the index following each one.
+static b8 index_free_list_pop(volatile u64* head_ptr, volatile u32* next, u32* out_index) {
+    while (true) {
+        u64 head = katomic_load_u64(head_ptr);
+        u32 index = (u32)(head & 0xFFFFFFFF);
+        if (index == INVALID_ID) {
+            return false;
+        }
+        u64 tag = (head >> 32) + 1;
+        u64 new_head = (tag << 32) | katomic_load_u32(&next[index]);
+        if (katomic_compare_exchange_u64(head_ptr, head, new_head)) {
+            *out_index = index;
+            return true;
+        }
+    }
+}
+
+// Pushes an index back onto a lock-free free list of indices.
+static void index_free_list_push(volatile u64* head_ptr, volatile u32* next, u32 index) {
+    while (true) {
+        u64 head = katomic_load_u64(head_ptr);
+        katomic_store_u32(&next[index], (u32)(head & 0xFFFFFFFF));
+        u64 tag = (head >> 32) + 1;
+        if (katomic_compare_exchange_u64(head_ptr, head, (tag << 32) | index)) {
+            return;
+        }
+    }
+}
+
+static b8 job_slot_acquire(u32* out_slot) {
+    return index_free_list_pop(&state_ptr->free_slot_head, state_ptr->job_slot_next, out_slot);
+}
+
+static void job_slot_release(u32 slot) {
+    index_free_list_push(&state_ptr->free_slot_head, state_ptr->job_slot_next, slot);
+}
+
+// Owner only.
+static b8 job_deque_push(job_deque* deque, u32 slot) {
+    i64 bottom = katomic_load_i64(&deque->bottom);
+    i64 top = katomic_load_i64(&deque->top);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) {
+        return false;
+    }
+    katomic_store_u32(&deque->slots[bottom & JOB_DEQUE_MASK], slot);
+    katomic_store_i64(&deque->bottom, bottom + 1);
+    return true;
+}
+
+// Owner only.
+static b8 job_deque_pop(job_deque* deque, u32* out_slot) {
+    i64 bottom = katomic_load_i64(&deque->bottom) - 1;
+    katomic_store_i64(&deque->bottom, bottom);
+    i64 top = katomic_load_i64(&deque->top);
+    if (top > bottom) {
+        // Empty.
+        katomic_store_i64(&deque->bottom, bottom + 1);
+        return false;
+    }
+
+    u32 slot = katomic_load_u32(&deque->slots[bottom & JOB_DEQUE_MASK]);
+    if (top == bottom) {
+        // Last item, so race against thieves for it.
+        b8 won = katomic_compare_exchange_i64(&deque->top, top, top + 1);
+        katomic_store_i64(&deque->bottom, bottom + 1);
+        if (!won) {
+            return false;
+        }
+    }
+    *out_slot = slot;
+    return true;
+}
+
+// Any thread.
+static b8 job_deque_steal(job_deque* deque, u32* out_slot) {
+    i64 top = katomic_load_i64(&deque->top);
+    i64 bottom = katomic_load_i64(&deque->bottom);
+    if (top >= bottom) {
+        return false;
+    }
+    u32 slot = katomic_load_u32(&deque->slots[top & JOB_DEQUE_MASK]);
+    if (!katomic_compare_exchange_i64(&deque->top, top, top + 1)) {
+        return false;
+    }
+    *out_slot = slot;
+    return true;
+}
+
+static void job_slot_take(u32 slot, job_info* out_info) {
+    *out_info = state_ptr->job_slots[slot];
+    job_slot_release(slot);
+}
+
+// Wakes a single sleeping thread (other than exclude) which can handle the given job type.
+static void wake_thread(job_type type, job_thread* exclude) {
+    for (u8 i = 0; i < state_ptr->thread_count; ++i) {
+        job_thread* thread = &state_ptr->job_threads[i];
+        if (thread == exclude || (thread->type_mask & type) == 0) {
+            continue;
+        }
+        if (katomic_exchange_u32(&thread->sleeping, 0)) {
+            ksemaphore_signal(&thread->semaphore);
+            return;
+        }
+    }
+}
+
+// Returns false if the job could not be queued, in which case it will never run.
+static b8 enqueue_job(job_info* info) {
+    u32 type_slot = job_type_slot(info->type);
+
+    // Jobs kicked off from a job thread that can handle them go directly onto that thread's deque.
+    job_thread* current = current_job_thread;
+    if (current && (current->type_mask & info->type)) {
+        u32 slot;
+        if (job_slot_acquire(&slot)) {
+            state_ptr->job_slots[slot] = *info;
+            if (job_deque_push(&current->deques[type_slot][info->priority], slot)) {
+                // Let an idle thread know there is something to steal.
+                wake_thread(info->type, current);
+                return true;
+            }
+            job_slot_release(slot);
+        }
+    }
+
+    // Otherwise go through the injection queue, where job threads pull it from.
+    kmutex* queue_mutex = &state_ptr->injection_queue_mutexes[type_slot][info->priority];
+    if (!kmutex_lock(queue_mutex)) {
+        KERROR("Failed to obtain lock on queue mutex!");
+    }
+    b8 queued = ring_queue_enqueue(&state_ptr->injection_queues[type_slot][info->priority], info);
+    if (!kmutex_unlock(queue_mutex)) {
+        KERROR("Failed to release lock on queue mutex!");
+    }
+
+    if (!queued) {
+        KERROR("Job queue is full, job will not be executed.");
+        return false;
+    }
+
+    wake_thread(info->type, 0);
+    return true;
+}
+
+static b8 take_from_injection_queue(job_thread* thread, u32 type_slot, u32 priority, job_info* out_info) {
+    ring_queue* queue = &state_ptr->injection_queues[type_slot][priority];
+    // Avoid taking the lock on empty queues.
+    if (katomic_load_u32(&queue->length) == 0) {
+        return false;
+    }
+
+    kmutex* queue_mutex = &state_ptr->injection_queue_mutexes[type_slot][priority];
+    if (!kmutex_lock(queue_mutex)) {
+        KERROR("Failed to obtain lock on queue mutex!");
+    }
+    // NOTE: The length needs to be checked again, as another thread may have emptied the queue.
+    b8 found = queue->length > 0 && ring_queue_dequeue(queue, out_info);
+
+    // Move a batch of the remaining jobs to this thread's deque so other threads can steal them.
+    // NOTE: The deque was just found to be empty by this (owning) thread, so pushes cannot fail.
+    u32 moved = 0;
+    while (found && thread && moved < JOB_INJECTION_BATCH_SIZE && queue->length > 0) {
+        u32 slot;
+        if (!job_slot_acquire(&slot)) {
+            break;
+        }
+        ring_queue_dequeue(queue, &state_ptr->job_slots[slot]);
+        job_deque_push(&thread->deques[type_slot][priority], slot);
+        moved++;
+    }
+    if (!kmutex_unlock(queue_mutex)) {
+        KERROR("Failed to release lock on queue mutex!");
+    }
+
+    if (moved) {
+        wake_thread(job_slot_types[type_slot], thread);
+    }
+
+    return found;
+}
+
+static b8 steal_job(job_thread* thread, u32 type_slot, u32 priority, job_info* out_info) {
+    u8 thread_count = state_ptr->thread_count;
+
+    // xorshift to pick a starting victim, so thieves don't all hammer the same thread.
+    u32 start = 0;
+    if (thread) {
+        thread->rng_state ^= thread->rng_state << 13;
+        thread->rng_state ^= thread->rng_state >> 17;
+        thread->rng_state ^= thread->rng_state << 5;
+        start = thread->rng_state % thread_count;
+    }
+
+    for (u8 i = 0; i < thread_count; ++i) {
+        job_thread* victim = &state_ptr->job_threads[(start + i) % thread_count];
+        if (victim == thread) {
+            continue;
+        }
+        u32 slot;
+        if (job_deque_steal(&victim->deques[type_slot][priority], &slot)) {
+            job_slot_take(slot, out_info);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Finds the next job of a type in type_mask. Higher priorities are always exhausted first.
+ * thread may be null when called from a thread outside the job system, which has no deques.
+ */
+static b8 job_acquire(job_thread* thread, u32 type_mask, job_info* out_info) {
+    for (i32 priority = JOB_PRIORITY_HIGH; priority >= JOB_PRIORITY_LOW; --priority) {
+        // Own deques first.
+        for (u32 t = 0; thread && t < JOB_TYPE_SLOT_COUNT; ++t) {
+            u32 slot;
+            if ((type_mask & job_slot_types[t]) && job_deque_pop(&thread->deques[t][priority], &slot)) {
+                job_slot_take(slot, out_info);
+                return true;
+            }
+        }
+
+        // Then newly-submitted jobs.
+        for (u32 t = 0; t < JOB_TYPE_SLOT_COUNT; ++t) {
+            if ((type_mask & job_slot_types[t]) && take_from_injection_queue(thread, t, priority, out_info)) {
+                return true;
+            }
+        }
+
+        // Then try stealing from other threads.
+        for (u32 t = 0; t < JOB_TYPE_SLOT_COUNT; ++t) {
+            if ((type_mask & job_slot_types[t]) && steal_job(thread, t, priority, out_info)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void job_record_lock(job_record* record) {
+    while (!katomic_compare_exchange_u32(&record->lock, 0, 1)) {
+        katomic_pause();
+    }
+}
+
+static void job_record_unlock(job_record* record) {
+    katomic_store_u32(&record->lock, 0);
+}
+
+// Allocates param/result data, using the payload pool if it fits.
+static void* job_payload_allocate(u32 size) {
+    if (size <= JOB_PAYLOAD_POOL_BLOCK_SIZE) {
+        return pool_allocator_allocate(&state_ptr->payload_pool);
+    }
+    return kallocate(size, MEMORY_TAG_JOB);
+}
+
+static void job_payload_free(void* block, u32 size) {
+    if (size <= JOB_PAYLOAD_POOL_BLOCK_SIZE) {
+        pool_allocator_free(&state_ptr->payload_pool, block);
+    } else {
+        kfree(block, size, MEMORY_TAG_JOB);
+    }
+}
+
+static void job_complete(u16 job_id);
+static void job_dispatch(job_info* info);
+
+// Called once for each dependency of a job as it completes. Kicks the job off after the last one.
+static void job_dependency_resolved(u16 job_id) {
+    job_record* record = &state_ptr->records[job_id];
+    if (katomic_fetch_sub_u32(&record->pending_count, 1) != 1) {
+        return;
+    }
+
+    job_info* info = record->waiting_info;
+    record->waiting_info = 0;
+    if (info) {
+        job_dispatch(info);
+        pool_allocator_free(&state_ptr->info_pool, info);
+    } else {
+        // Groups have nothing to execute, and are complete once their members are.
+        job_complete(job_id);
+    }
+}
+
+// Registers job_id to be released when dependency_id completes. Returns false if it is already complete.
+static b8 job_add_continuation(u16 dependency_id, u16 job_id) {
+    job_record* record = &state_ptr->records[dependency_id];
+    job_record_lock(record);
+    if (record->complete) {
+        job_record_unlock(record);
+        return false;
+    }
+    job_continuation* continuation = pool_allocator_allocate(&state_ptr->continuation_pool);
+    continuation->job_id = job_id;
+    continuation->next = record->continuations;
+    record->continuations = continuation;
+    job_record_unlock(record);
+    return true;
+}
+
+// Flags the job as complete and releases any jobs waiting on it.
+static void job_complete(u16 job_id) {
+    job_record* record = &state_ptr->records[job_id];
+    job_record_lock(record);
+    katomic_store_u32(&record->complete, true);
+    job_continuation* continuation = record->continuations;
+    record->continuations = 0;
+    job_record_unlock(record);
+
+    while (continuation) {
+        job_continuation* next = continuation->next;
+        job_dependency_resolved(continuation->job_id);
+        pool_allocator_free(&state_ptr->continuation_pool, continuation);
+        continuation = next;
+    }
+}
+
+static u16 job_id_create(void) {
+    u16 id = (u16)(katomic_fetch_add_u32(&state_ptr->current_job_id, 1) % MAX_JOB_IDS);
+    job_record* record = &state_ptr->records[id];
+    // NOTE: Identifiers wrap around, so this may be reusing the record of an old, completed job.
+    job_record_lock(record);
+    katomic_store_u32(&record->complete, false);
+    record->pending_count = 0;
+    record->waiting_info = 0;
+    job_record_unlock(record);
+    return id;
+}
+
 static void store_result(pfn_job_on_complete callback, u32 param_size, void* params) {
     // Create the new entry.
     job_result_entry entry;
-    entry.id = INVALID_ID_U16;
     entry.param_size = param_size;
     entry.callback = callback;
     if (entry.param_size > 0) {
         // Take a copy, as the job is destroyed after this.
-        entry.params = kallocate(param_size, MEMORY_TAG_JOB);
+        entry.params = job_payload_allocate(param_size);
         kcopy_memory(entry.params, params, param_size);
     } else {
         entry.params = 0;
     }
 
-    // Lock, find a free space, store, unlock.
+    // Lock, store, unlock.
     if (!kmutex_lock(&state_ptr->result_mutex)) {
         KERROR("Failed to obtain mutex lock for storing a result! Result storage may be corrupted.");
     }
-    for (u16 i = 0; i < MAX_JOB_RESULTS; ++i) {
-        if (state_ptr->pending_results[i].id == INVALID_ID_U16) {
-            state_ptr->pending_results[i] = entry;
-            state_ptr->pending_results[i].id = i;
-            break;
-        }
-    }
+    darray_push(state_ptr->pending_results, entry);
     if (!kmutex_unlock(&state_ptr->result_mutex)) {
         KERROR("Failed to release mutex lock for result storage, storage may be corrupted.");
     }
 }
 
-static u32 job_thread_run(void* params) {
-    u32 index = *(u32*)params;
-    job_thread* thread = &state_ptr->job_threads[index];
-    KTRACE("Starting job thread #%i (id=%#x, type=%#x).", thread->index, thread->thread.thread_id, thread->type_mask);
+// Queues the result callback and releases everything owned by the job, then flags it as complete.
+static void job_finish(job_info* info, b8 result) {
+    // Store the result to be executed on the main thread later.
+    // Note that store_result takes a copy of the result_data
+    // so it does not have to be held onto by this thread any longer.
+    if (result && info->on_success) {
+        store_result(info->on_success, info->result_data_size, info->result_data);
+    } else if (!result && info->on_fail) {
+        store_result(info->on_fail, info->result_data_size, info->result_data);
+    }
 
-    // A mutex to lock info for this thread.
-    if (!kmutex_create(&thread->info_mutex)) {
-        KERROR("Failed to create job thread mutex! Aborting thread.");
-        return 0;
+    // Clear the param data and result data. Jobs with a size of 0 do not own their data.
+    if (info->param_data && info->param_data_size) {
+        job_payload_free(info->param_data, info->param_data_size);
+    }
+    if (info->result_data && info->result_data_size) {
+        job_payload_free(info->result_data, info->result_data_size);
+    }
+    if (info->dependency_ids) {
+        kfree(info->dependency_ids, sizeof(u16) * info->dependency_count, MEMORY_TAG_ARRAY);
     }
 
-    // Create a semaphore for the thread which will block until there is work to do.
-    if (!ksemaphore_create(&thread->semaphore, 1, 1)) {
-        KERROR("Failed to create job thread semaphore! Aborting thread.");
-        return 0;
+    // Flag the job as complete, which also kicks off any jobs depending on it.
+    // Internal jobs (i.e. parallel-for helpers) have no identifier to complete.
+    if (info->id != INVALID_ID_U16) {
+        job_complete(info->id);
     }
+}
 
-    // Run forever, waiting for jobs.
-    while (true) {
-        if (!state_ptr || !state_ptr->running || !thread) {
-            break;
-        }
+static void job_execute(job_info* info) {
+    b8 result = info->entry_point(info->param_data, info->result_data);
+    job_finish(info, result);
+}
 
-        // Wait for the semaphore to be signaled.
-        ksemaphore_wait(&thread->semaphore, 0xFFFFFFFF);
+// Queues the job to be executed. If it can't be, it is failed instead so that anything waiting on it is still released.
+static void job_dispatch(job_info* info) {
+    if (!enqueue_job(info)) {
+        job_finish(info, false);
+    }
+}
 
-        // Lock and grab a copy of the info
-        if (!kmutex_lock(&thread->info_mutex)) {
-            KERROR("Failed to obtain lock on job thread mutex!");
-        }
-        job_info info = thread->info;
-        if (!kmutex_unlock(&thread->info_mutex)) {
-            KERROR("Failed to release lock on job thread mutex!");
-        }
+// Holds onto the job until all of its dependencies, as well as extra_dependency_id if valid, have completed.
+// Then it is queued to be executed.
+static void job_submit_after(job_info* info, u16 extra_dependency_id) {
+    u32 dependency_count = info->dependency_count + (extra_dependency_id != INVALID_ID_U16 ? 1 : 0);
+    if (!dependency_count) {
+        job_dispatch(info);
+        return;
+    }
 
-        if (info.entry_point) {
-            b8 result = info.entry_point(info.param_data, info.result_data);
+    // The extra pending count keeps dependencies which complete during registration from releasing it early.
+    job_record* record = &state_ptr->records[info->id];
+    katomic_store_u32(&record->pending_count, dependency_count + 1);
+    record->waiting_info = pool_allocator_allocate(&state_ptr->info_pool);
+    *record->waiting_info = *info;
 
-            // Store the result to be executed on the main thread later.
-            // Note that store_result takes a copy of the result_data
-            // so it does not have to be held onto by this thread any longer.
-            if (result && info.on_success) {
-                store_result(info.on_success, info.result_data_size, info.result_data);
-            } else if (!result && info.on_fail) {
-                store_result(info.on_fail, info.result_data_size, info.result_data);
-            }
+    for (u8 i = 0; i < info->dependency_count; ++i) {
+        if (!job_add_continuation(info->dependency_ids[i], info->id)) {
+            job_dependency_resolved(info->id);
+        }
+    }
+    if (extra_dependency_id != INVALID_ID_U16 && !job_add_continuation(extra_dependency_id, info->id)) {
+        job_dependency_resolved(info->id);
+    }
 
-            // Clear the param data and result data.
-            if (info.param_data) {
-                kfree(info.param_data, info.param_data_size, MEMORY_TAG_JOB);
-            }
-            if (info.result_data) {
-                kfree(info.result_data, info.result_data_size, MEMORY_TAG_JOB);
-            }
+    job_dependency_resolved(info->id);
+}
 
-            // Update the job status for this job.
-            if (!kmutex_lock(&state_ptr->job_status_mutex)) {
-                KERROR("Failed to lock job status mutex!");
-            }
-            state_ptr->job_statuses[thread->info.id] = true;
-            if (!kmutex_unlock(&state_ptr->job_status_mutex)) {
-                KERROR("Failed to unlock job status mutex!");
-            }
+static u32 job_thread_run(void* params) {
+    u8 index = *(u8*)params;
+    job_thread* thread = &state_ptr->job_threads[index];
+    current_job_thread = thread;
+    KTRACE("Starting job thread #%i (id=%#x, type=%#x).", thread->index, thread->thread.thread_id, thread->type_mask);
 
-            // Lock and reset the thread's info object
-            if (!kmutex_lock(&thread->info_mutex)) {
-                KERROR("Failed to obtain lock on job thread mutex!");
-            }
-            if (thread->info.dependency_ids) {
-                kfree(thread->info.dependency_ids, sizeof(u16) * thread->info.dependency_count, MEMORY_TAG_ARRAY);
-            }
-            kzero_memory(&thread->info, sizeof(job_info));
-            if (!kmutex_unlock(&thread->info_mutex)) {
-                KERROR("Failed to release lock on job thread mutex!");
-            }
+    // Run until shut down, pulling jobs directly from queues or other threads.
+    while (katomic_load_u32(&state_ptr->running)) {
+        job_info info;
+        if (job_acquire(thread, thread->type_mask, &info)) {
+            job_execute(&info);
+            continue;
         }
 
-        // If no longer running, shut down the thread.
-        if (!state_ptr->running) {
-            break;
+        // Nothing to do. Flag as sleeping, then check once more in case a job was
+        // submitted before the flag was visible to the submitting thread.
+        katomic_store_u32(&thread->sleeping, 1);
+        if (job_acquire(thread, thread->type_mask, &info)) {
+            katomic_store_u32(&thread->sleeping, 0);
+            job_execute(&info);
+            continue;
         }
-    }
 
-    // Destroy the mutex for this thread.
-    kmutex_destroy(&thread->info_mutex);
-
-    // Destroy the semaphore.
-    ksemaphore_destroy(&thread->semaphore);
+        // Block until a submission wakes this thread.
+        ksemaphore_wait(&thread->semaphore, 0xFFFFFFFF);
+        katomic_store_u32(&thread->sleeping, 0);
+    }
 
+    current_job_thread = 0;
+    // Hand back any small allocations cached by this thread.
+    kmemory_thread_cache_release();
     return 1;
 }
 
 b8 job_system_initialize(u64* job_system_memory_requirement, void* state, void* config) {
     job_system_config* typed_config = (job_system_config*)config;
-    *job_system_memory_requirement = sizeof(job_system_state) + (sizeof(u8) * (INVALID_ID_U16 - 1));
+    *job_system_memory_requirement = sizeof(job_system_state) + (sizeof(job_record) * MAX_JOB_IDS) + JOB_STATE_ALIGNMENT;
     if (state == 0) {
         return true;
     }
 
-    kzero_memory(state, sizeof(job_system_state));
+    state_ptr = (job_system_state*)get_aligned((u64)state, JOB_STATE_ALIGNMENT);
+    kzero_memory(state_ptr, sizeof(job_system_state));
 
-    state_ptr = state;
     state_ptr->running = true;
-    state_ptr->job_statuses = (void*)((u64)state_ptr + sizeof(job_system_state));
-
-    ring_queue_create(sizeof(job_info), 1024, 0, &state_ptr->low_priority_queue);
-    ring_queue_create(sizeof(job_info), 1024, 0, &state_ptr->normal_priority_queue);
-    ring_queue_create(sizeof(job_info), 1024, 0, &state_ptr->high_priority_queue);
-    state_ptr->thread_count = typed_config->max_job_thread_count;
-
-    // Invalidate all result slots
-    for (u16 i = 0; i < MAX_JOB_RESULTS; ++i) {
-        state_ptr->pending_results[i].id = INVALID_ID_U16;
+    state_ptr->records = (void*)((u64)state_ptr + sizeof(job_system_state));
+    kzero_memory(state_ptr->records, sizeof(job_record) * MAX_JOB_IDS);
+
+    for (u32 t = 0; t < JOB_TYPE_SLOT_COUNT; ++t) {
+        for (u32 p = 0; p < JOB_PRIORITY_COUNT; ++p) {
+            ring_queue_create(sizeof(job_info), JOB_INJECTION_QUEUE_CAPACITY, 0, &state_ptr->injection_queues[t][p]);
+            if (!kmutex_create(&state_ptr->injection_queue_mutexes[t][p])) {
+                KERROR("Failed to create job queue mutex!");
+                return false;
+            }
+        }
     }
 
-    KDEBUG("Main thread id is: %#x", platform_current_thread_id());
+    // Link up the free list of job slots.
+    for (u32 i = 0; i < MAX_JOB_SLOTS; ++i) {
+        state_ptr->job_slot_next[i] = (i + 1 < MAX_JOB_SLOTS) ? i + 1 : INVALID_ID;
+    }
+    state_ptr->free_slot_head = 0;
+    for (u32 i = 0; i < MAX_PARALLEL_FOR_TASKS; ++i) {
+        state_ptr->parallel_for_task_next[i] = (i + 1 < MAX_PARALLEL_FOR_TASKS) ? i + 1 : INVALID_ID;
+    }
+    state_ptr->free_parallel_for_task_head = 0;
 
-    KDEBUG("Spawning %i job threads.", state_ptr->thread_count);
+    state_ptr->thread_count = KMIN(typed_config->max_job_thread_count, MAX_JOB_THREADS);
 
-    for (u8 i = 0; i < state_ptr->thread_count; ++i) {
-        state_ptr->job_threads[i].index = i;
-        state_ptr->job_threads[i].type_mask = typed_config->type_masks[i];
-        if (!kthread_create(job_thread_run, &state_ptr->job_threads[i].index, false, &state_ptr->job_threads[i].thread)) {
-            KFATAL("OS Error in creating job thread. Application cannot continue.");
-            return false;
-        }
-        kzero_memory(&state_ptr->job_threads[i].info, sizeof(job_info));
-    }
+    state_ptr->pending_results = darray_create(job_result_entry);
+    state_ptr->processing_results = darray_create(job_result_entry);
 
     // Create needed mutexes
     if (!kmutex_create(&state_ptr->result_mutex)) {
         KERROR("Failed to create result mutex!");
         return false;
     }
-    if (!kmutex_create(&state_ptr->low_pri_queue_mutex)) {
-        KERROR("Failed to create low priority queue mutex!");
-        return false;
-    }
-    if (!kmutex_create(&state_ptr->normal_pri_queue_mutex)) {
-        KERROR("Failed to create normal priority queue mutex!");
+
+    // Jobs are created and completed from any thread, so the pools must be thread-safe.
+    if (!pool_allocator_create(sizeof(job_info), JOB_POOL_BLOCKS_PER_PAGE, true, MEMORY_TAG_JOB, &state_ptr->info_pool) ||
+        !pool_allocator_create(sizeof(job_continuation), JOB_POOL_BLOCKS_PER_PAGE, true, MEMORY_TAG_JOB, &state_ptr->continuation_pool) ||
+        !pool_allocator_create(JOB_PAYLOAD_POOL_BLOCK_SIZE, JOB_POOL_BLOCKS_PER_PAGE, true, MEMORY_TAG_JOB, &state_ptr->payload_pool)) {
+        KERROR("Failed to create job pools!");
         return false;
     }
-    if (!kmutex_create(&state_ptr->high_pri_queue_mutex)) {
-        KERROR("Failed to create high priority queue mutex!");
-        return false;
+
+    KDEBUG("Main thread id is: %#x", platform_current_thread_id());
+
+    KDEBUG("Spawning %i job threads.", state_ptr->thread_count);
+
+    for (u8 i = 0; i < state_ptr->thread_count; ++i) {
+        job_thread* thread = &state_ptr->job_threads[i];
+        thread->index = i;
+        thread->type_mask = typed_config->type_masks[i];
+        if (thread->type_mask & JOB_TYPE_GENERAL) {
+            state_ptr->general_thread_count++;
+        }
+        thread->rng_state = 0x9E3779B9u * (i + 1);
+
+        // Create a semaphore for the thread which will block until there is work to do.
+        // NOTE: This is done before the thread starts so that submissions can always signal it.
+        if (!ksemaphore_create(&thread->semaphore, 1, 0)) {
+            KERROR("Failed to create job thread semaphore!");
+            return false;
+        }
     }
-    if (!kmutex_create(&state_ptr->job_status_mutex)) {
-        KERROR("Failed to create job status mutex!");
-        return false;
+
+    for (u8 i = 0; i < state_ptr->thread_count; ++i) {
+        if (!kthread_create(job_thread_run, &state_ptr->job_threads[i].index, false, &state_ptr->job_threads[i].thread)) {
+            KFATAL("OS Error in creating job thread. Application cannot continue.");
+            return false;
+        }
     }
 
     return true;
@@ -246,96 +739,37 @@ b8 job_system_initialize(u64* job_system_memory_requirement, void* state, void*
 
 void job_system_shutdown(void* state) {
     if (state_ptr) {
-        state_ptr->running = false;
+        katomic_store_u32(&state_ptr->running, false);
 
         u64 thread_count = state_ptr->thread_count;
 
-        // Check for a free thread first.
+        // Wake up and wait for each thread to finish its current job.
         for (u8 i = 0; i < thread_count; ++i) {
-            kthread_destroy(&state_ptr->job_threads[i].thread);
+            ksemaphore_signal(&state_ptr->job_threads[i].semaphore);
         }
-        ring_queue_destroy(&state_ptr->low_priority_queue);
-        ring_queue_destroy(&state_ptr->normal_priority_queue);
-        ring_queue_destroy(&state_ptr->high_priority_queue);
-
-        // Destroy mutexes
-        kmutex_destroy(&state_ptr->result_mutex);
-        kmutex_destroy(&state_ptr->low_pri_queue_mutex);
-        kmutex_destroy(&state_ptr->normal_pri_queue_mutex);
-        kmutex_destroy(&state_ptr->high_pri_queue_mutex);
-        kmutex_destroy(&state_ptr->job_status_mutex);
-
-        state_ptr = 0;
-    }
-}
-
-static void process_queue(ring_queue* queue, kmutex* queue_mutex) {
-    u64 thread_count = state_ptr->thread_count;
-
-    // Check for a free thread first.
-    while (queue->length > 0) {
-        job_info info;
-        if (!ring_queue_peek(queue, &info)) {
-            break;
+        for (u8 i = 0; i < thread_count; ++i) {
+            kthread_wait(&state_ptr->job_threads[i].thread);
+            ksemaphore_destroy(&state_ptr->job_threads[i].semaphore);
         }
 
-        // Verify dependencies are complete.
-        b8 awaiting_dependency = false;
-        if (info.dependency_count) {
-            for (u32 i = 0; i < info.dependency_count; ++i) {
-                if (!job_system_query_job_complete(info.dependency_ids[i])) {
-                    KTRACE("Note: Not starting job id %u because it's dependency (job id=%u) is still running.", info.id, info.dependency_ids[i]);
-                    awaiting_dependency = true;
-                    break;
-                }
+        for (u32 t = 0; t < JOB_TYPE_SLOT_COUNT; ++t) {
+            for (u32 p = 0; p < JOB_PRIORITY_COUNT; ++p) {
+                ring_queue_destroy(&state_ptr->injection_queues[t][p]);
+                kmutex_destroy(&state_ptr->injection_queue_mutexes[t][p]);
             }
         }
 
-        if (awaiting_dependency) {
-            continue;
-        }
+        darray_destroy(state_ptr->pending_results);
+        darray_destroy(state_ptr->processing_results);
 
-        b8 thread_found = false;
-        for (u8 i = 0; i < thread_count; ++i) {
-            job_thread* thread = &state_ptr->job_threads[i];
-            if ((thread->type_mask & info.type) == 0) {
-                continue;
-            }
-
-            // Check that the job thread can handle the job type.
-            if (!kmutex_lock(&thread->info_mutex)) {
-                KERROR("Failed to obtain lock on job thread mutex!");
-            }
-            if (!thread->info.entry_point) {
-                // Make sure to remove the entry from the queue.
-                if (!kmutex_lock(queue_mutex)) {
-                    KERROR("Failed to obtain lock on queue mutex!");
-                }
-                ring_queue_dequeue(queue, &info);
-                if (!kmutex_unlock(queue_mutex)) {
-                    KERROR("Failed to release lock on queue mutex!");
-                }
-                thread->info = info;
-                KTRACE("Assigning job to thread: %u", thread->index);
-                thread_found = true;
-                // Signal the thread's semaphore since there is work to be done.
-                ksemaphore_signal(&thread->semaphore);
-            }
-            if (!kmutex_unlock(&thread->info_mutex)) {
-                KERROR("Failed to release lock on job thread mutex!");
-            }
+        // Destroy mutexes
+        kmutex_destroy(&state_ptr->result_mutex);
 
-            // Break after unlocking if an available thread was found.
-            if (thread_found) {
-                break;
-            }
-        }
+        pool_allocator_destroy(&state_ptr->info_pool);
+        pool_allocator_destroy(&state_ptr->continuation_pool);
+        pool_allocator_destroy(&state_ptr->payload_pool);
 
-        // This means all of the threads are currently handling a job,
-        // So wait until the next update and try again.
-        if (!thread_found) {
-            break;
-        }
+        state_ptr = 0;
     }
 }
 
@@ -344,93 +778,62 @@ b8 job_system_update(void* state, struct frame_data* p_frame_data) {
         return false;
     }
 
-    process_queue(&state_ptr->high_priority_queue, &state_ptr->high_pri_queue_mutex);
-    process_queue(&state_ptr->normal_priority_queue, &state_ptr->normal_pri_queue_mutex);
-    process_queue(&state_ptr->low_priority_queue, &state_ptr->low_pri_queue_mutex);
+    // Swap out the pending results so job threads are not blocked while callbacks run.
+    if (!kmutex_lock(&state_ptr->result_mutex)) {
+        KERROR("Failed to obtain lock on result mutex!");
+    }
+    job_result_entry* results = state_ptr->pending_results;
+    state_ptr->pending_results = state_ptr->processing_results;
+    state_ptr->processing_results = results;
+    if (!kmutex_unlock(&state_ptr->result_mutex)) {
+        KERROR("Failed to release lock on result mutex!");
+    }
 
     // Process pending results.
-    for (u16 i = 0; i < MAX_JOB_RESULTS; ++i) {
-        // Lock and take a copy, unlock.
-        if (!kmutex_lock(&state_ptr->result_mutex)) {
-            KERROR("Failed to obtain lock on result mutex!");
-        }
-        job_result_entry entry = state_ptr->pending_results[i];
-        if (!kmutex_unlock(&state_ptr->result_mutex)) {
-            KERROR("Failed to release lock on result mutex!");
-        }
-
-        if (entry.id != INVALID_ID_U16) {
-            // Execute the callback.
-            entry.callback(entry.params);
-
-            if (entry.params) {
-                kfree(entry.params, entry.param_size, MEMORY_TAG_JOB);
-            }
-
-            // Lock actual entry, invalidate and clear it
-            if (!kmutex_lock(&state_ptr->result_mutex)) {
-                KERROR("Failed to obtain lock on result mutex!");
-            }
-            kzero_memory(&state_ptr->pending_results[i], sizeof(job_result_entry));
-            state_ptr->pending_results[i].id = INVALID_ID_U16;
-            if (!kmutex_unlock(&state_ptr->result_mutex)) {
-                KERROR("Failed to release lock on result mutex!");
-            }
+    u32 result_count = darray_length(results);
+    for (u32 i = 0; i < result_count; ++i) {
+        job_result_entry* entry = &results[i];
+        // Execute the callback.
+        entry->callback(entry->params);
+
+        if (entry->params) {
+            job_payload_free(entry->params, entry->param_size);
         }
     }
+    darray_clear(results);
 
     return true;
 }
 
 void job_system_submit(job_info info) {
-    u64 thread_count = state_ptr->thread_count;
-    ring_queue* queue = &state_ptr->normal_priority_queue;
-    kmutex* queue_mutex = &state_ptr->normal_pri_queue_mutex;
+    job_submit_after(&info, INVALID_ID_U16);
+}
 
-    // If the job is high priority, try to kick it off immediately.
-    if (info.priority == JOB_PRIORITY_HIGH) {
-        queue = &state_ptr->high_priority_queue;
-        queue_mutex = &state_ptr->high_pri_queue_mutex;
+u16 job_system_submit_group(u32 job_count, job_info* jobs) {
+    u16 group_id = job_id_create();
+    job_record* record = &state_ptr->records[group_id];
+    katomic_store_u32(&record->pending_count, job_count + 1);
 
-        // Check for a free thread that supports the job type first.
-        for (u8 i = 0; i < thread_count; ++i) {
-            job_thread* thread = &state_ptr->job_threads[i];
-            if (state_ptr->job_threads[i].type_mask & info.type) {
-                b8 found = false;
-                if (!kmutex_lock(&thread->info_mutex)) {
-                    KERROR("Failed to obtain lock on job thread mutex!");
-                }
-                if (!state_ptr->job_threads[i].info.entry_point) {
-                    KTRACE("Job immediately submitted on thread %i", state_ptr->job_threads[i].index);
-                    state_ptr->job_threads[i].info = info;
-                    found = true;
-                }
-                if (!kmutex_unlock(&thread->info_mutex)) {
-                    KERROR("Failed to release lock on job thread mutex!");
-                }
-                if (found) {
-                    return;
-                }
-            }
+    // Register the group as a continuation of each job before any of them can complete.
+    // Members which have already completed count as resolved straight away.
+    for (u32 i = 0; i < job_count; ++i) {
+        if (!job_add_continuation(jobs[i].id, group_id)) {
+            job_dependency_resolved(group_id);
         }
     }
-
-    // If this point is reached, all threads are busy (if high) or it can wait a frame.
-    // Add to the queue and try again next cycle.
-    if (info.priority == JOB_PRIORITY_LOW) {
-        queue = &state_ptr->low_priority_queue;
-        queue_mutex = &state_ptr->low_pri_queue_mutex;
+    for (u32 i = 0; i < job_count; ++i) {
+        job_system_submit(jobs[i]);
     }
 
-    // NOTE: Locking here in case the job is submitted from another job/thread.
-    if (!kmutex_lock(queue_mutex)) {
-        KERROR("Failed to obtain lock on queue mutex!");
-    }
-    ring_queue_enqueue(queue, &info);
-    if (!kmutex_unlock(queue_mutex)) {
-        KERROR("Failed to release lock on queue mutex!");
+    job_dependency_resolved(group_id);
+    return group_id;
+}
+
+void job_system_submit_continuations(u16 job_id, u32 job_count, job_info* jobs) {
+    // Any dependencies the jobs were created with are waited on as well.
+    for (u32 i = 0; i < job_count; ++i) {
+        job_submit_after(&jobs[i], job_id);
     }
-    KTRACE("Job queued.");
 }
 
 job_info job_create(pfn_job_start entry_point, pfn_job_on_complete on_success, pfn_job_on_complete on_fail, void* param_data, u32 param_data_size, u32 result_data_size) {
@@ -463,24 +866,12 @@ job_info job_create_with_dependencies(
     job.type = type;
     job.priority = priority;
 
-    // Technically jobs can be created in the middle of other jobs (i.e. on a different thread)
-    // so make sure to lock around these updates.
-    if (!kmutex_lock(&state_ptr->job_status_mutex)) {
-        KERROR("Failed to lock job status mutex!");
-    }
-
-    // TODO: Pack booleans.
-    KASSERT_MSG(state_ptr->current_job_id < INVALID_ID_U16, "Job system identifier overflow - need to pack booleans.");
-    job.id = state_ptr->current_job_id;
-    state_ptr->current_job_id++;
-    state_ptr->job_statuses[job.id] = false;
-    if (!kmutex_unlock(&state_ptr->job_status_mutex)) {
-        KERROR("Failed to unlock job status mutex!");
-    }
+    // NOTE: Jobs can be created in the middle of other jobs (i.e. on a different thread), which job_id_create handles.
+    job.id = job_id_create();
 
     job.param_data_size = param_data_size;
     if (param_data_size) {
-        job.param_data = kallocate(param_data_size, MEMORY_TAG_JOB);
+        job.param_data = job_payload_allocate(param_data_size);
         kcopy_memory(job.param_data, param_data, param_data_size);
     } else {
         job.param_data = 0;
@@ -488,7 +879,7 @@ job_info job_create_with_dependencies(
 
     job.result_data_size = result_data_size;
     if (result_data_size) {
-        job.result_data = kallocate(result_data_size, MEMORY_TAG_JOB);
+        job.result_data = job_payload_allocate(result_data_size);
     } else {
         job.result_data = 0;
     }
@@ -505,17 +896,125 @@ job_info job_create_with_dependencies(
 }
 
 b8 job_system_query_job_complete(u16 job_id) {
-    b8 status = INVALID_ID;
-    if (!kmutex_lock(&state_ptr->job_status_mutex)) {
-        KERROR("Failed to lock job status mutex!");
+    return katomic_load_u32(&state_ptr->records[job_id].complete) != 0;
+}
+
+// Backs off while waiting on other threads. Spins briefly at first, then yields the time slice.
+static void job_wait_backoff(u32* spin_count) {
+    if (*spin_count < JOB_WAIT_SPIN_COUNT) {
+        (*spin_count)++;
+        katomic_pause();
+    } else {
+        platform_sleep(0);
+    }
+}
+
+b8 job_system_wait_for_jobs(u8 job_count, u16* job_ids) {
+    if (!state_ptr || !state_ptr->running) {
+        return false;
+    }
+
+    // Job threads execute other jobs of their own types while waiting, since the jobs being waited on
+    // may otherwise never get a thread. Other threads (i.e. the main thread) only wait, so they are
+    // never held up by an unrelated long-running job.
+    job_thread* thread = current_job_thread;
+    for (u8 i = 0; i < job_count; ++i) {
+        u32 spin_count = 0;
+        while (!job_system_query_job_complete(job_ids[i])) {
+            job_info info;
+            if (thread && job_acquire(thread, thread->type_mask, &info)) {
+                job_execute(&info);
+            } else {
+                job_wait_backoff(&spin_count);
+            }
+        }
+    }
+
+    return true;
+}
+
+// Claims and processes ranges of the task until none are left.
+static void parallel_for_run(parallel_for_task* task) {
+    while (true) {
+        u32 start = katomic_fetch_add_u32(&task->next, task->grain);
+        if (start >= task->count) {
+            return;
+        }
+        u32 end = KMIN(start + task->grain, task->count);
+        task->fn(start, end, task->context);
+        katomic_fetch_sub_u32(&task->remaining, end - start);
     }
-    status = state_ptr->job_statuses[job_id];
-    if (!kmutex_unlock(&state_ptr->job_status_mutex)) {
-        KERROR("Failed to unlock job status mutex!");
+}
+
+// Drops a reference to the task, returning it to the free list if it was the last.
+static void parallel_for_task_release(parallel_for_task* task) {
+    if (katomic_fetch_sub_u32(&task->ref_count, 1) == 1) {
+        index_free_list_push(&state_ptr->free_parallel_for_task_head, state_ptr->parallel_for_task_next, (u32)(task - state_ptr->parallel_for_tasks));
     }
-    return status;
 }
 
-b8 job_system_wait_for_jobs(u8 job_count, u16 job_ids) {
+static b8 parallel_for_job_entry(void* param_data, void* result_data) {
+    parallel_for_task* task = param_data;
+    parallel_for_run(task);
+    parallel_for_task_release(task);
     return true;
 }
+
+void job_system_parallel_for(u32 count, u32 grain, pfn_job_parallel_for fn, void* context) {
+    if (!count || !fn) {
+        return;
+    }
+
+    u32 helper_count = state_ptr ? state_ptr->general_thread_count : 0;
+    if (!grain) {
+        // Default to a few ranges per thread to even out the load.
+        grain = KMAX(1, count / ((helper_count + 1) * 4));
+    }
+
+    u32 range_count = (count + grain - 1) / grain;
+    helper_count = KMIN(helper_count, range_count - 1);
+
+    // Without helpers (or if too many calls are in progress), the calling thread does it all.
+    u32 task_index;
+    if (!helper_count || !index_free_list_pop(&state_ptr->free_parallel_for_task_head, state_ptr->parallel_for_task_next, &task_index)) {
+        fn(0, count, context);
+        return;
+    }
+
+    parallel_for_task* task = &state_ptr->parallel_for_tasks[task_index];
+    task->fn = fn;
+    task->context = context;
+    task->count = count;
+    task->grain = grain;
+    task->next = 0;
+    task->remaining = count;
+    katomic_store_u32(&task->ref_count, helper_count + 1);
+
+    // Helpers reference the task directly, so no param data is copied.
+    job_info helper = {0};
+    helper.type = JOB_TYPE_GENERAL;
+    helper.priority = JOB_PRIORITY_HIGH;
+    helper.id = INVALID_ID_U16;
+    helper.entry_point = parallel_for_job_entry;
+    helper.param_data = task;
+    for (u32 i = 0; i < helper_count; ++i) {
+        if (!enqueue_job(&helper)) {
+            // The remaining helpers will never run, so drop their references. Whatever ranges they
+            // would have taken are picked up by the calling thread below.
+            katomic_fetch_sub_u32(&task->ref_count, helper_count - i);
+            break;
+        }
+    }
+
+    // The calling thread takes part as well.
+    parallel_for_run(task);
+
+    // Wait for ranges still being processed by helpers. The calling thread does not pick up any other
+    // jobs meanwhile, so it is never held up by unrelated work. Helpers which haven't started yet are
+    // not waited on, as they will find nothing left to do.
+    u32 spin_count = 0;
+    while (katomic_load_u32(&task->remaining)) {
+        job_wait_backoff(&spin_count);
+    }
+    parallel_for_task_release(task);
+}
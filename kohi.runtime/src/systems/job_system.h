@@ -8,6 +8,14 @@ typedef b8 (*pfn_job_start)(void*, void*);
 /** @brief A function pointer definition for completion of a job. */
 typedef void (*pfn_job_on_complete)(void*);
 
+/**
+ * @brief A function pointer definition for processing a range of a parallel-for.
+ * @param start The first index of the range.
+ * @param end One past the last index of the range.
+ * @param context The context passed to job_system_parallel_for.
+ */
+typedef void (*pfn_job_parallel_for)(u32 start, u32 end, void* context);
+
 struct frame_data;
 
 /** @brief Describes a type of job */
@@ -80,7 +88,10 @@ typedef struct job_info {
     /** @brief The size of the data passed to the success/fail function. */
     u32 result_data_size;
 
-    /** @brief A count of job identifiers that must be complete before this job starts. */
+    /**
+     * @brief A count of job identifiers that must be complete before this job starts.
+     * The job is kicked off by whichever thread completes the last of them.
+     */
     u8 dependency_count;
 
     /** @brief An array of job identifiers that must be complete before this job starts. */
@@ -118,7 +129,9 @@ void job_system_shutdown(void* state);
 b8 job_system_update(void* state, struct frame_data* p_frame_data);
 
 /**
- * @brief Submits the provided job to be queued for execution.
+ * @brief Submits the provided job to be queued for execution. If the job cannot be queued,
+ * it is failed instead (its on_fail callback is invoked and it is flagged as complete),
+ * so anything waiting on it is still released.
  * @param info The description of the job to be executed.
  */
 KAPI void job_system_submit(job_info info);
@@ -188,7 +201,50 @@ KAPI job_info job_create_with_dependencies(
     u8 dependency_count,
     u16* dependencies);
 
+/**
+ * @brief Submits a group of jobs (fan-in). Returns an identifier which completes once every
+ * job in the group has completed, which can be used as a dependency of other jobs or waited on.
+ * @param job_count The number of jobs in the group.
+ * @param jobs An array of jobs to be submitted.
+ * @returns The identifier of the group.
+ */
+KAPI u16 job_system_submit_group(u32 job_count, job_info* jobs);
+
+/**
+ * @brief Submits jobs which are kicked off as soon as the given job completes (fan-out).
+ * This is the equivalent of adding job_id to the dependencies of each job, without the
+ * allocation of a dependency array per job. Any dependencies the jobs were created with
+ * must also complete before they are kicked off.
+ * @param job_id The identifier of the job (or group) to wait on.
+ * @param job_count The number of jobs to be submitted.
+ * @param jobs An array of jobs to be submitted.
+ */
+KAPI void job_system_submit_continuations(u16 job_id, u32 job_count, job_info* jobs);
+
 /**
  * @brief Returns whether or not the job with the given identifier has completed.
+ * @note Job identifiers wrap around after 65535 jobs have been created.
  */
 KAPI b8 job_system_query_job_complete(u16 job_id);
+
+/**
+ * @brief Blocks until all of the given jobs have completed. Job threads execute other jobs
+ * of their own types while waiting. Threads outside of the job system only wait.
+ * @note Success/fail callbacks are still only invoked during job_system_update.
+ * @param job_count The number of job identifiers.
+ * @param job_ids An array of job identifiers to wait on.
+ * @returns True on success; otherwise false.
+ */
+KAPI b8 job_system_wait_for_jobs(u8 job_count, u16* job_ids);
+
+/**
+ * @brief Splits the range [0, count) into ranges of grain elements, and processes them across
+ * job threads, including the calling thread. Blocks until the entire range has been processed.
+ * The calling thread only works on this range, and never picks up other jobs while it waits.
+ * @note fn may be invoked concurrently from several threads, and so must be thread-safe.
+ * @param count The number of elements to process.
+ * @param grain The number of elements per range. Pass 0 to have one picked based on thread count.
+ * @param fn The function to be invoked for each range.
+ * @param context A pointer passed through to fn. Not copied.
+ */
+KAPI void job_system_parallel_for(u32 count, u32 grain, pfn_job_parallel_for fn, void* context);
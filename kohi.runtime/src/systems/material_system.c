@@ -256,8 +256,8 @@ typedef struct material_standard_group_uniform_data {
 } material_standard_group_uniform_data;
 
 // Standard Material Per-draw UBO
+// NOTE: The model matrix is a per-instance vertex attribute instead, so instanced draws can share this.
 typedef struct material_standard_draw_uniform_data {
-    mat4 model;
     vec4 clipping_plane;
     u32 view_index;
     u32 irradiance_cubemap_index;
@@ -453,7 +453,7 @@ b8 material_system_initialize(u64* memory_requirement, material_system_state* st
         mat_std_shader.stages[1].package_name = PACKAGE_NAME_RUNTIME;
         mat_std_shader.stages[1].source_asset_name = MATERIAL_STANDARD_NAME_FRAG;
 
-        mat_std_shader.attribute_count = 5;
+        mat_std_shader.attribute_count = 9;
         mat_std_shader.attributes = KALLOC_TYPE_CARRAY(kasset_shader_attribute, mat_std_shader.attribute_count);
         mat_std_shader.attributes[0].type = SHADER_ATTRIB_TYPE_FLOAT32_3;
         mat_std_shader.attributes[0].name = "in_position";
@@ -466,6 +466,19 @@ b8 material_system_initialize(u64* memory_requirement, material_system_state* st
         mat_std_shader.attributes[3].type = SHADER_ATTRIB_TYPE_FLOAT32_4;
         mat_std_shader.attributes[4].name = "in_tangent";
         mat_std_shader.attributes[4].type = SHADER_ATTRIB_TYPE_FLOAT32_4;
+        // Per-instance model matrix, one column per attribute.
+        mat_std_shader.attributes[5].name = "in_model_0";
+        mat_std_shader.attributes[5].type = SHADER_ATTRIB_TYPE_FLOAT32_4;
+        mat_std_shader.attributes[5].per_instance = true;
+        mat_std_shader.attributes[6].name = "in_model_1";
+        mat_std_shader.attributes[6].type = SHADER_ATTRIB_TYPE_FLOAT32_4;
+        mat_std_shader.attributes[6].per_instance = true;
+        mat_std_shader.attributes[7].name = "in_model_2";
+        mat_std_shader.attributes[7].type = SHADER_ATTRIB_TYPE_FLOAT32_4;
+        mat_std_shader.attributes[7].per_instance = true;
+        mat_std_shader.attributes[8].name = "in_model_3";
+        mat_std_shader.attributes[8].type = SHADER_ATTRIB_TYPE_FLOAT32_4;
+        mat_std_shader.attributes[8].per_instance = true;
 
         mat_std_shader.uniform_count = 9;
         mat_std_shader.uniforms = KALLOC_TYPE_CARRAY(kasset_shader_uniform, mat_std_shader.uniform_count);
@@ -897,6 +910,14 @@ b8 material_flag_get(struct material_system_state* state, khandle material, kmat
     return FLAG_GET(data->flags, (u32)flag);
 }
 
+kmaterial_type material_type_get(struct material_system_state* state, khandle material) {
+    if (!state || khandle_is_invalid(material) || khandle_is_stale(material, state->materials[material.handle_index].unique_id)) {
+        return KMATERIAL_TYPE_UNKNOWN;
+    }
+
+    return state->materials[material.handle_index].type;
+}
+
 b8 material_system_acquire(material_system_state* state, kname name, material_instance* out_instance) {
     KASSERT_MSG(out_instance, "out_instance is required.");
 
@@ -1404,7 +1425,6 @@ b8 material_system_apply_instance(material_system_state* state, const material_i
         // Update uniform data
         material_standard_draw_uniform_data draw_ubo = {0};
         draw_ubo.clipping_plane = draw_data.clipping_plane;
-        draw_ubo.model = draw_data.model;
         draw_ubo.irradiance_cubemap_index = draw_data.irradiance_cubemap_index;
         draw_ubo.view_index = draw_data.view_index;
 
@@ -199,6 +199,15 @@ KAPI b8 material_flag_set(struct material_system_state* state, khandle material,
  */
 KAPI b8 material_flag_get(struct material_system_state* state, khandle material, kmaterial_flag_bits flag);
 
+/**
+ * @brief Gets the type of the given material, which determines the shader it is rendered with.
+ *
+ * @param state A pointer to the material system state.
+ * @param material The identifier of the material.
+ * @returns The material type, or KMATERIAL_TYPE_UNKNOWN if the material is invalid.
+ */
+KAPI kmaterial_type material_type_get(struct material_system_state* state, khandle material);
+
 // -------------------------------------------------
 // ------------- MATERIAL INSTANCE -----------------
 // -------------------------------------------------
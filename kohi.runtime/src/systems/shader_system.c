@@ -475,13 +475,17 @@ static b8 internal_attribute_add(kshader* shader, const shader_attribute_config*
         break;
     }
 
-    shader->attribute_stride += size;
+    // Per-instance attributes come from a separate buffer, so they aren't part of the vertex.
+    if (!config->per_instance) {
+        shader->attribute_stride += size;
+    }
 
     // Create/push the attribute.
     shader_attribute attrib = {};
     attrib.name = config->name;
     attrib.size = size;
     attrib.type = config->type;
+    attrib.per_instance = config->per_instance;
     darray_push(shader->attributes, attrib);
 
     return true;
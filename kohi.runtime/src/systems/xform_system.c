@@ -13,6 +13,14 @@
 #include "memory/kmemory.h"
 #include "strings/kstring.h"
 
+// The local matrix needs to be recalculated.
+#define XFORM_FLAG_LOCAL_DIRTY 0x1
+// The xform is already in the dirty list.
+#define XFORM_FLAG_QUEUED 0x2
+
+// The number of xforms handed to the batched math routines at once.
+#define XFORM_BATCH_SIZE 256
+
 // Going with a SOA here so that like data is grouped together.
 typedef struct xform_system_state {
     /** @brief The cached local matrices in the world, indexed by handle. */
@@ -37,6 +45,15 @@ typedef struct xform_system_state {
     u32* local_dirty_handles;
     u32 local_dirty_count;
 
+    /** @brief XFORM_FLAG_ bits for each xform, indexed by handle. */
+    u8* flags;
+
+    /** @brief Incremented each time the local values of an xform change, indexed by handle. */
+    u32* local_versions;
+
+    /** @brief Incremented each time the world matrix of an xform is set, indexed by handle. */
+    u32* world_versions;
+
     /** The number of currently-allocated slots available (NOT the allocated space in bytes!) */
     u32 allocated;
 
@@ -50,6 +67,7 @@ typedef struct xform_system_state {
  */
 static void ensure_allocated(xform_system_state* state, u32 slot_count);
 static void dirty_list_reset(xform_system_state* state);
+static void local_matrix_calculate(xform_system_state* state, u32 index);
 static void dirty_list_add(xform_system_state* state, khandle t);
 static khandle handle_create(xform_system_state* state);
 static void handle_destroy(xform_system_state* state, khandle* t);
@@ -117,11 +135,38 @@ void xform_system_shutdown(void* state) {
             kfree_aligned(typed_state->local_dirty_handles, sizeof(u32) * typed_state->allocated, 16, MEMORY_TAG_TRANSFORM);
             typed_state->local_dirty_handles = 0;
         }
+        if (typed_state->flags) {
+            kfree_aligned(typed_state->flags, sizeof(u8) * typed_state->allocated, 16, MEMORY_TAG_TRANSFORM);
+            typed_state->flags = 0;
+        }
+        if (typed_state->local_versions) {
+            kfree_aligned(typed_state->local_versions, sizeof(u32) * typed_state->allocated, 16, MEMORY_TAG_TRANSFORM);
+            typed_state->local_versions = 0;
+        }
+        if (typed_state->world_versions) {
+            kfree_aligned(typed_state->world_versions, sizeof(u32) * typed_state->allocated, 16, MEMORY_TAG_TRANSFORM);
+            typed_state->world_versions = 0;
+        }
     }
 }
 
 b8 xform_system_update(void* state, struct frame_data* p_frame_data) {
-    // TODO: update locals for dirty xforms, reset list.
+    xform_system_state* typed_state = state;
+
+    // Update locals for xforms which are still dirty. Some may have been calculated on demand already.
+    // The list is thrown away afterward, so compact it in place to build the batch.
+    u32 batch_count = 0;
+    for (u32 i = 0; i < typed_state->local_dirty_count; ++i) {
+        u32 index = typed_state->local_dirty_handles[i];
+        if (typed_state->flags[index] & XFORM_FLAG_LOCAL_DIRTY) {
+            typed_state->local_dirty_handles[batch_count] = index;
+            batch_count++;
+        }
+        typed_state->flags[index] &= ~(XFORM_FLAG_LOCAL_DIRTY | XFORM_FLAG_QUEUED);
+    }
+    mat4_compose_trs_batch(batch_count, typed_state->local_dirty_handles, typed_state->positions, typed_state->rotations, typed_state->scales, typed_state->local_matrices);
+
+    typed_state->local_dirty_count = 0;
     return true;
 }
 
@@ -358,17 +403,73 @@ void xform_translate_rotate(khandle t, vec3 translation, quat rotation) {
 void xform_calculate_local(khandle t) {
     xform_system_state* state = engine_systems_get()->xform_system;
     if (!khandle_is_invalid(t)) {
-        u32 index = t.handle_index;
-        // TODO: investigate mat4_from_translation_rotation_scale
-        state->local_matrices[index] = mat4_mul(quat_to_mat4(state->rotations[index]), mat4_translation(state->positions[index]));
-        state->local_matrices[index] = mat4_mul(mat4_scale(state->scales[index]), state->local_matrices[index]);
+        // Nothing to do if the local values haven't changed since the last calculation.
+        if (state->flags[t.handle_index] & XFORM_FLAG_LOCAL_DIRTY) {
+            local_matrix_calculate(state, t.handle_index);
+        }
     }
 }
 
+void xform_world_update_batch(u32 count, const khandle* xforms, const khandle* parents) {
+    xform_system_state* state = engine_systems_get()->xform_system;
+
+    u32 local_indices[XFORM_BATCH_SIZE];
+    u32 child_indices[XFORM_BATCH_SIZE];
+    u32 parent_indices[XFORM_BATCH_SIZE];
+    for (u32 start = 0; start < count; start += XFORM_BATCH_SIZE) {
+        u32 end = KMIN(start + XFORM_BATCH_SIZE, count);
+        u32 local_count = 0;
+        u32 child_count = 0;
+        for (u32 i = start; i < end; ++i) {
+            u32 index = xforms[i].handle_index;
+            if (state->flags[index] & XFORM_FLAG_LOCAL_DIRTY) {
+                state->flags[index] &= ~XFORM_FLAG_LOCAL_DIRTY;
+                local_indices[local_count] = index;
+                local_count++;
+            }
+        }
+
+        // Bring the local matrices up to date first.
+        mat4_compose_trs_batch(local_count, local_indices, state->positions, state->rotations, state->scales, state->local_matrices);
+
+        for (u32 i = start; i < end; ++i) {
+            u32 index = xforms[i].handle_index;
+            state->world_versions[index]++;
+            if (parents && !khandle_is_invalid(parents[i])) {
+                child_indices[child_count] = index;
+                parent_indices[child_count] = parents[i].handle_index;
+                child_count++;
+            } else {
+                // Without a parent, world is the same as local.
+                state->world_matrices[index] = state->local_matrices[index];
+            }
+        }
+
+        mat4_mul_batch(child_count, child_indices, state->local_matrices, parent_indices, state->world_matrices, state->world_matrices);
+    }
+}
+
+u32 xform_local_version_get(khandle t) {
+    xform_system_state* state = engine_systems_get()->xform_system;
+    if (khandle_is_invalid(t)) {
+        return 0;
+    }
+    return state->local_versions[t.handle_index];
+}
+
+u32 xform_world_version_get(khandle t) {
+    xform_system_state* state = engine_systems_get()->xform_system;
+    if (khandle_is_invalid(t)) {
+        return 0;
+    }
+    return state->world_versions[t.handle_index];
+}
+
 void xform_world_set(khandle t, mat4 world) {
     xform_system_state* state = engine_systems_get()->xform_system;
     if (!khandle_is_invalid(t)) {
         state->world_matrices[t.handle_index] = world;
+        state->world_versions[t.handle_index]++;
     }
 }
 
@@ -541,6 +642,10 @@ static void ensure_allocated(xform_system_state* state, u32 slot_count) {
             kfree_aligned(state->ids, sizeof(identifier) * state->allocated, 16, MEMORY_TAG_TRANSFORM);
         }
         state->ids = new_ids;
+        // Invalidate all new entries so they are seen as free slots.
+        for (u32 i = state->allocated; i < slot_count; ++i) {
+            state->ids[i].uniqueid = INVALID_ID_U64;
+        }
 
         // Dirty handle list doesn't *need* to be aligned, but do it anyways since everything else is.
         u32* new_dirty_handles = kallocate_aligned(sizeof(u32) * slot_count, 16, MEMORY_TAG_TRANSFORM);
@@ -550,6 +655,27 @@ static void ensure_allocated(xform_system_state* state, u32 slot_count) {
         }
         state->local_dirty_handles = new_dirty_handles;
 
+        u8* new_flags = kallocate_aligned(sizeof(u8) * slot_count, 16, MEMORY_TAG_TRANSFORM);
+        if (state->flags) {
+            kcopy_memory(new_flags, state->flags, sizeof(u8) * state->allocated);
+            kfree_aligned(state->flags, sizeof(u8) * state->allocated, 16, MEMORY_TAG_TRANSFORM);
+        }
+        state->flags = new_flags;
+
+        u32* new_local_versions = kallocate_aligned(sizeof(u32) * slot_count, 16, MEMORY_TAG_TRANSFORM);
+        if (state->local_versions) {
+            kcopy_memory(new_local_versions, state->local_versions, sizeof(u32) * state->allocated);
+            kfree_aligned(state->local_versions, sizeof(u32) * state->allocated, 16, MEMORY_TAG_TRANSFORM);
+        }
+        state->local_versions = new_local_versions;
+
+        u32* new_world_versions = kallocate_aligned(sizeof(u32) * slot_count, 16, MEMORY_TAG_TRANSFORM);
+        if (state->world_versions) {
+            kcopy_memory(new_world_versions, state->world_versions, sizeof(u32) * state->allocated);
+            kfree_aligned(state->world_versions, sizeof(u32) * state->allocated, 16, MEMORY_TAG_TRANSFORM);
+        }
+        state->world_versions = new_world_versions;
+
         // Make sure the allocated count is up to date.
         state->allocated = slot_count;
     }
@@ -557,20 +683,27 @@ static void ensure_allocated(xform_system_state* state, u32 slot_count) {
 
 static void dirty_list_reset(xform_system_state* state) {
     for (u32 i = 0; i < state->local_dirty_count; ++i) {
+        state->flags[state->local_dirty_handles[i]] &= ~(XFORM_FLAG_LOCAL_DIRTY | XFORM_FLAG_QUEUED);
         state->local_dirty_handles[i] = INVALID_ID;
     }
     state->local_dirty_count = 0;
 }
 
 static void dirty_list_add(xform_system_state* state, khandle t) {
-    for (u32 i = 0; i < state->local_dirty_count; ++i) {
-        if (state->local_dirty_handles[i] == t.handle_index) {
-            // Already there, do nothing.
-            return;
-        }
+    u32 index = t.handle_index;
+    state->local_versions[index]++;
+    state->flags[index] |= XFORM_FLAG_LOCAL_DIRTY;
+    // The flag avoids searching the list for duplicates.
+    if (!(state->flags[index] & XFORM_FLAG_QUEUED)) {
+        state->flags[index] |= XFORM_FLAG_QUEUED;
+        state->local_dirty_handles[state->local_dirty_count] = index;
+        state->local_dirty_count++;
     }
-    state->local_dirty_handles[state->local_dirty_count] = t.handle_index;
-    state->local_dirty_count++;
+}
+
+static void local_matrix_calculate(xform_system_state* state, u32 index) {
+    mat4_compose_trs_batch(1, &index, state->positions, state->rotations, state->scales, state->local_matrices);
+    state->flags[index] &= ~XFORM_FLAG_LOCAL_DIRTY;
 }
 
 static khandle handle_create(xform_system_state* state) {
@@ -583,6 +716,9 @@ static khandle handle_create(xform_system_state* state) {
             // Found an entry. Fill out the handle, and update the unique_id.uniqueid
             handle = khandle_create(i);
             state->ids[i].uniqueid = handle.unique_id.uniqueid;
+            // A new xform in a reused slot must not look unchanged to anything watching the slot.
+            state->local_versions[i]++;
+            state->world_versions[i]++;
             return handle;
         }
     }
@@ -591,6 +727,8 @@ static khandle handle_create(xform_system_state* state) {
     ensure_allocated(state, state->allocated * 2);
     handle = khandle_create(xform_count);
     state->ids[xform_count].uniqueid = handle.unique_id.uniqueid;
+    state->local_versions[xform_count]++;
+    state->world_versions[xform_count]++;
     return handle;
 }
 
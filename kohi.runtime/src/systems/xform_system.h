@@ -184,10 +184,30 @@ KAPI void xform_position_rotation_scale_set(khandle t, vec3 position, quat rotat
 KAPI void xform_translate_rotate(khandle t, vec3 translation, quat rotation);
 
 /**
- * Recalculates the local matrix for the transform with the given handle.
+ * Recalculates the local matrix for the transform with the given handle, if its
+ * position, rotation or scale have changed since it was last calculated.
  */
 KAPI void xform_calculate_local(khandle t);
 
+/**
+ * @brief Obtains a counter for the given xform which changes whenever its position,
+ * rotation or scale does. Comparing against a previously obtained value is a cheap
+ * way to detect changes without consuming the xform's dirty state.
+ *
+ * @param t A handle to the xform to examine.
+ * @return The current version, or 0 if the handle is invalid.
+ */
+KAPI u32 xform_local_version_get(khandle t);
+
+/**
+ * @brief Obtains a counter for the given xform which changes whenever its world
+ * matrix is set, either directly or by a hierarchy update.
+ *
+ * @param t A handle to the xform to examine.
+ * @return The current version, or 0 if the handle is invalid.
+ */
+KAPI u32 xform_world_version_get(khandle t);
+
 /**
  * @brief Retrieves the local xformation matrix from the provided xform.
  * Automatically recalculates the matrix if it is dirty. Otherwise, the already
@@ -200,6 +220,18 @@ KAPI mat4 xform_local_get(khandle t);
 
 KAPI void xform_world_set(khandle t, mat4 world);
 
+/**
+ * @brief Updates the world matrices of a batch of xforms, recalculating local matrices
+ * first where needed. Each world matrix becomes local * parent world. The parents must
+ * already be up to date and must not be part of the same batch, so a hierarchy should
+ * be processed one level at a time.
+ *
+ * @param count The number of xforms to update.
+ * @param xforms Handles to the xforms to update. Must be valid.
+ * @param parents Handles to the parent of each xform. An invalid handle means the xform has no parent. Pass 0 if none of them do.
+ */
+KAPI void xform_world_update_batch(u32 count, const khandle* xforms, const khandle* parents);
+
 /**
  * @brief Obtains the world matrix of the given xform.
  *
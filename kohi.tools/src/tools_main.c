@@ -1,9 +1,12 @@
 #include <containers/darray.h>
+#include <core_render_types.h>
 #include <defines.h>
 #include <logger.h>
+#include <platform/filesystem.h>
 #include <stdio.h>
 #include <strings/kstring.h>
 #include <utils/crc64.h>
+#include <utils/render_type_utils.h>
 
 // For executing shell commands.
 #include <stdlib.h>
@@ -16,6 +19,7 @@
 
 void print_help(void);
 i32 combine_texture_maps(i32 argc, char** argv);
+i32 build_shaders(i32 argc, char** argv);
 
 // sed -E 's|(KNAME\(\")(.*?)(\"\))|echo "value of: \2"|g' file.c
 // sed -E 's|(KNAME\(\")(.*?)(\"\))|../kohi.tools -crc "\1"|ge' ../kohi.runtime/src/core/metrics.h
@@ -39,6 +43,8 @@ i32 main(i32 argc, char** argv) {
     // The second argument tells us what mode to go into.
     if (strings_equali(argv[1], "combine") || strings_equali(argv[1], "cmaps")) {
         return combine_texture_maps(argc, argv);
+    } else if (strings_equali(argv[1], "buildshaders")) {
+        return build_shaders(argc, argv);
     } else {
         KERROR("Unrecognized argument '%s'.", argv[1]);
         print_help();
@@ -195,6 +201,98 @@ i32 combine_texture_maps(i32 argc, char** argv) {
     return 0;
 }
 
+// Returns the stage named at the end of the given path, i.e. "vert" for "Shader.Foo_vert.glsl".
+static b8 shader_stage_from_path(const char* path, shader_stage* out_stage, const char** out_glslc_stage) {
+    char name[512] = {0};
+    string_filename_no_extension_from_path(name, path);
+    i32 separator = KMAX(string_last_index_of(name, '_'), string_last_index_of(name, '.'));
+    if (separator == -1) {
+        return false;
+    }
+    const char* stage_str = name + separator + 1;
+    if (strings_equali(stage_str, "vert")) {
+        *out_stage = SHADER_STAGE_VERTEX;
+        *out_glslc_stage = "vert";
+    } else if (strings_equali(stage_str, "frag")) {
+        *out_stage = SHADER_STAGE_FRAGMENT;
+        *out_glslc_stage = "frag";
+    } else if (strings_equali(stage_str, "geom")) {
+        *out_stage = SHADER_STAGE_GEOMETRY;
+        *out_glslc_stage = "geom";
+    } else if (strings_equali(stage_str, "comp")) {
+        *out_stage = SHADER_STAGE_COMPUTE;
+        *out_glslc_stage = "comp";
+    } else {
+        return false;
+    }
+    return true;
+}
+
+i32 build_shaders(i32 argc, char** argv) {
+    if (argc < 3) {
+        KERROR("Build shaders mode requires at least one additional argument.");
+        return -3;
+    }
+
+    // tools.exe buildshaders [outdir=[directory]] [filename] [filename] ...
+    // Each file is compiled with glslc (from the Vulkan SDK) into the SPIR-V cache directory,
+    // named by its cache key so the renderer can find it by the source it loads at runtime.
+    const char* out_dir = "spirv_cache";
+    u32 built_count = 0;
+    u32 skipped_count = 0;
+
+    // Starting at third argument. One argument = 1 shader.
+    for (u32 i = 2; i < argc; ++i) {
+        if (string_index_of_str(argv[i], "outdir=") == 0) {
+            out_dir = argv[i] + 7;
+            continue;
+        }
+
+        const char* path = argv[i];
+        shader_stage stage;
+        const char* glslc_stage = 0;
+        if (!shader_stage_from_path(path, &stage, &glslc_stage)) {
+            KERROR("Unable to determine shader stage for '%s'. File names must end in <stage>.glsl, where stage is one of: vert, frag, geom, comp.", path);
+            return -4;
+        }
+
+        const char* source = filesystem_read_entire_text_file(path);
+        if (!source) {
+            KERROR("Failed to read shader source '%s'.", path);
+            return -5;
+        }
+        u64 key = shader_spirv_cache_key(stage, SHADER_SPIRV_COMPILE_OPTIONS, source, string_length(source));
+        string_free(source);
+
+        if (!filesystem_directory_create(out_dir)) {
+            KERROR("Unable to create output directory '%s'.", out_dir);
+            return -6;
+        }
+
+        char* out_path = string_format("%s/%016llx.spv", out_dir, key);
+        // Entries are content-addressed, so an existing one is already up to date.
+        if (filesystem_exists(out_path)) {
+            string_free(out_path);
+            skipped_count++;
+            continue;
+        }
+
+        char* command = string_format("glslc %s -fshader-stage=%s -o \"%s\" \"%s\"", SHADER_SPIRV_COMPILE_OPTIONS, glslc_stage, out_path, path);
+        KINFO("Compiling '%s' -> '%s'...", path, out_path);
+        i32 result = system(command);
+        string_free(command);
+        string_free(out_path);
+        if (result != 0) {
+            KERROR("glslc failed to compile '%s' (exit code %d).", path, result);
+            return -7;
+        }
+        built_count++;
+    }
+
+    KINFO("Successfully built %u shaders (%u already up to date).", built_count, skipped_count);
+    return 0;
+}
+
 void print_help(void) {
 #ifdef KPLATFORM_WINDOWS
     const char* extension = ".exe";
@@ -211,6 +309,8 @@ void print_help(void) {
                     should be provided that all end in <stage>.glsl, where <stage> is\n\
                     replaced by one of the following supported stages:\n\
                         vert, frag, geom, comp\n\
-                    The compiled .spv file is output to the same path as the input file.\n",
+                    The compiled .spv files are output to the SPIR-V cache directory given\n\
+                    by outdir=[directory] (default: spirv_cache), named by a hash of their\n\
+                    source and compile options. Requires glslc from the Vulkan SDK.\n",
         extension);
 }
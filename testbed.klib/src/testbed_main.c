@@ -418,6 +418,7 @@ b8 application_boot(struct application* game_inst) {
     application_config* config = &game_inst->app_config;
 
     config->frame_allocator_size = MEBIBYTES(64);
+    config->frame_allocator_thread_size = MEBIBYTES(8);
     config->app_frame_data_size = sizeof(testbed_application_frame_data);
 
     // Register custom rendergraph nodes, systems, etc.
@@ -1113,6 +1114,11 @@ b8 application_prepare_frame(struct application* app_inst, struct frame_data* p_
                 // Tell it about the directional light.
                 shadow_rendergraph_node_directional_light_set(node, dir_light);
 
+                // Used to snap cascades to whole shadow map texels in light space.
+                f32 shadow_resolution = (f32)shadow_rendergraph_node_resolution_get(node);
+                mat4 light_space = mat4_look_at(vec3_zero(), light_dir, vec3_up());
+                mat4 light_space_inverse = mat4_inverse(light_space);
+
                 // frustum culling_frustum;
                 vec3 culling_center;
                 f32 culling_radius;
@@ -1150,9 +1156,6 @@ b8 application_prepare_frame(struct application* app_inst, struct frame_data* p_
                         center = vec3_add(center, vec3_from_vec4(corners[i]));
                     }
                     center = vec3_div_scalar(center, 8.0f); // size
-                    if (c == MATERIAL_MAX_SHADOW_CASCADES - 1) {
-                        culling_center = center;
-                    }
 
                     // Get the furthest-out point from the center and use that as the extents.
                     f32 radius = 0.0f;
@@ -1160,7 +1163,20 @@ b8 application_prepare_frame(struct application* app_inst, struct frame_data* p_
                         f32 distance = vec3_distance(vec3_from_vec4(corners[i]), center);
                         radius = KMAX(radius, distance);
                     }
+
+                    // Round the radius up, and snap the center to whole texels in light space. This keeps the cascade's
+                    // bounds identical while the camera moves less than a texel (so the shadow node can keep its
+                    // cached static casters), and stops shadow edges from shimmering as the camera moves.
+                    radius = kceil(radius * 16.0f) / 16.0f;
+                    f32 texel_size = (radius * 2.0f) / shadow_resolution;
+                    vec3 light_space_center = vec3_transform(center, 1.0f, light_space);
+                    light_space_center.x = kfloor(light_space_center.x / texel_size) * texel_size;
+                    light_space_center.y = kfloor(light_space_center.y / texel_size) * texel_size;
+                    light_space_center.z = kfloor(light_space_center.z / texel_size) * texel_size;
+                    center = vec3_transform(light_space_center, 1.0f, light_space_inverse);
+
                     if (c == MATERIAL_MAX_SHADOW_CASCADES - 1) {
+                        culling_center = center;
                         culling_radius = radius;
                     }
 